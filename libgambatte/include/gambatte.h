@@ -24,15 +24,11 @@
 #include "serial_io.h"
 #endif
 #include "gbint.h"
+#include "pixelformat.h"
 #include <string>
 #include <cstddef>
 
 namespace gambatte {
-#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
-typedef uint16_t video_pixel_t;
-#else
-typedef uint_least32_t video_pixel_t;
-#endif
 enum { BG_PALETTE = 0, SP1_PALETTE = 1, SP2_PALETTE = 2 };
 
 class GB {
@@ -66,14 +62,14 @@ public:
 	  * The return value indicates whether a new video frame has been drawn, and the
 	  * exact time (in number of samples) at which it was drawn.
 	  *
-	  * @param videoBuf 160x144 RGB32 (native endian) video frame buffer or 0
+	  * @param videoBuf 160x144 video frame buffer in the format set with setPixelFormat, or 0
 	  * @param pitch distance in number of pixels (not bytes) from the start of one line to the next in videoBuf.
 	  * @param soundBuf buffer with space >= samples + 2064
 	  * @param soundBufSize actual size of soundBuf buffer
 	  * @param samples in: number of stereo samples to produce, out: actual number of samples produced
 	  * @return sample number at which the video frame was produced. -1 means no frame was produced.
 	  */
-	long runFor(gambatte::video_pixel_t *videoBuf, int pitch,
+	long runFor(void *videoBuf, int pitch,
 			gambatte::uint_least32_t *soundBuf, std::size_t soundBufSize, unsigned &samples);
 	
 	/** Reset to initial state.
@@ -83,9 +79,16 @@ public:
 	
 	/** @param palNum 0 <= palNum < 3. One of BG_PALETTE, SP1_PALETTE and SP2_PALETTE.
 	  * @param colorNum 0 <= colorNum < 4
+	  * @param rgb32 colour packed in the current pixel format
 	  */
 	void setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned rgb32);
 
+	/** Sets the format of the pixels written to the video buffer (PIXEL_RGB565 by default).
+	  * Resets the DMG palette colours to their defaults, as colours set earlier were packed
+	  * in the previous format.
+	  */
+	void setPixelFormat(PixelFormat format);
+
 	/** Sets the callback used for getting input state. */
 	void setInputGetter(InputGetter *getInput);
    
@@ -102,6 +105,22 @@ public:
 
    void *savedata_ptr();
    unsigned savedata_size();
+
+   /** Size, in bytes, of the blocks in which changes to battery RAM are tracked. */
+   enum { SAVEDATA_BLOCK_SIZE = 0x200 };
+
+   /** Returns true if battery RAM has changed since it was last collected by savedata_dirty_ranges(). */
+   bool savedata_dirty();
+
+   /** Collects the parts of battery RAM changed since the last call, and marks them clean.
+     * Each range is a run of SAVEDATA_BLOCK_SIZE byte blocks, relative to savedata_ptr().
+     * Writes that leave a byte unchanged do not count, and neither do changes made
+     * through savedata_ptr() or by reset(). loadState() marks all of battery RAM as changed.
+     *
+     * @return Number of ranges stored (at most maxRanges). Ranges that do not fit are
+     *         left for the next call.
+     */
+   unsigned savedata_dirty_ranges(unsigned *offsets, unsigned *sizes, unsigned maxRanges);
    void *rtcdata_ptr();
    unsigned rtcdata_size();
 	
@@ -111,10 +130,20 @@ public:
 	/** Returns true if a ROM image is loaded. */
 	bool isLoaded() const;
 	
+	/** Returns true while the boot ROM is running, that is until it
+	  * unmaps itself by writing to FF50. Always false without a boot ROM.
+	  */
+	bool isBooting() const;
+	
    void saveState(void *data);
    void loadState(const void *data);
    size_t stateSize() const;
 
+   /** Compares two savestates of the given size, field by field.
+     * @return Label of the first differing field, or NULL if the states are identical.
+     */
+   static const char * stateDiff(const void *a, const void *b, size_t size);
+
    void setColorCorrection(bool enable);
    void setColorCorrectionMode(unsigned colorCorrectionMode);
    void setColorCorrectionBrightness(float colorCorrectionBrightness);
@@ -127,11 +156,24 @@ public:
    void setGameGenie(const std::string &codes);
 
    /** Set Game Shark codes to apply to currently loaded ROM image. Cleared on ROM load.
-    * @param codes Game Shark codes in format 01HHHHHH;01HHHHHH;... where H is [0-9]|[A-F]
+    * @param codes Game Shark codes in format TTHHHHHH;TTHHHHHH;... where H is [0-9]|[A-F], and
+    *              TT is 01, or 8x/9x to write to RAM bank x whether or not it is mapped
+    *              (cartridge RAM at 0xA000-0xBFFF, CGB WRAM at 0xD000-0xDFFF)
     */
    void setGameShark(const std::string &codes);
 
+   /** Game Shark codes are applied once per frame (at VBlank). When freeze is enabled,
+     * codes writing to WRAM or to a specific cartridge RAM bank are also re-applied
+     * whenever the game writes to their address.
+     */
+   void setGameSharkFreeze(bool enable);
+
    void clearCheats();
+
+   /** Runs ROM code through the dynamic recompiler, where it is built in (HAVE_JIT
+     * on x86-64). Emulation is identical either way. Enabled by default.
+     */
+   void setRecompilerEnabled(bool enable);
    
 #ifdef __LIBRETRO__
    void *vram_ptr() const;
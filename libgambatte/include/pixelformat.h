@@ -0,0 +1,75 @@
+#ifndef GAMBATTE_PIXELFORMAT_H
+#define GAMBATTE_PIXELFORMAT_H
+
+#include "gbint.h"
+
+namespace gambatte {
+
+/** A colour packed in the output pixel format. 16-bit formats use the low half. */
+typedef uint_least32_t video_pixel_t;
+
+/** Pixel formats the core can render in. Chosen at run time with GB::setPixelFormat. */
+enum PixelFormat {
+	PIXEL_RGB565,   /**< 16 bits, red in the high bits. Green gets 5 significant bits. */
+	PIXEL_ABGR1555, /**< 16 bits, red in the low bits (PS2 GS) */
+	PIXEL_XRGB8888  /**< 32 bits, red in bits 16-23 */
+};
+
+/** Compile-time descriptions of each pixel format, for kernels templated on the format.
+  * Channels unpack to [0, channel_max] with (pixel >> x_shift & channel_max).
+  * mix_lsb has the lowest bit of each channel set, for averaging two pixels without
+  * unpacking them ("Mixing Packed RGB Pixels Efficiently", blargg).
+  */
+struct PixelRgb565 {
+	typedef uint_least16_t pixel_t;
+	enum { format = PIXEL_RGB565 };
+	enum { red_shift = 11, green_shift = 6, blue_shift = 0, channel_max = 0x1F };
+	enum { mix_lsb = 0x821 };
+
+	static video_pixel_t fromRgb555(unsigned r, unsigned g, unsigned b) {
+		return r << 11 | g << 6 | b;
+	}
+
+	static video_pixel_t fromRgb888(unsigned long rgb) {
+		return (rgb & 0x0000F8) >> 3 | (rgb & 0x00FC00) >> 5 | (rgb & 0xF80000) >> 8;
+	}
+};
+
+struct PixelAbgr1555 {
+	typedef uint_least16_t pixel_t;
+	enum { format = PIXEL_ABGR1555 };
+	enum { red_shift = 0, green_shift = 5, blue_shift = 10, channel_max = 0x1F };
+	enum { mix_lsb = 0x521 };
+
+	static video_pixel_t fromRgb555(unsigned r, unsigned g, unsigned b) {
+		return b << 10 | g << 5 | r;
+	}
+
+	static video_pixel_t fromRgb888(unsigned long rgb) {
+		return (rgb & 0x0000F8) << 7 | (rgb & 0x00F800) >> 6 | (rgb & 0xF80000) >> 19;
+	}
+};
+
+struct PixelXrgb8888 {
+	typedef uint_least32_t pixel_t;
+	enum { format = PIXEL_XRGB8888 };
+	enum { red_shift = 16, green_shift = 8, blue_shift = 0, channel_max = 0xFF };
+	enum { mix_lsb = 0x10101 };
+
+	static video_pixel_t fromRgb555(unsigned r, unsigned g, unsigned b) {
+		return (r << 3 | r >> 2) << 16 | (g << 3 | g >> 2) << 8 | (b << 3 | b >> 2);
+	}
+
+	static video_pixel_t fromRgb888(unsigned long rgb) {
+		return rgb & 0xFFFFFF;
+	}
+};
+
+/** Bytes per pixel in the video buffer */
+inline unsigned pixelSize(PixelFormat format) {
+	return format == PIXEL_XRGB8888 ? sizeof(PixelXrgb8888::pixel_t) : sizeof(PixelRgb565::pixel_t);
+}
+
+}
+
+#endif
@@ -0,0 +1,346 @@
+#include "benchmark.h"
+#include "video/next_m0_time.h"
+#include "video/ppu.h"
+#include "sound.h"
+
+#include <cstdio>
+#include <ctime>
+
+#ifndef BENCHMARK_MIN_BATCH_US
+#define BENCHMARK_MIN_BATCH_US 20000
+#endif
+#ifndef BENCHMARK_BATCHES
+#define BENCHMARK_BATCHES 5
+#endif
+
+using namespace gambatte;
+
+namespace {
+
+// Fills the synthetic inputs, the same way on every run
+class Rng {
+	public:
+		explicit Rng(unsigned seed) : state_(seed) {}
+
+		unsigned next() {
+			state_ = (state_ * 1103515245ul + 12345) & 0xFFFFFFFF;
+			return state_ >> 8 & 0xFFFFFF;
+		}
+
+	private:
+		unsigned long state_;
+};
+
+static video_pixel_t packColor(PixelFormat format, unsigned long rgb)
+{
+	switch (format) {
+		case PIXEL_XRGB8888:
+			return PixelXrgb8888::fromRgb888(rgb);
+		case PIXEL_ABGR1555:
+			return PixelAbgr1555::fromRgb888(rgb);
+		default:
+			return PixelRgb565::fromRgb888(rgb);
+	}
+}
+
+// A busy line 0: random tiles and (for CGB) attributes, and
+// the 10 sprites a line can hold, spread across it
+struct PpuBench {
+	unsigned char vram[0x4000];
+	unsigned char oam[0xA0];
+	PixelXrgb8888::pixel_t line[160];
+	NextM0Time nextM0Time;
+	PPU ppu;
+	unsigned lcdc;
+
+	PpuBench(bool cgb, bool sprites, PixelFormat format);
+};
+
+PpuBench::PpuBench(bool cgb, bool sprites, PixelFormat format)
+: ppu(nextM0Time, oam, vram)
+, lcdc(sprites ? 0x93 : 0x91)
+{
+	Rng rng(cgb ? 2 : 1);
+
+	for (unsigned i = 0; i < sizeof vram; ++i)
+		vram[i] = rng.next() & 0xFF;
+
+	// No BG-to-OAM priority in the CGB attribute map
+	for (unsigned i = 0x3800; i < 0x4000; ++i)
+		vram[i] &= 0x7F;
+
+	for (unsigned i = 0; i < sizeof oam; i += 4) {
+		unsigned n = i / 4;
+		oam[i    ] = n < 10 ? 16 - (n & 7) : 0;
+		oam[i + 1] = n < 10 ? 8 + n * 16 : 0;
+		oam[i + 2] = rng.next() & 0xFF;
+		oam[i + 3] = rng.next() & 0xFF;
+	}
+
+	for (unsigned i = 0; i < 8 * 4; ++i) {
+		ppu.bgPalette()[i] = packColor(format, rng.next());
+		ppu.spPalette()[i] = packColor(format, rng.next());
+	}
+
+	ppu.setPixelFormat(format);
+	ppu.setFrameBuf(line, 160);
+	ppu.reset(oam, vram, cgb);
+	ppu.doSpriteMapEvent(1);
+}
+
+static void ppuLine(void *data)
+{
+	PpuBench *b = static_cast<PpuBench *>(data);
+	b->ppu.drawBenchmarkLine(b->lcdc);
+}
+
+// 40 sprites, staggered down the screen
+struct SpriteMapperBench {
+	unsigned char oam[0xA0];
+	NextM0Time nextM0Time;
+	LyCounter lyCounter;
+	SpriteMapper mapper;
+
+	SpriteMapperBench();
+};
+
+SpriteMapperBench::SpriteMapperBench()
+: mapper(nextM0Time, lyCounter, oam)
+{
+	for (unsigned i = 0; i < sizeof oam; i += 4) {
+		oam[i    ] = 16 + i;
+		oam[i + 1] = 8 + i;
+		oam[i + 2] = i / 4;
+		oam[i + 3] = 0;
+	}
+
+	mapper.reset(oam, false);
+}
+
+static void mapSprites(void *data)
+{
+	// The OAM reader is up to date, so this only remaps
+	static_cast<SpriteMapperBench *>(data)->mapper.doEvent(1);
+}
+
+// One frame of samples, with both square channels and the
+// noise channel playing
+enum { psg_frame_samples = 70224 / 2 };
+
+struct PsgBench {
+	PSG psg;
+	uint_least32_t buf[psg_frame_samples];
+	unsigned long cc;
+
+	PsgBench();
+	void generate();
+};
+
+PsgBench::PsgBench()
+: cc(0)
+{
+	psg.init(false);
+	psg.reset();
+	psg.setEnabled(true);
+	psg.setSoVolume(0x77);
+	psg.mapSo(0xFF);
+	psg.setNr11(0x80);
+	psg.setNr12(0xF0);
+	psg.setNr13(0x00);
+	psg.setNr14(0x86);
+	psg.setNr21(0x40);
+	psg.setNr22(0xA0);
+	psg.setNr23(0x80);
+	psg.setNr24(0x87);
+	psg.setNr42(0xF0);
+	psg.setNr43(0x32);
+	psg.setNr44(0x80);
+	generate();
+}
+
+void PsgBench::generate()
+{
+	psg.setBuffer(buf, psg_frame_samples);
+	cc += psg_frame_samples * 2;
+	psg.generateSamples(cc, false);
+}
+
+static void psgGenerate(void *data)
+{
+	static_cast<PsgBench *>(data)->generate();
+}
+
+static void psgFill(void *data)
+{
+	// Sums the same (already summed) frame over and over,
+	// which costs the same as summing a fresh one
+	static_cast<PsgBench *>(data)->psg.fillBuffer();
+}
+
+static void appendJsonString(std::string &out, const std::string &s)
+{
+	out += '"';
+	for (std::size_t i = 0; i < s.size(); ++i) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (c < 0x20) {
+			char esc[8];
+			snprintf(esc, sizeof esc, "\\u%04x", c);
+			out += esc;
+		} else
+			out += c;
+	}
+	out += '"';
+}
+
+} // anon namespace
+
+Benchmark::Benchmark(const struct retro_perf_callback *perf)
+: getTime_(perf ? perf->get_time_usec : 0)
+, getCounter_(perf ? perf->get_perf_counter : 0)
+{
+}
+
+void Benchmark::setInfo(const char *key, const std::string &value)
+{
+	info_.push_back(std::make_pair(std::string(key), value));
+}
+
+retro_time_t Benchmark::timeUsec() const
+{
+	if (getTime_)
+		return getTime_();
+
+	return static_cast<retro_time_t>(std::clock()) * 1000000 / CLOCKS_PER_SEC;
+}
+
+void Benchmark::run(const char *name, Kernel kernel, void *data, std::size_t bytes)
+{
+	Result r;
+	unsigned long calls = 1;
+
+	// Warms up the caches, then doubles the batch until it is
+	// long enough to time
+	kernel(data);
+	for (;;) {
+		retro_time_t start = timeUsec();
+		for (unsigned long i = 0; i < calls; ++i)
+			kernel(data);
+
+		if (timeUsec() - start >= BENCHMARK_MIN_BATCH_US || calls >= 1ul << 30)
+			break;
+
+		calls <<= 1;
+	}
+
+	r.name = name;
+	r.calls = calls;
+	r.nsPerCall = -1;
+	r.ticksPerCall = 0;
+	r.bytes = bytes;
+
+	for (unsigned n = 0; n < BENCHMARK_BATCHES; ++n) {
+		retro_perf_tick_t ticks = getCounter_ ? getCounter_() : 0;
+		retro_time_t start = timeUsec();
+
+		for (unsigned long i = 0; i < calls; ++i)
+			kernel(data);
+
+		retro_time_t usec = timeUsec() - start;
+		ticks = getCounter_ ? getCounter_() - ticks : 0;
+
+		double ns = usec * 1000.0 / calls;
+		if (r.nsPerCall < 0 || ns < r.nsPerCall) {
+			r.nsPerCall = ns;
+			r.ticksPerCall = static_cast<double>(ticks) / calls;
+		}
+	}
+
+	results_.push_back(r);
+}
+
+void Benchmark::runCoreKernels(PixelFormat format)
+{
+	static const struct {
+		const char *name;
+		bool cgb;
+		bool sprites;
+	} scenes[] = {
+		{ "doFullTilesUnrolledDmg",         false, false },
+		{ "doFullTilesUnrolledDmg+sprites", false, true  },
+		{ "doFullTilesUnrolledCgb",         true,  false },
+		{ "doFullTilesUnrolledCgb+sprites", true,  true  }
+	};
+
+	for (std::size_t i = 0; i < sizeof scenes / sizeof scenes[0]; ++i) {
+		PpuBench *ppu = new PpuBench(scenes[i].cgb, scenes[i].sprites, format);
+		run(scenes[i].name, ppuLine, ppu, 160 * pixelSize(format));
+		delete ppu;
+	}
+
+	SpriteMapperBench *mapper = new SpriteMapperBench;
+	run("SpriteMapper::mapSprites", mapSprites, mapper, sizeof mapper->oam);
+	delete mapper;
+
+	PsgBench *psg = new PsgBench;
+	run("PSG::generateSamples", psgGenerate, psg, sizeof psg->buf);
+	run("PSG::fillBuffer", psgFill, psg, sizeof psg->buf);
+	delete psg;
+}
+
+std::string Benchmark::json() const
+{
+	std::string out = "{\n  \"info\": {";
+	char buf[256];
+
+	for (std::size_t i = 0; i < info_.size(); ++i) {
+		out += i ? ",\n    " : "\n    ";
+		appendJsonString(out, info_[i].first);
+		out += ": ";
+		appendJsonString(out, info_[i].second);
+	}
+
+	out += info_.empty() ? "},\n  \"results\": [" : "\n  },\n  \"results\": [";
+
+	for (std::size_t i = 0; i < results_.size(); ++i) {
+		Result const &r = results_[i];
+
+		out += i ? ",\n    { \"name\": " : "\n    { \"name\": ";
+		appendJsonString(out, r.name);
+
+		snprintf(buf, sizeof buf,
+				", \"calls\": %lu, \"ns_per_call\": %.3f, \"bytes_per_call\": %lu, \"mb_per_s\": %.3f",
+				r.calls, r.nsPerCall, static_cast<unsigned long>(r.bytes),
+				r.nsPerCall > 0 ? r.bytes * 1000.0 / r.nsPerCall : 0.0);
+		out += buf;
+
+		// Only meaningful if the frontend has a tick counter
+		if (r.ticksPerCall > 0)
+			snprintf(buf, sizeof buf, ", \"ticks_per_call\": %.3f, \"bytes_per_tick\": %.4f }",
+					r.ticksPerCall, r.bytes / r.ticksPerCall);
+		else
+			snprintf(buf, sizeof buf, ", \"ticks_per_call\": null, \"bytes_per_tick\": null }");
+		out += buf;
+	}
+
+	out += results_.empty() ? "]\n}\n" : "\n  ]\n}\n";
+	return out;
+}
+
+std::string Benchmark::summary(std::size_t index) const
+{
+	Result const &r = results_[index];
+	char buf[256];
+
+	if (r.ticksPerCall > 0)
+		snprintf(buf, sizeof buf, "%s: %.1f ns/call, %.1f ticks/call, %.3f bytes/tick",
+				r.name.c_str(), r.nsPerCall, r.ticksPerCall, r.bytes / r.ticksPerCall);
+	else
+		snprintf(buf, sizeof buf, "%s: %.1f ns/call, %.1f MB/s",
+				r.name.c_str(), r.nsPerCall,
+				r.nsPerCall > 0 ? r.bytes * 1000.0 / r.nsPerCall : 0.0);
+
+	return buf;
+}
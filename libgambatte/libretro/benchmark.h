@@ -0,0 +1,66 @@
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <libretro.h>
+#include "pixelformat.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Kernel microbenchmarks, built in with BENCHMARK=1.
+//
+// Each kernel is called on synthetic input sized like one frame's
+// worth of work (one line for the PPU), in batches that are grown
+// until a batch takes at least BENCHMARK_MIN_BATCH_US. The fastest
+// of BENCHMARK_BATCHES batches is kept, as the time per call, the
+// frontend's perf counter ticks per call (CPU cycles on most
+// platforms) and the bytes processed per call, so that throughput
+// in bytes per cycle can be compared across SoCs.
+//
+// Results are written out as JSON, for comparing runs across
+// commits and devices.
+class Benchmark
+{
+	public:
+		typedef void (*Kernel)(void *data);
+
+		// 'perf' may be NULL, or have NULL members, if the
+		// frontend has no perf interface
+		explicit Benchmark(const struct retro_perf_callback *perf);
+
+		// Adds a string to the "info" object of the JSON output
+		void setInfo(const char *key, const std::string &value);
+
+		// Times 'kernel', which processes 'bytes' bytes per call
+		void run(const char *name, Kernel kernel, void *data, std::size_t bytes);
+
+		// The core's own kernels, on internal synthetic state:
+		// PPU full tile loop (DMG and CGB, with and without
+		// sprites), sprite mapping and PSG sample generation
+		void runCoreKernels(gambatte::PixelFormat format);
+
+		std::string json() const;
+
+		// One line per result, for the log
+		std::string summary(std::size_t index) const;
+		std::size_t numResults() const { return results_.size(); }
+
+	private:
+		struct Result {
+			std::string name;
+			unsigned long calls;
+			double nsPerCall;
+			double ticksPerCall;
+			std::size_t bytes;
+		};
+
+		retro_perf_get_time_usec_t getTime_;
+		retro_perf_get_counter_t getCounter_;
+		std::vector<std::pair<std::string, std::string> > info_;
+		std::vector<Result> results_;
+
+		retro_time_t timeUsec() const;
+};
+
+#endif
@@ -412,6 +412,73 @@ void blipper_push_samples(blipper_t *blip, const blipper_sample_t *data,
 #endif
 }
 
+void blipper_push_samples_stereo(blipper_t *left, blipper_t *right,
+      const blipper_sample_t *data, unsigned samples)
+{
+   unsigned s = 0;
+   /* Frames pushed up to, biased by one so that the first
+    * delta is pushed s + 1 clocks on, as in blipper_push_samples() */
+   unsigned pushed_l = 0;
+   unsigned pushed_r = 0;
+   blipper_sample_t last_l = left->last_sample;
+   blipper_sample_t last_r = right->last_sample;
+
+#if BLIPPER_LOG_PERFORMANCE
+   double t0 = get_time();
+#endif
+
+   for (;;)
+   {
+      blipper_sample_t l, r;
+
+      /* One test per frame */
+      while (s < samples && !((data[0] ^ last_l) | (data[1] ^ last_r)))
+      {
+         s++;
+         data += 2;
+      }
+
+      if (s == samples)
+         break;
+
+      l = data[0];
+      r = data[1];
+
+      if (l != last_l)
+      {
+         blipper_push_delta(left, (blipper_long_sample_t)l - (blipper_long_sample_t)last_l,
+               s + 1 - pushed_l);
+         pushed_l = s + 1;
+         last_l = l;
+      }
+
+      if (r != last_r)
+      {
+         blipper_push_delta(right, (blipper_long_sample_t)r - (blipper_long_sample_t)last_r,
+               s + 1 - pushed_r);
+         pushed_r = s + 1;
+         last_r = r;
+      }
+
+      s++;
+      data += 2;
+   }
+
+   left->phase += samples - pushed_l;
+   left->output_avail = (left->phase + left->phases - 1) >> left->phases_log2;
+   left->last_sample = last_l;
+
+   right->phase += samples - pushed_r;
+   right->output_avail = (right->phase + right->phases - 1) >> right->phases_log2;
+   right->last_sample = last_r;
+
+#if BLIPPER_LOG_PERFORMANCE
+   left->total_time += get_time() - t0;
+   left->total_samples += samples;
+   right->total_samples += samples;
+#endif
+}
+
 unsigned blipper_read_avail(blipper_t *blip)
 {
    return blip->output_avail;
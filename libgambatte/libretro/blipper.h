@@ -147,6 +147,14 @@ void blipper_push_delta(blipper_t *blip, blipper_long_sample_t delta, unsigned c
 void blipper_push_samples(blipper_t *blip, const blipper_sample_t *delta,
       unsigned samples, unsigned stride);
 
+/* Same as blipper_push_samples() with a stride of 2, for left and
+ * right, but reads the interleaved stereo data only once. Runs of
+ * frames where neither channel changes are skipped over together.
+ */
+#define blipper_push_samples_stereo BLIPPER_MANGLE(blipper_push_samples_stereo)
+void blipper_push_samples_stereo(blipper_t *left, blipper_t *right,
+      const blipper_sample_t *data, unsigned samples);
+
 /* Returns the number of samples available for reading using
  * blipper_read().
  */
@@ -0,0 +1,292 @@
+#include "cheat_search.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CHEAT_SEARCH_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CHEAT_SEARCH_NEON
+#endif
+
+namespace {
+
+struct Params {
+	CheatSearch::Compare op;
+	bool wide;
+	// Constant to compare with, when there is no snapshot
+	unsigned value;
+	// Added to snapshot values
+	unsigned delta;
+};
+
+// Returns a mask of the offsets in the block at 'cur' whose value
+// passes the comparison with the same offset in 'prev' (or with
+// p.value if 'prev' is NULL). 16-bit values are compared as pairs
+// of bytes (the low byte at the offset, the high byte after it),
+// so all the work is done in byte lanes.
+#if defined(CHEAT_SEARCH_SSE2)
+
+static unsigned compareBlock(const unsigned char *cur, const unsigned char *prev, const Params &p)
+{
+	// SSE2 only has signed byte compares
+	const __m128i bias = _mm_set1_epi8(-0x80);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i clo = _mm_loadu_si128((const __m128i *)cur);
+	__m128i chi = p.wide ? _mm_loadu_si128((const __m128i *)(cur + 1)) : zero;
+	__m128i rlo, rhi;
+
+	if (prev) {
+		rlo = _mm_loadu_si128((const __m128i *)prev);
+		rhi = p.wide ? _mm_loadu_si128((const __m128i *)(prev + 1)) : zero;
+
+		if (p.delta) {
+			__m128i sum = _mm_add_epi8(rlo, _mm_set1_epi8((char)(p.delta & 0xFF)));
+			if (p.wide) {
+				// Carry (0xFF) where the low byte wrapped around
+				__m128i carry = _mm_cmplt_epi8(_mm_xor_si128(sum, bias), _mm_xor_si128(rlo, bias));
+				rhi = _mm_sub_epi8(_mm_add_epi8(rhi, _mm_set1_epi8((char)(p.delta >> 8 & 0xFF))), carry);
+			}
+			rlo = sum;
+		}
+	} else {
+		rlo = _mm_set1_epi8((char)(p.value & 0xFF));
+		rhi = p.wide ? _mm_set1_epi8((char)(p.value >> 8 & 0xFF)) : zero;
+	}
+
+	__m128i eqHi = _mm_cmpeq_epi8(chi, rhi);
+	__m128i eq = _mm_and_si128(_mm_cmpeq_epi8(clo, rlo), eqHi);
+	__m128i mask;
+
+	clo = _mm_xor_si128(clo, bias);
+	chi = _mm_xor_si128(chi, bias);
+	rlo = _mm_xor_si128(rlo, bias);
+	rhi = _mm_xor_si128(rhi, bias);
+
+	switch (p.op) {
+		case CheatSearch::EQUAL:
+			mask = eq;
+			break;
+		case CheatSearch::NOT_EQUAL:
+			mask = _mm_xor_si128(eq, _mm_set1_epi8(-1));
+			break;
+		case CheatSearch::LESS:
+			mask = _mm_or_si128(_mm_cmplt_epi8(chi, rhi),
+					_mm_and_si128(eqHi, _mm_cmplt_epi8(clo, rlo)));
+			break;
+		default:
+			mask = _mm_or_si128(_mm_cmpgt_epi8(chi, rhi),
+					_mm_and_si128(eqHi, _mm_cmpgt_epi8(clo, rlo)));
+			break;
+	}
+
+	return _mm_movemask_epi8(mask);
+}
+
+#elif defined(CHEAT_SEARCH_NEON)
+
+static unsigned movemask(uint8x16_t mask)
+{
+	static const unsigned char weights[16] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+	};
+	uint8x16_t bits = vandq_u8(mask, vld1q_u8(weights));
+	uint8x8_t lo = vget_low_u8(bits);
+	uint8x8_t hi = vget_high_u8(bits);
+
+	lo = vpadd_u8(lo, hi);
+	lo = vpadd_u8(lo, lo);
+	lo = vpadd_u8(lo, lo);
+	return vget_lane_u8(lo, 0) | vget_lane_u8(lo, 1) << 8;
+}
+
+static unsigned compareBlock(const unsigned char *cur, const unsigned char *prev, const Params &p)
+{
+	const uint8x16_t zero = vdupq_n_u8(0);
+	uint8x16_t clo = vld1q_u8(cur);
+	uint8x16_t chi = p.wide ? vld1q_u8(cur + 1) : zero;
+	uint8x16_t rlo, rhi;
+
+	if (prev) {
+		rlo = vld1q_u8(prev);
+		rhi = p.wide ? vld1q_u8(prev + 1) : zero;
+
+		if (p.delta) {
+			uint8x16_t sum = vaddq_u8(rlo, vdupq_n_u8(p.delta & 0xFF));
+			if (p.wide) {
+				// Carry (0xFF) where the low byte wrapped around
+				uint8x16_t carry = vcltq_u8(sum, rlo);
+				rhi = vsubq_u8(vaddq_u8(rhi, vdupq_n_u8(p.delta >> 8 & 0xFF)), carry);
+			}
+			rlo = sum;
+		}
+	} else {
+		rlo = vdupq_n_u8(p.value & 0xFF);
+		rhi = p.wide ? vdupq_n_u8(p.value >> 8 & 0xFF) : zero;
+	}
+
+	uint8x16_t eqHi = vceqq_u8(chi, rhi);
+	uint8x16_t eq = vandq_u8(vceqq_u8(clo, rlo), eqHi);
+	uint8x16_t mask;
+
+	switch (p.op) {
+		case CheatSearch::EQUAL:
+			mask = eq;
+			break;
+		case CheatSearch::NOT_EQUAL:
+			mask = vmvnq_u8(eq);
+			break;
+		case CheatSearch::LESS:
+			mask = vorrq_u8(vcltq_u8(chi, rhi), vandq_u8(eqHi, vcltq_u8(clo, rlo)));
+			break;
+		default:
+			mask = vorrq_u8(vcgtq_u8(chi, rhi), vandq_u8(eqHi, vcgtq_u8(clo, rlo)));
+			break;
+	}
+
+	return movemask(mask);
+}
+
+#else
+
+static unsigned compareBlock(const unsigned char *cur, const unsigned char *prev, const Params &p)
+{
+	const unsigned valueMask = p.wide ? 0xFFFF : 0xFF;
+	unsigned mask = 0;
+
+	for (unsigned i = 0; i < 16; ++i) {
+		unsigned c = p.wide ? cur[i] | cur[i + 1] << 8 : cur[i];
+		unsigned r = prev
+		           ? ((p.wide ? prev[i] | prev[i + 1] << 8 : prev[i]) + p.delta) & valueMask
+		           : p.value;
+		bool keep;
+
+		switch (p.op) {
+			case CheatSearch::EQUAL:     keep = c == r; break;
+			case CheatSearch::NOT_EQUAL: keep = c != r; break;
+			case CheatSearch::LESS:      keep = c <  r; break;
+			default:                     keep = c >  r; break;
+		}
+
+		mask |= keep << i;
+	}
+
+	return mask;
+}
+
+#endif
+
+static unsigned bitCount(unsigned n)
+{
+	unsigned count = 0;
+	for (; n; n &= n - 1)
+		++count;
+	return count;
+}
+
+}
+
+CheatSearch::CheatSearch()
+: count_(0)
+, wide_(false)
+{
+	std::memset(regions_, 0, sizeof regions_);
+}
+
+void CheatSearch::setRegion(Region region, const unsigned char *data, std::size_t size)
+{
+	regions_[region].data = data;
+	regions_[region].size = data ? size : 0;
+}
+
+void CheatSearch::reset(bool wide)
+{
+	std::size_t size = 0;
+
+	for (int i = 0; i < NUM_REGIONS; ++i) {
+		regions_[i].base = size;
+		size += (regions_[i].size + BLOCK_SIZE - 1) & ~std::size_t(BLOCK_SIZE - 1);
+	}
+
+	wide_ = wide;
+	prev_.assign(size + BLOCK_SIZE, 0);
+	cur_.assign(size + BLOCK_SIZE, 0);
+	candidates_.assign(size / BLOCK_SIZE, 0);
+
+	for (int i = 0; i < NUM_REGIONS; ++i) {
+		// 16-bit words may not straddle two regions
+		std::size_t const end = regions_[i].base + regions_[i].size - (wide && regions_[i].size);
+		for (std::size_t n = regions_[i].base; n < end; ++n)
+			candidates_[n / BLOCK_SIZE] |= 1 << (n % BLOCK_SIZE);
+	}
+
+	count_ = 0;
+	for (std::size_t i = 0; i < candidates_.size(); ++i)
+		count_ += bitCount(candidates_[i]);
+
+	snapshot(prev_);
+}
+
+void CheatSearch::filterPrevious(Compare op, int delta)
+{
+	filter(op, true, 0, delta);
+}
+
+void CheatSearch::filterConstant(Compare op, unsigned value)
+{
+	filter(op, false, value & (wide_ ? 0xFFFF : 0xFF), 0);
+}
+
+void CheatSearch::filter(Compare op, bool previous, unsigned value, unsigned delta)
+{
+	Params p;
+	p.op    = op;
+	p.wide  = wide_;
+	p.value = value;
+	p.delta = delta & (wide_ ? 0xFFFF : 0xFF);
+
+	snapshot(cur_);
+	count_ = 0;
+
+	for (std::size_t i = 0; i < candidates_.size(); ++i) {
+		if (!candidates_[i])
+			continue;
+
+		candidates_[i] &= compareBlock(&cur_[i * BLOCK_SIZE],
+				previous ? &prev_[i * BLOCK_SIZE] : 0, p);
+		count_ += bitCount(candidates_[i]);
+	}
+
+	prev_.swap(cur_);
+}
+
+void CheatSearch::snapshot(std::vector<unsigned char> &dst) const
+{
+	for (int i = 0; i < NUM_REGIONS; ++i) {
+		if (regions_[i].size)
+			std::memcpy(&dst[regions_[i].base], regions_[i].data, regions_[i].size);
+	}
+}
+
+std::size_t CheatSearch::results(Result *out, std::size_t max) const
+{
+	std::size_t n = 0;
+
+	for (int r = 0; r < NUM_REGIONS && n < max; ++r) {
+		std::size_t const base = regions_[r].base;
+
+		for (std::size_t offset = 0; offset < regions_[r].size && n < max; ++offset) {
+			std::size_t const i = base + offset;
+			if (!(candidates_[i / BLOCK_SIZE] >> (i % BLOCK_SIZE) & 1))
+				continue;
+
+			out[n].region = Region(r);
+			out[n].offset = offset;
+			out[n].value  = wide_ ? prev_[i] | prev_[i + 1] << 8 : prev_[i];
+			++n;
+		}
+	}
+
+	return n;
+}
@@ -0,0 +1,77 @@
+#ifndef _CHEAT_SEARCH_H
+#define _CHEAT_SEARCH_H
+
+#include <cstddef>
+#include <vector>
+
+// RAM search, for finding the addresses worth cheating on.
+//
+// Keeps a snapshot of the searched regions, and a bitmap of
+// candidates (one bit per byte offset, the value being the
+// byte at that offset, or the little endian 16-bit word
+// starting there). Each filter step compares the current
+// contents of memory with either the snapshot (as taken by
+// the previous step) or a constant, drops the candidates
+// for which the comparison fails, and takes a new snapshot.
+//
+// Comparisons are done 16 offsets at a time (with SSE2 or
+// NEON when available), and blocks without candidates left
+// are skipped, so a step over the 32 KiB of CGB WRAM only
+// takes a few microseconds.
+class CheatSearch
+{
+	public:
+		enum Region { WRAM, HRAM, SRAM, NUM_REGIONS };
+		enum Compare { EQUAL, NOT_EQUAL, LESS, GREATER };
+
+		struct Result {
+			Region region;
+			unsigned offset;
+			unsigned value;
+		};
+
+		CheatSearch();
+
+		// Size 0 leaves a region out. Takes effect on reset()
+		void setRegion(Region region, const unsigned char *data, std::size_t size);
+
+		// Starts a new search, for 16-bit values if 'wide',
+		// with every offset a candidate
+		void reset(bool wide);
+		// Keeps candidates whose value compares 'op' with the
+		// previous value plus 'delta' (wrapping around)
+		void filterPrevious(Compare op, int delta = 0);
+		// Keeps candidates whose value compares 'op' with 'value'
+		void filterConstant(Compare op, unsigned value);
+
+		bool active() const { return !candidates_.empty(); }
+		bool wide() const { return wide_; }
+		std::size_t count() const { return count_; }
+		// Stores up to 'max' candidates in address order,
+		// and returns the number stored
+		std::size_t results(Result *out, std::size_t max) const;
+
+	private:
+		enum { BLOCK_SIZE = 16 };
+
+		struct RegionInfo {
+			const unsigned char *data;
+			std::size_t size;
+			std::size_t base;
+		};
+
+		void snapshot(std::vector<unsigned char> &dst) const;
+		void filter(Compare op, bool previous, unsigned value, unsigned delta);
+
+		RegionInfo regions_[NUM_REGIONS];
+		// Regions, each padded to a whole number of blocks,
+		// plus one block so that 16-bit words never overrun
+		std::vector<unsigned char> prev_;
+		std::vector<unsigned char> cur_;
+		// One word (bit n for offset n) per block
+		std::vector<unsigned short> candidates_;
+		std::size_t count_;
+		bool wide_;
+};
+
+#endif
@@ -17,7 +17,8 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include <array/rhmap.h>
+#include <algorithm>
+#include <cstring>
 
 namespace {
 
@@ -2660,6 +2661,7 @@ static const unsigned short pixelshift_45_wish[] = {
 
 struct GbcPaletteEntry { const char *title; const unsigned short *p; };
 
+// Note: all GbcPaletteEntry tables must be kept sorted by title
 static const GbcPaletteEntry gbcDirPalettes[] = {
 	{ "GB - DMG", gbdmg },    // Original Game Boy
 	{ "GB - Light", gblit },  // Original Game Boy Light
@@ -2676,6 +2678,51 @@ static const GbcPaletteEntry gbcDirPalettes[] = {
 	{ "GBC - Pastel Mix", p017 }, // Down
 	{ "GBC - Red", p510 },        // A + Up
 	{ "GBC - Yellow", p51A },     // B + Down
+	{ "PixelShift 01 - Arctic Green", pixelshift_01_arctic_green },
+	{ "PixelShift 02 - Arduboy", pixelshift_02_arduboy },
+	{ "PixelShift 03 - BGB 0.3 Emulator", pixelshift_03_bgb_0_3_emulator },
+	{ "PixelShift 04 - Camouflage", pixelshift_04_camouflage },
+	{ "PixelShift 05 - Chocolate Bar", pixelshift_05_chocolate_bar },
+	{ "PixelShift 06 - CMYK", pixelshift_06_cmyk },
+	{ "PixelShift 07 - Cotton Candy", pixelshift_07_cotton_candy },
+	{ "PixelShift 08 - Easy Greens", pixelshift_08_easy_greens },
+	{ "PixelShift 09 - Gamate", pixelshift_09_gamate },
+	{ "PixelShift 10 - Game Boy Light", pixelshift_10_game_boy_light },
+	{ "PixelShift 11 - Game Boy Pocket", pixelshift_11_game_boy_pocket },
+	{ "PixelShift 12 - Game Boy Pocket Alt", pixelshift_12_game_boy_pocket_alt },
+	{ "PixelShift 13 - Game Pocket Computer", pixelshift_13_game_pocket_computer },
+	{ "PixelShift 14 - Game & Watch Ball", pixelshift_14_game_and_watch_ball },
+	{ "PixelShift 15 - GB Backlight Blue", pixelshift_15_gb_backlight_blue },
+	{ "PixelShift 16 - GB Backlight Faded", pixelshift_16_gb_backlight_faded },
+	{ "PixelShift 17 - GB Backlight Orange", pixelshift_17_gb_backlight_orange },
+	{ "PixelShift 18 - GB Backlight White ", pixelshift_18_gb_backlight_white_ },
+	{ "PixelShift 19 - GB Backlight Yellow Dark", pixelshift_19_gb_backlight_yellow_dark },
+	{ "PixelShift 20 - GB Bootleg", pixelshift_20_gb_bootleg },
+	{ "PixelShift 21 - GB Hunter", pixelshift_21_gb_hunter },
+	{ "PixelShift 22 - GB Kiosk", pixelshift_22_gb_kiosk },
+	{ "PixelShift 23 - GB Kiosk 2", pixelshift_23_gb_kiosk_2 },
+	{ "PixelShift 24 - GB New", pixelshift_24_gb_new },
+	{ "PixelShift 25 - GB Nuked", pixelshift_25_gb_nuked },
+	{ "PixelShift 26 - GB Old", pixelshift_26_gb_old },
+	{ "PixelShift 27 - GBP Bivert", pixelshift_27_gbp_bivert },
+	{ "PixelShift 28 - GB Washed Yellow Backlight", pixelshift_28_gb_washed_yellow_backlight },
+	{ "PixelShift 29 - Ghost", pixelshift_29_ghost },
+	{ "PixelShift 30 - Glow In The Dark", pixelshift_30_glow_in_the_dark },
+	{ "PixelShift 31 - Gold Bar", pixelshift_31_gold_bar },
+	{ "PixelShift 32 - Grapefruit", pixelshift_32_grapefruit },
+	{ "PixelShift 33 - Gray Green Mix", pixelshift_33_gray_green_mix },
+	{ "PixelShift 34 - Missingno", pixelshift_34_missingno },
+	{ "PixelShift 35 - MS-Dos", pixelshift_35_ms_dos },
+	{ "PixelShift 36 - Newspaper", pixelshift_36_newspaper },
+	{ "PixelShift 37 - Pip-Boy", pixelshift_37_pip_boy },
+	{ "PixelShift 38 - Pocket Girl", pixelshift_38_pocket_girl },
+	{ "PixelShift 39 - Silhouette", pixelshift_39_silhouette },
+	{ "PixelShift 40 - Sunburst", pixelshift_40_sunburst },
+	{ "PixelShift 41 - Technicolor", pixelshift_41_technicolor },
+	{ "PixelShift 42 - Tron", pixelshift_42_tron },
+	{ "PixelShift 43 - Vaporwave", pixelshift_43_vaporwave },
+	{ "PixelShift 44 - Virtual Boy", pixelshift_44_virtual_boy },
+	{ "PixelShift 45 - Wish", pixelshift_45_wish },
 	{ "SGB - 1A", sgb1A }, // 1-A (default SGB)
 	{ "SGB - 1B", sgb1B }, // (NB: don't think these
 	{ "SGB - 1C", sgb1C }, // palettes have 'official'
@@ -3012,51 +3059,6 @@ static const GbcPaletteEntry gbcDirPalettes[] = {
 	{ "TWB64 298 - Baja Blast Beach", twb64_298_baja_blast_beach },
 	{ "TWB64 299 - 3DS Virtual Console Green", twb64_299_3ds_virtual_console_green },
 	{ "TWB64 300 - Wonder Purple", twb64_300_wonder_purple },
-	{ "PixelShift 01 - Arctic Green", pixelshift_01_arctic_green },
-	{ "PixelShift 02 - Arduboy", pixelshift_02_arduboy },
-	{ "PixelShift 03 - BGB 0.3 Emulator", pixelshift_03_bgb_0_3_emulator },
-	{ "PixelShift 04 - Camouflage", pixelshift_04_camouflage },
-	{ "PixelShift 05 - Chocolate Bar", pixelshift_05_chocolate_bar },
-	{ "PixelShift 06 - CMYK", pixelshift_06_cmyk },
-	{ "PixelShift 07 - Cotton Candy", pixelshift_07_cotton_candy },
-	{ "PixelShift 08 - Easy Greens", pixelshift_08_easy_greens },
-	{ "PixelShift 09 - Gamate", pixelshift_09_gamate },
-	{ "PixelShift 10 - Game Boy Light", pixelshift_10_game_boy_light },
-	{ "PixelShift 11 - Game Boy Pocket", pixelshift_11_game_boy_pocket },
-	{ "PixelShift 12 - Game Boy Pocket Alt", pixelshift_12_game_boy_pocket_alt },
-	{ "PixelShift 13 - Game Pocket Computer", pixelshift_13_game_pocket_computer },
-	{ "PixelShift 14 - Game & Watch Ball", pixelshift_14_game_and_watch_ball },
-	{ "PixelShift 15 - GB Backlight Blue", pixelshift_15_gb_backlight_blue },
-	{ "PixelShift 16 - GB Backlight Faded", pixelshift_16_gb_backlight_faded },
-	{ "PixelShift 17 - GB Backlight Orange", pixelshift_17_gb_backlight_orange },
-	{ "PixelShift 18 - GB Backlight White ", pixelshift_18_gb_backlight_white_ },
-	{ "PixelShift 19 - GB Backlight Yellow Dark", pixelshift_19_gb_backlight_yellow_dark },
-	{ "PixelShift 20 - GB Bootleg", pixelshift_20_gb_bootleg },
-	{ "PixelShift 21 - GB Hunter", pixelshift_21_gb_hunter },
-	{ "PixelShift 22 - GB Kiosk", pixelshift_22_gb_kiosk },
-	{ "PixelShift 23 - GB Kiosk 2", pixelshift_23_gb_kiosk_2 },
-	{ "PixelShift 24 - GB New", pixelshift_24_gb_new },
-	{ "PixelShift 25 - GB Nuked", pixelshift_25_gb_nuked },
-	{ "PixelShift 26 - GB Old", pixelshift_26_gb_old },
-	{ "PixelShift 27 - GBP Bivert", pixelshift_27_gbp_bivert },
-	{ "PixelShift 28 - GB Washed Yellow Backlight", pixelshift_28_gb_washed_yellow_backlight },
-	{ "PixelShift 29 - Ghost", pixelshift_29_ghost },
-	{ "PixelShift 30 - Glow In The Dark", pixelshift_30_glow_in_the_dark },
-	{ "PixelShift 31 - Gold Bar", pixelshift_31_gold_bar },
-	{ "PixelShift 32 - Grapefruit", pixelshift_32_grapefruit },
-	{ "PixelShift 33 - Gray Green Mix", pixelshift_33_gray_green_mix },
-	{ "PixelShift 34 - Missingno", pixelshift_34_missingno },
-	{ "PixelShift 35 - MS-Dos", pixelshift_35_ms_dos },
-	{ "PixelShift 36 - Newspaper", pixelshift_36_newspaper },
-	{ "PixelShift 37 - Pip-Boy", pixelshift_37_pip_boy },
-	{ "PixelShift 38 - Pocket Girl", pixelshift_38_pocket_girl },
-	{ "PixelShift 39 - Silhouette", pixelshift_39_silhouette },
-	{ "PixelShift 40 - Sunburst", pixelshift_40_sunburst },
-	{ "PixelShift 41 - Technicolor", pixelshift_41_technicolor },
-	{ "PixelShift 42 - Tron", pixelshift_42_tron },
-	{ "PixelShift 43 - Vaporwave", pixelshift_43_vaporwave },
-	{ "PixelShift 44 - Virtual Boy", pixelshift_44_virtual_boy },
-	{ "PixelShift 45 - Wish", pixelshift_45_wish },
 };
 
 static const GbcPaletteEntry gbcTitlePalettes[] = {
@@ -3088,12 +3090,12 @@ static const GbcPaletteEntry gbcTitlePalettes[] = {
 	{ "G&W GALLERY", p304 },
 	{ "GALAGA&GALAXIAN", p013 },
 	{ "GAME&WATCH", p012 },
-	{ "Game and Watch 2", p304 },
 	{ "GAMEBOY GALLERY", p304 },
 	{ "GAMEBOY GALLERY2", p304 },
 	{ "GBWARS", p500 },
 	{ "GBWARST", p500 },	// unofficial ("GBWARS" alt.)
 	{ "GOLF", p30E },
+	{ "Game and Watch 2", p304 },
 	{ "HOSHINOKA-BI", p508 },
 	{ "JAMES  BOND  007", p11C },
 	{ "KAERUNOTAMENI", p10D },
@@ -3250,47 +3252,36 @@ static const GbcPaletteEntry sgbTitlePalettes[] = {
 	{ "ZELDA", sgb1E },
 };
 
-static const unsigned short **gbcDirPaletteMap   = NULL;
-static const unsigned short **gbcTitlePaletteMap = NULL;
-static const unsigned short **sgbTitlePaletteMap = NULL;
+struct GbcPaletteEntryLess {
+	bool operator()(const GbcPaletteEntry &lhs, const char *const rhstitle) const {
+		return std::strcmp(lhs.title, rhstitle) < 0;
+	}
+};
 
-static void initPaletteMaps(void)
+// Palette tables are sorted by title (strcmp() order),
+// so lookups are a binary search over static data
+template<std::size_t N>
+static const unsigned short *findPal(const GbcPaletteEntry (&palettes)[N], const char *const title)
 {
-	unsigned i;
-
-	// gbcDirPalettes
-	for (i = 0; i < (sizeof gbcDirPalettes) / (sizeof gbcDirPalettes[0]); i++)
-		RHMAP_SET_STR(gbcDirPaletteMap, gbcDirPalettes[i].title, gbcDirPalettes[i].p);
-
-	// gbcTitlePalettes
-	for (i = 0; i < (sizeof gbcTitlePalettes) / (sizeof gbcTitlePalettes[0]); i++)
-		RHMAP_SET_STR(gbcTitlePaletteMap, gbcTitlePalettes[i].title, gbcTitlePalettes[i].p);
+	const GbcPaletteEntry *const end = palettes + N;
+	const GbcPaletteEntry *const r   = std::lower_bound(palettes, end, title, GbcPaletteEntryLess());
 
-	// sgbTitlePalettes
-	for (i = 0; i < (sizeof sgbTitlePalettes) / (sizeof sgbTitlePalettes[0]); i++)
-		RHMAP_SET_STR(sgbTitlePaletteMap, sgbTitlePalettes[i].title, sgbTitlePalettes[i].p);
-}
-
-static void freePaletteMaps(void)
-{
-	RHMAP_FREE(gbcDirPaletteMap);
-	RHMAP_FREE(gbcTitlePaletteMap);
-	RHMAP_FREE(sgbTitlePaletteMap);
+	return r < end && !std::strcmp(r->title, title) ? r->p : 0;
 }
 
 static const unsigned short *findGbcDirPal(const char *const title)
 {
-	return RHMAP_GET_STR(gbcDirPaletteMap, title);
+	return findPal(gbcDirPalettes, title);
 }
 
 static const unsigned short *findGbcTitlePal(const char *const title)
 {
-	return RHMAP_GET_STR(gbcTitlePaletteMap, title);
+	return findPal(gbcTitlePalettes, title);
 }
 
 static const unsigned short *findSgbTitlePal(const char *const title)
 {
-	return RHMAP_GET_STR(sgbTitlePaletteMap, title);
+	return findPal(sgbTitlePalettes, title);
 }
 
 static const unsigned short *findGbcPal(const char *const title)
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+"""Internal palette index generator
+
+Generates 'gbcpalettes_index.h' from the internal palette option
+values in 'libretro_core_options.h', so that the core can map
+palette names to 'consolidated' palette indices using static
+tables (no hash maps, no parsing of option definitions at runtime).
+
+Must be re-run whenever internal palette options are added,
+removed or reordered.
+
+Usage:
+python3 path/to/gbcpalettes_index.py
+"""
+import os
+import re
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+OPTIONS_FILE = os.path.join(SCRIPT_DIR, 'libretro_core_options.h')
+OUTPUT_FILE = os.path.join(SCRIPT_DIR, 'gbcpalettes_index.h')
+
+# (option key, #define suffix, value of 'gambatte_gb_internal_palette'
+#  that selects this group)
+# > Order defines the 'consolidated' palette index
+PALETTE_GROUPS = [
+    ('gambatte_gb_internal_palette',     'DEFAULT',      None),
+    ('gambatte_gb_palette_twb64_1',      'TWB64_1',      'TWB64 - Pack 1'),
+    ('gambatte_gb_palette_twb64_2',      'TWB64_2',      'TWB64 - Pack 2'),
+    ('gambatte_gb_palette_twb64_3',      'TWB64_3',      'TWB64 - Pack 3'),
+    ('gambatte_gb_palette_pixelshift_1', 'PIXELSHIFT_1', 'PixelShift - Pack 1'),
+]
+
+
+def option_values(src, key):
+    start = src.find('"%s",' % key, src.find('option_defs_us[]'))
+    if start < 0:
+        sys.exit('Option %s not found' % key)
+    values_start = src.index('{', src.index('{', start) + 1)
+    values_end = src.index('{ NULL, NULL }', values_start)
+    return re.findall(r'\{\s*"((?:[^"\\]|\\.)*)"\s*,', src[values_start:values_end])
+
+
+def c_string(s):
+    return '"%s"' % s
+
+
+def main():
+    with open(OPTIONS_FILE, 'r', encoding='utf-8') as f:
+        src = f.read()
+
+    selectors = set(g[2] for g in PALETTE_GROUPS if g[2])
+    groups = []
+    for key, suffix, _ in PALETTE_GROUPS:
+        values = [v for v in option_values(src, key) if v not in selectors]
+        groups.append((key, suffix, values))
+
+    names = [v for _, _, values in groups for v in values]
+    if len(set(names)) != len(names):
+        sys.exit('Internal palette names must be unique')
+
+    # strcmp() order
+    sorted_indices = sorted(range(len(names)), key=lambda i: names[i].encode('utf-8'))
+
+    out = []
+    out.append('/* This file is generated by gbcpalettes_index.py from')
+    out.append(' * libretro_core_options.h - do not edit by hand */')
+    out.append('')
+    out.append('#ifndef GBCPALETTES_INDEX_H__')
+    out.append('#define GBCPALETTES_INDEX_H__')
+    out.append('')
+    for _, suffix, values in groups:
+        out.append('#define %-26s %d' % ('NUM_PALETTES_' + suffix, len(values)))
+    out.append('#define NUM_PALETTES_TOTAL         %d' % len(names))
+    out.append('')
+    out.append('/* Internal palette names, in \'consolidated\'')
+    out.append(' * palette index order */')
+    out.append('static const char *const internal_palette_names[NUM_PALETTES_TOTAL] = {')
+    for key, _, values in groups:
+        out.append('   /* %s */' % key)
+        for v in values:
+            out.append('   %s,' % c_string(v))
+    out.append('};')
+    out.append('')
+    out.append('/* Consolidated palette indices, sorted by')
+    out.append(' * palette name (strcmp() order) */')
+    out.append('static const unsigned short internal_palette_sorted[NUM_PALETTES_TOTAL] = {')
+    for i in range(0, len(sorted_indices), 12):
+        out.append('   ' + ' '.join('%3d,' % n for n in sorted_indices[i:i + 12]))
+    out.append('};')
+    out.append('')
+    out.append('#endif')
+    out.append('')
+
+    with open(OUTPUT_FILE, 'w', encoding='utf-8', newline='\n') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
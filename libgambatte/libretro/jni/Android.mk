@@ -8,7 +8,7 @@ HAVE_NETWORK := 1
 
 include $(ROOT_DIR)/Makefile.common
 
-COREFLAGS := -DINLINE=inline -DHAVE_STDINT_H -DHAVE_INTTYPES_H -D__LIBRETRO__ -DVIDEO_RGB565 -DCC_RESAMPLER_NO_HIGHPASS -Wno-c++11-narrowing
+COREFLAGS := -DINLINE=inline -DHAVE_STDINT_H -DHAVE_INTTYPES_H -D__LIBRETRO__ -DCC_RESAMPLER_NO_HIGHPASS -Wno-c++11-narrowing
 
 ifeq ($(HAVE_NETWORK),1)
   COREFLAGS += -DHAVE_NETWORK
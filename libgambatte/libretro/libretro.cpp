@@ -7,10 +7,25 @@
 #include "cc_resampler.h"
 #include "gambatte.h"
 #include "gbcpalettes.h"
+#include "gbcpalettes_index.h"
 #include "bootloader.h"
 #include "../src/mem/fake_rtc.h"
+#include "cheat_search.h"
+#include "quality_governor.h"
+#include "perf_profile.h"
+#ifdef HAVE_BENCHMARK
+#include "benchmark.h"
+#endif
+#ifdef HAVE_SHM_OUTPUT
+#include "shm_output.h"
+#include <unistd.h>
+#endif
 #ifdef HAVE_NETWORK
 #include "net_serial.h"
+#include "link_cable.h"
+#ifdef HAVE_LINK_THREADS
+#include "link_worker.h"
+#endif
 #endif
 
 #if defined(__DJGPP__) && defined(__STRICT_ANSI__)
@@ -29,7 +44,6 @@
 #include <string/stdstring.h>
 #include <file/file_path.h>
 #include <streams/file_stream.h>
-#include <array/rhmap.h>
 
 #include <cassert>
 #include <cstdio>
@@ -41,6 +55,14 @@
 #include <algorithm>
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCALE_SSE2
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define SCALE_NEON
+#endif
+
 #ifdef _3DS
 extern "C" void* linearMemAlign(size_t size, size_t alignment);
 extern "C" void linearFree(void* mem);
@@ -51,9 +73,32 @@ static retro_input_poll_t input_poll_cb;
 static retro_input_state_t input_state_cb;
 static retro_audio_sample_batch_t audio_batch_cb;
 static retro_environment_t environ_cb;
-static gambatte::video_pixel_t* video_buf;
+static void *video_buf;
+/* Buffer the core draws the current frame to: video_buf
+ * itself, or (when frames are blended) a slot of the
+ * blending history ring, from which the blended frame
+ * is written to video_buf */
+static void *render_buf;
 static gambatte::GB gb;
 
+#ifdef HAVE_SHM_OUTPUT
+/* Video and audio output to other processes. While
+ * open, video_buf points to a slot of its frame ring */
+static ShmOutput shm_output;
+#endif
+
+/* Format of the pixels in video_buf, as agreed
+ * with the frontend by set_pixel_format() */
+static gambatte::PixelFormat pixel_format = gambatte::PIXEL_RGB565;
+static unsigned video_pixel_size          = 2;
+
+/* Picks the instantiation of a function template
+ * matching the current pixel format */
+#define PIXEL_FORMAT_FUNC(func) \
+   (pixel_format == gambatte::PIXEL_XRGB8888 ? &func<gambatte::PixelXrgb8888> : \
+    pixel_format == gambatte::PIXEL_ABGR1555 ? &func<gambatte::PixelAbgr1555> : \
+                                               &func<gambatte::PixelRgb565>)
+
 static bool libretro_supports_option_categories = false;
 static bool libretro_supports_bitmasks          = false;
 static bool libretro_supports_set_variable      = false;
@@ -97,6 +142,9 @@ static bool fast_forward_audio_enabled = false;
 #define TURBO_PULSE_WIDTH_MAX 15
 
 static unsigned libretro_input_state = 0;
+#ifdef HAVE_NETWORK
+static unsigned libretro_input_state_p2 = 0;
+#endif
 static bool up_down_allowed          = false;
 static unsigned turbo_period         = TURBO_PERIOD_MIN;
 static unsigned turbo_pulse_width    = TURBO_PULSE_WIDTH_MIN;
@@ -105,26 +153,61 @@ static unsigned turbo_b_counter      = 0;
 
 static bool rom_loaded = false;
 
-//Dual mode runs two GBCs side by side.
-//Currently, they load the same ROM, take the same input, and only the left one supports SRAM, cheats, savestates, or sound.
-//Can be made useful later, but for now, it's just a tech demo.
-//#define DUAL_MODE
-
-#ifdef DUAL_MODE
-static gambatte::GB gb2;
-#define NUM_GAMEBOYS 2
+#ifdef HAVE_NETWORK
+/* Local link mode runs two Game Boys side by side,
+ * connected by an in-process link cable. Enabled by
+ * loading content via the 'Link (2 Players)' subsystem.
+ * Player 2 takes input from port 2, and has its own
+ * SRAM and savestate data. Cheats apply to player 1 only */
+#define MAX_GAMEBOYS 2
+#define NUM_GAMEBOYS (gb2 ? 2 : 1)
+
+#define SUBSYSTEM_LINK_2P 0x101
+
+/* Subsystem memory types */
+#define RETRO_MEMORY_LINK_P1_SAVE_RAM ((1 << 8) | RETRO_MEMORY_SAVE_RAM)
+#define RETRO_MEMORY_LINK_P1_RTC      ((2 << 8) | RETRO_MEMORY_RTC)
+#define RETRO_MEMORY_LINK_P2_SAVE_RAM ((3 << 8) | RETRO_MEMORY_SAVE_RAM)
+#define RETRO_MEMORY_LINK_P2_RTC      ((4 << 8) | RETRO_MEMORY_RTC)
+
+static gambatte::GB *gb2 = NULL;
+static LinkCable link_cable;
+static bool link_audio_p2 = false;
+#ifdef HAVE_LINK_THREADS
+/* Runs player 2 on a second core, if available */
+static LinkWorker link_worker;
+#endif
 #else
+#define MAX_GAMEBOYS 1
 #define NUM_GAMEBOYS 1
 #endif
 
 bool use_official_bootloader = false;
 
+/* Fast boot: the boot ROM, and optionally the first
+ * few frames of the game, are run headless and silent
+ * before the first frame is presented. Presentation
+ * starts on the frame after the boot ROM hands over
+ * to the cartridge (FF50 write) */
+#define FAST_BOOT_MAX_FRAMES        600 /* Boot ROMs lock up on a bad logo - give up after 10 seconds */
+#ifdef SF2000
+#define FAST_BOOT_FRAMES_PER_SPLASH 2   /* Spread over the splash screen, which leaves the CPU idle */
+#endif
+static bool fast_boot_enabled         = false;
+static unsigned fast_boot_skip_frames = 0;
+static bool fast_boot_pending         = false;
+static unsigned fast_boot_frames_run  = 0;
+static unsigned fast_boot_frames_left = 0;
+
 #define GB_SCREEN_WIDTH 160
 #define VIDEO_WIDTH (GB_SCREEN_WIDTH * NUM_GAMEBOYS)
 #define VIDEO_HEIGHT 144
 /* Video buffer 'width' is 256, not 160 -> assume
- * there is a benefit to making this a power of 2 */
-#define VIDEO_BUFF_SIZE (256 * NUM_GAMEBOYS * VIDEO_HEIGHT * sizeof(gambatte::video_pixel_t))
+ * there is a benefit to making this a power of 2.
+ * Buffers are sized for the widest pixel format, as
+ * the format is only known once the frontend has
+ * accepted it */
+#define VIDEO_BUFF_SIZE (256 * MAX_GAMEBOYS * VIDEO_HEIGHT * sizeof(gambatte::PixelXrgb8888::pixel_t))
 #define VIDEO_PITCH (256 * NUM_GAMEBOYS)
 #define VIDEO_REFRESH_RATE (4194304.0 / 70224.0)
 
@@ -249,7 +332,8 @@ static const unsigned char splash_font_8x8[][8] = {
    {0x00,0x00,0x7E,0x0C,0x18,0x30,0x7E,0x00}, // z (122)
 };
 
-static void sf2000_draw_char(gambatte::video_pixel_t *video_buf, int x, int y, char c, gambatte::video_pixel_t color)
+template<class Pixel>
+static void sf2000_draw_char(Pixel *video_buf, int x, int y, char c, gambatte::video_pixel_t color)
 {
    if (c < 32 || c > 122) c = 32; // Default to space for unsupported chars
    
@@ -272,7 +356,8 @@ static void sf2000_draw_char(gambatte::video_pixel_t *video_buf, int x, int y, c
    }
 }
 
-static void sf2000_draw_string(gambatte::video_pixel_t *video_buf, int x, int y, const char *text, gambatte::video_pixel_t color)
+template<class Pixel>
+static void sf2000_draw_string(Pixel *video_buf, int x, int y, const char *text, gambatte::video_pixel_t color)
 {
    int pos_x = x;
    while (*text)
@@ -283,12 +368,15 @@ static void sf2000_draw_string(gambatte::video_pixel_t *video_buf, int x, int y,
    }
 }
 
-static void sf2000_draw_splash_screen(gambatte::video_pixel_t *video_buf)
+template<class Format>
+static void sf2000_draw_splash_screen(void *buf)
 {
+   typename Format::pixel_t *video_buf = (typename Format::pixel_t*)buf;
+
    /* Clear entire screen to pastel pink */
-   gambatte::video_pixel_t bg_color = 0xFD3C; // Pastel pink (#FFA6E7) in RGB565
-   gambatte::video_pixel_t white_color = 0xFFFF; // White in RGB565
-   gambatte::video_pixel_t black_color = 0x0000; // Black in RGB565
+   gambatte::video_pixel_t bg_color = Format::fromRgb888(0xFFA6E7);
+   gambatte::video_pixel_t white_color = Format::fromRgb888(0xFFFFFF);
+   gambatte::video_pixel_t black_color = Format::fromRgb888(0x000000);
    
    /* Fill entire video buffer with background color */
    for (int i = 0; i < VIDEO_PITCH * VIDEO_HEIGHT; i++)
@@ -340,10 +428,36 @@ static void sf2000_draw_splash_screen(gambatte::video_pixel_t *video_buf)
  * excess samples are detected... */
 #define SOUND_BUFF_SIZE         (SOUND_SAMPLES_PER_RUN + 2064)
 
+#ifdef HAVE_NETWORK
+/* Local link mode: per-player run state. Each
+ * player renders into its own back buffer, which
+ * is copied to its half of render_buf whenever a
+ * frame completes (so the two may run concurrently,
+ * and past the end of a frame, without tearing) */
+struct link_player
+{
+   gambatte::GB *gb;
+   /* Offset of the player's screen in render_buf */
+   size_t output;
+   gambatte::PixelXrgb8888::pixel_t video[GB_SCREEN_WIDTH * VIDEO_HEIGHT];
+   gambatte::uint_least32_t sound[SOUND_BUFF_SIZE];
+   /* Samples generated during the last quantum */
+   unsigned samples;
+   /* Samples run past the end of the last quantum */
+   long carry;
+   bool frame_done;
+};
+
+static struct link_player *link_players = NULL;
+#endif
+
 /* Blipper produces between 548 and 549 output samples
  * per frame. For safety, we want to keep the blip
  * buffer no more than ~50% full. (2 * 549) = 1098,
- * so add some padding and round up to (1024 + 512) */
+ * so add some padding and round up to (1024 + 512)
+ * NOTE: At a decimation of 32 (see audio_rate_configs)
+ * this doubles, but the buffer is drained whenever it
+ * is half full, which happens long before that */
 #define BLIP_BUFFER_SIZE (1024 + 512)
 
 static blipper_t *resampler_l = NULL;
@@ -355,16 +469,88 @@ static bool use_cc_resampler = true;
 static bool use_cc_resampler = false;
 #endif
 
+/* Selectable output sample rates. Blipper can only
+ * decimate by powers of two, so it produces the next
+ * such rate above the output rate, which is then
+ * linearly interpolated down to the output rate.
+ * Its cutoff is set below the output Nyquist frequency
+ * so that this final step does not alias, and low rates
+ * use fewer taps, since blipper cost scales with taps.
+ * The CC resampler has a fixed decimation, and is
+ * converted from its own rate (~64 kHz) */
+struct audio_rate_config
+{
+   const char *value; /* 'gambatte_audio_output_rate' value */
+   unsigned rate;     /* 0: resampler rate, no conversion */
+   unsigned decimation;
+   unsigned taps;
+   double cutoff;
+   double beta;
+};
+
+static const struct audio_rate_config audio_rate_configs[] = {
+   { "native", 0,     64, 32, 0.85, 6.5 }, /* ~32 kHz */
+   { "22050",  22050, 64, 16, 0.60, 5.0 }, /* from ~32 kHz */
+   { "32000",  32000, 64, 32, 0.85, 6.5 }, /* from ~32 kHz */
+   { "44100",  44100, 32, 32, 0.60, 6.5 }, /* from ~64 kHz */
+   { "48000",  48000, 32, 32, 0.65, 6.5 }, /* from ~64 kHz */
+};
+
+#define NUM_AUDIO_RATE_CONFIGS (sizeof(audio_rate_configs) / sizeof(audio_rate_configs[0]))
+
+static const struct audio_rate_config *audio_rate_config = &audio_rate_configs[0];
+
+/* Output rate conversion: 16.16 fixed point input
+ * samples per output sample (0 when disabled), and
+ * position of the next output sample relative to the
+ * last input sample of the previous batch */
+static uint32_t audio_rate_step        = 0;
+static uint32_t audio_rate_phase       = 0;
+static int16_t audio_rate_prev[2]      = {0};
+static int16_t *audio_rate_buffer      = NULL;
+static size_t audio_rate_buffer_size   = 0;
+
+/* Rate of the samples produced by the resampler */
+static double audio_resampler_rate(void)
+{
+   return SOUND_SAMPLE_RATE_NATIVE / (use_cc_resampler ?
+         CC_DECIMATION_RATE : audio_rate_config->decimation);
+}
+
+/* Sample rate reported to the frontend */
+static double audio_output_rate(void)
+{
+   if (audio_rate_config->rate)
+      return audio_rate_config->rate;
+#if !defined(SF2000)
+   return use_cc_resampler ?
+         SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
+#else
+   return 32000;
+#endif
+}
+
 
 static int16_t *audio_out_buffer     = NULL;
 static size_t audio_out_buffer_size  = 0;
 static size_t audio_out_buffer_pos   = 0;
 static size_t audio_batch_frames_max = (1 << 16);
 
+/* Sets up the conversion from the rate of the
+ * resampler in use to the output rate, if any */
+static void audio_rate_update_step(void)
+{
+   audio_rate_step = 0;
+   if (audio_rate_config->rate)
+      audio_rate_step = (uint32_t)(audio_resampler_rate() * 65536.0 /
+            audio_rate_config->rate + 0.5);
+}
+
 static void audio_out_buffer_init(void)
 {
-   float sample_rate       = use_cc_resampler ?
-         SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
+   /* Sized for the faster of the two resamplers, so that
+    * they can be switched without a reallocation */
+   float sample_rate       = SOUND_SAMPLE_RATE_NATIVE / CC_DECIMATION_RATE;
    float samples_per_frame = sample_rate / VIDEO_REFRESH_RATE;
    size_t buffer_size      = ((size_t)samples_per_frame + 1) << 1;
 
@@ -378,6 +564,11 @@ static void audio_out_buffer_init(void)
    audio_out_buffer_size   = buffer_size;
    audio_out_buffer_pos    = 0;
    audio_batch_frames_max  = (1 << 16);
+
+   audio_rate_phase        = 0;
+   audio_rate_prev[0]      = 0;
+   audio_rate_prev[1]      = 0;
+   audio_rate_update_step();
 }
 
 static void audio_out_buffer_deinit(void)
@@ -389,6 +580,11 @@ static void audio_out_buffer_deinit(void)
    audio_out_buffer_size  = 0;
    audio_out_buffer_pos   = 0;
    audio_batch_frames_max = (1 << 16);
+
+   free(audio_rate_buffer);
+   audio_rate_buffer      = NULL;
+   audio_rate_buffer_size = 0;
+   audio_rate_step        = 0;
 }
 
 static INLINE void audio_out_buffer_resize(size_t num_samples)
@@ -438,6 +634,57 @@ static void audio_out_buffer_read_blipper(size_t num_samples)
    audio_out_buffer_pos += num_samples << 1;
 }
 
+/* Linearly interpolates num_samples stereo frames of
+ * resampler output down to the output rate, into
+ * audio_rate_buffer. Returns the number of frames
+ * produced */
+static size_t audio_rate_convert(const int16_t *in, size_t num_samples)
+{
+   size_t max_out = (size_t)(((uint64_t)num_samples << 16) / audio_rate_step) + 2;
+   uint32_t phase = audio_rate_phase;
+   int16_t *out;
+   size_t n = 0;
+
+   if (audio_rate_buffer_size < (max_out << 1))
+   {
+      free(audio_rate_buffer);
+      audio_rate_buffer_size = max_out << 1;
+      audio_rate_buffer      = (int16_t *)malloc(audio_rate_buffer_size * sizeof(int16_t));
+      if (!audio_rate_buffer)
+      {
+         audio_rate_buffer_size = 0;
+         return 0;
+      }
+   }
+   out = audio_rate_buffer;
+
+   /* Position 0 is the last frame of the previous batch,
+    * position i > 0 is in[i - 1] */
+   while ((phase >> 16) < num_samples)
+   {
+      size_t i        = phase >> 16;
+      int32_t frac    = (phase & 0xFFFF) >> 1;
+      const int16_t *b = in + (i << 1);
+      int32_t a_l     = i ? b[-2] : audio_rate_prev[0];
+      int32_t a_r     = i ? b[-1] : audio_rate_prev[1];
+
+      out[n << 1]       = (int16_t)(a_l + (((b[0] - a_l) * frac) >> 15));
+      out[(n << 1) + 1] = (int16_t)(a_r + (((b[1] - a_r) * frac) >> 15));
+      n++;
+
+      phase += audio_rate_step;
+   }
+
+   if (num_samples)
+   {
+      audio_rate_prev[0] = in[(num_samples << 1) - 2];
+      audio_rate_prev[1] = in[(num_samples << 1) - 1];
+   }
+   audio_rate_phase = phase - (uint32_t)(num_samples << 16);
+
+   return n;
+}
+
 static void audio_upload_samples(void)
 {
    int16_t *audio_out_buffer_ptr = audio_out_buffer;
@@ -459,6 +706,17 @@ static void audio_upload_samples(void)
    }
 #endif
 
+   if (audio_rate_step)
+   {
+      num_samples          = audio_rate_convert(audio_out_buffer, num_samples);
+      audio_out_buffer_ptr = audio_rate_buffer;
+   }
+
+#ifdef HAVE_SHM_OUTPUT
+   if (shm_output.isOpen())
+      shm_output.writeAudio(audio_out_buffer_ptr, num_samples);
+#endif
+
    while (num_samples > 0)
    {
       size_t samples_to_write = (num_samples >
@@ -484,8 +742,7 @@ static void blipper_renderaudio(const int16_t *samples, unsigned frames)
    if (!frames)
       return;
 
-   blipper_push_samples(resampler_l, samples + 0, frames, 2);
-   blipper_push_samples(resampler_r, samples + 1, frames, 2);
+   blipper_push_samples_stereo(resampler_l, resampler_r, samples, frames);
 }
 
 static void audio_resampler_deinit(void)
@@ -508,8 +765,12 @@ static void audio_resampler_init(bool startup)
       CC_init();
    else
    {
-      resampler_l = blipper_new(32, 0.85, 6.5, 64, BLIP_BUFFER_SIZE, NULL);
-      resampler_r = blipper_new(32, 0.85, 6.5, 64, BLIP_BUFFER_SIZE, NULL);
+      const struct audio_rate_config *config = audio_rate_config;
+
+      resampler_l = blipper_new(config->taps, config->cutoff, config->beta,
+            config->decimation, BLIP_BUFFER_SIZE, NULL);
+      resampler_r = blipper_new(config->taps, config->cutoff, config->beta,
+            config->decimation, BLIP_BUFFER_SIZE, NULL);
 
       /* It is possible for blipper_new() to fail,
        * must handle errors */
@@ -563,6 +824,33 @@ static void audio_resampler_init(bool startup)
    }
 
    audio_out_buffer_init();
+
+#ifdef HAVE_SHM_OUTPUT
+   shm_output.setSampleRate(audio_output_rate());
+#endif
+}
+
+/* Switches between the configured resampler and the
+ * CC resampler between frames, without allocating.
+ * Only valid when the output rate is converted, so
+ * that the frontend sees no change of rate */
+static void audio_resampler_switch(bool cc)
+{
+   if (cc == use_cc_resampler || !audio_rate_config->rate)
+      return;
+
+   if (cc)
+      CC_init();
+   else
+   {
+      if (!resampler_l || !resampler_r)
+         return;
+      blipper_reset(resampler_l);
+      blipper_reset(resampler_r);
+   }
+
+   use_cc_resampler = cc;
+   audio_rate_update_step();
 }
 
 /***********************/
@@ -581,128 +869,148 @@ static unsigned palette_switch_counter = 0;
  * when holding RetroPad L/R */
 #define PALETTE_SWITCH_PERIOD 30
 
-/* Note: These must be updated if the internal
- * palette options in libretro_core_options.h
- * are changed
- * > We could count the palettes at runtime,
- *   but this adds unnecessary performance
- *   overheads and seems futile given that
- *   a number of other parameters must be
- *   hardcoded anyway... */
-#define NUM_PALETTES_DEFAULT       51
-#define NUM_PALETTES_TWB64_1      100
-#define NUM_PALETTES_TWB64_2      100
-#define NUM_PALETTES_TWB64_3      100
-#define NUM_PALETTES_PIXELSHIFT_1  45
-#define NUM_PALETTES_TOTAL        (NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2 + \
-                                   NUM_PALETTES_TWB64_3 + NUM_PALETTES_PIXELSHIFT_1)
-
-struct retro_core_option_value *palettes_default_opt_values      = NULL;
-struct retro_core_option_value *palettes_twb64_1_opt_values      = NULL;
-struct retro_core_option_value *palettes_twb64_2_opt_values      = NULL;
-struct retro_core_option_value *palettes_twb64_3_opt_values      = NULL;
-struct retro_core_option_value *palettes_pixelshift_1_opt_values = NULL;
-
-static const char *internal_palette_labels[NUM_PALETTES_TOTAL] = {0};
-
-static size_t *palettes_default_index_map      = NULL;
-static size_t *palettes_twb64_1_index_map      = NULL;
-static size_t *palettes_twb64_2_index_map      = NULL;
-static size_t *palettes_twb64_3_index_map      = NULL;
-static size_t *palettes_pixelshift_1_index_map = NULL;
-
-static void parse_internal_palette_values(const char *key,
-      struct retro_core_option_v2_definition *opt_defs_intl,
-      size_t num_palettes, size_t palette_offset,
-      struct retro_core_option_value **opt_values,
-      size_t **index_map)
+/* Internal palette groups
+ * > Palette counts and names are generated from
+ *   the internal palette options in libretro_core_options.h
+ *   (see gbcpalettes_index.h), so we never have to parse
+ *   option definitions or build hash maps at runtime */
+struct internal_palette_group
 {
-   size_t i;
-   struct retro_core_option_v2_definition *opt_defs     = option_defs_us;
-   struct retro_core_option_v2_definition *opt_def      = NULL;
-   size_t label_index                                   = 0;
+   const char *key;      /* Option key */
+   const char *selector; /* 'gambatte_gb_internal_palette' value
+                          * that selects this group */
+   size_t offset;        /* 'Consolidated' index of first palette */
+   size_t count;
+};
+
+static const struct internal_palette_group internal_palette_groups[] = {
+   { "gambatte_gb_internal_palette",     NULL,
+         0,
+         NUM_PALETTES_DEFAULT },
+   { "gambatte_gb_palette_twb64_1",      "TWB64 - Pack 1",
+         NUM_PALETTES_DEFAULT,
+         NUM_PALETTES_TWB64_1 },
+   { "gambatte_gb_palette_twb64_2",      "TWB64 - Pack 2",
+         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1,
+         NUM_PALETTES_TWB64_2 },
+   { "gambatte_gb_palette_twb64_3",      "TWB64 - Pack 3",
+         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2,
+         NUM_PALETTES_TWB64_3 },
+   { "gambatte_gb_palette_pixelshift_1", "PixelShift - Pack 1",
+         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2 +
+               NUM_PALETTES_TWB64_3,
+         NUM_PALETTES_PIXELSHIFT_1 },
+};
+
+#define NUM_PALETTE_GROUPS (sizeof(internal_palette_groups) / sizeof(internal_palette_groups[0]))
+
 #ifndef HAVE_NO_LANGEXTRA
-   struct retro_core_option_v2_definition *opt_def_intl = NULL;
+static unsigned palette_language = RETRO_LANGUAGE_ENGLISH;
+static char palette_label_intl[128];
 #endif
-   /* Find option corresponding to key */
-   for (opt_def = opt_defs; !string_is_empty(opt_def->key); opt_def++)
-      if (string_is_equal(opt_def->key, key))
+
+static const struct internal_palette_group *internal_palette_get_group(
+      size_t palette_index)
+{
+   size_t i;
+
+   for (i = NUM_PALETTE_GROUPS - 1; i > 0; i--)
+      if (palette_index >= internal_palette_groups[i].offset)
          break;
 
-   /* Cache option values array for fast access
-    * when setting palette index */
-   *opt_values = opt_def->values;
-
-   /* Loop over all palette values for specified
-    * option and:
-    * - Generate palette index maps
-    * - Fetch palette labels for notification
-    *   purposes
-    * Note: We perform no error checking here,
-    * since we are operating on hardcoded structs
-    * over which the core has full control */
-   for (i = 0; i < num_palettes; i++)
-   {
-      const char *value       = opt_def->values[i].value;
-      const char *value_label = NULL;
-
-      /* Add entry to hash map
-       * > Note that we have to set index+1, since
-       *   a return value of 0 from RHMAP_GET_STR()
-       *   indicates that the key string was not found */
-      RHMAP_SET_STR((*index_map), value, i + 1);
-
-      /* Check if we have a localised palette label */
-#ifndef HAVE_NO_LANGEXTRA
-      if (opt_defs_intl)
-      {
-         /* Find localised option corresponding to key */
-         for (opt_def_intl = opt_defs_intl;
-              !string_is_empty(opt_def_intl->key);
-              opt_def_intl++)
-         {
-            if (string_is_equal(opt_def_intl->key, key))
-            {
-               size_t j = 0;
+   return &internal_palette_groups[i];
+}
 
-               /* Search for current option value */
-               for (;;)
-               {
-                  const char *value_intl = opt_def_intl->values[j].value;
+/* Returns 'consolidated' index of the named palette,
+ * or the first palette of the specified group if the
+ * name is not a member of that group */
+static size_t internal_palette_find_index(const char *name,
+      const struct internal_palette_group *group)
+{
+   size_t lo = 0;
+   size_t hi = NUM_PALETTES_TOTAL;
 
-                  if (string_is_empty(value_intl))
-                     break;
+   /* Binary search of names in strcmp() order */
+   while (lo < hi)
+   {
+      size_t mid = (lo + hi) >> 1;
 
-                  if (string_is_equal(value, value_intl))
-                  {
-                     /* We have a match; fetch localised label */
-                     value_label = opt_def_intl->values[j].label;
-                     break;
-                  }
+      if (strcmp(internal_palette_names[internal_palette_sorted[mid]], name) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
-                  j++;
-               }
+   if (lo < NUM_PALETTES_TOTAL)
+   {
+      size_t index = internal_palette_sorted[lo];
+
+      if (string_is_equal(internal_palette_names[index], name) &&
+          (index >= group->offset) &&
+          (index <  group->offset + group->count))
+         return index;
+   }
+
+   return group->offset;
+}
+
+/* Fetches (localised, if available) palette label
+ * for notification purposes
+ * > Only called when switching palettes, so
+ *   translations are unpacked on demand and
+ *   released immediately */
+static const char *internal_palette_get_label(size_t palette_index)
+{
+   const char *name = internal_palette_names[palette_index];
+#ifndef HAVE_NO_LANGEXTRA
+   const struct internal_palette_group *group = NULL;
+   struct retro_core_options_v2 *options_intl = NULL;
+   struct retro_core_option_v2_definition *opt_def_intl;
+   struct retro_core_option_value *value_intl;
+
+   options_intl = libretro_core_options_intl_unpack(palette_language);
+   if (!options_intl)
+      return name;
+
+   group = internal_palette_get_group(palette_index);
 
-               break;
+   /* Find localised option corresponding to key */
+   for (opt_def_intl = options_intl->definitions;
+        !string_is_empty(opt_def_intl->key);
+        opt_def_intl++)
+   {
+      if (!string_is_equal(opt_def_intl->key, group->key))
+         continue;
+
+      /* Search for current option value */
+      for (value_intl = opt_def_intl->values;
+           !string_is_empty(value_intl->value);
+           value_intl++)
+      {
+         if (string_is_equal(value_intl->value, name))
+         {
+            if (value_intl->label)
+            {
+               strlcpy(palette_label_intl, value_intl->label,
+                     sizeof(palette_label_intl));
+               name = palette_label_intl;
             }
+            break;
          }
       }
-#endif
-      /* If localised palette label is unset,
-       * use value itself from option_defs_us */
-      if (!value_label)
-         value_label = value;
 
-      /* Cache label for 'consolidated' palette index */
-      internal_palette_labels[palette_offset + label_index++] = value_label;
+      break;
    }
+
+   libretro_core_options_intl_free(options_intl);
+#endif
+   return name;
 }
 
 static void init_palette_switch(void)
 {
-   struct retro_core_option_v2_definition *opt_defs_intl = NULL;
 #ifndef HAVE_NO_LANGEXTRA
-   unsigned language                                     = 0;
+   unsigned language = 0;
 #endif
 
    libretro_supports_set_variable = false;
@@ -718,148 +1026,57 @@ static void init_palette_switch(void)
    palette_switch_counter  = 0;
 
 #ifndef HAVE_NO_LANGEXTRA
-   if (environ_cb(RETRO_ENVIRONMENT_GET_LANGUAGE, &language) &&
-       (language < RETRO_LANGUAGE_LAST) &&
-       (language != RETRO_LANGUAGE_ENGLISH) &&
-       options_intl[language])
-      opt_defs_intl = options_intl[language]->definitions;
+   palette_language = RETRO_LANGUAGE_ENGLISH;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_LANGUAGE, &language))
+      palette_language = language;
 #endif
-
-   /* Parse palette values for each palette group
-    * > Default palettes */
-   parse_internal_palette_values("gambatte_gb_internal_palette",
-         opt_defs_intl, NUM_PALETTES_DEFAULT,
-         0,
-         &palettes_default_opt_values,
-         &palettes_default_index_map);
-   /* > TWB64 Pack 1 palettes */
-   parse_internal_palette_values("gambatte_gb_palette_twb64_1",
-         opt_defs_intl, NUM_PALETTES_TWB64_1,
-         NUM_PALETTES_DEFAULT,
-         &palettes_twb64_1_opt_values,
-         &palettes_twb64_1_index_map);
-   /* > TWB64 Pack 2 palettes */
-   parse_internal_palette_values("gambatte_gb_palette_twb64_2",
-         opt_defs_intl, NUM_PALETTES_TWB64_2,
-         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1,
-         &palettes_twb64_2_opt_values,
-         &palettes_twb64_2_index_map);
-   /* > TWB64 Pack 3 palettes */
-   parse_internal_palette_values("gambatte_gb_palette_twb64_3",
-         opt_defs_intl, NUM_PALETTES_TWB64_3,
-         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2,
-         &palettes_twb64_3_opt_values,
-         &palettes_twb64_3_index_map);
-   /* > PixelShift - Pack 1 palettes */
-   parse_internal_palette_values("gambatte_gb_palette_pixelshift_1",
-         opt_defs_intl, NUM_PALETTES_PIXELSHIFT_1,
-         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2 +
-         NUM_PALETTES_TWB64_3,
-         &palettes_pixelshift_1_opt_values,
-         &palettes_pixelshift_1_index_map);
 }
 
 static void deinit_palette_switch(void)
 {
-   libretro_supports_set_variable   = false;
-   libretro_msg_interface_version   = 0;
-   internal_palette_active          = false;
-   internal_palette_index           = 0;
-   palette_switch_counter           = 0;
-   palettes_default_opt_values      = NULL;
-   palettes_twb64_1_opt_values      = NULL;
-   palettes_twb64_2_opt_values      = NULL;
-   palettes_twb64_3_opt_values      = NULL;
-   palettes_pixelshift_1_opt_values = NULL;
-
-   RHMAP_FREE(palettes_default_index_map);
-   RHMAP_FREE(palettes_twb64_1_index_map);
-   RHMAP_FREE(palettes_twb64_2_index_map);
-   RHMAP_FREE(palettes_twb64_3_index_map);
-   RHMAP_FREE(palettes_pixelshift_1_index_map);
+   libretro_supports_set_variable = false;
+   libretro_msg_interface_version = 0;
+   internal_palette_active        = false;
+   internal_palette_index         = 0;
+   palette_switch_counter         = 0;
+#ifndef HAVE_NO_LANGEXTRA
+   palette_language               = RETRO_LANGUAGE_ENGLISH;
+#endif
 }
 
 static void palette_switch_set_index(size_t palette_index)
 {
-   const char *palettes_default_value = NULL;
-   const char *palettes_ext_key       = NULL;
-   const char *palettes_ext_value     = NULL;
-   size_t opt_index                   = 0;
-   struct retro_variable var          = {0};
+   const struct internal_palette_group *group = NULL;
+   const char *palette_label                  = NULL;
+   struct retro_variable var                  = {0};
 
    if (palette_index >= NUM_PALETTES_TOTAL)
       palette_index = NUM_PALETTES_TOTAL - 1;
 
    /* Check which palette group the specified
     * index corresponds to */
-   if (palette_index < NUM_PALETTES_DEFAULT)
-   {
-      /* This is a palette from the default group */
-      opt_index              = palette_index;
-      palettes_default_value = palettes_default_opt_values[opt_index].value;
-   }
-   else if (palette_index <
-         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1)
-   {
-      /* This is a palette from the TWB64 Pack 1 group */
-      palettes_default_value = "TWB64 - Pack 1";
-
-      opt_index              = palette_index - NUM_PALETTES_DEFAULT;
-      palettes_ext_key       = "gambatte_gb_palette_twb64_1";
-      palettes_ext_value     = palettes_twb64_1_opt_values[opt_index].value;
-   }
-   else if (palette_index <
-         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2)
-   {
-      /* This is a palette from the TWB64 Pack 2 group */
-      palettes_default_value = "TWB64 - Pack 2";
-
-      opt_index              = palette_index -
-            (NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1);
-      palettes_ext_key       = "gambatte_gb_palette_twb64_2";
-      palettes_ext_value     = palettes_twb64_2_opt_values[opt_index].value;
-   }
-   else if (palette_index <
-         NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2 +
-         NUM_PALETTES_TWB64_3)
-   {
-      /* This is a palette from the TWB64 Pack 3 group */
-      palettes_default_value = "TWB64 - Pack 3";
-
-      opt_index              = palette_index -
-            (NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2);
-      palettes_ext_key       = "gambatte_gb_palette_twb64_3";
-      palettes_ext_value     = palettes_twb64_3_opt_values[opt_index].value;
-   }
-   else
-   {
-      /* This is a palette from the PixelShift Pack 1 group */
-      palettes_default_value = "PixelShift - Pack 1";
-
-      opt_index              = palette_index -
-            (NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2 +
-             NUM_PALETTES_TWB64_3);
-      palettes_ext_key       = "gambatte_gb_palette_pixelshift_1";
-      palettes_ext_value     = palettes_pixelshift_1_opt_values[opt_index].value;
-   }
+   group = internal_palette_get_group(palette_index);
 
    /* Notify frontend of option value changes */
    var.key   = "gambatte_gb_internal_palette";
-   var.value = palettes_default_value;
+   var.value = group->selector ?
+         group->selector : internal_palette_names[palette_index];
    environ_cb(RETRO_ENVIRONMENT_SET_VARIABLE, &var);
 
-   if (palettes_ext_key)
+   if (group->selector)
    {
-      var.key   = palettes_ext_key;
-      var.value = palettes_ext_value;
+      var.key   = group->key;
+      var.value = internal_palette_names[palette_index];
       environ_cb(RETRO_ENVIRONMENT_SET_VARIABLE, &var);
    }
 
    /* Display notification message */
+   palette_label = internal_palette_get_label(palette_index);
+
    if (libretro_msg_interface_version >= 1)
    {
       struct retro_message_ext msg = {
-         internal_palette_labels[palette_index],
+         palette_label,
          2000,
          1,
          RETRO_LOG_INFO,
@@ -872,7 +1089,7 @@ static void palette_switch_set_index(size_t palette_index)
    else
    {
       struct retro_message msg = {
-         internal_palette_labels[palette_index],
+         palette_label,
          120
       };
       environ_cb(RETRO_ENVIRONMENT_SET_MESSAGE, &msg);
@@ -883,219 +1100,613 @@ static void palette_switch_set_index(size_t palette_index)
 /* Palette Switching END */
 /*************************/
 
-/*****************************/
-/* Interframe blending START */
-/*****************************/
-
-#define LCD_RESPONSE_TIME 0.333f
-/* > 'LCD Ghosting (Fast)' method does not
- *   correctly interpret the set response time,
- *   leading to an artificially subdued blur effect.
- *   We have to compensate for this by increasing
- *   the response time, hence this 'fake' value */
-#define LCD_RESPONSE_TIME_FAKE 0.5f
+/************************/
+/* Output scaling START */
+/************************/
 
-enum frame_blend_method
+/* Optional core-side scaling to the display's native
+ * resolution, for devices where the frontend scales in
+ * software (e.g. SF2000: 160x144 -> 320x240). Lines are
+ * scaled as soon as they have been blended, while still
+ * in cache, so each frame is only walked once */
+enum output_scale_method
 {
-   FRAME_BLEND_NONE = 0,
-   FRAME_BLEND_MIX,
-   FRAME_BLEND_LCD_GHOSTING,
-   FRAME_BLEND_LCD_GHOSTING_FAST,
-#ifdef __mips__
-   FRAME_BLEND_ULTRA_FAST
-#endif
+   OUTPUT_SCALE_NONE = 0,
+   OUTPUT_SCALE_2X,
+   OUTPUT_SCALE_2X_BLEND,
+   OUTPUT_SCALE_FIT
 };
 
-static enum frame_blend_method frame_blend_type  = FRAME_BLEND_NONE;
-static gambatte::video_pixel_t* video_buf_prev_1 = NULL;
-static gambatte::video_pixel_t* video_buf_prev_2 = NULL;
-static gambatte::video_pixel_t* video_buf_prev_3 = NULL;
-static gambatte::video_pixel_t* video_buf_prev_4 = NULL;
-static float* video_buf_acc_r                    = NULL;
-static float* video_buf_acc_g                    = NULL;
-static float* video_buf_acc_b                    = NULL;
-static float frame_blend_response[4]             = {0.0f};
-static int frame_blend_response_int[4]           = {0};
-static bool frame_blend_response_set             = false;
-static void (*blend_frames)(void)                = NULL;
+#define SCALE_FIT_WIDTH  320
+#define SCALE_FIT_HEIGHT 240
+#define SCALE_MAX_WIDTH  (2 * GB_SCREEN_WIDTH)
+#define SCALE_MAX_HEIGHT (2 * VIDEO_HEIGHT)
+#define SCALE_BUFF_SIZE  (SCALE_MAX_WIDTH * SCALE_MAX_HEIGHT * sizeof(gambatte::PixelXrgb8888::pixel_t))
+
+static enum output_scale_method output_scale_type = OUTPUT_SCALE_NONE;
+static void* scale_buf                            = NULL;
+static unsigned scale_width                       = GB_SCREEN_WIDTH;
+static unsigned scale_height                      = VIDEO_HEIGHT;
+/* Scales source line y (already blended) into scale_buf */
+static void (*scale_line)(const void *src, unsigned y) = NULL;
+/* 'Fit' scaling: source column of each output column, and
+ * first output row of each source row (plus one past the
+ * last, so that row y covers [map[y], map[y + 1]) ) */
+static uint16_t scale_col_map[SCALE_FIT_WIDTH];
+static uint16_t scale_row_map[VIDEO_HEIGHT + 1];
+
+/* Dimensions, buffer and pitch (in pixels) of the
+ * frames handed to the frontend */
+#define OUTPUT_WIDTH  (scale_line ? scale_width  : VIDEO_WIDTH)
+#define OUTPUT_HEIGHT (scale_line ? scale_height : VIDEO_HEIGHT)
+#define OUTPUT_BUF    (scale_line ? scale_buf    : video_buf)
+#define OUTPUT_PITCH  (scale_line ? SCALE_MAX_WIDTH : VIDEO_PITCH)
+
+/* 50:50 mix of two packed pixels
+ * > "Mixing Packed RGB Pixels Efficiently"
+ *   http://blargg.8bitalley.com/info/rgb_mixing.html */
+template<class Format>
+static inline typename Format::pixel_t pixel_mix(typename Format::pixel_t a,
+      typename Format::pixel_t b)
+{
+   return (a + b + ((a ^ b) & Format::mix_lsb)) >> 1;
+}
 
-/* > Note: The individual frame blending functions
- *   are somewhat WET (Write Everything Twice), in that
- *   we duplicate the entire nested for loop.
- *   This code is performance-critical, so we want to
- *   minimise logic in the inner loops where possible  */
-static void blend_frames_mix(void)
+#if defined(SCALE_SSE2) || defined(SCALE_NEON)
+/* 16 bytes of pixels at a time. pixel_mix() is done
+ * as (a | b) - (((a ^ b) & ~mix_lsb) >> 1), which
+ * gives the same result without carries, so that
+ * it works on any number of pixels per lane */
+#define SCALE_SIMD
+#define SCALE_VEC_BYTES 16
+
+#if defined(SCALE_SSE2)
+typedef __m128i scale_vec_t;
+
+static inline scale_vec_t scale_vec_load(const void *p)
 {
-   gambatte::video_pixel_t *curr = video_buf;
-   gambatte::video_pixel_t *prev = video_buf_prev_1;
-   
-#ifdef __mips__
-   /* MIPS-optimized version using 32-bit operations */
-   size_t total_pixels = VIDEO_HEIGHT * VIDEO_WIDTH;
-   size_t i;
-   
-#ifdef VIDEO_RGB565
-   const uint32_t blend_mask = 0x08210821; /* 0x821 for both pixels in 32-bit word */
-#elif defined(VIDEO_ABGR1555)
-   const uint32_t blend_mask = 0x05210521; /* 0x521 for both pixels in 32-bit word */
-#else
-   const uint32_t blend_mask = 0x01010101; /* 0x10101 for both pixels in 32-bit word */
-#endif
-   
-   /* Process 2 pixels at a time using 32-bit operations */
-   uint32_t *curr32 = (uint32_t*)curr;
-   uint32_t *prev32 = (uint32_t*)prev;
-   size_t pixels_32 = total_pixels >> 1; /* Divide by 2 for 32-bit processing */
-   
-   for (i = 0; i < pixels_32; i++)
+   return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void scale_vec_store(void *p, scale_vec_t v)
+{
+   _mm_storeu_si128((__m128i*)p, v);
+}
+
+static inline scale_vec_t scale_vec_set(uint32_t n)
+{
+   return _mm_set1_epi32((int)n);
+}
+
+static inline scale_vec_t scale_vec_mix(scale_vec_t a, scale_vec_t b,
+      scale_vec_t not_lsb)
+{
+   return _mm_sub_epi32(_mm_or_si128(a, b),
+         _mm_srli_epi32(_mm_and_si128(_mm_xor_si128(a, b), not_lsb), 1));
+}
+
+/* Interleaves the pixels of a and b */
+static inline void scale_vec_zip(scale_vec_t a, scale_vec_t b,
+      size_t pixel_size, scale_vec_t *lo, scale_vec_t *hi)
+{
+   if (pixel_size == 2)
    {
-      uint32_t curr_pair = curr32[i];
-      uint32_t prev_pair = prev32[i];
-      
-      /* Store current for next frame */
-      prev32[i] = curr_pair;
-      
-      /* Blend two pixels simultaneously */
-      curr32[i] = (curr_pair + prev_pair + ((curr_pair ^ prev_pair) & blend_mask)) >> 1;
+      *lo = _mm_unpacklo_epi16(a, b);
+      *hi = _mm_unpackhi_epi16(a, b);
    }
-   
-   /* Handle odd pixel if VIDEO_WIDTH * VIDEO_HEIGHT is odd */
-   if (total_pixels & 1)
+   else
    {
-      gambatte::video_pixel_t rgb_curr = curr[total_pixels - 1];
-      gambatte::video_pixel_t rgb_prev = prev[total_pixels - 1];
-      prev[total_pixels - 1] = rgb_curr;
-      
-#ifdef VIDEO_RGB565
-      curr[total_pixels - 1] = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x821)) >> 1;
-#elif defined(VIDEO_ABGR1555)
-      curr[total_pixels - 1] = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x521)) >> 1;
-#else
-      curr[total_pixels - 1] = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x10101)) >> 1;
-#endif
+      *lo = _mm_unpacklo_epi32(a, b);
+      *hi = _mm_unpackhi_epi32(a, b);
    }
+}
 #else
-   /* Original version for other architectures */
-   size_t x, y;
-   
-   for (y = 0; y < VIDEO_HEIGHT; y++)
-   {
-      for (x = 0; x < VIDEO_WIDTH; x++)
-      {
-         /* Get colours from current + previous frames */
-         gambatte::video_pixel_t rgb_curr = *(curr + x);
-         gambatte::video_pixel_t rgb_prev = *(prev + x);
-
-         /* Store colours for next frame */
-         *(prev + x) = rgb_curr;
-
-         /* Mix colours
-          * > "Mixing Packed RGB Pixels Efficiently"
-          *   http://blargg.8bitalley.com/info/rgb_mixing.html */
-#ifdef VIDEO_RGB565
-         *(curr + x) = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x821)) >> 1;
-#elif defined(VIDEO_ABGR1555)
-         *(curr + x) = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x521)) >> 1;
-#else
-         *(curr + x) = (rgb_curr + rgb_prev + ((rgb_curr ^ rgb_prev) & 0x10101)) >> 1;
-#endif
-      }
+typedef uint32x4_t scale_vec_t;
 
-      curr += VIDEO_PITCH;
-      prev += VIDEO_PITCH;
-   }
-#endif
+/* Byte loads and stores, as 16 bit pixels are
+ * not always 4 byte aligned */
+static inline scale_vec_t scale_vec_load(const void *p)
+{
+   return vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)p));
 }
 
-static void blend_frames_lcd_ghost(void)
+static inline void scale_vec_store(void *p, scale_vec_t v)
 {
-   gambatte::video_pixel_t *curr   = video_buf;
-   gambatte::video_pixel_t *prev_1 = video_buf_prev_1;
-   gambatte::video_pixel_t *prev_2 = video_buf_prev_2;
-   gambatte::video_pixel_t *prev_3 = video_buf_prev_3;
-   gambatte::video_pixel_t *prev_4 = video_buf_prev_4;
-   int *response                   = frame_blend_response_int;
-   size_t x, y;
-
-   for (y = 0; y < VIDEO_HEIGHT; y++)
-   {
-      for (x = 0; x < VIDEO_WIDTH; x++)
-      {
-         /* Get colours from current + previous frames */
-         gambatte::video_pixel_t rgb_curr   = *(curr + x);
-         gambatte::video_pixel_t rgb_prev_1 = *(prev_1 + x);
-         gambatte::video_pixel_t rgb_prev_2 = *(prev_2 + x);
-         gambatte::video_pixel_t rgb_prev_3 = *(prev_3 + x);
-         gambatte::video_pixel_t rgb_prev_4 = *(prev_4 + x);
-
-         /* Store colours for next frame */
-         *(prev_1 + x) = rgb_curr;
-         *(prev_2 + x) = rgb_prev_1;
-         *(prev_3 + x) = rgb_prev_2;
-         *(prev_4 + x) = rgb_prev_3;
+   vst1q_u8((uint8_t*)p, vreinterpretq_u8_u32(v));
+}
 
-         /* Unpack colours to integers */
-#ifdef VIDEO_RGB565
-         int r_curr = (rgb_curr >> 11) & 0x1F;
-         int g_curr = (rgb_curr >> 6) & 0x1F;
-         int b_curr = rgb_curr & 0x1F;
-
-         int r_prev_1 = (rgb_prev_1 >> 11) & 0x1F;
-         int g_prev_1 = (rgb_prev_1 >> 6) & 0x1F;
-         int b_prev_1 = rgb_prev_1 & 0x1F;
-
-         int r_prev_2 = (rgb_prev_2 >> 11) & 0x1F;
-         int g_prev_2 = (rgb_prev_2 >> 6) & 0x1F;
-         int b_prev_2 = rgb_prev_2 & 0x1F;
-
-         int r_prev_3 = (rgb_prev_3 >> 11) & 0x1F;
-         int g_prev_3 = (rgb_prev_3 >> 6) & 0x1F;
-         int b_prev_3 = rgb_prev_3 & 0x1F;
-
-         int r_prev_4 = (rgb_prev_4 >> 11) & 0x1F;
-         int g_prev_4 = (rgb_prev_4 >> 6) & 0x1F;
-         int b_prev_4 = rgb_prev_4 & 0x1F;
-#elif defined(VIDEO_ABGR1555)
-         int r_curr = rgb_curr & 0x1F;
-         int g_curr = (rgb_curr >> 5) & 0x1F;
-         int b_curr = (rgb_curr >> 10) & 0x1F;
-
-         int r_prev_1 = rgb_prev_1 & 0x1F;
-         int g_prev_1 = (rgb_prev_1 >> 5) & 0x1F;
-         int b_prev_1 = (rgb_prev_1 >> 10) & 0x1F;
-
-         int r_prev_2 = rgb_prev_2 & 0x1F;
-         int g_prev_2 = (rgb_prev_2 >> 5) & 0x1F;
-         int b_prev_2 = (rgb_prev_2 >> 10) & 0x1F;
-
-         int r_prev_3 = rgb_prev_3 & 0x1F;
-         int g_prev_3 = (rgb_prev_3 >> 5) & 0x1F;
-         int b_prev_3 = (rgb_prev_3 >> 10) & 0x1F;
-
-         int r_prev_4 = rgb_prev_4 & 0x1F;
-         int g_prev_4 = (rgb_prev_4 >> 5) & 0x1F;
-         int b_prev_4 = (rgb_prev_4 >> 10) & 0x1F;
-#else
-         int r_curr = (rgb_curr >> 16) & 0x1F;
-         int g_curr = (rgb_curr >> 8) & 0x1F;
-         int b_curr = rgb_curr & 0x1F;
+static inline scale_vec_t scale_vec_set(uint32_t n)
+{
+   return vdupq_n_u32(n);
+}
 
-         int r_prev_1 = (rgb_prev_1 >> 16) & 0x1F;
-         int g_prev_1 = (rgb_prev_1 >> 8) & 0x1F;
-         int b_prev_1 = rgb_prev_1 & 0x1F;
+static inline scale_vec_t scale_vec_mix(scale_vec_t a, scale_vec_t b,
+      scale_vec_t not_lsb)
+{
+   return vsubq_u32(vorrq_u32(a, b),
+         vshrq_n_u32(vandq_u32(veorq_u32(a, b), not_lsb), 1));
+}
 
-         int r_prev_2 = (rgb_prev_2 >> 16) & 0x1F;
-         int g_prev_2 = (rgb_prev_2 >> 8) & 0x1F;
-         int b_prev_2 = rgb_prev_2 & 0x1F;
+/* Interleaves the pixels of a and b */
+static inline void scale_vec_zip(scale_vec_t a, scale_vec_t b,
+      size_t pixel_size, scale_vec_t *lo, scale_vec_t *hi)
+{
+   if (pixel_size == 2)
+   {
+      uint16x8x2_t z = vzipq_u16(vreinterpretq_u16_u32(a),
+            vreinterpretq_u16_u32(b));
+      *lo = vreinterpretq_u32_u16(z.val[0]);
+      *hi = vreinterpretq_u32_u16(z.val[1]);
+   }
+   else
+   {
+      uint32x4x2_t z = vzipq_u32(a, b);
+      *lo = z.val[0];
+      *hi = z.val[1];
+   }
+}
+#endif
+
+/* ~mix_lsb for every pixel of a 32 bit lane */
+template<class Format>
+static inline scale_vec_t scale_vec_not_lsb(void)
+{
+   return scale_vec_set(~(sizeof(typename Format::pixel_t) == 2 ?
+         (uint32_t)Format::mix_lsb * 0x10001u : (uint32_t)Format::mix_lsb));
+}
+#endif
+
+template<class Format>
+static void scale_line_2x(const void *src_line, unsigned y)
+{
+   typedef typename Format::pixel_t pixel_t;
+   const pixel_t *src = (const pixel_t*)src_line;
+   pixel_t *dst       = (pixel_t*)scale_buf + 2 * y * SCALE_MAX_WIDTH;
+   size_t x;
+
+#ifdef SCALE_SIMD
+   /* GB_SCREEN_WIDTH is a whole number of vectors */
+   const size_t lanes = SCALE_VEC_BYTES / sizeof(pixel_t);
+
+   for (x = 0; x < GB_SCREEN_WIDTH; x += lanes)
+   {
+      scale_vec_t rgb = scale_vec_load(src + x);
+      scale_vec_t lo, hi;
+
+      scale_vec_zip(rgb, rgb, sizeof(pixel_t), &lo, &hi);
+      scale_vec_store(dst + 2 * x, lo);
+      scale_vec_store(dst + 2 * x + lanes, hi);
+   }
+#else
+   if (sizeof(pixel_t) == 2)
+   {
+      /* Both halves of each 32-bit store hold the same
+       * pixel, so this is endian-neutral */
+      uint32_t *dst32 = (uint32_t*)dst;
+      for (x = 0; x < GB_SCREEN_WIDTH; x++)
+         dst32[x] = src[x] * 0x10001u;
+   }
+   else
+   {
+      for (x = 0; x < GB_SCREEN_WIDTH; x++)
+      {
+         pixel_t rgb    = src[x];
+         dst[2 * x]     = rgb;
+         dst[2 * x + 1] = rgb;
+      }
+   }
+#endif
+
+   memcpy(dst + SCALE_MAX_WIDTH, dst, SCALE_MAX_WIDTH * sizeof(pixel_t));
+}
+
+/* Writes the two output lines of source line 'top',
+ * interpolating towards the line below and the pixel
+ * to the right */
+template<class Format>
+static void scale_lines_2x_blend(const typename Format::pixel_t *top,
+      const typename Format::pixel_t *bottom, typename Format::pixel_t *dst)
+{
+   typedef typename Format::pixel_t pixel_t;
+   pixel_t *dst_below = dst + SCALE_MAX_WIDTH;
+   pixel_t top_l;
+   pixel_t bottom_l;
+   size_t x           = 0;
+
+#ifdef SCALE_SIMD
+   const size_t lanes  = SCALE_VEC_BYTES / sizeof(pixel_t);
+   scale_vec_t not_lsb = scale_vec_not_lsb<Format>();
+
+   /* The last pixel, which has no right neighbour,
+    * is left to the scalar loop */
+   for (; x + lanes < GB_SCREEN_WIDTH; x += lanes)
+   {
+      scale_vec_t top_l_v    = scale_vec_load(top + x);
+      scale_vec_t top_r_v    = scale_vec_load(top + x + 1);
+      scale_vec_t bottom_l_v = scale_vec_load(bottom + x);
+      scale_vec_t bottom_r_v = scale_vec_load(bottom + x + 1);
+      scale_vec_t top_mid_v  = scale_vec_mix(top_l_v, top_r_v, not_lsb);
+      scale_vec_t lo, hi;
+
+      scale_vec_zip(top_l_v, top_mid_v, sizeof(pixel_t), &lo, &hi);
+      scale_vec_store(dst + 2 * x, lo);
+      scale_vec_store(dst + 2 * x + lanes, hi);
+
+      scale_vec_zip(scale_vec_mix(top_l_v, bottom_l_v, not_lsb),
+            scale_vec_mix(top_mid_v,
+                  scale_vec_mix(bottom_l_v, bottom_r_v, not_lsb), not_lsb),
+            sizeof(pixel_t), &lo, &hi);
+      scale_vec_store(dst_below + 2 * x, lo);
+      scale_vec_store(dst_below + 2 * x + lanes, hi);
+   }
+#endif
+
+   top_l    = top[x];
+   bottom_l = bottom[x];
+
+   for (; x < GB_SCREEN_WIDTH; x++)
+   {
+      size_t x_r       = (x < GB_SCREEN_WIDTH - 1) ? x + 1 : x;
+      pixel_t top_r    = top[x_r];
+      pixel_t bottom_r = bottom[x_r];
+      pixel_t top_mid  = pixel_mix<Format>(top_l, top_r);
+
+      dst[2 * x]           = top_l;
+      dst[2 * x + 1]       = top_mid;
+      dst_below[2 * x]     = pixel_mix<Format>(top_l, bottom_l);
+      dst_below[2 * x + 1] = pixel_mix<Format>(top_mid,
+            pixel_mix<Format>(bottom_l, bottom_r));
+
+      top_l    = top_r;
+      bottom_l = bottom_r;
+   }
+}
+
+/* Interpolation needs the following source line, so
+ * output lags one line behind; the last line is
+ * flushed against itself */
+template<class Format>
+static void scale_line_2x_blend(const void *src_line, unsigned y)
+{
+   typedef typename Format::pixel_t pixel_t;
+   const pixel_t *src = (const pixel_t*)src_line;
+   pixel_t *dst       = (pixel_t*)scale_buf + 2 * y * SCALE_MAX_WIDTH;
+
+   if (y > 0)
+      scale_lines_2x_blend<Format>(src - VIDEO_PITCH, src,
+            dst - 2 * SCALE_MAX_WIDTH);
+
+   if (y == VIDEO_HEIGHT - 1)
+      scale_lines_2x_blend<Format>(src, src, dst);
+}
+
+template<class Format>
+static void scale_line_fit(const void *src_line, unsigned y)
+{
+   typedef typename Format::pixel_t pixel_t;
+   const pixel_t *src = (const pixel_t*)src_line;
+   pixel_t *dst       = (pixel_t*)scale_buf + scale_row_map[y] * SCALE_MAX_WIDTH;
+   unsigned rows      = scale_row_map[y + 1] - scale_row_map[y];
+   size_t x;
+
+   for (x = 0; x < SCALE_FIT_WIDTH; x++)
+      dst[x] = src[scale_col_map[x]];
+
+   for (; rows > 1; rows--)
+   {
+      memcpy(dst + SCALE_MAX_WIDTH, dst, SCALE_FIT_WIDTH * sizeof(pixel_t));
+      dst += SCALE_MAX_WIDTH;
+   }
+}
+
+/* Scaling pass for frames that are not blended
+ * (blended frames are scaled by blend_frames) */
+static void scale_frame(void)
+{
+   const unsigned char *src = (const unsigned char*)video_buf;
+   unsigned y;
+
+   for (y = 0; y < VIDEO_HEIGHT; y++)
+   {
+      scale_line(src, y);
+      src += VIDEO_PITCH * video_pixel_size;
+   }
+}
+
+static void init_output_scaling(void)
+{
+   unsigned i;
+
+   scale_line   = NULL;
+   scale_width  = GB_SCREEN_WIDTH;
+   scale_height = VIDEO_HEIGHT;
+
+   /* Local link output is two screens wide */
+   if ((output_scale_type == OUTPUT_SCALE_NONE) || (NUM_GAMEBOYS > 1))
+      return;
+
+   if (!scale_buf)
+   {
+      scale_buf = malloc(SCALE_BUFF_SIZE);
+      if (!scale_buf)
+         return;
+   }
+
+   switch (output_scale_type)
+   {
+      case OUTPUT_SCALE_2X:
+         scale_width  = SCALE_MAX_WIDTH;
+         scale_height = SCALE_MAX_HEIGHT;
+         scale_line   = PIXEL_FORMAT_FUNC(scale_line_2x);
+         break;
+      case OUTPUT_SCALE_2X_BLEND:
+         scale_width  = SCALE_MAX_WIDTH;
+         scale_height = SCALE_MAX_HEIGHT;
+         scale_line   = PIXEL_FORMAT_FUNC(scale_line_2x_blend);
+         break;
+      case OUTPUT_SCALE_FIT:
+         scale_width  = SCALE_FIT_WIDTH;
+         scale_height = SCALE_FIT_HEIGHT;
+         for (i = 0; i < SCALE_FIT_WIDTH; i++)
+            scale_col_map[i] = i * GB_SCREEN_WIDTH / SCALE_FIT_WIDTH;
+         for (i = 0; i <= VIDEO_HEIGHT; i++)
+            scale_row_map[i] = (i * SCALE_FIT_HEIGHT + VIDEO_HEIGHT - 1) / VIDEO_HEIGHT;
+         scale_line   = PIXEL_FORMAT_FUNC(scale_line_fit);
+         break;
+      default:
+         break;
+   }
+}
+
+static void deinit_output_scaling(void)
+{
+   free(scale_buf);
+   scale_buf         = NULL;
+   scale_line        = NULL;
+   output_scale_type = OUTPUT_SCALE_NONE;
+}
+
+static void check_output_scale_variable(bool startup)
+{
+   struct retro_variable var;
+   enum output_scale_method old_output_scale_type = output_scale_type;
+
+   output_scale_type = OUTPUT_SCALE_NONE;
+
+   var.key   = "gambatte_output_scale";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "2x"))
+         output_scale_type = OUTPUT_SCALE_2X;
+      else if (!strcmp(var.value, "2x_blend"))
+         output_scale_type = OUTPUT_SCALE_2X_BLEND;
+      else if (!strcmp(var.value, "fit_320x240"))
+         output_scale_type = OUTPUT_SCALE_FIT;
+   }
+
+   if (startup || (output_scale_type != old_output_scale_type))
+      init_output_scaling();
+
+   if (!startup && (output_scale_type != old_output_scale_type))
+   {
+      struct retro_system_av_info av_info;
+      retro_get_system_av_info(&av_info);
+      environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &av_info.geometry);
+   }
+}
+
+/**********************/
+/* Output scaling END */
+/**********************/
+
+/*****************************/
+/* Interframe blending START */
+/*****************************/
+
+#define LCD_RESPONSE_TIME 0.333f
+/* > 'LCD Ghosting (Fast)' method does not
+ *   correctly interpret the set response time,
+ *   leading to an artificially subdued blur effect.
+ *   We have to compensate for this by increasing
+ *   the response time, hence this 'fake' value */
+#define LCD_RESPONSE_TIME_FAKE 0.5f
+
+enum frame_blend_method
+{
+   FRAME_BLEND_NONE = 0,
+   FRAME_BLEND_MIX,
+   FRAME_BLEND_LCD_GHOSTING,
+   FRAME_BLEND_LCD_GHOSTING_FAST,
+#ifdef __mips__
+   FRAME_BLEND_ULTRA_FAST
+#endif
+};
+
+static enum frame_blend_method frame_blend_type  = FRAME_BLEND_NONE;
+/* Frames drawn by the core are kept in a ring of
+ * buffers, as history for blending: each frame is
+ * drawn to the slot of the oldest, and blended from
+ * the ring into video_buf. History is never copied,
+ * the slots just change roles from frame to frame
+ * > Slot video_buf_ring_curr is the frame being drawn,
+ *   and blended */
+#define VIDEO_BUF_RING_MAX_SIZE 5
+static void* video_buf_ring[VIDEO_BUF_RING_MAX_SIZE] = {NULL};
+static unsigned video_buf_ring_size              = 0;
+static unsigned video_buf_ring_curr              = 0;
+static float* video_buf_acc_r                    = NULL;
+static float* video_buf_acc_g                    = NULL;
+static float* video_buf_acc_b                    = NULL;
+static float frame_blend_response[4]             = {0.0f};
+static int frame_blend_response_int[4]           = {0};
+static bool frame_blend_response_set             = false;
+static void (*blend_frames)(void)                = NULL;
+
+/* Frame drawn 'age' frames before the current one */
+static inline void *video_buf_ring_frame(unsigned age)
+{
+   return video_buf_ring[(video_buf_ring_curr + video_buf_ring_size - age) %
+         video_buf_ring_size];
+}
 
-         int r_prev_3 = (rgb_prev_3 >> 16) & 0x1F;
-         int g_prev_3 = (rgb_prev_3 >> 8) & 0x1F;
-         int b_prev_3 = rgb_prev_3 & 0x1F;
+/* Makes the oldest frame's slot current, once the
+ * current frame has been blended */
+static void video_buf_ring_advance(void)
+{
+   if (++video_buf_ring_curr == video_buf_ring_size)
+      video_buf_ring_curr = 0;
+}
+
+/* Fills the whole ring with the last unblended frame,
+ * so that blending switched back on does not pick up
+ * stale history */
+static void video_buf_ring_fill(void)
+{
+   unsigned i;
+
+   for (i = 0; i < video_buf_ring_size; i++)
+      memcpy(video_buf_ring[i], video_buf, VIDEO_BUFF_SIZE);
+}
+
+/* Copies a screen of the previous frame to the one
+ * being drawn, for when the screen was not redrawn
+ * (e.g. a link player that did not finish a frame) */
+static void video_buf_ring_keep_screen(size_t offset)
+{
+   const unsigned char *src;
+   unsigned char *dst;
+   unsigned y;
+
+   if (render_buf == video_buf)
+      return;
+
+   src = (const unsigned char*)video_buf_ring_frame(1) + offset;
+   dst = (unsigned char*)render_buf + offset;
+
+   for (y = 0; y < VIDEO_HEIGHT; y++)
+   {
+      memcpy(dst, src, GB_SCREEN_WIDTH * video_pixel_size);
+      src += VIDEO_PITCH * video_pixel_size;
+      dst += VIDEO_PITCH * video_pixel_size;
+   }
+}
 
-         int r_prev_4 = (rgb_prev_4 >> 16) & 0x1F;
-         int g_prev_4 = (rgb_prev_4 >> 8) & 0x1F;
-         int b_prev_4 = rgb_prev_4 & 0x1F;
+/* > Note: The individual frame blending functions
+ *   are somewhat WET (Write Everything Twice), in that
+ *   we duplicate the entire nested for loop.
+ *   This code is performance-critical, so we want to
+ *   minimise logic in the inner loops where possible.
+ * > Each function is instantiated once per pixel
+ *   format, so channel layout is a compile time
+ *   constant in the inner loops
+ * > Frames are only read from the history ring, and
+ *   each blended pixel is written once, to video_buf
+ * > Blended lines are passed straight on to the
+ *   output scaler, if enabled */
+template<class Format>
+static void blend_frames_mix(void)
+{
+   typedef typename Format::pixel_t pixel_t;
+   const pixel_t *curr = (const pixel_t*)video_buf_ring_frame(0);
+   const pixel_t *prev = (const pixel_t*)video_buf_ring_frame(1);
+   pixel_t *out        = (pixel_t*)video_buf;
+   
+   size_t x, y;
+   
+   for (y = 0; y < VIDEO_HEIGHT; y++)
+   {
+      x = 0;
+#ifdef __mips__
+      /* MIPS-optimized version using 32-bit operations */
+      if (sizeof(pixel_t) == 2)
+      {
+         /* Format::mix_lsb for both pixels in 32-bit word */
+         const uint32_t blend_mask = Format::mix_lsb * 0x10001u;
+         
+         /* Process 2 pixels at a time using 32-bit operations */
+         const uint32_t *curr32 = (const uint32_t*)curr;
+         const uint32_t *prev32 = (const uint32_t*)prev;
+         uint32_t *out32        = (uint32_t*)out;
+         
+         for (; x < (VIDEO_WIDTH >> 1); x++)
+         {
+            uint32_t curr_pair = curr32[x];
+            uint32_t prev_pair = prev32[x];
+            
+            /* Blend two pixels simultaneously */
+            out32[x] = (curr_pair + prev_pair + ((curr_pair ^ prev_pair) & blend_mask)) >> 1;
+         }
+         x <<= 1;
+      }
 #endif
+      for (; x < VIDEO_WIDTH; x++)
+      {
+         /* Get colours from current + previous frames */
+         pixel_t rgb_curr = *(curr + x);
+         pixel_t rgb_prev = *(prev + x);
+
+         /* Mix colours */
+         *(out + x) = pixel_mix<Format>(rgb_curr, rgb_prev);
+      }
+
+      if (scale_line)
+         scale_line(out, y);
+
+      curr += VIDEO_PITCH;
+      prev += VIDEO_PITCH;
+      out  += VIDEO_PITCH;
+   }
+}
+
+template<class Format>
+static void blend_frames_lcd_ghost(void)
+{
+   typedef typename Format::pixel_t pixel_t;
+   enum { rs = Format::red_shift, gs = Format::green_shift, bs = Format::blue_shift };
+   enum { cmax = Format::channel_max };
+   const pixel_t *curr   = (const pixel_t*)video_buf_ring_frame(0);
+   const pixel_t *prev_1 = (const pixel_t*)video_buf_ring_frame(1);
+   const pixel_t *prev_2 = (const pixel_t*)video_buf_ring_frame(2);
+   const pixel_t *prev_3 = (const pixel_t*)video_buf_ring_frame(3);
+   const pixel_t *prev_4 = (const pixel_t*)video_buf_ring_frame(4);
+   pixel_t *out          = (pixel_t*)video_buf;
+   int *response         = frame_blend_response_int;
+   size_t x, y;
+
+   for (y = 0; y < VIDEO_HEIGHT; y++)
+   {
+      for (x = 0; x < VIDEO_WIDTH; x++)
+      {
+         /* Get colours from current + previous frames */
+         pixel_t rgb_curr   = *(curr + x);
+         pixel_t rgb_prev_1 = *(prev_1 + x);
+         pixel_t rgb_prev_2 = *(prev_2 + x);
+         pixel_t rgb_prev_3 = *(prev_3 + x);
+         pixel_t rgb_prev_4 = *(prev_4 + x);
+
+         /* Unpack colours to integers */
+         int r_curr = (rgb_curr >> rs) & cmax;
+         int g_curr = (rgb_curr >> gs) & cmax;
+         int b_curr = (rgb_curr >> bs) & cmax;
+
+         int r_prev_1 = (rgb_prev_1 >> rs) & cmax;
+         int g_prev_1 = (rgb_prev_1 >> gs) & cmax;
+         int b_prev_1 = (rgb_prev_1 >> bs) & cmax;
+
+         int r_prev_2 = (rgb_prev_2 >> rs) & cmax;
+         int g_prev_2 = (rgb_prev_2 >> gs) & cmax;
+         int b_prev_2 = (rgb_prev_2 >> bs) & cmax;
+
+         int r_prev_3 = (rgb_prev_3 >> rs) & cmax;
+         int g_prev_3 = (rgb_prev_3 >> gs) & cmax;
+         int b_prev_3 = (rgb_prev_3 >> bs) & cmax;
+
+         int r_prev_4 = (rgb_prev_4 >> rs) & cmax;
+         int g_prev_4 = (rgb_prev_4 >> gs) & cmax;
+         int b_prev_4 = (rgb_prev_4 >> bs) & cmax;
+
          /* Mix colours using fixed-point arithmetic (8.8 format)
           * > Response time effect implemented via an exponential
           *   drop-off algorithm, taken from the 'Gameboy Classic Shader'
@@ -1128,86 +1739,40 @@ static void blend_frames_lcd_ghost(void)
          int b_mix = (b_accum + 128) >> 8;
          
          /* Clamp to valid range */
-         r_mix = (r_mix > 0x1F) ? 0x1F : ((r_mix < 0) ? 0 : r_mix);
-         g_mix = (g_mix > 0x1F) ? 0x1F : ((g_mix < 0) ? 0 : g_mix);
-         b_mix = (b_mix > 0x1F) ? 0x1F : ((b_mix < 0) ? 0 : b_mix);
+         r_mix = (r_mix > cmax) ? cmax : ((r_mix < 0) ? 0 : r_mix);
+         g_mix = (g_mix > cmax) ? cmax : ((g_mix < 0) ? 0 : g_mix);
+         b_mix = (b_mix > cmax) ? cmax : ((b_mix < 0) ? 0 : b_mix);
 
          /* Repack colours for current frame */
-#ifdef VIDEO_RGB565
-         *(curr + x) = (r_mix << 11) | (g_mix << 6) | b_mix;
-#elif defined(VIDEO_ABGR1555)
-         *(curr + x) = r_mix | (g_mix << 5) | (b_mix << 10);
-#else
-         *(curr + x) = (r_mix << 16) | (g_mix << 8) | b_mix;
-#endif
+         *(out + x) = (r_mix << rs) | (g_mix << gs) | (b_mix << bs);
       }
 
+      if (scale_line)
+         scale_line(out, y);
+
       curr   += VIDEO_PITCH;
       prev_1 += VIDEO_PITCH;
       prev_2 += VIDEO_PITCH;
       prev_3 += VIDEO_PITCH;
       prev_4 += VIDEO_PITCH;
+      out    += VIDEO_PITCH;
    }
 }
 
+template<class Format>
 static void blend_frames_lcd_ghost_fast(void)
 {
-   gambatte::video_pixel_t *curr = video_buf;
-   gambatte::video_pixel_t *prev = video_buf_prev_1;
+   typedef typename Format::pixel_t pixel_t;
+   enum { rs = Format::red_shift, gs = Format::green_shift, bs = Format::blue_shift };
+   enum { cmax = Format::channel_max };
+   const pixel_t *curr = (const pixel_t*)video_buf_ring_frame(0);
+   const pixel_t *prev = (const pixel_t*)video_buf_ring_frame(1);
+   pixel_t *out        = (pixel_t*)video_buf;
    
    /* Convert LCD_RESPONSE_TIME_FAKE to fixed point (8.8 format) */
    static const int fade_factor = static_cast<int>(LCD_RESPONSE_TIME_FAKE * 256.0f);
    static const int curr_factor = 256 - fade_factor;
 
-#ifdef __mips__
-   /* MIPS-optimized version with reduced per-pixel overhead */
-   size_t total_pixels = VIDEO_HEIGHT * VIDEO_WIDTH;
-   size_t i;
-   
-   for (i = 0; i < total_pixels; i++)
-   {
-      gambatte::video_pixel_t rgb_curr = curr[i];
-      gambatte::video_pixel_t rgb_prev = prev[i];
-
-      /* Store current for next frame */
-      prev[i] = rgb_curr;
-
-#ifdef VIDEO_RGB565
-      /* Extract and blend components in one go */
-      int r_mix = (((rgb_curr >> 11) & 0x1F) * curr_factor + ((rgb_prev >> 11) & 0x1F) * fade_factor) >> 8;
-      int g_mix = (((rgb_curr >> 6) & 0x1F) * curr_factor + ((rgb_prev >> 6) & 0x1F) * fade_factor) >> 8;
-      int b_mix = ((rgb_curr & 0x1F) * curr_factor + (rgb_prev & 0x1F) * fade_factor) >> 8;
-      
-      /* Clamp and pack efficiently */
-      r_mix = (r_mix > 0x1F) ? 0x1F : r_mix;
-      g_mix = (g_mix > 0x1F) ? 0x1F : g_mix;
-      b_mix = (b_mix > 0x1F) ? 0x1F : b_mix;
-      
-      curr[i] = (r_mix << 11) | (g_mix << 6) | b_mix;
-#elif defined(VIDEO_ABGR1555)
-      int r_mix = ((rgb_curr & 0x1F) * curr_factor + (rgb_prev & 0x1F) * fade_factor) >> 8;
-      int g_mix = (((rgb_curr >> 5) & 0x1F) * curr_factor + ((rgb_prev >> 5) & 0x1F) * fade_factor) >> 8;
-      int b_mix = (((rgb_curr >> 10) & 0x1F) * curr_factor + ((rgb_prev >> 10) & 0x1F) * fade_factor) >> 8;
-      
-      r_mix = (r_mix > 0x1F) ? 0x1F : r_mix;
-      g_mix = (g_mix > 0x1F) ? 0x1F : g_mix;
-      b_mix = (b_mix > 0x1F) ? 0x1F : b_mix;
-      
-      curr[i] = r_mix | (g_mix << 5) | (b_mix << 10);
-#else
-      int r_mix = (((rgb_curr >> 16) & 0x1F) * curr_factor + ((rgb_prev >> 16) & 0x1F) * fade_factor) >> 8;
-      int g_mix = (((rgb_curr >> 8) & 0x1F) * curr_factor + ((rgb_prev >> 8) & 0x1F) * fade_factor) >> 8;
-      int b_mix = ((rgb_curr & 0x1F) * curr_factor + (rgb_prev & 0x1F) * fade_factor) >> 8;
-      
-      r_mix = (r_mix > 0x1F) ? 0x1F : r_mix;
-      g_mix = (g_mix > 0x1F) ? 0x1F : g_mix;
-      b_mix = (b_mix > 0x1F) ? 0x1F : b_mix;
-      
-      curr[i] = (r_mix << 16) | (g_mix << 8) | b_mix;
-#endif
-   }
-#else
-   /* Original version for other architectures */
    size_t x, y;
    
    for (y = 0; y < VIDEO_HEIGHT; y++)
@@ -1215,38 +1780,17 @@ static void blend_frames_lcd_ghost_fast(void)
       for (x = 0; x < VIDEO_WIDTH; x++)
       {
          /* Get colours from current + previous frames */
-         gambatte::video_pixel_t rgb_curr = *(curr + x);
-         gambatte::video_pixel_t rgb_prev = *(prev + x);
-
-         /* Store current for next frame */
-         *(prev + x) = rgb_curr;
+         pixel_t rgb_curr = *(curr + x);
+         pixel_t rgb_prev = *(prev + x);
 
          /* Unpack current and previous colours */
-#ifdef VIDEO_RGB565
-         int r_curr = (rgb_curr >> 11) & 0x1F;
-         int g_curr = (rgb_curr >> 6) & 0x1F;
-         int b_curr = rgb_curr & 0x1F;
+         int r_curr = (rgb_curr >> rs) & cmax;
+         int g_curr = (rgb_curr >> gs) & cmax;
+         int b_curr = (rgb_curr >> bs) & cmax;
          
-         int r_prev = (rgb_prev >> 11) & 0x1F;
-         int g_prev = (rgb_prev >> 6) & 0x1F;
-         int b_prev = rgb_prev & 0x1F;
-#elif defined(VIDEO_ABGR1555)
-         int r_curr = rgb_curr & 0x1F;
-         int g_curr = (rgb_curr >> 5) & 0x1F;
-         int b_curr = (rgb_curr >> 10) & 0x1F;
-         
-         int r_prev = rgb_prev & 0x1F;
-         int g_prev = (rgb_prev >> 5) & 0x1F;
-         int b_prev = (rgb_prev >> 10) & 0x1F;
-#else
-         int r_curr = (rgb_curr >> 16) & 0x1F;
-         int g_curr = (rgb_curr >> 8) & 0x1F;
-         int b_curr = rgb_curr & 0x1F;
-         
-         int r_prev = (rgb_prev >> 16) & 0x1F;
-         int g_prev = (rgb_prev >> 8) & 0x1F;
-         int b_prev = rgb_prev & 0x1F;
-#endif
+         int r_prev = (rgb_prev >> rs) & cmax;
+         int g_prev = (rgb_prev >> gs) & cmax;
+         int b_prev = (rgb_prev >> bs) & cmax;
 
          /* Mix colours using fixed-point arithmetic */
          int r_mix = (r_curr * curr_factor + r_prev * fade_factor) >> 8;
@@ -1254,84 +1798,86 @@ static void blend_frames_lcd_ghost_fast(void)
          int b_mix = (b_curr * curr_factor + b_prev * fade_factor) >> 8;
 
          /* Clamp to valid range */
-         r_mix = (r_mix > 0x1F) ? 0x1F : r_mix;
-         g_mix = (g_mix > 0x1F) ? 0x1F : g_mix;
-         b_mix = (b_mix > 0x1F) ? 0x1F : b_mix;
+         r_mix = (r_mix > cmax) ? cmax : r_mix;
+         g_mix = (g_mix > cmax) ? cmax : g_mix;
+         b_mix = (b_mix > cmax) ? cmax : b_mix;
 
          /* Repack colours for current frame */
-#ifdef VIDEO_RGB565
-         *(curr + x) = (r_mix << 11) | (g_mix << 6) | b_mix;
-#elif defined(VIDEO_ABGR1555)
-         *(curr + x) = r_mix | (g_mix << 5) | (b_mix << 10);
-#else
-         *(curr + x) = (r_mix << 16) | (g_mix << 8) | b_mix;
-#endif
+         *(out + x) = (r_mix << rs) | (g_mix << gs) | (b_mix << bs);
       }
 
+      if (scale_line)
+         scale_line(out, y);
+
       curr += VIDEO_PITCH;
       prev += VIDEO_PITCH;
+      out  += VIDEO_PITCH;
    }
-#endif
 }
 
 #ifdef __mips__
 /* Ultra-fast MIPS-specific blending using minimal operations */
+template<class Format>
 static void blend_frames_ultra_fast(void)
 {
-   gambatte::video_pixel_t *curr = video_buf;
-   gambatte::video_pixel_t *prev = video_buf_prev_1;
-   size_t total_pixels = VIDEO_HEIGHT * VIDEO_WIDTH;
-   size_t i;
+   typedef typename Format::pixel_t pixel_t;
+   enum { rs = Format::red_shift, gs = Format::green_shift, bs = Format::blue_shift };
+   enum { cmax = Format::channel_max };
+   const pixel_t *curr = (const pixel_t*)video_buf_ring_frame(0);
+   const pixel_t *prev = (const pixel_t*)video_buf_ring_frame(1);
+   pixel_t *out        = (pixel_t*)video_buf;
+   size_t x, y;
    
    /* Use simple bit operations - 75% current + 25% previous */
-   for (i = 0; i < total_pixels; i++)
+   for (y = 0; y < VIDEO_HEIGHT; y++)
    {
-      gambatte::video_pixel_t rgb_curr = curr[i];
-      gambatte::video_pixel_t rgb_prev = prev[i];
-      
-      /* Store current for next frame */
-      prev[i] = rgb_curr;
-      
-#ifdef VIDEO_RGB565
-      /* Fast blend using bit operations: 3/4 current + 1/4 previous */
-      uint32_t r_blend = (((rgb_curr >> 11) & 0x1F) * 3 + ((rgb_prev >> 11) & 0x1F)) >> 2;
-      uint32_t g_blend = (((rgb_curr >> 6) & 0x1F) * 3 + ((rgb_prev >> 6) & 0x1F)) >> 2;
-      uint32_t b_blend = ((rgb_curr & 0x1F) * 3 + (rgb_prev & 0x1F)) >> 2;
-      
-      curr[i] = (r_blend << 11) | (g_blend << 6) | b_blend;
-#elif defined(VIDEO_ABGR1555)
-      uint32_t r_blend = ((rgb_curr & 0x1F) * 3 + (rgb_prev & 0x1F)) >> 2;
-      uint32_t g_blend = (((rgb_curr >> 5) & 0x1F) * 3 + ((rgb_prev >> 5) & 0x1F)) >> 2;
-      uint32_t b_blend = (((rgb_curr >> 10) & 0x1F) * 3 + ((rgb_prev >> 10) & 0x1F)) >> 2;
-      
-      curr[i] = r_blend | (g_blend << 5) | (b_blend << 10);
-#else
-      uint32_t r_blend = (((rgb_curr >> 16) & 0x1F) * 3 + ((rgb_prev >> 16) & 0x1F)) >> 2;
-      uint32_t g_blend = (((rgb_curr >> 8) & 0x1F) * 3 + ((rgb_prev >> 8) & 0x1F)) >> 2;
-      uint32_t b_blend = ((rgb_curr & 0x1F) * 3 + (rgb_prev & 0x1F)) >> 2;
-      
-      curr[i] = (r_blend << 16) | (g_blend << 8) | b_blend;
-#endif
+      for (x = 0; x < VIDEO_WIDTH; x++)
+      {
+         pixel_t rgb_curr = curr[x];
+         pixel_t rgb_prev = prev[x];
+         
+         /* Fast blend using bit operations: 3/4 current + 1/4 previous */
+         uint32_t r_blend = (((rgb_curr >> rs) & cmax) * 3 + ((rgb_prev >> rs) & cmax)) >> 2;
+         uint32_t g_blend = (((rgb_curr >> gs) & cmax) * 3 + ((rgb_prev >> gs) & cmax)) >> 2;
+         uint32_t b_blend = (((rgb_curr >> bs) & cmax) * 3 + ((rgb_prev >> bs) & cmax)) >> 2;
+         
+         out[x] = (r_blend << rs) | (g_blend << gs) | (b_blend << bs);
+      }
+
+      if (scale_line)
+         scale_line(out, y);
+
+      curr += VIDEO_PITCH;
+      prev += VIDEO_PITCH;
+      out  += VIDEO_PITCH;
    }
 }
 #endif
 
-static bool allocate_video_buf_prev(gambatte::video_pixel_t** buf)
+static bool allocate_video_buf_ring(unsigned size)
 {
-   if (!*buf)
+   unsigned i;
+
+   for (i = 0; i < size; i++)
    {
-      *buf = (gambatte::video_pixel_t*)malloc(VIDEO_BUFF_SIZE);
-      if (!*buf)
-         return false;
+      if (!video_buf_ring[i])
+      {
+         video_buf_ring[i] = malloc(VIDEO_BUFF_SIZE);
+         if (!video_buf_ring[i])
+            return false;
+      }
+      memset(video_buf_ring[i], 0, VIDEO_BUFF_SIZE);
    }
-   memset(*buf, 0, VIDEO_BUFF_SIZE);
+
+   video_buf_ring_size = size;
+   video_buf_ring_curr = 0;
    return true;
 }
 
 static bool allocate_video_buf_acc(void)
 {
    size_t i;
-   size_t buf_size = 256 * NUM_GAMEBOYS * VIDEO_HEIGHT * sizeof(float);
+   size_t buf_size = 256 * MAX_GAMEBOYS * VIDEO_HEIGHT * sizeof(float);
 
    if (!video_buf_acc_r)
    {
@@ -1355,7 +1901,7 @@ static bool allocate_video_buf_acc(void)
    }
 
    /* Cannot use memset() on arrays of floats... */
-   for (i = 0; i < (256 * NUM_GAMEBOYS * VIDEO_HEIGHT); i++)
+   for (i = 0; i < (256 * MAX_GAMEBOYS * VIDEO_HEIGHT); i++)
    {
       video_buf_acc_r[i] = 0.0f;
       video_buf_acc_g[i] = 0.0f;
@@ -1364,6 +1910,34 @@ static bool allocate_video_buf_acc(void)
    return true;
 }
 
+/* Assigns the frame blending function for 'type'.
+ * The ring must already hold as much history as
+ * the method reads */
+static void set_frame_blend_function(enum frame_blend_method type)
+{
+   switch (type)
+   {
+      case FRAME_BLEND_MIX:
+         blend_frames = PIXEL_FORMAT_FUNC(blend_frames_mix);
+         return;
+      case FRAME_BLEND_LCD_GHOSTING:
+         blend_frames = PIXEL_FORMAT_FUNC(blend_frames_lcd_ghost);
+         return;
+      case FRAME_BLEND_LCD_GHOSTING_FAST:
+         blend_frames = PIXEL_FORMAT_FUNC(blend_frames_lcd_ghost_fast);
+         return;
+#ifdef __mips__
+      case FRAME_BLEND_ULTRA_FAST:
+         blend_frames = PIXEL_FORMAT_FUNC(blend_frames_ultra_fast);
+         return;
+#endif
+      case FRAME_BLEND_NONE:
+      default:
+         blend_frames = NULL;
+         return;
+   }
+}
+
 static void init_frame_blending(void)
 {
    blend_frames = NULL;
@@ -1374,30 +1948,28 @@ static void init_frame_blending(void)
    switch (frame_blend_type)
    {
       case FRAME_BLEND_MIX:
-         /* Simple 50:50 blending requires a single buffer */
-         if (!allocate_video_buf_prev(&video_buf_prev_1))
+         /* Simple 50:50 blending requires the current
+          * and previous frames */
+         if (!allocate_video_buf_ring(2))
             return;
          break;
       case FRAME_BLEND_LCD_GHOSTING:
-         /* 'Accurate' LCD ghosting requires four buffers */
-         if (!allocate_video_buf_prev(&video_buf_prev_1))
-            return;
-         if (!allocate_video_buf_prev(&video_buf_prev_2))
-            return;
-         if (!allocate_video_buf_prev(&video_buf_prev_3))
-            return;
-         if (!allocate_video_buf_prev(&video_buf_prev_4))
+         /* 'Accurate' LCD ghosting requires the current
+          * and four previous frames */
+         if (!allocate_video_buf_ring(5))
             return;
          break;
       case FRAME_BLEND_LCD_GHOSTING_FAST:
-         /* 'Fast' LCD ghosting now uses single buffer like mix mode */
-         if (!allocate_video_buf_prev(&video_buf_prev_1))
+         /* 'Fast' LCD ghosting only needs the previous
+          * frame, like mix mode */
+         if (!allocate_video_buf_ring(2))
             return;
          break;
 #ifdef __mips__
       case FRAME_BLEND_ULTRA_FAST:
-         /* Ultra-fast MIPS mode uses single buffer */
-         if (!allocate_video_buf_prev(&video_buf_prev_1))
+         /* Ultra-fast MIPS mode only needs the previous
+          * frame */
+         if (!allocate_video_buf_ring(2))
             return;
          break;
 #endif
@@ -1429,121 +2001,516 @@ static void init_frame_blending(void)
       frame_blend_response[2] = std::pow(LCD_RESPONSE_TIME, 3.0f);
       frame_blend_response[3] = std::pow(LCD_RESPONSE_TIME, 4.0f);
 
-      /* Convert to fixed-point (8.8 format) for integer version */
-      frame_blend_response_int[0] = static_cast<int>(frame_blend_response[0] * 256.0f);
-      frame_blend_response_int[1] = static_cast<int>(frame_blend_response[1] * 256.0f);
-      frame_blend_response_int[2] = static_cast<int>(frame_blend_response[2] * 256.0f);
-      frame_blend_response_int[3] = static_cast<int>(frame_blend_response[3] * 256.0f);
+      /* Convert to fixed-point (8.8 format) for integer version */
+      frame_blend_response_int[0] = static_cast<int>(frame_blend_response[0] * 256.0f);
+      frame_blend_response_int[1] = static_cast<int>(frame_blend_response[1] * 256.0f);
+      frame_blend_response_int[2] = static_cast<int>(frame_blend_response[2] * 256.0f);
+      frame_blend_response_int[3] = static_cast<int>(frame_blend_response[3] * 256.0f);
+
+      frame_blend_response_set = true;
+   }
+
+   set_frame_blend_function(frame_blend_type);
+}
+
+static void deinit_frame_blending(void)
+{
+   unsigned i;
+
+   for (i = 0; i < VIDEO_BUF_RING_MAX_SIZE; i++)
+   {
+      if (video_buf_ring[i])
+      {
+         free(video_buf_ring[i]);
+         video_buf_ring[i] = NULL;
+      }
+   }
+
+   video_buf_ring_size = 0;
+   video_buf_ring_curr = 0;
+
+   if (video_buf_acc_r)
+   {
+      free(video_buf_acc_r);
+      video_buf_acc_r = NULL;
+   }
+
+   if (video_buf_acc_g)
+   {
+      free(video_buf_acc_g);
+      video_buf_acc_g = NULL;
+   }
+
+   if (video_buf_acc_b)
+   {
+      free(video_buf_acc_b);
+      video_buf_acc_b = NULL;
+   }
+
+   frame_blend_type         = FRAME_BLEND_NONE;
+   frame_blend_response_set = false;
+}
+
+static void check_frame_blend_variable(void)
+{
+   struct retro_variable var;
+   enum frame_blend_method old_frame_blend_type = frame_blend_type;
+
+   frame_blend_type = FRAME_BLEND_NONE;
+
+   var.key = "gambatte_mix_frames";
+   var.value = 0;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "mix"))
+         frame_blend_type = FRAME_BLEND_MIX;
+      else if (!strcmp(var.value, "lcd_ghosting"))
+         frame_blend_type = FRAME_BLEND_LCD_GHOSTING;
+      else if (!strcmp(var.value, "lcd_ghosting_fast"))
+         frame_blend_type = FRAME_BLEND_LCD_GHOSTING_FAST;
+#ifdef __mips__
+      else if (!strcmp(var.value, "ultra_fast"))
+         frame_blend_type = FRAME_BLEND_ULTRA_FAST;
+#endif
+   }
+
+   if (frame_blend_type == FRAME_BLEND_NONE)
+      blend_frames = NULL;
+   else if (frame_blend_type != old_frame_blend_type)
+      init_frame_blending();
+}
+
+/***************************/
+/* Interframe blending END */
+/***************************/
+
+/*****************************/
+/* Performance profile START */
+/*****************************/
+
+/* Frame time statistics for each game, kept across
+ * sessions in the save directory (see perf_profile.h).
+ * They are recorded with the settings of the quality
+ * governor's ladder in use, and the governor starts
+ * from the first step not known to overrun */
+#define FRAME_BUDGET_USEC ((unsigned)(1000000.0 / VIDEO_REFRESH_RATE + 0.5))
+
+static PerfProfile perf_profile;
+static bool perf_profile_enabled = false;
+static bool perf_profile_loaded  = false;
+static std::string perf_profile_key;
+static char perf_profile_path[PATH_MAX_LENGTH] = {0};
+
+/* Games are told apart by their header: the title
+ * at 0x134 and the header and global checksums */
+static void perf_profile_init(const uint8_t *rom, size_t size)
+{
+   const char *save_dir = NULL;
+   char title[17];
+   char safe_title[17];
+   char checksum[8];
+   char name[64];
+   size_t i;
+
+   perf_profile_path[0] = '\0';
+   perf_profile_loaded  = false;
+   perf_profile_key.clear();
+
+#ifdef HAVE_NETWORK
+   if (gb2)
+      return;
+#endif
+
+   if (!rom || (size < 0x150) ||
+       !environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &save_dir) ||
+       !save_dir)
+      return;
+
+   /* The title may be cut short by a manufacturer
+    * code and CGB flag */
+   for (i = 0; i < 16; i++)
+   {
+      char c = (char)rom[0x134 + i];
+
+      if ((c < 0x20) || (c > 0x7E))
+         break;
+
+      title[i]      = c;
+      safe_title[i] = ((c >= '0' && c <= '9') ||
+                       (c >= 'A' && c <= 'Z') ||
+                       (c >= 'a' && c <= 'z')) ? c : '_';
+   }
+
+   while (i && (title[i - 1] == ' '))
+      i--;
+   title[i]      = '\0';
+   safe_title[i] = '\0';
+
+   snprintf(checksum, sizeof(checksum), "%02X%02X%02X",
+         rom[0x14D], rom[0x14E], rom[0x14F]);
+   snprintf(name, sizeof(name), "gambatte_perf_%s_%s.ini",
+         safe_title, checksum);
+
+   fill_pathname_join(perf_profile_path, save_dir, name,
+         sizeof(perf_profile_path));
+   perf_profile_key = std::string(title) + "/" + checksum;
+}
+
+/* Reads the statistics of earlier sessions, once
+ * per game */
+static void perf_profile_load(void)
+{
+   void *buf   = NULL;
+   int64_t len = 0;
+
+   if (perf_profile_loaded || string_is_empty(perf_profile_path))
+      return;
+
+   perf_profile.reset(perf_profile_key, FRAME_BUDGET_USEC,
+         FRAME_BUDGET_USEC * QualityGovernor::STEP_DOWN_PERCENT / 100);
+   perf_profile_loaded = true;
+
+   if (!path_is_valid(perf_profile_path) ||
+       !filestream_read_file(perf_profile_path, &buf, &len))
+      return;
+
+   if (perf_profile.parse(std::string((const char*)buf, (size_t)len)))
+      gambatte_log(RETRO_LOG_INFO,
+            "Performance profile: %llu frames, average %u us, 95th percentile %u us\n",
+            perf_profile.frames(), perf_profile.averageUsec(),
+            perf_profile.percentileUsec(95));
+   else
+      gambatte_log(RETRO_LOG_WARN,
+            "Ignoring performance profile for another game: %s\n",
+            perf_profile_path);
+
+   free(buf);
+}
+
+static void perf_profile_save(void)
+{
+   std::string text;
+
+   if (!perf_profile_enabled || !perf_profile_loaded ||
+       !perf_profile.sessionFrames())
+      return;
+
+   text = perf_profile.text();
+   if (!filestream_write_file(perf_profile_path, text.data(), text.size()))
+      gambatte_log(RETRO_LOG_WARN,
+            "Unable to write performance profile: %s\n", perf_profile_path);
+}
+
+static void check_perf_profile_variable(void)
+{
+   struct retro_variable var = {0};
+
+   perf_profile_enabled = false;
+
+   var.key = "gambatte_perf_profile";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value &&
+       !strcmp(var.value, "enabled") && !string_is_empty(perf_profile_path))
+      perf_profile_enabled = true;
+
+   if (perf_profile_enabled)
+      perf_profile_load();
+}
+
+/***************************/
+/* Performance profile END */
+/***************************/
 
-      frame_blend_response_set = true;
-   }
+/**************************/
+/* Quality governor START */
+/**************************/
+
+/* Steps expensive options down while the core takes
+ * too long per frame, and back up once it has time
+ * to spare (see quality_governor.h). Each step of
+ * the ladder is no more expensive than the one
+ * before it; step 0 is the configured settings.
+ * Steps are only taken between frames, and never
+ * allocate: the blending ring already holds the
+ * history of the configured method, which reads
+ * the most, and both resamplers stay set up */
+enum quality_governor_mode
+{
+   QUALITY_GOVERNOR_DISABLED = 0,
+   QUALITY_GOVERNOR_BLENDING,
+   QUALITY_GOVERNOR_BLENDING_AUDIO,
+   QUALITY_GOVERNOR_ALL
+};
 
-   /* Assign frame blending function */
-   switch (frame_blend_type)
+struct quality_step
+{
+   enum frame_blend_method blend;
+   bool cc_resampler;
+   bool frameskip;
+};
+
+/* Blending methods, most expensive first */
+static const enum frame_blend_method quality_blend_order[] = {
+   FRAME_BLEND_LCD_GHOSTING,
+   FRAME_BLEND_LCD_GHOSTING_FAST,
+#ifdef __mips__
+   FRAME_BLEND_ULTRA_FAST,
+#endif
+   FRAME_BLEND_MIX,
+   FRAME_BLEND_NONE
+};
+
+#define NUM_QUALITY_BLEND_METHODS (sizeof(quality_blend_order) / sizeof(quality_blend_order[0]))
+#define QUALITY_LADDER_MAX_SIZE (NUM_QUALITY_BLEND_METHODS + 2)
+
+static QualityGovernor quality_governor;
+static struct retro_perf_callback quality_perf;
+static struct quality_step quality_ladder[QUALITY_LADDER_MAX_SIZE];
+static unsigned quality_ladder_size = 0;
+static bool quality_timing          = false;
+static bool quality_frameskip       = false;
+static unsigned quality_frame_count = 0;
+/* Index of each step's settings in perf_profile */
+static unsigned quality_profile_settings[QUALITY_LADDER_MAX_SIZE];
+
+/* Names the settings of a step after their core
+ * option values, for perf_profile */
+static std::string quality_step_name(const struct quality_step *step)
+{
+   std::string name;
+
+   switch (step->blend)
    {
       case FRAME_BLEND_MIX:
-         blend_frames = blend_frames_mix;
-         return;
+         name = "mix";
+         break;
       case FRAME_BLEND_LCD_GHOSTING:
-         blend_frames = blend_frames_lcd_ghost;
-         return;
+         name = "lcd_ghosting";
+         break;
       case FRAME_BLEND_LCD_GHOSTING_FAST:
-         blend_frames = blend_frames_lcd_ghost_fast;
-         return;
+         name = "lcd_ghosting_fast";
+         break;
 #ifdef __mips__
       case FRAME_BLEND_ULTRA_FAST:
-         blend_frames = blend_frames_ultra_fast;
-         return;
+         name = "ultra_fast";
+         break;
 #endif
       case FRAME_BLEND_NONE:
       default:
-         /* Error condition - cannot happen
-          * > Just leave blend_frames() function set to NULL */
-         return;
+         name = "disabled";
+         break;
    }
+
+   name += step->cc_resampler ? ",cc" : ",sinc";
+   name += step->frameskip ? ",frameskip" : ",no_frameskip";
+   return name;
 }
 
-static void deinit_frame_blending(void)
+static void quality_apply_step(unsigned index)
 {
-   if (video_buf_prev_1)
-   {
-      free(video_buf_prev_1);
-      video_buf_prev_1 = NULL;
-   }
+   const struct quality_step *step = &quality_ladder[index];
+   bool was_blending               = blend_frames != NULL;
+
+   set_frame_blend_function(step->blend);
+   if (blend_frames && !was_blending)
+      video_buf_ring_fill();
+
+   audio_resampler_switch(step->cc_resampler);
+   quality_frameskip = step->frameskip;
+}
+
+/* Puts the configured settings back, so that they
+ * can be compared with changed options */
+static void quality_governor_restore(void)
+{
+   if (quality_ladder_size > 1 && quality_governor.level())
+      quality_apply_step(0);
+}
+
+static void quality_governor_configure(bool startup)
+{
+   enum quality_governor_mode mode = QUALITY_GOVERNOR_DISABLED;
+   struct quality_step ladder[QUALITY_LADDER_MAX_SIZE];
+   struct quality_step step;
+   struct retro_variable var = {0};
+   unsigned size             = 0;
+   size_t i;
 
-   if (video_buf_prev_2)
+   var.key = "gambatte_quality_governor";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
    {
-      free(video_buf_prev_2);
-      video_buf_prev_2 = NULL;
+      if (!strcmp(var.value, "blending"))
+         mode = QUALITY_GOVERNOR_BLENDING;
+      else if (!strcmp(var.value, "blending_audio"))
+         mode = QUALITY_GOVERNOR_BLENDING_AUDIO;
+      else if (!strcmp(var.value, "all"))
+         mode = QUALITY_GOVERNOR_ALL;
    }
 
-   if (video_buf_prev_3)
+   if (((mode != QUALITY_GOVERNOR_DISABLED) || perf_profile_enabled) &&
+       !quality_perf.get_time_usec)
    {
-      free(video_buf_prev_3);
-      video_buf_prev_3 = NULL;
+      memset(&quality_perf, 0, sizeof(quality_perf));
+      environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &quality_perf);
+      if (!quality_perf.get_time_usec)
+      {
+         gambatte_log(RETRO_LOG_WARN, "Adaptive quality and performance profile unavailable: frontend has no perf interface\n");
+         mode                 = QUALITY_GOVERNOR_DISABLED;
+         perf_profile_enabled = false;
+      }
    }
 
-   if (video_buf_prev_4)
+   /* Zeroed, so that ladders compare with memcmp() */
+   memset(ladder, 0, sizeof(ladder));
+   memset(&step, 0, sizeof(step));
+   step.blend        = blend_frames ? frame_blend_type : FRAME_BLEND_NONE;
+   step.cc_resampler = use_cc_resampler;
+   step.frameskip    = false;
+   ladder[size++]    = step;
+
+   if (mode >= QUALITY_GOVERNOR_BLENDING)
    {
-      free(video_buf_prev_4);
-      video_buf_prev_4 = NULL;
+      for (i = 0; i < NUM_QUALITY_BLEND_METHODS; i++)
+         if (quality_blend_order[i] == step.blend)
+            break;
+
+      for (i++; i < NUM_QUALITY_BLEND_METHODS; i++)
+      {
+         step.blend     = quality_blend_order[i];
+         ladder[size++] = step;
+      }
    }
 
-   if (video_buf_acc_r)
+   /* The output rate must not change */
+   if ((mode >= QUALITY_GOVERNOR_BLENDING_AUDIO) &&
+       !step.cc_resampler && audio_rate_config->rate)
    {
-      free(video_buf_acc_r);
-      video_buf_acc_r = NULL;
+      step.cc_resampler = true;
+      ladder[size++]    = step;
    }
 
-   if (video_buf_acc_g)
+   if (mode >= QUALITY_GOVERNOR_ALL)
    {
-      free(video_buf_acc_g);
-      video_buf_acc_g = NULL;
+      step.frameskip = true;
+      ladder[size++] = step;
    }
 
-   if (video_buf_acc_b)
+   quality_timing = (size > 1) || perf_profile_enabled;
+
+   if (perf_profile_enabled)
+      for (i = 0; i < size; i++)
+         quality_profile_settings[i] = perf_profile.settings(
+               quality_step_name(&ladder[i]));
+
+   /* Keep the current step if only other
+    * options have changed */
+   if (!startup && (size == quality_ladder_size) &&
+       !memcmp(ladder, quality_ladder, sizeof(ladder)))
    {
-      free(video_buf_acc_b);
-      video_buf_acc_b = NULL;
+      quality_apply_step(quality_governor.level());
+      return;
    }
 
-   frame_blend_type         = FRAME_BLEND_NONE;
-   frame_blend_response_set = false;
+   memcpy(quality_ladder, ladder, sizeof(ladder));
+   quality_ladder_size = size;
+   quality_frameskip   = false;
+   quality_frame_count = 0;
+
+   /* Start from the first step not known to overrun */
+   i = 0;
+   if (perf_profile_enabled)
+      while ((i + 1 < size) &&
+             (perf_profile.withinBudget(quality_profile_settings[i]) < 0))
+         i++;
+
+   quality_governor.reset(size, FRAME_BUDGET_USEC, i);
+
+   /* Settings are not all set up yet at startup,
+    * see quality_governor_start() */
+   if (!startup && i)
+      quality_apply_step(i);
 }
 
-static void check_frame_blend_variable(void)
+/* Takes the step the governor starts from, once
+ * a game is loaded */
+static void quality_governor_start(void)
 {
-   struct retro_variable var;
-   enum frame_blend_method old_frame_blend_type = frame_blend_type;
+   if (quality_ladder_size < 2 || !quality_governor.level())
+      return;
 
-   frame_blend_type = FRAME_BLEND_NONE;
+   quality_apply_step(quality_governor.level());
+   gambatte_log(RETRO_LOG_INFO, "Adaptive quality: starting from step %u of %u, as profiled\n",
+         quality_governor.level(), quality_ladder_size - 1);
+}
 
-   var.key = "gambatte_mix_frames";
-   var.value = 0;
+static void quality_governor_deinit(void)
+{
+   quality_ladder_size = 0;
+   quality_timing      = false;
+   quality_frameskip   = false;
+   quality_governor.reset(1, FRAME_BUDGET_USEC);
+}
 
-   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
-   {
-      if (!strcmp(var.value, "mix"))
-         frame_blend_type = FRAME_BLEND_MIX;
-      else if (!strcmp(var.value, "lcd_ghosting"))
-         frame_blend_type = FRAME_BLEND_LCD_GHOSTING;
-      else if (!strcmp(var.value, "lcd_ghosting_fast"))
-         frame_blend_type = FRAME_BLEND_LCD_GHOSTING_FAST;
-#ifdef __mips__
-      else if (!strcmp(var.value, "ultra_fast"))
-         frame_blend_type = FRAME_BLEND_ULTRA_FAST;
+/* Host time in microseconds, when the governor
+ * or performance profile needs it */
+static INLINE retro_time_t quality_time_usec(void)
+{
+   return quality_timing ? quality_perf.get_time_usec() : 0;
+}
+
+/* Whether to run the next frame without drawing it,
+ * leaving the frontend to show the last one again */
+static bool quality_drop_frame(void)
+{
+   if (!quality_frameskip)
+      return false;
+#ifdef HAVE_NETWORK
+   if (gb2)
+      return false;
 #endif
-   }
+#ifdef SF2000
+   if (!sf2000_splash_shown || sf2000_fastforward_state ||
+       sf2000_slowmotion_state)
+      return false;
+#endif
+   return (++quality_frame_count & 1) != 0;
+}
 
-   if (frame_blend_type == FRAME_BLEND_NONE)
-      blend_frames = NULL;
-   else if (frame_blend_type != old_frame_blend_type)
-      init_frame_blending();
+/* Records the time the core took for a frame,
+ * excluding frontend callbacks */
+static void quality_governor_frame(retro_time_t usec)
+{
+   if (!quality_timing)
+      return;
+
+   /* Only full speed frames have a budget */
+#ifdef SF2000
+   if (sf2000_fastforward_state || sf2000_slowmotion_state)
+      return;
+#else
+   if (libretro_ff_enabled)
+      return;
+#endif
+
+   /* The caller leaves out frames that ran the fast
+    * boot, which would read as overruns of the
+    * settings in use */
+   if (perf_profile_enabled)
+      perf_profile.frame((unsigned)usec,
+            quality_profile_settings[quality_governor.level()]);
+
+   if (!quality_governor.frame((unsigned)usec))
+      return;
+
+   quality_apply_step(quality_governor.level());
+   gambatte_log(RETRO_LOG_INFO, "Adaptive quality: step %u of %u (%u us per frame)\n",
+         quality_governor.level(), quality_ladder_size - 1,
+         quality_governor.averageUsec());
 }
 
-/***************************/
-/* Interframe blending END */
-/***************************/
+/************************/
+/* Quality governor END */
+/************************/
 
 /************************/
 /* Rumble support START */
@@ -1648,9 +2615,18 @@ static bool update_option_visibility(void)
          option_display.key = "gambatte_gb_link_mode";
          environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
 
+         option_display.key = "gambatte_gb_link_local_audio";
+         environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+
          option_display.key = "gambatte_gb_link_network_port";
          environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
 
+         option_display.key = "gambatte_gb_link_network_delay";
+         environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+
+         option_display.key = "gambatte_gb_link_network_test_latency";
+         environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+
          for (i = 0; i < 12; i++)
          {
             char key[64] = {0};
@@ -1913,6 +2889,178 @@ namespace input
    };
 }
 
+/* Cheat search hotkeys. While Select is held:
+ * - Y:     start a new search
+ * - Up:    keep values that increased
+ * - Down:  keep values that decreased
+ * - Right: keep values that did not change
+ * - X:     keep values that changed
+ * - R/L:   keep values that increased/decreased by 1
+ * The game sees no input on frames where one of
+ * these combinations is held */
+#define CHEAT_SEARCH_MAX_LISTED 4
+
+enum cheat_search_mode_type
+{
+   CHEAT_SEARCH_DISABLED = 0,
+   CHEAT_SEARCH_8BIT,
+   CHEAT_SEARCH_16BIT
+};
+
+static enum cheat_search_mode_type cheat_search_mode = CHEAT_SEARCH_DISABLED;
+static CheatSearch cheat_search;
+static unsigned cheat_search_buttons_prev = 0;
+
+static void cheat_search_init(void)
+{
+   cheat_search.setRegion(CheatSearch::WRAM,
+         (const unsigned char*)gb.rambank0_ptr(), gb.isCgb() ? 0x8000 : 0x2000);
+   cheat_search.setRegion(CheatSearch::HRAM,
+         (const unsigned char*)gb.zeropage_ptr(), 0x7F);
+   cheat_search.setRegion(CheatSearch::SRAM,
+         (const unsigned char*)gb.savedata_ptr(), gb.savedata_size());
+   cheat_search.reset(cheat_search_mode == CHEAT_SEARCH_16BIT);
+}
+
+/* Formats a search result as its address (with
+ * bank where relevant) and value, followed for
+ * 8-bit values by a GameShark code setting it */
+static void cheat_search_format(const CheatSearch::Result &result,
+      char *s, size_t len)
+{
+   unsigned address = 0;
+   unsigned type    = 0x01;
+
+   switch (result.region)
+   {
+      case CheatSearch::WRAM:
+         if (result.offset < 0x1000)
+            address = 0xC000 + result.offset;
+         else
+         {
+            address = 0xD000 + (result.offset & 0xFFF);
+            if (gb.isCgb())
+               type = 0x90 | result.offset >> 12;
+         }
+         break;
+      case CheatSearch::HRAM:
+         address = 0xFF80 + result.offset;
+         break;
+      default:
+         address = 0xA000 + (result.offset & 0x1FFF);
+         type    = 0x80 | result.offset >> 13;
+         break;
+   }
+
+   if (cheat_search.wide())
+      snprintf(s, len, "%02X:%04X=%04X", type, address, result.value);
+   else
+      snprintf(s, len, "%02X%02X%02X%02X", type, result.value,
+            address & 0xFF, address >> 8);
+}
+
+static void cheat_search_notify(void)
+{
+   CheatSearch::Result results[CHEAT_SEARCH_MAX_LISTED];
+   size_t count = cheat_search.count();
+   size_t num_results = 0;
+   size_t i;
+   char msg[128];
+   char result[16];
+
+   snprintf(msg, sizeof(msg), "Cheat search: %u match%s",
+         (unsigned)count, count == 1 ? "" : "es");
+
+   if (count && count <= CHEAT_SEARCH_MAX_LISTED)
+   {
+      num_results = cheat_search.results(results, CHEAT_SEARCH_MAX_LISTED);
+      for (i = 0; i < num_results; i++)
+      {
+         cheat_search_format(results[i], result, sizeof(result));
+         strlcat(msg, i ? " " : ": ", sizeof(msg));
+         strlcat(msg, result, sizeof(msg));
+      }
+   }
+
+   gambatte_log(RETRO_LOG_INFO, "%s\n", msg);
+
+   if (libretro_msg_interface_version >= 1)
+   {
+      struct retro_message_ext msg_ext = {
+         msg,
+         3000,
+         1,
+         RETRO_LOG_INFO,
+         RETRO_MESSAGE_TARGET_OSD,
+         RETRO_MESSAGE_TYPE_NOTIFICATION_ALT,
+         -1
+      };
+      environ_cb(RETRO_ENVIRONMENT_SET_MESSAGE_EXT, &msg_ext);
+   }
+   else
+   {
+      struct retro_message msg_legacy = {
+         msg,
+         180
+      };
+      environ_cb(RETRO_ENVIRONMENT_SET_MESSAGE, &msg_legacy);
+   }
+}
+
+/* Returns the Game Boy input for this frame,
+ * minus any hotkey combination */
+static unsigned cheat_search_update_input(unsigned res)
+{
+   static const unsigned hotkeys[] = {
+      RETRO_DEVICE_ID_JOYPAD_Y,
+      RETRO_DEVICE_ID_JOYPAD_UP,
+      RETRO_DEVICE_ID_JOYPAD_DOWN,
+      RETRO_DEVICE_ID_JOYPAD_RIGHT,
+      RETRO_DEVICE_ID_JOYPAD_X,
+      RETRO_DEVICE_ID_JOYPAD_R,
+      RETRO_DEVICE_ID_JOYPAD_L
+   };
+   unsigned buttons = 0;
+   unsigned pressed;
+   size_t i;
+
+   if (!(res & gambatte::InputGetter::SELECT))
+   {
+      cheat_search_buttons_prev = 0;
+      return res;
+   }
+
+   for (i = 0; i < sizeof(hotkeys) / sizeof(hotkeys[0]); i++)
+      if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, hotkeys[i]))
+         buttons |= 1 << hotkeys[i];
+
+   pressed = buttons & ~cheat_search_buttons_prev;
+   cheat_search_buttons_prev = buttons;
+
+   if (!buttons)
+      return res;
+
+   if ((pressed & (1 << RETRO_DEVICE_ID_JOYPAD_Y)) || !cheat_search.active())
+      cheat_search_init();
+   else if (pressed & (1 << RETRO_DEVICE_ID_JOYPAD_UP))
+      cheat_search.filterPrevious(CheatSearch::GREATER);
+   else if (pressed & (1 << RETRO_DEVICE_ID_JOYPAD_DOWN))
+      cheat_search.filterPrevious(CheatSearch::LESS);
+   else if (pressed & (1 << RETRO_DEVICE_ID_JOYPAD_RIGHT))
+      cheat_search.filterPrevious(CheatSearch::EQUAL);
+   else if (pressed & (1 << RETRO_DEVICE_ID_JOYPAD_X))
+      cheat_search.filterPrevious(CheatSearch::NOT_EQUAL);
+   else if (pressed & (1 << RETRO_DEVICE_ID_JOYPAD_R))
+      cheat_search.filterPrevious(CheatSearch::EQUAL, 1);
+   else if (pressed & (1 << RETRO_DEVICE_ID_JOYPAD_L))
+      cheat_search.filterPrevious(CheatSearch::EQUAL, -1);
+
+   if (pressed)
+      cheat_search_notify();
+
+   return 0;
+}
+
 static void update_input_state(void)
 {
    unsigned i;
@@ -2065,6 +3213,22 @@ static void update_input_state(void)
             res &= ~(gambatte::InputGetter::LEFT | gambatte::InputGetter::RIGHT);
    }
 
+   /* Cheat search hotkeys (Select + X/Y/L/R/d-pad)
+    * are not also turbo buttons or palette switches */
+   if (cheat_search_mode != CHEAT_SEARCH_DISABLED)
+   {
+      unsigned game_input = cheat_search_update_input(res);
+
+      if (res && !game_input)
+      {
+         turbo_a      = false;
+         turbo_b      = false;
+         palette_prev = false;
+         palette_next = false;
+      }
+      res = game_input;
+   }
+
 #ifdef SF2000
    /* Fast forward handling is done above in input processing for SF2000 */
 #else
@@ -2136,6 +3300,42 @@ static void update_input_state(void)
    libretro_input_state = res;
 }
 
+#ifdef HAVE_NETWORK
+/* Player 2 (local link mode) has plain
+ * joypad input on port 2 - no turbo buttons
+ * or hotkeys */
+static void update_input_state_p2(void)
+{
+   unsigned i;
+   unsigned res = 0;
+
+   if (libretro_supports_bitmasks)
+   {
+      int16_t ret = input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_MASK);
+      for (i = 0; i < sizeof(input::btn_map) / sizeof(input::map); i++)
+         res |= (ret & (1 << input::btn_map[i].snes)) ? input::btn_map[i].gb : 0;
+   }
+   else
+   {
+      for (i = 0; i < sizeof(input::btn_map) / sizeof(input::map); i++)
+         res |= input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, input::btn_map[i].snes) ? input::btn_map[i].gb : 0;
+   }
+
+   if (!up_down_allowed)
+   {
+      if (res & gambatte::InputGetter::UP)
+         if (res & gambatte::InputGetter::DOWN)
+            res &= ~(gambatte::InputGetter::UP | gambatte::InputGetter::DOWN);
+
+      if (res & gambatte::InputGetter::LEFT)
+         if (res & gambatte::InputGetter::RIGHT)
+            res &= ~(gambatte::InputGetter::LEFT | gambatte::InputGetter::RIGHT);
+   }
+
+   libretro_input_state_p2 = res;
+}
+#endif
+
 /* gb_input is called multiple times per frame.
  * Determine input state once per frame using
  * update_input_state(), and simply return
@@ -2149,11 +3349,23 @@ class SNESInput : public gambatte::InputGetter
       }
 } static gb_input;
 
+#ifdef HAVE_NETWORK
+class SNESInputP2 : public gambatte::InputGetter
+{
+   public:
+      unsigned operator()()
+      {
+         return libretro_input_state_p2;
+      }
+} static gb_input_p2;
+#endif
+
 #ifdef HAVE_NETWORK
 enum SerialMode {
    SERIAL_NONE,
    SERIAL_SERVER,
-   SERIAL_CLIENT
+   SERIAL_CLIENT,
+   SERIAL_LOCAL
 };
 static NetSerial gb_net_serial;
 static SerialMode gb_serialMode = SERIAL_NONE;
@@ -2180,11 +3392,14 @@ void retro_get_system_info(struct retro_system_info *info)
 void retro_get_system_av_info(struct retro_system_av_info *info)
 {
 
-   info->geometry.base_width   = VIDEO_WIDTH;
-   info->geometry.base_height  = VIDEO_HEIGHT;
-   info->geometry.max_width    = VIDEO_WIDTH;
-   info->geometry.max_height   = VIDEO_HEIGHT;
-   info->geometry.aspect_ratio = (float)GB_SCREEN_WIDTH / (float)VIDEO_HEIGHT;
+   info->geometry.base_width   = OUTPUT_WIDTH;
+   info->geometry.base_height  = OUTPUT_HEIGHT;
+   /* Leave room for output scaling, so that
+    * it can be toggled with SET_GEOMETRY */
+   info->geometry.max_width    = (VIDEO_WIDTH > SCALE_MAX_WIDTH) ?
+         VIDEO_WIDTH : SCALE_MAX_WIDTH;
+   info->geometry.max_height   = SCALE_MAX_HEIGHT;
+   info->geometry.aspect_ratio = (float)VIDEO_WIDTH / (float)VIDEO_HEIGHT;
 
 #ifdef SF2000
    /* SF2000: Report higher FPS during fast forward */
@@ -2198,18 +3413,49 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 #else
    info->timing.fps            = VIDEO_REFRESH_RATE;
 #endif
-#if !defined(SF2000)
-   info->timing.sample_rate    = use_cc_resampler ?
-         SOUND_SAMPLE_RATE_CC : SOUND_SAMPLE_RATE_BLIPPER;
+   info->timing.sample_rate    = audio_output_rate();
+}
+
+static void check_system_specs(void)
+{
+   unsigned level = 4;
+   environ_cb(RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL, &level);
+}
+
+/* Agrees on a pixel format with the frontend and
+ * switches the core to it. RGB565 is preferred,
+ * as it halves the bandwidth of every frame; the
+ * frontend may refuse it, in which case we render
+ * XRGB8888 instead */
+static bool set_pixel_format(void)
+{
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+
+   if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+   {
+#ifdef VIDEO_ABGR1555
+      /* The PS2 GS consumes 16 bit pixels with
+       * red in the low bits */
+      pixel_format = gambatte::PIXEL_ABGR1555;
 #else
-   info->timing.sample_rate    = 32000;
+      pixel_format = gambatte::PIXEL_RGB565;
 #endif
-}
+   }
+   else
+   {
+      fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+      if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+      {
+         gambatte_log(RETRO_LOG_ERROR, "Neither RGB565 nor XRGB8888 is supported.\n");
+         return false;
+      }
+      gambatte_log(RETRO_LOG_INFO, "RGB565 is not supported, using XRGB8888.\n");
+      pixel_format = gambatte::PIXEL_XRGB8888;
+   }
 
-static void check_system_specs(void)
-{
-   unsigned level = 4;
-   environ_cb(RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL, &level);
+   video_pixel_size = gambatte::pixelSize(pixel_format);
+   gb.setPixelFormat(pixel_format);
+   return true;
 }
 
 void retro_init(void)
@@ -2222,44 +3468,23 @@ void retro_init(void)
       gambatte_log_set_cb(NULL);
 
 #if defined(SF2000)
-#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
-   {
-      gambatte_log(RETRO_LOG_ERROR, "RGB565 is not supported.\n");
-   }
-#else
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
-   {
-      gambatte_log(RETRO_LOG_ERROR, "XRGB8888 is not supported.\n");
-   }
-#endif
+   set_pixel_format();
 #endif
 
    // Using uint_least32_t in an audio interface expecting you to cast to short*? :( Weird stuff.
    assert(sizeof(gambatte::uint_least32_t) == sizeof(uint32_t));
    gb.setInputGetter(&gb_input);
-#ifdef DUAL_MODE
-   gb2.setInputGetter(&gb_input);
-#endif
 
 #ifdef _3DS
-   video_buf = (gambatte::video_pixel_t*)linearMemAlign(VIDEO_BUFF_SIZE, 128);
+   video_buf = linearMemAlign(VIDEO_BUFF_SIZE, 128);
 #else
-   video_buf = (gambatte::video_pixel_t*)malloc(VIDEO_BUFF_SIZE);
+   video_buf = malloc(VIDEO_BUFF_SIZE);
 #endif
 
    check_system_specs();
    
    //gb/gbc bootloader support
    gb.setBootloaderGetter(get_bootloader_from_file);
-#ifdef DUAL_MODE
-   gb2.setBootloaderGetter(get_bootloader_from_file);
-#endif
-
-   // Initialise internal palette maps
-   initPaletteMaps();
 
    // Initialise palette switching functionality
    init_palette_switch();
@@ -2295,9 +3520,10 @@ void retro_deinit(void)
 #endif
    video_buf = NULL;
    deinit_frame_blending();
+   deinit_output_scaling();
    audio_resampler_deinit();
+   quality_governor_deinit();
 
-   freePaletteMaps();
    deinit_palette_switch();
    
    // Save fake RTC state on exit
@@ -2332,6 +3558,9 @@ void retro_deinit(void)
 #endif
 
    libretro_input_state = 0;
+#ifdef HAVE_NETWORK
+   libretro_input_state_p2 = 0;
+#endif
    up_down_allowed      = false;
    turbo_period         = TURBO_PERIOD_MIN;
    turbo_pulse_width    = TURBO_PULSE_WIDTH_MIN;
@@ -2361,6 +3590,28 @@ void retro_set_environment(retro_environment_t cb)
    libretro_supports_option_categories |= option_categories;
 
 #ifdef HAVE_NETWORK
+   /* Local link mode */
+   {
+      static const struct retro_subsystem_memory_info link_p1_memory[] = {
+         { "srm", RETRO_MEMORY_LINK_P1_SAVE_RAM },
+         { "rtc", RETRO_MEMORY_LINK_P1_RTC },
+      };
+      static const struct retro_subsystem_memory_info link_p2_memory[] = {
+         { "srm", RETRO_MEMORY_LINK_P2_SAVE_RAM },
+         { "rtc", RETRO_MEMORY_LINK_P2_RTC },
+      };
+      static const struct retro_subsystem_rom_info link_roms[] = {
+         { "Player 1 ROM", "gb|gbc|dmg", false, false, true, link_p1_memory, 2 },
+         { "Player 2 ROM", "gb|gbc|dmg", false, false, true, link_p2_memory, 2 },
+      };
+      static const struct retro_subsystem_info subsystems[] = {
+         { "Link (2 Players)", "gb_link_2p", link_roms, 2, SUBSYSTEM_LINK_2P },
+         { NULL },
+      };
+
+      environ_cb(RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO, (void*)subsystems);
+   }
+
    /* If frontend supports core option categories,
     * gambatte_show_gb_link_settings is unused and
     * should be hidden */
@@ -2403,42 +3654,323 @@ void retro_set_input_state(retro_input_state_t cb) { input_state_cb = cb; }
 
 void retro_set_controller_port_device(unsigned, unsigned) {}
 
-void retro_reset()
+#ifdef HAVE_STATE_CHECK
+/* Savestate determinism checker (enabled by building
+ * with STATE_CHECK=1). Every STATE_CHECK_INTERVAL frames,
+ * the state is saved, and the input of the following
+ * STATE_CHECK_FRAMES frames is recorded along with hashes
+ * of their video and audio output. The saved state is
+ * then loaded and the same frames re-run: netplay, rewind
+ * and run-ahead all require this to reproduce exactly the
+ * same output and end state as the original run.
+ * Any mismatch is logged, with the label of the first
+ * differing savestate field. Emulation then continues
+ * from the original run's end state */
+#ifndef STATE_CHECK_INTERVAL
+#define STATE_CHECK_INTERVAL 600
+#endif
+#ifndef STATE_CHECK_FRAMES
+#define STATE_CHECK_FRAMES 60
+#endif
+
+struct state_check_frame
+{
+   unsigned input;
+   uint32_t video_hash;
+   uint32_t audio_hash;
+};
+
+static struct state_check_frame state_check_frames[STATE_CHECK_FRAMES];
+static uint8_t *state_check_start                = NULL;
+static uint8_t *state_check_end                  = NULL;
+static uint8_t *state_check_tmp                  = NULL;
+static void *state_check_video                   = NULL;
+static size_t state_check_size                   = 0;
+static unsigned state_check_counter              = 0;
+static unsigned state_check_recorded             = 0;
+static bool state_check_recording                = false;
+static uint64_t state_check_runs                 = 0;
+
+/* FNV-1a */
+static uint32_t state_check_hash(uint32_t hash, const void *data, size_t size)
+{
+   const uint8_t *bytes = (const uint8_t*)data;
+   size_t i;
+
+   for (i = 0; i < size; i++)
+      hash = (hash ^ bytes[i]) * 16777619u;
+
+   return hash;
+}
+
+static uint32_t state_check_hash_video(const void *video, unsigned pitch)
+{
+   uint32_t hash = 2166136261u;
+   unsigned y;
+
+   for (y = 0; y < VIDEO_HEIGHT; y++)
+      hash = state_check_hash(hash,
+            (const uint8_t*)video + y * pitch * video_pixel_size,
+            GB_SCREEN_WIDTH * video_pixel_size);
+
+   return hash;
+}
+
+static void state_check_deinit(void)
+{
+   free(state_check_start);
+   free(state_check_end);
+   free(state_check_tmp);
+   free(state_check_video);
+   state_check_start     = NULL;
+   state_check_end       = NULL;
+   state_check_tmp       = NULL;
+   state_check_video     = NULL;
+   state_check_size      = 0;
+   state_check_counter   = 0;
+   state_check_recording = false;
+}
+
+/* Called at the start of each frame, after input
+ * has been polled */
+static void state_check_begin_frame(void)
+{
+   /* Link modes exchange data with the outside
+    * world, and cannot be replayed */
+#ifdef HAVE_NETWORK
+   if (gb2 || (gb_serialMode != SERIAL_NONE))
+      return;
+#endif
+
+   if (!state_check_recording)
+   {
+      if (++state_check_counter < STATE_CHECK_INTERVAL)
+         return;
+      state_check_counter = 0;
+
+      if (state_check_size != gb.stateSize())
+      {
+         state_check_deinit();
+         state_check_size  = gb.stateSize();
+         state_check_start = (uint8_t*)malloc(state_check_size);
+         state_check_end   = (uint8_t*)malloc(state_check_size);
+         state_check_tmp   = (uint8_t*)malloc(state_check_size);
+         state_check_video = malloc(
+               256 * VIDEO_HEIGHT * sizeof(gambatte::PixelXrgb8888::pixel_t));
+
+         if (!state_check_start || !state_check_end ||
+             !state_check_tmp || !state_check_video)
+         {
+            state_check_deinit();
+            return;
+         }
+      }
+
+      gb.saveState(state_check_start);
+      state_check_recorded  = 0;
+      state_check_recording = true;
+   }
+
+   state_check_frames[state_check_recorded].input      = libretro_input_state;
+   state_check_frames[state_check_recorded].audio_hash = 2166136261u;
+}
+
+static void state_check_audio(const gambatte::uint_least32_t *sound_buf, unsigned samples)
+{
+   if (state_check_recording)
+      state_check_frames[state_check_recorded].audio_hash = state_check_hash(
+            state_check_frames[state_check_recorded].audio_hash,
+            sound_buf, samples * sizeof(gambatte::uint_least32_t));
+}
+
+static void state_check_replay(void)
+{
+   static gambatte::uint_least32_t sound_buf[SOUND_BUFF_SIZE];
+   unsigned input      = libretro_input_state;
+   bool video_mismatch = false;
+   bool audio_mismatch = false;
+   const char *label;
+   unsigned i;
+
+   state_check_runs++;
+   gb.saveState(state_check_end);
+
+   /* Loading a state and saving it again
+    * must be lossless */
+   gb.loadState(state_check_start);
+   gb.saveState(state_check_tmp);
+   label = gambatte::GB::stateDiff(state_check_start, state_check_tmp, state_check_size);
+   if (label)
+      gambatte_log(RETRO_LOG_WARN, "[State Check] Run %llu: save/load round trip differs (first field: '%s').\n",
+            (unsigned long long)state_check_runs, label);
+
+   for (i = 0; i < STATE_CHECK_FRAMES; i++)
+   {
+      uint32_t audio_hash = 2166136261u;
+      unsigned samples    = SOUND_SAMPLES_PER_RUN;
+      long frame;
+
+      libretro_input_state = state_check_frames[i].input;
+
+      do
+      {
+         frame = gb.runFor(state_check_video, 256, sound_buf, SOUND_BUFF_SIZE, samples);
+         audio_hash = state_check_hash(audio_hash, sound_buf,
+               samples * sizeof(gambatte::uint_least32_t));
+         samples = SOUND_SAMPLES_PER_RUN;
+      } while (frame == -1);
+
+      if (!video_mismatch &&
+          (state_check_hash_video(state_check_video, 256) != state_check_frames[i].video_hash))
+      {
+         gambatte_log(RETRO_LOG_WARN, "[State Check] Run %llu: video differs from frame %u.\n",
+               (unsigned long long)state_check_runs, i);
+         video_mismatch = true;
+      }
+
+      if (!audio_mismatch && (audio_hash != state_check_frames[i].audio_hash))
+      {
+         gambatte_log(RETRO_LOG_WARN, "[State Check] Run %llu: audio differs from frame %u.\n",
+               (unsigned long long)state_check_runs, i);
+         audio_mismatch = true;
+      }
+   }
+
+   libretro_input_state = input;
+
+   gb.saveState(state_check_tmp);
+   label = gambatte::GB::stateDiff(state_check_end, state_check_tmp, state_check_size);
+   if (label)
+      gambatte_log(RETRO_LOG_WARN, "[State Check] Run %llu: end state differs after %u frames (first field: '%s').\n",
+            (unsigned long long)state_check_runs, STATE_CHECK_FRAMES, label);
+   else if (!video_mismatch && !audio_mismatch)
+      gambatte_log(RETRO_LOG_INFO, "[State Check] Run %llu: OK.\n",
+            (unsigned long long)state_check_runs);
+
+   /* Continue from the original run */
+   gb.loadState(state_check_end);
+}
+
+/* Called at the end of each frame, once all
+ * audio has been generated */
+static void state_check_end_frame(void)
+{
+   if (!state_check_recording)
+      return;
+
+   state_check_frames[state_check_recorded].video_hash =
+         state_check_hash_video(render_buf, VIDEO_PITCH);
+
+   if (++state_check_recorded < STATE_CHECK_FRAMES)
+      return;
+
+   state_check_recording = false;
+   state_check_replay();
+}
+#endif
+
+static void reset_gb(gambatte::GB &gameboy)
 {
    // gambatte seems to clear out SRAM on reset.
    uint8_t *sram = 0;
    uint8_t *rtc = 0;
-   if (gb.savedata_size())
+   if (gameboy.savedata_size())
    {
-      sram = new uint8_t[gb.savedata_size()];
-      memcpy(sram, gb.savedata_ptr(), gb.savedata_size());
+      sram = new uint8_t[gameboy.savedata_size()];
+      memcpy(sram, gameboy.savedata_ptr(), gameboy.savedata_size());
    }
-   if (gb.rtcdata_size())
+   if (gameboy.rtcdata_size())
    {
-      rtc = new uint8_t[gb.rtcdata_size()];
-      memcpy(rtc, gb.rtcdata_ptr(), gb.rtcdata_size());
+      rtc = new uint8_t[gameboy.rtcdata_size()];
+      memcpy(rtc, gameboy.rtcdata_ptr(), gameboy.rtcdata_size());
    }
 
-   gb.reset();
-#ifdef DUAL_MODE
-   gb2.reset();
-#endif
+   gameboy.reset();
 
    if (sram)
    {
-      memcpy(gb.savedata_ptr(), sram, gb.savedata_size());
+      memcpy(gameboy.savedata_ptr(), sram, gameboy.savedata_size());
       delete[] sram;
    }
    if (rtc)
    {
-      memcpy(gb.rtcdata_ptr(), rtc, gb.rtcdata_size());
+      memcpy(gameboy.rtcdata_ptr(), rtc, gameboy.rtcdata_size());
       delete[] rtc;
    }
 }
 
+/* Arms fast boot for freshly loaded or reset content */
+static void fast_boot_start(void)
+{
+   fast_boot_pending     = fast_boot_enabled;
+   fast_boot_frames_run  = 0;
+   fast_boot_frames_left = fast_boot_skip_frames;
+
+#ifdef HAVE_NETWORK
+   /* The two Game Boys of a local link are
+    * stepped together in link_run_frame() */
+   if (gb2)
+      fast_boot_pending = false;
+#endif
+}
+
+/* Runs up to max_frames frames of pending fast boot,
+ * discarding video and audio. Always stops on a frame
+ * boundary, so the first presented frame is complete */
+static void fast_boot_run(unsigned max_frames, gambatte::uint_least32_t *sound_buf)
+{
+   while (fast_boot_pending && max_frames--)
+   {
+      bool booting = gb.isBooting();
+      unsigned samples;
+
+      if ((!booting && !fast_boot_frames_left) ||
+          (fast_boot_frames_run >= FAST_BOOT_MAX_FRAMES))
+      {
+         gambatte_log(RETRO_LOG_INFO, "Fast boot skipped %u frames.\n",
+               fast_boot_frames_run);
+         fast_boot_pending = false;
+         break;
+      }
+
+      samples = SOUND_SAMPLES_PER_RUN;
+      while (gb.runFor(NULL, VIDEO_PITCH, sound_buf, SOUND_BUFF_SIZE, samples) == -1)
+         samples = SOUND_SAMPLES_PER_RUN;
+
+      fast_boot_frames_run++;
+      if (!booting)
+         fast_boot_frames_left--;
+   }
+}
+
+void retro_reset()
+{
+   reset_gb(gb);
+   fast_boot_start();
+#ifdef HAVE_STATE_CHECK
+   state_check_recording = false;
+#endif
+#ifdef HAVE_NETWORK
+   if (gb2)
+   {
+      reset_gb(*gb2);
+      link_cable.reset();
+      link_players[0].carry = 0;
+      link_players[1].carry = 0;
+   }
+#endif
+}
+
 static size_t serialize_size = 0;
 size_t retro_serialize_size(void)
 {
+#ifdef HAVE_NETWORK
+   /* Local link mode: player 1, player 2, link
+    * cable, sample carry (per player) */
+   if (gb2)
+      return gb.stateSize() + gb2->stateSize() +
+            link_cable.stateSize() + 2 * sizeof(int32_t);
+#endif
    return gb.stateSize();
 }
 
@@ -2450,6 +3982,22 @@ bool retro_serialize(void *data, size_t size)
       return false;
 
    gb.saveState(data);
+#ifdef HAVE_NETWORK
+   if (gb2)
+   {
+      uint8_t *ptr = (uint8_t*)data + gb.stateSize();
+      int32_t carry[2];
+
+      carry[0] = (int32_t)link_players[0].carry;
+      carry[1] = (int32_t)link_players[1].carry;
+
+      gb2->saveState(ptr);
+      ptr += gb2->stateSize();
+      link_cable.saveState(ptr);
+      ptr += link_cable.stateSize();
+      memcpy(ptr, carry, sizeof(carry));
+   }
+#endif
    return true;
 }
 
@@ -2461,6 +4009,28 @@ bool retro_unserialize(const void *data, size_t size)
       return false;
 
    gb.loadState(data);
+   /* Fast boot is for content started from power-on
+    * or reset, not for a state loaded (automatically,
+    * say) before the first frame */
+   fast_boot_pending = false;
+#ifdef HAVE_STATE_CHECK
+   state_check_recording = false;
+#endif
+#ifdef HAVE_NETWORK
+   if (gb2)
+   {
+      const uint8_t *ptr = (const uint8_t*)data + gb.stateSize();
+      int32_t carry[2];
+
+      gb2->loadState(ptr);
+      ptr += gb2->stateSize();
+      link_cable.loadState(ptr);
+      ptr += link_cable.stateSize();
+      memcpy(carry, ptr, sizeof(carry));
+      link_players[0].carry = carry[0];
+      link_players[1].carry = carry[1];
+   }
+#endif
    return true;
 }
 
@@ -2497,6 +4067,102 @@ static enum gb_colorization_enable_type gb_colorization_enable = GB_COLORIZATION
 static std::string rom_path;
 static char internal_game_name[17];
 
+/* Incremental battery save flush. Every
+ * sram_flush_interval frames, the parts of battery
+ * RAM changed since the last flush are written in
+ * place into <save dir>/<rom name>.srm, in blocks of
+ * gambatte::GB::SAVEDATA_BLOCK_SIZE bytes rather than
+ * as a whole file */
+#define SRAM_FLUSH_MAX_RANGES 16
+
+static unsigned sram_flush_interval = 0;
+static unsigned sram_flush_counter  = 0;
+static char sram_flush_path[PATH_MAX_LENGTH];
+
+static void sram_flush_init(void)
+{
+   const char *save_dir = NULL;
+   const char *rom_file = path_basename(rom_path.c_str());
+   char rom_name[PATH_MAX_LENGTH];
+
+   sram_flush_path[0] = '\0';
+   sram_flush_counter = 0;
+
+#ifdef HAVE_NETWORK
+   /* Link subsystem saves are named by the frontend */
+   if (gb2)
+      return;
+#endif
+
+   if (string_is_empty(rom_file) ||
+       !environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &save_dir) ||
+       !save_dir)
+      return;
+
+   strlcpy(rom_name, rom_file, sizeof(rom_name));
+   path_remove_extension(rom_name);
+   fill_pathname_join(sram_flush_path, save_dir, rom_name,
+         sizeof(sram_flush_path));
+   strlcat(sram_flush_path, ".srm", sizeof(sram_flush_path));
+}
+
+static void sram_flush(void)
+{
+   unsigned offsets[SRAM_FLUSH_MAX_RANGES];
+   unsigned sizes[SRAM_FLUSH_MAX_RANGES];
+   const uint8_t *sram = (const uint8_t*)gb.savedata_ptr();
+   unsigned size       = gb.savedata_size();
+   unsigned written    = 0;
+   unsigned num_ranges;
+   unsigned i;
+   RFILE *file;
+
+   if (string_is_empty(sram_flush_path) || !gb.savedata_dirty())
+      return;
+
+   /* Update the existing file in place, or write
+    * it whole if there is none yet */
+   file = filestream_open(sram_flush_path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE |
+         RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (file && filestream_get_size(file) < (int64_t)size)
+   {
+      filestream_close(file);
+      file = NULL;
+   }
+
+   if (!file)
+   {
+      if (!filestream_write_file(sram_flush_path, sram, size))
+      {
+         gambatte_log(RETRO_LOG_WARN,
+               "Unable to write battery save: %s\n", sram_flush_path);
+         return;
+      }
+
+      while (gb.savedata_dirty_ranges(offsets, sizes, SRAM_FLUSH_MAX_RANGES));
+      gambatte_log(RETRO_LOG_DEBUG,
+            "Wrote battery save: %s\n", sram_flush_path);
+      return;
+   }
+
+   while ((num_ranges = gb.savedata_dirty_ranges(
+               offsets, sizes, SRAM_FLUSH_MAX_RANGES)))
+   {
+      for (i = 0; i < num_ranges; i++)
+      {
+         filestream_seek(file, offsets[i], RETRO_VFS_SEEK_POSITION_START);
+         written += filestream_write(file, sram + offsets[i], sizes[i]);
+      }
+   }
+
+   filestream_close(file);
+   gambatte_log(RETRO_LOG_DEBUG,
+         "Flushed %u bytes of battery save.\n", written);
+}
+
 static void load_custom_palette(void)
 {
    const char *system_dir = NULL;
@@ -2627,15 +4293,18 @@ static void load_custom_palette(void)
          }
       }
 
-#ifdef VIDEO_RGB565
-      rgb32 = (rgb32 & 0x0000F8) >>  3 | /* blue */
-              (rgb32 & 0x00FC00) >>  5 | /* green */
-              (rgb32 & 0xF80000) >>  8;  /* red */
-#elif defined(VIDEO_ABGR1555)
-      rgb32 = (rgb32 & 0x0000F8) <<  7 | /* blue */
-              (rgb32 & 0xF800)   >>  6 | /* green */
-              (rgb32 & 0xF80000) >> 19;  /* red */
-#endif
+      switch (pixel_format)
+      {
+         case gambatte::PIXEL_RGB565:
+            rgb32 = gambatte::PixelRgb565::fromRgb888(rgb32);
+            break;
+         case gambatte::PIXEL_ABGR1555:
+            rgb32 = gambatte::PixelAbgr1555::fromRgb888(rgb32);
+            break;
+         case gambatte::PIXEL_XRGB8888:
+            rgb32 = gambatte::PixelXrgb8888::fromRgb888(rgb32);
+            break;
+      }
 
       if (     string_starts_with(line, "Background0="))
          gb.setDmgPaletteColor(0, 0, rgb32);
@@ -2678,7 +4347,6 @@ palette_line_end:
 static void find_internal_palette(const unsigned short **palette, bool *is_gbc)
 {
    const char *palette_title = NULL;
-   size_t index              = 0;
    struct retro_variable var = {0};
 
    // Read main internal palette setting
@@ -2687,81 +4355,34 @@ static void find_internal_palette(const unsigned short **palette, bool *is_gbc)
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
    {
-      // Handle TWB64 packs
-      if (string_is_equal(var.value, "TWB64 - Pack 1"))
-      {
-         var.key   = "gambatte_gb_palette_twb64_1";
-         var.value = NULL;
-
-         if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
-            palette_title = var.value;
+      const struct internal_palette_group *group = &internal_palette_groups[0];
+      size_t i;
 
-         // Determine 'consolidated' palette index
-         if (palette_title)
-            index = RHMAP_GET_STR(palettes_twb64_1_index_map, palette_title);
-         if (index > 0)
-            index--;
-         internal_palette_index = NUM_PALETTES_DEFAULT + index;
-      }
-      else if (string_is_equal(var.value, "TWB64 - Pack 2"))
+      // Check whether this is a TWB64/PixelShift pack
+      for (i = 1; i < NUM_PALETTE_GROUPS; i++)
       {
-         var.key   = "gambatte_gb_palette_twb64_2";
-         var.value = NULL;
-
-         if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
-            palette_title = var.value;
-
-         // Determine 'consolidated' palette index
-         if (palette_title)
-            index = RHMAP_GET_STR(palettes_twb64_2_index_map, palette_title);
-         if (index > 0)
-            index--;
-         internal_palette_index = NUM_PALETTES_DEFAULT +
-               NUM_PALETTES_TWB64_1 + index;
+         if (string_is_equal(var.value, internal_palette_groups[i].selector))
+         {
+            group = &internal_palette_groups[i];
+            break;
+         }
       }
-      else if (string_is_equal(var.value, "TWB64 - Pack 3"))
-      {
-         var.key   = "gambatte_gb_palette_twb64_3";
-         var.value = NULL;
-
-         if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
-            palette_title = var.value;
 
-         // Determine 'consolidated' palette index
-         if (palette_title)
-            index = RHMAP_GET_STR(palettes_twb64_3_index_map, palette_title);
-         if (index > 0)
-            index--;
-         internal_palette_index = NUM_PALETTES_DEFAULT +
-               NUM_PALETTES_TWB64_1 + NUM_PALETTES_TWB64_2 + index;
-      }
-      // Handle PixelShift packs
-      else if (string_is_equal(var.value, "PixelShift - Pack 1"))
+      if (group->selector)
       {
-         var.key   = "gambatte_gb_palette_pixelshift_1";
+         var.key   = group->key;
          var.value = NULL;
 
          if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
             palette_title = var.value;
-
-         // Determine 'consolidated' palette index
-         if (palette_title)
-            index = RHMAP_GET_STR(palettes_pixelshift_1_index_map, palette_title);
-         if (index > 0)
-            index--;
-         internal_palette_index = NUM_PALETTES_DEFAULT + NUM_PALETTES_TWB64_1 +
-               NUM_PALETTES_TWB64_2 + NUM_PALETTES_TWB64_3 + index;
       }
       else
-      {
          palette_title = var.value;
 
-         // Determine 'consolidated' palette index
-         index = RHMAP_GET_STR(palettes_default_index_map, palette_title);
-         if (index > 0)
-            index--;
-         internal_palette_index = index;
-      }
+      // Determine 'consolidated' palette index
+      internal_palette_index = palette_title ?
+            internal_palette_find_index(palette_title, group) :
+            group->offset;
    }
 
    // Ensure we have a valid palette title
@@ -2798,11 +4419,58 @@ static void find_internal_palette(const unsigned short **palette, bool *is_gbc)
    internal_palette_active = true;
 }
 
+#ifdef HAVE_SHM_OUTPUT
+/* Shared memory output. When enabled (and content
+ * is loaded), frames and audio are published to the
+ * POSIX shared memory segment /gambatte.<pid>, as
+ * described in shm_output.h. Each frame is drawn
+ * straight into its slot of the segment's frame ring,
+ * by pointing video_buf at it */
+static bool shm_output_enabled = false;
+static void *shm_output_video_buf = NULL;
+
+static void shm_output_update(void)
+{
+   if (shm_output_enabled && rom_loaded && !shm_output.isOpen())
+   {
+      char name[32];
+      snprintf(name, sizeof(name), "/gambatte.%ld", (long)getpid());
+
+      if (!shm_output.open(name, VIDEO_WIDTH, VIDEO_HEIGHT,
+               VIDEO_PITCH * video_pixel_size,
+               pixel_format == gambatte::PIXEL_XRGB8888 ?
+                     RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565,
+               VIDEO_BUFF_SIZE))
+      {
+         gambatte_log(RETRO_LOG_WARN, "Failed to create shared memory output %s\n", name);
+         return;
+      }
+
+      shm_output.setSampleRate(audio_output_rate());
+      shm_output_video_buf = video_buf;
+      gambatte_log(RETRO_LOG_INFO, "Shared memory output: %s\n", name);
+   }
+   else if ((!shm_output_enabled || !rom_loaded) && shm_output.isOpen())
+   {
+      /* Keep the last frame, for anything
+       * reading it back */
+      memcpy(shm_output_video_buf, video_buf, VIDEO_BUFF_SIZE);
+      video_buf            = shm_output_video_buf;
+      shm_output_video_buf = NULL;
+      shm_output.close();
+   }
+}
+#endif
+
 static void check_variables(bool startup)
 {
    gambatte_log(RETRO_LOG_INFO, "[LIBRETRO] check_variables() called with startup=%s\n", startup ? "true" : "false");
    unsigned i, j;
 
+   /* Options are compared with the configured settings,
+    * not those the quality governor has stepped down to */
+   quality_governor_restore();
+
    unsigned colorCorrection = 0;
    struct retro_variable var = {0};
    var.key = "gambatte_gbc_color_correction";
@@ -2843,6 +4511,19 @@ static void check_variables(bool startup)
    }
    gb.setDarkFilterLevel(darkFilterLevel);
 
+#ifdef HAVE_NETWORK
+   /* Player 2 (local link mode) shares display
+    * settings, but always uses the default
+    * DMG palette */
+   if (gb2)
+   {
+      gb2->setColorCorrectionMode(colorCorrectionMode);
+      gb2->setColorCorrectionBrightness(colorCorrectionBrightness);
+      gb2->setDarkFilterLevel(darkFilterLevel);
+      gb2->setColorCorrection(gb2->isCgb() && (colorCorrection != 0));
+   }
+#endif
+
    bool old_use_cc_resampler = use_cc_resampler;
    use_cc_resampler          = false;
    var.key                   = "gambatte_audio_resampler";
@@ -2851,7 +4532,24 @@ static void check_variables(bool startup)
        var.value && !strcmp(var.value, "cc"))
       use_cc_resampler = true;
 
-   if (!startup && (use_cc_resampler != old_use_cc_resampler))
+   const struct audio_rate_config *old_audio_rate_config = audio_rate_config;
+   audio_rate_config = &audio_rate_configs[0];
+   var.key           = "gambatte_audio_output_rate";
+   var.value         = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      for (size_t i = 0; i < NUM_AUDIO_RATE_CONFIGS; i++)
+      {
+         if (!strcmp(var.value, audio_rate_configs[i].value))
+         {
+            audio_rate_config = &audio_rate_configs[i];
+            break;
+         }
+      }
+   }
+
+   if (!startup && ((use_cc_resampler != old_use_cc_resampler) ||
+                    (audio_rate_config != old_audio_rate_config)))
    {
       struct retro_system_av_info av_info;
       audio_resampler_deinit();
@@ -2872,6 +4570,61 @@ static void check_variables(bool startup)
          up_down_allowed = false;
    }
 
+   {
+      enum cheat_search_mode_type mode = CHEAT_SEARCH_DISABLED;
+
+      var.key   = "gambatte_cheat_search";
+      var.value = NULL;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      {
+         if (!strcmp(var.value, "8bit"))
+            mode = CHEAT_SEARCH_8BIT;
+         else if (!strcmp(var.value, "16bit"))
+            mode = CHEAT_SEARCH_16BIT;
+      }
+
+      /* Changing the value width restarts the search */
+      if (mode != cheat_search_mode && mode != CHEAT_SEARCH_DISABLED)
+      {
+         cheat_search_mode = mode;
+         cheat_search_init();
+      }
+      cheat_search_mode = mode;
+   }
+
+   var.key   = "gambatte_gameshark_freeze";
+   var.value = NULL;
+   gb.setGameSharkFreeze(environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) &&
+         var.value && !strcmp(var.value, "enabled"));
+
+   fast_boot_enabled     = false;
+   fast_boot_skip_frames = 0;
+   var.key               = "gambatte_fast_boot";
+   var.value             = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value &&
+       strcmp(var.value, "disabled"))
+   {
+      fast_boot_enabled = true;
+      if (strcmp(var.value, "enabled"))
+         fast_boot_skip_frames = atoi(var.value);
+   }
+
+#ifdef HAVE_JIT
+   var.key   = "gambatte_jit";
+   var.value = NULL;
+   gb.setRecompilerEnabled(!environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) ||
+         !var.value || strcmp(var.value, "disabled"));
+#endif
+
+#ifdef HAVE_SHM_OUTPUT
+   var.key            = "gambatte_shm_output";
+   var.value          = NULL;
+   shm_output_enabled = environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) &&
+         var.value && !strcmp(var.value, "enabled");
+   if (!startup)
+      shm_output_update();
+#endif
+
    turbo_period      = TURBO_PERIOD_MIN;
    turbo_pulse_width = TURBO_PULSE_WIDTH_MIN;
    var.key           = "gambatte_turbo_period";
@@ -2915,8 +4668,12 @@ static void check_variables(bool startup)
       fast_forward_audio_enabled = (strcmp(var.value, "enabled") == 0);
    }
 
-   /* Interframe blending option has its own handler */
+   /* Interframe blending and output scaling
+    * options have their own handlers */
    check_frame_blend_variable();
+   check_output_scale_variable(startup);
+   check_perf_profile_variable();
+   quality_governor_configure(startup);
 
 #ifdef HAVE_NETWORK
 
@@ -2931,10 +4688,25 @@ static void check_variables(bool startup)
       }
    }
 
-   var.key = "gambatte_gb_link_network_port";
+   var.key = "gambatte_gb_link_network_port";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+      gb_NetworkPort=atoi(var.value);
+   }
+
+   var.key = "gambatte_gb_link_network_delay";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      gb_net_serial.setDelay(atoi(var.value));
+
+   /* Simulated latency (for testing), with
+    * +/-25% jitter. Value is in ms */
+   var.key = "gambatte_gb_link_network_test_latency";
    var.value = NULL;
-   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
-      gb_NetworkPort=atoi(var.value);
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned latency = (unsigned)(atoi(var.value) * VIDEO_REFRESH_RATE / 1000.0 + 0.5);
+      gb_net_serial.setSimulatedLatency(latency, latency / 4);
    }
 
    unsigned ip_index = 1;
@@ -2975,8 +4747,23 @@ static void check_variables(bool startup)
       gb_NetworkClientAddr += octet;
    }
 
+   /* Local link mode takes precedence
+    * over network link */
+   if (gb2)
+      gb_serialMode = SERIAL_LOCAL;
+
+   link_audio_p2 = false;
+   var.key = "gambatte_gb_link_local_audio";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      link_audio_p2 = !strcmp(var.value, "player_2");
+
    switch(gb_serialMode)
    {
+      case SERIAL_LOCAL:
+         gb_net_serial.stop();
+         gb.setSerialIO(link_cable.port(0));
+         break;
       case SERIAL_SERVER:
          gb_net_serial.start(true, gb_NetworkPort, gb_NetworkClientAddr);
          gb.setSerialIO(&gb_net_serial);
@@ -2996,6 +4783,13 @@ static void check_variables(bool startup)
 
 #endif
 
+   /* Battery save flush interval (seconds) */
+   sram_flush_interval = 0;
+   var.key   = "gambatte_sram_flush_interval";
+   var.value = NULL;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      sram_flush_interval = (unsigned)(atoi(var.value) * VIDEO_REFRESH_RATE + 0.5);
+
    gambatte_log(RETRO_LOG_INFO, "[LIBRETRO] About to process fake RTC variables\n");
    // Handle fake RTC variables
    gambatte_log(RETRO_LOG_INFO, "[LIBRETRO] Processing fake RTC variables\n");
@@ -3196,7 +4990,237 @@ static unsigned pow2ceil(unsigned n) {
    return n;
 }
 
-bool retro_load_game(const struct retro_game_info *info)
+#if defined(HAVE_NETWORK) && defined(HAVE_LINK_THREADS)
+static void link_worker_run(void *arg);
+#endif
+
+#ifdef HAVE_BENCHMARK
+/* Kernel microbenchmarks (enabled by building with
+ * BENCHMARK=1). These are run once, when content is
+ * loaded. The core's own kernels are timed on synthetic
+ * state by benchmark.cpp; the resamplers and frame
+ * blending are timed here on one frame of synthetic
+ * audio and video, and the serializer on the loaded
+ * game's state. Results are logged, and written to
+ * <save dir>/gambatte_benchmark.json */
+struct benchmark_audio
+{
+   int16_t samples[SOUND_SAMPLES_PER_FRAME * 2];
+   int16_t out[BLIP_BUFFER_SIZE * 2];
+   blipper_t *blip_l;
+   blipper_t *blip_r;
+};
+
+static void benchmark_blipper(void *data)
+{
+   struct benchmark_audio *audio = (struct benchmark_audio*)data;
+   unsigned avail;
+
+   blipper_push_samples_stereo(audio->blip_l, audio->blip_r,
+         audio->samples, SOUND_SAMPLES_PER_FRAME);
+
+   avail = blipper_read_avail(audio->blip_l);
+   blipper_read(audio->blip_l, audio->out + 0, avail, 2);
+   blipper_read(audio->blip_r, audio->out + 1, avail, 2);
+}
+
+static void benchmark_cc(void *data)
+{
+   struct benchmark_audio *audio = (struct benchmark_audio*)data;
+
+   CC_renderaudio((audio_frame_t*)audio->samples, SOUND_SAMPLES_PER_FRAME);
+   audio_out_buffer_pos = 0;
+}
+
+static void benchmark_blend(void *data)
+{
+   blend_frames();
+}
+
+static void benchmark_save_state(void *data)
+{
+   gb.saveState(data);
+}
+
+static void benchmark_load_state(void *data)
+{
+   gb.loadState(data);
+}
+
+static void benchmark_audio_kernels(Benchmark &bench)
+{
+   struct benchmark_audio *audio =
+         (struct benchmark_audio*)calloc(1, sizeof(struct benchmark_audio));
+   const struct audio_rate_config *config = audio_rate_config;
+   size_t i;
+
+   if (!audio)
+      return;
+
+   /* Two square waves, at roughly the pitch and
+    * volume of game music */
+   for (i = 0; i < SOUND_SAMPLES_PER_FRAME; i++)
+   {
+      audio->samples[(i << 1)    ] = (i / 4789) & 1 ? 3000 : -3000;
+      audio->samples[(i << 1) + 1] = (i / 2391) & 1 ? 2000 : -2000;
+   }
+
+   audio->blip_l = blipper_new(config->taps, config->cutoff, config->beta,
+         config->decimation, BLIP_BUFFER_SIZE, NULL);
+   audio->blip_r = blipper_new(config->taps, config->cutoff, config->beta,
+         config->decimation, BLIP_BUFFER_SIZE, NULL);
+
+   if (audio->blip_l && audio->blip_r)
+      bench.run("blipper_push_samples", benchmark_blipper, audio,
+            SOUND_SAMPLES_PER_FRAME * 4);
+
+   if (audio->blip_l)
+      blipper_free(audio->blip_l);
+   if (audio->blip_r)
+      blipper_free(audio->blip_r);
+
+   /* CC_renderaudio() writes to the live output
+    * buffer, so leave it as it was found */
+   if (audio_out_buffer)
+   {
+      size_t out_pos = audio_out_buffer_pos;
+
+      audio_out_buffer_pos = 0;
+      bench.run("CC_renderaudio", benchmark_cc, audio,
+            SOUND_SAMPLES_PER_FRAME * 4);
+      audio_out_buffer_pos = out_pos;
+      CC_init();
+   }
+
+   free(audio);
+}
+
+static void benchmark_blend_kernels(Benchmark &bench)
+{
+   static const struct
+   {
+      enum frame_blend_method type;
+      const char *name;
+   } methods[] = {
+      { FRAME_BLEND_MIX,               "blend_frames_mix" },
+      { FRAME_BLEND_LCD_GHOSTING,      "blend_frames_lcd_ghost" },
+      { FRAME_BLEND_LCD_GHOSTING_FAST, "blend_frames_lcd_ghost_fast" },
+#ifdef __mips__
+      { FRAME_BLEND_ULTRA_FAST,        "blend_frames_ultra_fast" },
+#endif
+   };
+   void (*old_scale_line)(const void *src, unsigned y) = scale_line;
+   size_t i, j;
+
+   /* Blend a noisy frame, without scaling it
+    * (the blended frame is overwritten by the
+    * first emulated frame anyway) */
+   scale_line = NULL;
+
+   for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++)
+   {
+      uint32_t seed = 1;
+      uint8_t *curr;
+
+      deinit_frame_blending();
+      frame_blend_type = methods[i].type;
+      init_frame_blending();
+
+      if (!blend_frames)
+         continue;
+
+      curr = (uint8_t*)video_buf_ring_frame(0);
+      for (j = 0; j < VIDEO_BUFF_SIZE; j++)
+      {
+         seed    = seed * 1103515245u + 12345u;
+         curr[j] = seed >> 24;
+      }
+
+      bench.run(methods[i].name, benchmark_blend, NULL,
+            VIDEO_WIDTH * VIDEO_HEIGHT * video_pixel_size);
+   }
+
+   /* Back to the blending set by the core options */
+   deinit_frame_blending();
+   blend_frames = NULL;
+   scale_line   = old_scale_line;
+   check_frame_blend_variable();
+   memset(video_buf, 0, VIDEO_BUFF_SIZE);
+}
+
+static void benchmark_state_kernels(Benchmark &bench)
+{
+   size_t size = gb.stateSize();
+   void *data  = malloc(size);
+
+   if (!data)
+      return;
+
+   gb.saveState(data);
+   bench.run("StateSaver::saveState", benchmark_save_state, data, size);
+   bench.run("StateSaver::loadState", benchmark_load_state, data, size);
+
+   free(data);
+}
+
+static void benchmark_run(void)
+{
+   struct retro_perf_callback perf;
+   struct retro_system_info info;
+   const char *save_dir = NULL;
+   char path[PATH_MAX_LENGTH];
+   char features[32];
+   std::string json;
+   size_t i;
+
+   memset(&perf, 0, sizeof(perf));
+   environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf);
+
+   Benchmark bench(&perf);
+
+   retro_get_system_info(&info);
+   bench.setInfo("core_version", info.library_version);
+   bench.setInfo("game", path_basename(rom_path.c_str()));
+   bench.setInfo("model", gb.isCgb() ? "cgb" : "dmg");
+   bench.setInfo("pixel_format",
+         pixel_format == gambatte::PIXEL_XRGB8888 ? "xrgb8888" :
+         pixel_format == gambatte::PIXEL_ABGR1555 ? "abgr1555" : "rgb565");
+#ifdef __VERSION__
+   bench.setInfo("compiler", __VERSION__);
+#endif
+   if (perf.get_cpu_features)
+   {
+      snprintf(features, sizeof(features), "0x%llx",
+            (unsigned long long)perf.get_cpu_features());
+      bench.setInfo("cpu_features", features);
+   }
+
+   gambatte_log(RETRO_LOG_INFO, "Running kernel benchmarks...\n");
+
+   bench.runCoreKernels(pixel_format);
+   benchmark_audio_kernels(bench);
+   benchmark_blend_kernels(bench);
+   benchmark_state_kernels(bench);
+
+   for (i = 0; i < bench.numResults(); i++)
+      gambatte_log(RETRO_LOG_INFO, "Benchmark: %s\n", bench.summary(i).c_str());
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &save_dir) ||
+       string_is_empty(save_dir))
+      return;
+
+   fill_pathname_join(path, save_dir, "gambatte_benchmark.json", sizeof(path));
+   json = bench.json();
+
+   if (filestream_write_file(path, json.data(), json.size()))
+      gambatte_log(RETRO_LOG_INFO, "Benchmark results written to %s\n", path);
+   else
+      gambatte_log(RETRO_LOG_WARN, "Failed to write benchmark results to %s\n", path);
+}
+#endif
+
+static bool load_game(const struct retro_game_info *info,
+      const struct retro_game_info *info_p2)
 {
 #ifdef SF2000
    /* SF2000: Reset splash screen variables */
@@ -3295,21 +5319,8 @@ bool retro_load_game(const struct retro_game_info *info)
    }
 
 #if !defined(SF2000)
-#if defined(VIDEO_RGB565) || defined(VIDEO_ABGR1555)
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
-   {
-      gambatte_log(RETRO_LOG_ERROR, "RGB565 is not supported.\n");
+   if (!set_pixel_format())
       return false;
-   }
-#else
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
-   {
-      gambatte_log(RETRO_LOG_ERROR, "XRGB8888 is not supported.\n");
-      return false;
-   }
-#endif
 #endif
    
    bool has_gbc_bootloader = file_present_in_system("gbc_bios.bin");
@@ -3340,14 +5351,52 @@ bool retro_load_game(const struct retro_game_info *info)
 
    if (gb.load(info->data, info->size, flags) != 0)
       return false;
-#ifdef DUAL_MODE
-   if (gb2.load(info->data, info->size, flags) != 0)
-      return false;
+
+#ifdef HAVE_NETWORK
+   if (info_p2)
+   {
+      gb2 = new gambatte::GB;
+      gb2->setInputGetter(&gb_input_p2);
+      gb2->setBootloaderGetter(get_bootloader_from_file);
+      gb2->setPixelFormat(pixel_format);
+
+      if (gb2->load(info_p2->data, info_p2->size, flags) != 0)
+      {
+         delete gb2;
+         gb2 = NULL;
+         return false;
+      }
+
+      /* Player 1 is connected to port 0
+       * in check_variables() */
+      link_cable.reset();
+      gb2->setSerialIO(link_cable.port(1));
+
+      link_players = new link_player[2];
+      for (unsigned i = 0; i < 2; i++)
+      {
+         link_players[i].gb         = i ? gb2 : &gb;
+         link_players[i].output     = i * GB_SCREEN_WIDTH * video_pixel_size;
+         link_players[i].samples    = 0;
+         link_players[i].carry      = 0;
+         link_players[i].frame_done = false;
+         memset(link_players[i].video, 0, sizeof(link_players[i].video));
+      }
+
+#ifdef HAVE_LINK_THREADS
+      if (LinkWorker::numCpus() > 1 &&
+          link_worker.start(link_worker_run, &link_players[1]))
+         gambatte_log(RETRO_LOG_INFO, "Running link player 2 on a separate thread.\n");
+#endif
+   }
 #endif
 
    rom_path = info->path ? info->path : "";
    strncpy(internal_game_name, (const char*)info->data + 0x134, sizeof(internal_game_name) - 1);
    internal_game_name[sizeof(internal_game_name)-1]='\0';
+   sram_flush_init();
+   perf_profile_init((const uint8_t*)info->data, info->size);
+   cheat_search_init();
    
    // Set fake RTC save directory - get from frontend like other save files
    const char* save_dir = NULL;
@@ -3365,6 +5414,7 @@ bool retro_load_game(const struct retro_game_info *info)
    gambatte_log(RETRO_LOG_INFO, "Got internal game name: %s.\n", internal_game_name);
 
    check_variables(true);
+   fast_boot_start();
    
    // Initialize fake RTC after core options are processed
    gambatte_log(RETRO_LOG_INFO, "[LIBRETRO] =================== INITIALIZING FAKE RTC ===================\n");
@@ -3455,20 +5505,64 @@ bool retro_load_game(const struct retro_game_info *info)
    rewind_init_buffer();
 #endif
 
+#ifdef HAVE_BENCHMARK
+   benchmark_run();
+#endif
+
+   quality_governor_start();
+
    rom_loaded = true;
+#ifdef HAVE_SHM_OUTPUT
+   shm_output_update();
+#endif
    return true;
 }
 
 
-bool retro_load_game_special(unsigned, const struct retro_game_info*, size_t) { return false; }
+bool retro_load_game(const struct retro_game_info *info)
+{
+   return load_game(info, NULL);
+}
+
+bool retro_load_game_special(unsigned type,
+      const struct retro_game_info *info, size_t num_info)
+{
+#ifdef HAVE_NETWORK
+   if ((type == SUBSYSTEM_LINK_2P) && (num_info == 2) && info)
+      return load_game(&info[0], &info[1]);
+#endif
+   return false;
+}
 
 void retro_unload_game()
 {
 #ifdef SF2000
    /* Clean up rewind buffer */
    rewind_deinit_buffer();
+#endif
+#ifdef HAVE_STATE_CHECK
+   state_check_deinit();
+#endif
+   if (sram_flush_interval)
+      sram_flush();
+   perf_profile_save();
+#ifdef HAVE_NETWORK
+   if (gb2)
+   {
+#ifdef HAVE_LINK_THREADS
+      link_worker.stop();
+#endif
+      gb.setSerialIO(NULL);
+      delete gb2;
+      gb2 = NULL;
+      delete[] link_players;
+      link_players = NULL;
+   }
 #endif
    rom_loaded = false;
+#ifdef HAVE_SHM_OUTPUT
+   shm_output_update();
+#endif
 }
 
 unsigned retro_get_region() { return RETRO_REGION_NTSC; }
@@ -3481,6 +5575,16 @@ void *retro_get_memory_data(unsigned id)
          return gb.savedata_ptr();
       case RETRO_MEMORY_RTC:
          return gb.rtcdata_ptr();
+#ifdef HAVE_NETWORK
+      case RETRO_MEMORY_LINK_P1_SAVE_RAM:
+         return gb.savedata_ptr();
+      case RETRO_MEMORY_LINK_P1_RTC:
+         return gb.rtcdata_ptr();
+      case RETRO_MEMORY_LINK_P2_SAVE_RAM:
+         return gb2 ? gb2->savedata_ptr() : 0;
+      case RETRO_MEMORY_LINK_P2_RTC:
+         return gb2 ? gb2->rtcdata_ptr() : 0;
+#endif
       case RETRO_MEMORY_SYSTEM_RAM:
          /* Really ugly hack here, relies upon 
           * libgambatte/src/memory/memptrs.cpp MemPtrs::reset not
@@ -3500,6 +5604,16 @@ size_t retro_get_memory_size(unsigned id)
          return gb.savedata_size();
       case RETRO_MEMORY_RTC:
          return gb.rtcdata_size();
+#ifdef HAVE_NETWORK
+      case RETRO_MEMORY_LINK_P1_SAVE_RAM:
+         return gb.savedata_size();
+      case RETRO_MEMORY_LINK_P1_RTC:
+         return gb.rtcdata_size();
+      case RETRO_MEMORY_LINK_P2_SAVE_RAM:
+         return gb2 ? gb2->savedata_size() : 0;
+      case RETRO_MEMORY_LINK_P2_RTC:
+         return gb2 ? gb2->rtcdata_size() : 0;
+#endif
       case RETRO_MEMORY_SYSTEM_RAM:
          /* This is rather hacky too... it relies upon 
           * libgambatte/src/memory/cartridge.cpp not changing
@@ -3514,6 +5628,120 @@ size_t retro_get_memory_size(unsigned id)
    return 0;
 }
 
+#ifdef HAVE_NETWORK
+static void link_render_audio(gambatte::uint_least32_t *sound_buf, unsigned samples)
+{
+   if (use_cc_resampler)
+      CC_renderaudio((audio_frame_t*)sound_buf, samples);
+   else
+   {
+      blipper_renderaudio((const int16_t*)sound_buf, samples);
+
+      unsigned read_avail = blipper_read_avail(resampler_l);
+      if (read_avail >= (BLIP_BUFFER_SIZE >> 1))
+         audio_out_buffer_read_blipper(read_avail);
+   }
+}
+
+/* Runs one player for a link cable quantum */
+static void link_run_player(struct link_player *p, unsigned quantum)
+{
+   long remaining = (long)quantum - p->carry;
+
+   p->samples    = 0;
+   p->frame_done = false;
+
+   while (remaining > 0)
+   {
+      unsigned samples = (unsigned)remaining;
+
+      if (p->gb->runFor(p->video, GB_SCREEN_WIDTH,
+            p->sound + p->samples, SOUND_BUFF_SIZE - p->samples,
+            samples) >= 0)
+      {
+         /* Frame complete - present it */
+         const unsigned char *src = (const unsigned char*)p->video;
+         unsigned char *dst       = (unsigned char*)render_buf + p->output;
+         unsigned y;
+
+         for (y = 0; y < VIDEO_HEIGHT; y++)
+         {
+            memcpy(dst, src, GB_SCREEN_WIDTH * video_pixel_size);
+            src += GB_SCREEN_WIDTH * video_pixel_size;
+            dst += VIDEO_PITCH * video_pixel_size;
+         }
+
+         p->frame_done = true;
+      }
+
+      p->samples += samples;
+      remaining  -= samples;
+   }
+
+   /* Overshoot (at most one instruction) is
+    * carried over to the next quantum */
+   p->carry = -remaining;
+}
+
+#ifdef HAVE_LINK_THREADS
+static void link_worker_run(void *arg)
+{
+   link_run_player((struct link_player*)arg, link_cable.quantum());
+}
+#endif
+
+/* Runs both Game Boys, one link cable quantum
+ * at a time, until player 1 has completed a video
+ * frame. Within a quantum the players are independent,
+ * so player 2 runs in parallel when a worker thread is
+ * available (with identical results). Only the selected
+ * player's audio is output.
+ * Returns number of samples generated */
+static unsigned link_run_frame(void)
+{
+   struct link_player *p1 = &link_players[0];
+   struct link_player *p2 = &link_players[1];
+   unsigned samples_total = 0;
+   bool p2_frame_done     = false;
+
+   do
+   {
+      unsigned quantum = link_cable.quantum();
+
+#ifdef HAVE_LINK_THREADS
+      if (link_worker.running())
+      {
+         link_worker.post();
+         link_run_player(p1, quantum);
+         link_worker.wait();
+      }
+      else
+#endif
+      {
+         link_run_player(p1, quantum);
+         link_run_player(p2, quantum);
+      }
+
+      link_cable.sync();
+      p2_frame_done |= p2->frame_done;
+
+      if (link_audio_p2)
+         link_render_audio(p2->sound, p2->samples);
+      else
+         link_render_audio(p1->sound, p1->samples);
+
+      samples_total += p1->samples;
+   } while (!p1->frame_done);
+
+   /* Player 2 may run a little behind, and not
+    * finish a frame before player 1 does */
+   if (!p2_frame_done)
+      video_buf_ring_keep_screen(p2->output);
+
+   return samples_total;
+}
+#endif
+
 static void retro_run_internal();
 
 void retro_run()
@@ -3567,6 +5795,10 @@ static void retro_run_internal()
 
    input_poll_cb();
    update_input_state();
+#ifdef HAVE_NETWORK
+   if (gb2)
+      update_input_state_p2();
+#endif
    
    // Update fake RTC every frame
    gambatte::fake_rtc_update();
@@ -3574,24 +5806,78 @@ static void retro_run_internal()
    uint64_t expected_frames = samples_count / SOUND_SAMPLES_PER_FRAME;
    if (frames_count < expected_frames) // Detect frame dupes.
    {
-      video_cb(NULL, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_PITCH * sizeof(gambatte::video_pixel_t));
+      video_cb(NULL, OUTPUT_WIDTH, OUTPUT_HEIGHT, OUTPUT_PITCH * video_pixel_size);
       frames_count++;
       return;
    }
 
+#ifdef HAVE_STATE_CHECK
+   state_check_begin_frame();
+#endif
+
+#ifdef HAVE_NETWORK
+   /* Network link: hold the frame (without blocking)
+    * if the peer has fallen more than the input delay
+    * behind */
+   bool net_link = (gb_serialMode == SERIAL_SERVER) ||
+                   (gb_serialMode == SERIAL_CLIENT);
+   if (net_link && !gb_net_serial.beginFrame())
+   {
+      video_cb(NULL, OUTPUT_WIDTH, OUTPUT_HEIGHT, OUTPUT_PITCH * video_pixel_size);
+      return;
+   }
+#endif
+
+   /* A frame dropped by the quality governor is
+    * emulated but not drawn, and the frontend shows
+    * the last one again */
+   bool frame_dropped      = quality_drop_frame();
+#ifdef HAVE_STATE_CHECK
+   if (state_check_recording)
+      frame_dropped = false;
+#endif
+   /* Frames that run the fast boot, or show the
+    * splash screen, say nothing of the game's cost */
+   bool frame_timed        = !fast_boot_pending;
+#ifdef SF2000
+   if (!sf2000_splash_shown)
+      frame_timed = false;
+#endif
+   retro_time_t frame_time;
+
+#ifdef HAVE_SHM_OUTPUT
+   if (shm_output.isOpen() && !frame_dropped)
+      video_buf = shm_output.beginFrame();
+#endif
+
+   if (frame_dropped)
+      render_buf = NULL;
+   else
+      render_buf = blend_frames ? video_buf_ring_frame(0) : video_buf;
+
    union
    {
       gambatte::uint_least32_t u32[SOUND_BUFF_SIZE];
       int16_t i16[2 * SOUND_BUFF_SIZE];
    } static sound_buf;
-   unsigned samples = SOUND_SAMPLES_PER_RUN;
+   unsigned samples   = SOUND_SAMPLES_PER_RUN;
+   bool frame_skipped = false;
+
+#ifdef SF2000
+   if (!sf2000_splash_shown)
+      fast_boot_run(FAST_BOOT_FRAMES_PER_SPLASH, sound_buf.u32);
+   else
+#endif
+      fast_boot_run(FAST_BOOT_MAX_FRAMES, sound_buf.u32);
+
+   frame_time = quality_time_usec();
 
 #ifdef SF2000
    /* SF2000: Check splash screen first - don't run emulator during splash */
    if (!sf2000_splash_shown && sf2000_splash_timer < SF2000_SPLASH_DURATION)
    {
       /* During splash screen, don't run emulator - just show splash */
-      sf2000_draw_splash_screen(video_buf);
+      PIXEL_FORMAT_FUNC(sf2000_draw_splash_screen)(render_buf);
       sf2000_splash_timer++;
       if (sf2000_splash_timer >= SF2000_SPLASH_DURATION)
       {
@@ -3614,7 +5900,7 @@ static void retro_run_internal()
             /* Frameskip: for 5x mode, skip rendering intermediate frames for performance */
             bool is_final_frame = (iter == iterations - 1);
             bool use_frameskip = (sf2000_fastforward_state == 2) && !is_final_frame; /* 5x mode with frameskip */
-            gambatte::video_pixel_t *frame_buf = use_frameskip ? NULL : video_buf;
+            void *frame_buf = use_frameskip ? NULL : render_buf;
             
             while (gb.runFor(frame_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
             {
@@ -3649,7 +5935,7 @@ static void retro_run_internal()
          if (should_run_frame)
          {
             /* Run emulation normally for this frame */
-            while (gb.runFor(video_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
+            while (gb.runFor(render_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
             {
                /* Only process audio if enabled during slow motion */
                if (fast_forward_audio_enabled)
@@ -3674,13 +5960,23 @@ static void retro_run_internal()
          {
             /* Skip this frame - just output the previous frame again */
             /* The video buffer retains the last frame content */
+            frame_skipped = true;
          }
       }
       else
       {
          /* Normal speed */
 #endif
-         while (gb.runFor(video_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
+#ifdef HAVE_NETWORK
+         if (gb2)
+         {
+            /* Audio has already been rendered */
+            samples_count += link_run_frame();
+            samples        = 0;
+         }
+         else
+#endif
+         while (gb.runFor(render_buf, VIDEO_PITCH, sound_buf.u32, SOUND_BUFF_SIZE, samples) == -1)
          {
             if (use_cc_resampler)
                CC_renderaudio((audio_frame_t*)sound_buf.u32, samples);
@@ -3693,6 +5989,13 @@ static void retro_run_internal()
                   audio_out_buffer_read_blipper(read_avail);
             }
 
+#ifdef HAVE_NETWORK
+            /* Time stamps network link events */
+            gb_net_serial.advance(samples);
+#endif
+#ifdef HAVE_STATE_CHECK
+            state_check_audio(sound_buf.u32, samples);
+#endif
             samples_count += samples;
             samples = SOUND_SAMPLES_PER_RUN;
          }
@@ -3700,17 +6003,33 @@ static void retro_run_internal()
       } /* Close the normal speed block */
    } /* Close the splash done block */
 #endif
-#ifdef DUAL_MODE
-   while (gb2.runFor(video_buf + GB_SCREEN_WIDTH, VIDEO_PITCH, sound_buf.u32, samples) == -1) {}
+#ifdef HAVE_NETWORK
+   if (net_link)
+      gb_net_serial.endFrame();
 #endif
 
-   /* Perform interframe blending, if required */
-   if (blend_frames)
-      blend_frames();
+   /* Perform interframe blending and output
+    * scaling, if required (a skipped frame is
+    * still in the output buffers) */
+   if (!frame_skipped && !frame_dropped)
+   {
+      if (blend_frames)
+      {
+         blend_frames();
+         video_buf_ring_advance();
+      }
+      else if (scale_line)
+         scale_frame();
+   }
 
    /* Splash screen is now handled before emulator execution */
 
-   video_cb(video_buf, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_PITCH * sizeof(gambatte::video_pixel_t));
+   frame_time = quality_time_usec() - frame_time;
+
+   video_cb(frame_dropped ? NULL : OUTPUT_BUF,
+         OUTPUT_WIDTH, OUTPUT_HEIGHT, OUTPUT_PITCH * video_pixel_size);
+
+   retro_time_t audio_time = quality_time_usec();
 
    if (use_cc_resampler)
       CC_renderaudio((audio_frame_t*)sound_buf.u32, samples);
@@ -3722,8 +6041,30 @@ static void retro_run_internal()
       audio_out_buffer_read_blipper(read_avail);
    }
    samples_count += samples;
+
+   frame_time += quality_time_usec() - audio_time;
    audio_upload_samples();
 
+#ifdef HAVE_SHM_OUTPUT
+   if (shm_output.isOpen())
+      shm_output.endFrame();
+#endif
+
+#ifdef HAVE_STATE_CHECK
+   state_check_audio(sound_buf.u32, samples);
+   state_check_end_frame();
+#endif
+
+   /* Settings only change between frames */
+   if (frame_timed)
+      quality_governor_frame(frame_time);
+
+   if (sram_flush_interval && ++sram_flush_counter >= sram_flush_interval)
+   {
+      sram_flush_counter = 0;
+      sram_flush();
+   }
+
    /* Apply any 'pending' rumble effects */
    if (rumble_active)
       apply_rumble();
@@ -8,14 +8,18 @@
 #include <retro_inline.h>
 
 #ifndef HAVE_NO_LANGEXTRA
-#include "libretro_core_options_intl.h"
+#include "libretro_core_options_intl_packed.h"
 #endif
 
 /*
  ********************************
- * VERSION: 2.0
+ * VERSION: 2.1
  ********************************
  *
+ * - 2.1: Translations are stored compressed (generated from
+ *        libretro_core_options_intl.h by
+ *        libretro_core_options_intl_pack.py), and only the
+ *        selected language is unpacked at runtime
  * - 2.0: Add support for core options v2 interface 
  * - 1.3: Move translations to libretro_core_options_intl.h
  *        - libretro_core_options_intl.h includes BOM and utf-8
@@ -623,6 +627,22 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+   {
+      "gambatte_output_scale",
+      "Core Output Scaling",
+      NULL,
+      "Scale frames inside the core, together with interframe blending, instead of leaving it to the frontend. Saves a full pass over each frame on devices that scale in software. '2x Smooth' interpolates between neighbouring pixels. 'Fit to 320x240' fills a 320x240 display. Not applied in Game Link (2 Players) mode.",
+      NULL,
+      NULL,
+      {
+         { "disabled",    NULL },
+         { "2x",          "2x" },
+         { "2x_blend",    "2x Smooth" },
+         { "fit_320x240", "Fit to 320x240" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       "gambatte_audio_resampler",
       "Audio Resampler",
@@ -641,6 +661,53 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       "sinc"
 #endif
    },
+   {
+      "gambatte_audio_output_rate",
+      "Audio Output Rate",
+      NULL,
+      "Sample rate of the audio passed to the frontend. 'Native' uses the rate of the selected resampler (~32 kHz for 'Sinc', ~64 kHz for 'Cosine'). Choosing the rate of the audio device avoids a second resampling pass in the frontend. '22050 Hz' uses a shorter 'Sinc' filter, roughly halving its cost on low-end hardware.",
+      NULL,
+      NULL,
+      {
+         { "native", "Native" },
+         { "22050",  "22050 Hz" },
+         { "32000",  "32000 Hz" },
+         { "44100",  "44100 Hz" },
+         { "48000",  "48000 Hz" },
+         { NULL, NULL },
+      },
+      "native"
+   },
+   {
+      "gambatte_quality_governor",
+      "Adaptive Quality",
+      NULL,
+      "Lowers the cost of expensive options while the core cannot keep up with full speed, and restores them once it can. 'Blending' steps 'Interframe Blending' down towards 'Disabled'. 'Blending + Audio' then switches to the 'Cosine' resampler (only when 'Audio Output Rate' is not 'Native'). 'All' then skips every other frame.",
+      NULL,
+      NULL,
+      {
+         { "disabled",       NULL },
+         { "blending",       "Blending" },
+         { "blending_audio", "Blending + Audio" },
+         { "all",            "All" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "gambatte_perf_profile",
+      "Per-Game Performance Profile",
+      NULL,
+      "Keeps statistics of how long each game takes per frame, and of the settings that kept it at full speed, in a small file in the save directory. With 'Adaptive Quality' enabled, each game then starts from the settings that last kept it at full speed, instead of stepping down to them.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
 #ifdef __mips__
    {
       "gambatte_mips_performance",
@@ -688,6 +755,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "enabled"
    },
+   {
+      "gambatte_fast_boot",
+      "Fast Boot",
+      NULL,
+      "Run the bootloader start-up animation invisibly and silently at full speed when content starts or is reset, so that play begins as soon as the bootloader hands over to the game. The hardware state left by the bootloader is kept. Optionally also skips the first frames of the game. Without an official bootloader, only the skipped game frames apply. Nothing is skipped when a save state is loaded as content starts.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  "Bootloader Only" },
+         { "30",       "Bootloader + 30 Frames" },
+         { "60",       "Bootloader + 60 Frames" },
+         { "120",      "Bootloader + 120 Frames" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       "gambatte_up_down_allowed",
       "Allow Opposing Directions",
@@ -702,6 +786,35 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+   {
+      "gambatte_gameshark_freeze",
+      "GameShark Freeze",
+      NULL,
+      "Re-applies GameShark codes for work RAM and cartridge RAM every time the game writes to their address, instead of once per frame. Makes codes stick in games that overwrite the value mid-frame.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+   {
+      "gambatte_cheat_search",
+      "Cheat Search Hotkeys",
+      NULL,
+      "Searches RAM for the 8-bit or 16-bit value to cheat on, narrowing the candidates as it changes in game. While holding Select: Y starts a new search, Up/Down keep values that increased/decreased, Right keeps unchanged values, X keeps changed values, R/L keep values that increased/decreased by 1. Once few candidates remain, their addresses (and GameShark codes, for 8-bit values) are shown.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "8bit",     "8-bit" },
+         { "16bit",    "16-bit" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       "gambatte_turbo_period",
       "Turbo Button Period",
@@ -868,6 +981,38 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+#ifdef HAVE_JIT
+   {
+      "gambatte_jit",
+      "Dynamic Recompiler",
+      NULL,
+      "Translates game code into native x86-64 code instead of interpreting it one instruction at a time. Emulation is identical either way; disable only to compare performance or rule the recompiler out when troubleshooting.",
+      NULL,
+      NULL,
+      {
+         { "enabled",  NULL },
+         { "disabled", NULL },
+         { NULL, NULL },
+      },
+      "enabled"
+   },
+#endif
+#ifdef HAVE_SHM_OUTPUT
+   {
+      "gambatte_shm_output",
+      "Shared Memory Output",
+      NULL,
+      "Publishes each frame and the output audio to the POSIX shared memory segment '/gambatte.<process id>', for capture, streaming and automation tools to read without copies. See 'shm_output.h' for the layout.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
+#endif
 #ifdef HAVE_NETWORK
    {
       "gambatte_show_gb_link_settings",
@@ -898,6 +1043,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "Not Connected"
    },
+   {
+      "gambatte_gb_link_local_audio",
+      "Local Link Audio",
+      "Local Audio",
+      "When running two linked Game Boys side by side (loaded via the 'Link (2 Players)' subsystem), specify which player's audio is output.",
+      NULL,
+      "gb_link",
+      {
+         { "player_1", "Player 1" },
+         { "player_2", "Player 2" },
+         { NULL, NULL },
+      },
+      "player_1"
+   },
    {
       "gambatte_gb_link_network_port",
       "Network Link Port",
@@ -931,6 +1090,43 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "56400"
    },
+   {
+      "gambatte_gb_link_network_delay",
+      "Network Link Input Delay",
+      "Input Delay",
+      "Number of frames by which each side sees the other's Game Link activity delayed. Hides network latency: the link never stalls as long as messages arrive within this delay, but each transferred byte takes twice this long to be acknowledged. The larger of the two sides' settings is used.",
+      NULL,
+      "gb_link",
+      {
+         { "1", "1 frame" },
+         { "2", "2 frames" },
+         { "3", "3 frames" },
+         { "4", "4 frames" },
+         { "5", "5 frames" },
+         { "6", "6 frames" },
+         { "7", "7 frames" },
+         { "8", "8 frames" },
+         { NULL, NULL },
+      },
+      "3"
+   },
+   {
+      "gambatte_gb_link_network_test_latency",
+      "Network Link Simulated Latency",
+      "Simulated Latency",
+      "For testing: delay outgoing Game Link network messages (with +/-25% jitter), e.g. to try out input delay settings with both instances running on the same machine.",
+      NULL,
+      "gb_link",
+      {
+         { "0",   "disabled" },
+         { "25",  "25ms" },
+         { "50",  "50ms" },
+         { "100", "100ms" },
+         { "200", "200ms" },
+         { NULL, NULL },
+      },
+      "0"
+   },
    {
       "gambatte_gb_link_network_server_ip_1",
       "Network Link Server Address Pt. 01: x__.___.___.___",
@@ -1196,6 +1392,24 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       "0"
    },
 #endif
+   {
+      "gambatte_sram_flush_interval",
+      "Battery Save Auto-Flush",
+      NULL,
+      "Periodically writes in-game saves to '[ROM name].srm' in the save directory, updating only the parts of the file that changed. Protects saves against power loss on devices where the frontend only writes save files on exit, with minimal flash wear.",
+      NULL,
+      NULL,
+      {
+         { "disabled", NULL },
+         { "1",        "1 second" },
+         { "5",        "5 seconds" },
+         { "10",       "10 seconds" },
+         { "30",       "30 seconds" },
+         { "60",       "60 seconds" },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    {
       "gambatte_fake_rtc",
       "Fake RTC",
@@ -1292,47 +1506,215 @@ struct retro_core_options_v2 options_us = {
 
 /*
  ********************************
- * Language Mapping
+ * Functions
  ********************************
 */
 
 #ifndef HAVE_NO_LANGEXTRA
-struct retro_core_options_v2 *options_intl[RETRO_LANGUAGE_LAST] = {
-   &options_us,    /* RETRO_LANGUAGE_ENGLISH */
-   &options_ja,    /* RETRO_LANGUAGE_JAPANESE */
-   &options_fr,    /* RETRO_LANGUAGE_FRENCH */
-   &options_es,    /* RETRO_LANGUAGE_SPANISH */
-   &options_de,    /* RETRO_LANGUAGE_GERMAN */
-   &options_it,    /* RETRO_LANGUAGE_ITALIAN */
-   &options_nl,    /* RETRO_LANGUAGE_DUTCH */
-   &options_pt_br, /* RETRO_LANGUAGE_PORTUGUESE_BRAZIL */
-   &options_pt_pt, /* RETRO_LANGUAGE_PORTUGUESE_PORTUGAL */
-   &options_ru,    /* RETRO_LANGUAGE_RUSSIAN */
-   &options_ko,    /* RETRO_LANGUAGE_KOREAN */
-   &options_cht,   /* RETRO_LANGUAGE_CHINESE_TRADITIONAL */
-   &options_chs,   /* RETRO_LANGUAGE_CHINESE_SIMPLIFIED */
-   &options_eo,    /* RETRO_LANGUAGE_ESPERANTO */
-   &options_pl,    /* RETRO_LANGUAGE_POLISH */
-   &options_vn,    /* RETRO_LANGUAGE_VIETNAMESE */
-   &options_ar,    /* RETRO_LANGUAGE_ARABIC */
-   &options_el,    /* RETRO_LANGUAGE_GREEK */
-   &options_tr,    /* RETRO_LANGUAGE_TURKISH */
-   &options_sk,    /* RETRO_LANGUAGE_SLOVAK */
-   &options_fa,    /* RETRO_LANGUAGE_PERSIAN */
-   &options_he,    /* RETRO_LANGUAGE_HEBREW */
-   &options_ast,   /* RETRO_LANGUAGE_ASTURIAN */
-   &options_fi,    /* RETRO_LANGUAGE_FINNISH */
-   &options_id,    /* RETRO_LANGUAGE_INDONESIAN */
-   &options_sv,    /* RETRO_LANGUAGE_SWEDISH */
-   &options_uk,    /* RETRO_LANGUAGE_UKRAINIAN */
-};
-#endif
+/* Decompresses translation data
+ * (see libretro_core_options_intl_pack.py for
+ * a description of the format) */
+static INLINE size_t libretro_core_options_intl_length(
+      const unsigned char **src, const unsigned char *src_end,
+      size_t len)
+{
+   if (len == 15)
+   {
+      unsigned char b;
 
-/*
- ********************************
- * Functions
- ********************************
-*/
+      do
+      {
+         if (*src >= src_end)
+            return (size_t)-1;
+
+         b    = *(*src)++;
+         len += b;
+      } while (b == 255);
+   }
+
+   return len;
+}
+
+static INLINE bool libretro_core_options_intl_decompress(
+      const unsigned char *src, size_t src_size,
+      unsigned char *dst, size_t dst_size)
+{
+   const unsigned char *src_end = src + src_size;
+   unsigned char *dst_start     = dst;
+   unsigned char *dst_end       = dst + dst_size;
+
+   while (src < src_end)
+   {
+      unsigned char token = *src++;
+      size_t len          = libretro_core_options_intl_length(
+            &src, src_end, token >> 4);
+      size_t offset;
+      const unsigned char *match;
+
+      /* Literals */
+      if ((len > (size_t)(src_end - src)) ||
+          (len > (size_t)(dst_end - dst)))
+         return false;
+
+      memcpy(dst, src, len);
+      dst += len;
+      src += len;
+
+      /* Final sequence has no match */
+      if (src >= src_end)
+         break;
+
+      /* Match */
+      if (src_end - src < 2)
+         return false;
+
+      offset = src[0] | (src[1] << 8);
+      src   += 2;
+      len    = libretro_core_options_intl_length(
+            &src, src_end, token & 0xF);
+
+      if ((len == (size_t)-1) ||
+          (offset == 0) ||
+          (offset > (size_t)(dst - dst_start)) ||
+          (len + 4 > (size_t)(dst_end - dst)))
+         return false;
+
+      len  += 4;
+      match = dst - offset;
+
+      /* Matches may overlap, so copy
+       * byte by byte */
+      while (len--)
+         *dst++ = *match++;
+   }
+
+   return dst == dst_end;
+}
+
+static INLINE const char *libretro_core_options_intl_string(char **str)
+{
+   char *s = *str;
+
+   *str += strlen(s) + 1;
+   return *s ? s : NULL;
+}
+
+/* Unpacks translated core options for the specified
+ * language. Returns NULL if no translation is available.
+ * > Returned pointer must be freed via
+ *   libretro_core_options_intl_free() once the frontend
+ *   has copied the options */
+static INLINE struct retro_core_options_v2 *libretro_core_options_intl_unpack(
+      unsigned language)
+{
+   const struct retro_core_options_intl_packed *packed = NULL;
+   struct retro_core_options_v2 *options               = NULL;
+   struct retro_core_option_v2_category *cats          = NULL;
+   struct retro_core_option_v2_definition *defs        = NULL;
+   char *str                                           = NULL;
+   size_t num_defs                                     = 0;
+   size_t i, j;
+
+   if ((language >= RETRO_LANGUAGE_LAST) ||
+       (language == RETRO_LANGUAGE_ENGLISH))
+      return NULL;
+
+   packed = &options_intl_packed[language];
+   if (!packed->data)
+      return NULL;
+
+   /* Everything lives in a single allocation:
+    * options, categories, definitions, strings */
+   options = (struct retro_core_options_v2 *)calloc(1,
+         sizeof(struct retro_core_options_v2) +
+         (packed->num_cats + 1) * sizeof(struct retro_core_option_v2_category) +
+         (packed->num_defs + 1) * sizeof(struct retro_core_option_v2_definition) +
+         packed->size);
+   if (!options)
+      return NULL;
+
+   cats = (struct retro_core_option_v2_category *)(options + 1);
+   defs = (struct retro_core_option_v2_definition *)(cats + packed->num_cats + 1);
+   str  = (char *)(defs + packed->num_defs + 1);
+
+   if (!libretro_core_options_intl_decompress(packed->data,
+         packed->data_size, (unsigned char *)str, packed->size))
+   {
+      free(options);
+      return NULL;
+   }
+
+   options->categories  = cats;
+   options->definitions = defs;
+
+   /* Categories */
+   for (i = 0; i < packed->num_cats; i++)
+   {
+      cats[i].key  = libretro_core_options_intl_string(&str);
+      cats[i].desc = libretro_core_options_intl_string(&str);
+      cats[i].info = libretro_core_options_intl_string(&str);
+   }
+   libretro_core_options_intl_string(&str);
+
+   /* Definitions */
+   for (i = 0; i < packed->num_defs; i++)
+   {
+      struct retro_core_option_v2_definition *def    = &defs[num_defs];
+      struct retro_core_option_v2_definition *def_us = NULL;
+      size_t num_values                              = 0;
+      const char *value;
+
+      def->key              = libretro_core_options_intl_string(&str);
+      def->desc             = libretro_core_options_intl_string(&str);
+      def->desc_categorized = libretro_core_options_intl_string(&str);
+      def->info             = libretro_core_options_intl_string(&str);
+      def->info_categorized = libretro_core_options_intl_string(&str);
+      def->category_key     = libretro_core_options_intl_string(&str);
+
+      while ((value = libretro_core_options_intl_string(&str)))
+      {
+         const char *label = libretro_core_options_intl_string(&str);
+
+         if (num_values < RETRO_NUM_CORE_OPTION_VALUES_MAX - 1)
+         {
+            def->values[num_values].value = value;
+            def->values[num_values].label = label;
+            num_values++;
+         }
+      }
+
+      /* Translations cover all options - skip any
+       * that are not present in this build (and
+       * use US default values, which are platform
+       * dependent) */
+      for (j = 0; option_defs_us[j].key; j++)
+      {
+         if (!strcmp(option_defs_us[j].key, def->key))
+         {
+            def_us = &option_defs_us[j];
+            break;
+         }
+      }
+
+      if (!def_us)
+      {
+         memset(def, 0, sizeof(*def));
+         continue;
+      }
+
+      def->default_value = def_us->default_value;
+      num_defs++;
+   }
+
+   return options;
+}
+
+static INLINE void libretro_core_options_intl_free(
+      struct retro_core_options_v2 *options)
+{
+   free(options);
+}
+#endif
 
 /* Handles configuration/setting of core options.
  * Should be called as early as possible - ideally inside
@@ -1366,12 +1748,16 @@ static INLINE void libretro_set_core_options(retro_environment_t environ_cb,
       core_options_intl.us    = &options_us;
       core_options_intl.local = NULL;
 
-      if (environ_cb(RETRO_ENVIRONMENT_GET_LANGUAGE, &language) &&
-          (language < RETRO_LANGUAGE_LAST) && (language != RETRO_LANGUAGE_ENGLISH))
-         core_options_intl.local = options_intl[language];
+      if (environ_cb(RETRO_ENVIRONMENT_GET_LANGUAGE, &language))
+         core_options_intl.local = libretro_core_options_intl_unpack(language);
 
       *categories_supported = environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2_INTL,
             &core_options_intl);
+
+      /* Frontend has copied the options - translations
+       * are no longer required */
+      if (core_options_intl.local)
+         libretro_core_options_intl_free(core_options_intl.local);
 #else
       *categories_supported = environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2,
             &options_us);
@@ -1386,6 +1772,8 @@ static INLINE void libretro_set_core_options(retro_environment_t environ_cb,
             *option_v1_defs_us         = NULL;
 #ifndef HAVE_NO_LANGEXTRA
       size_t num_options_intl          = 0;
+      struct retro_core_options_v2
+            *options_intl              = NULL;
       struct retro_core_option_v2_definition
             *option_defs_intl          = NULL;
       struct retro_core_option_definition
@@ -1436,10 +1824,11 @@ static INLINE void libretro_set_core_options(retro_environment_t environ_cb,
          }
 
 #ifndef HAVE_NO_LANGEXTRA
-         if (environ_cb(RETRO_ENVIRONMENT_GET_LANGUAGE, &language) &&
-             (language < RETRO_LANGUAGE_LAST) && (language != RETRO_LANGUAGE_ENGLISH) &&
-             options_intl[language])
-            option_defs_intl = options_intl[language]->definitions;
+         if (environ_cb(RETRO_ENVIRONMENT_GET_LANGUAGE, &language))
+            options_intl = libretro_core_options_intl_unpack(language);
+
+         if (options_intl)
+            option_defs_intl = options_intl->definitions;
 
          if (option_defs_intl)
          {
@@ -1589,6 +1978,12 @@ error:
          free(option_v1_defs_intl);
          option_v1_defs_intl = NULL;
       }
+
+      if (options_intl)
+      {
+         libretro_core_options_intl_free(options_intl);
+         options_intl = NULL;
+      }
 #endif
 
       if (values_buf)
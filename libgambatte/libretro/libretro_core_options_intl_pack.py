@@ -0,0 +1,362 @@
+#!/usr/bin/env python3
+
+"""Core option translation packer
+
+Generates 'libretro_core_options_intl_packed.h' from the translated
+core option definitions in 'libretro_core_options_intl.h'.
+
+Each language is serialised to a flat list of strings and compressed
+(simple LZ77 format, see libretro_core_options_intl_unpack() in
+'libretro_core_options.h'), so that only the language selected by
+the frontend is ever expanded at runtime, and translation data costs
+no relocations or writable memory.
+
+Must be re-run whenever 'libretro_core_options_intl.h' is updated.
+
+Serialised format (all strings NUL terminated, empty string == NULL):
+  categories:  { key, desc, info }...                         ""
+  definitions: { key, desc, desc_categorized, info,
+                 info_categorized, category_key,
+                 { value, label }... "" }...                  ""
+
+Compressed format (byte oriented LZ77):
+  sequence: token, [literal length ext], literals,
+            [match offset (u16 LE), [match length ext]]
+  > token high nibble: literal length (15 == extended)
+  > token low nibble:  match length - 4 (15 == extended)
+  > length ext: bytes summed until a byte != 255
+  > final sequence contains literals only
+
+Usage:
+python3 path/to/libretro_core_options_intl_pack.py
+"""
+import os
+import re
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+INTL_FILE = os.path.join(SCRIPT_DIR, 'libretro_core_options_intl.h')
+OUTPUT_FILE = os.path.join(SCRIPT_DIR, 'libretro_core_options_intl_packed.h')
+
+# (language suffix, RETRO_LANGUAGE_* enum)
+# > Languages not listed here are not packed
+LANGUAGES = [
+    ('ja',    'RETRO_LANGUAGE_JAPANESE'),
+    ('fr',    'RETRO_LANGUAGE_FRENCH'),
+    ('es',    'RETRO_LANGUAGE_SPANISH'),
+    ('de',    'RETRO_LANGUAGE_GERMAN'),
+    ('it',    'RETRO_LANGUAGE_ITALIAN'),
+    ('nl',    'RETRO_LANGUAGE_DUTCH'),
+    ('pt_br', 'RETRO_LANGUAGE_PORTUGUESE_BRAZIL'),
+    ('pt_pt', 'RETRO_LANGUAGE_PORTUGUESE_PORTUGAL'),
+    ('ru',    'RETRO_LANGUAGE_RUSSIAN'),
+    ('ko',    'RETRO_LANGUAGE_KOREAN'),
+    ('cht',   'RETRO_LANGUAGE_CHINESE_TRADITIONAL'),
+    ('chs',   'RETRO_LANGUAGE_CHINESE_SIMPLIFIED'),
+    ('eo',    'RETRO_LANGUAGE_ESPERANTO'),
+    ('pl',    'RETRO_LANGUAGE_POLISH'),
+    ('vn',    'RETRO_LANGUAGE_VIETNAMESE'),
+    ('ar',    'RETRO_LANGUAGE_ARABIC'),
+    ('el',    'RETRO_LANGUAGE_GREEK'),
+    ('tr',    'RETRO_LANGUAGE_TURKISH'),
+    ('sk',    'RETRO_LANGUAGE_SLOVAK'),
+    ('fa',    'RETRO_LANGUAGE_PERSIAN'),
+    ('he',    'RETRO_LANGUAGE_HEBREW'),
+    ('ast',   'RETRO_LANGUAGE_ASTURIAN'),
+    ('fi',    'RETRO_LANGUAGE_FINNISH'),
+    ('id',    'RETRO_LANGUAGE_INDONESIAN'),
+    ('sv',    'RETRO_LANGUAGE_SWEDISH'),
+    ('uk',    'RETRO_LANGUAGE_UKRAINIAN'),
+]
+
+STRING_RE = r'"(?:[^"\\]|\\.)*"'
+TOKEN_RE = re.compile(r'(%s)|([A-Za-z_][A-Za-z0-9_]*)|(\d+)|([{},])' % STRING_RE)
+ESCAPES = {'"': '"', '\\': '\\', 'n': '\n', 't': '\t', "'": "'", '?': '?'}
+
+LZ_MIN_MATCH = 4
+LZ_MAX_OFFSET = 0xFFFF
+LZ_MAX_CHAIN = 256
+
+
+def c_unescape(literal):
+    out = []
+    i = 1
+    while i < len(literal) - 1:
+        c = literal[i]
+        if c == '\\':
+            e = literal[i + 1]
+            if e not in ESCAPES:
+                sys.exit('Unsupported escape sequence \\%s' % e)
+            out.append(ESCAPES[e])
+            i += 2
+        else:
+            out.append(c)
+            i += 1
+    return ''.join(out)
+
+
+def strip_preprocessor(body):
+    # Drop '#else' branches (platform specific default values,
+    # which are never used by translations) and all directives
+    lines = []
+    skip = False
+    for line in body.split('\n'):
+        stripped = line.strip()
+        if stripped.startswith('#'):
+            if stripped.startswith('#else'):
+                skip = True
+            elif stripped.startswith('#endif'):
+                skip = False
+            continue
+        if not skip:
+            lines.append(line)
+    return '\n'.join(lines)
+
+
+def parse_initializer(body, macros):
+    stack = [[]]
+    for m in TOKEN_RE.finditer(strip_preprocessor(body)):
+        string, ident, number, punct = m.groups()
+        if string is not None:
+            stack[-1].append(c_unescape(string))
+        elif ident is not None:
+            if ident == 'NULL':
+                stack[-1].append(None)
+            elif ident in macros:
+                stack[-1].append(macros[ident])
+            else:
+                sys.exit('Unknown identifier %s' % ident)
+        elif number is not None:
+            stack[-1].append(None)
+        elif punct == '{':
+            stack.append([])
+        elif punct == '}':
+            item = stack.pop()
+            stack[-1].append(item)
+    return stack[0]
+
+
+def array_body(src, name):
+    start = src.find(name + '[] = {')
+    if start < 0:
+        sys.exit('Array %s not found' % name)
+    start = src.index('{', start)
+    end = src.index('\n};', start)
+    return src[start + 1:end]
+
+
+def serialise(cats, defs):
+    out = []
+
+    def put(s):
+        if s == '':
+            sys.exit('Empty strings cannot be packed')
+        out.append((s or '').encode('utf-8') + b'\0')
+
+    for cat in cats:
+        if cat[0] is None:
+            break
+        put(cat[0])
+        put(cat[1])
+        put(cat[2])
+    put(None)
+
+    num_cats = len([c for c in cats if c[0] is not None])
+    num_defs = 0
+    for d in defs:
+        if d[0] is None:
+            break
+        num_defs += 1
+        for s in d[:6]:
+            put(s)
+        for v in d[6]:
+            if not v or v[0] is None:
+                break
+            put(v[0])
+            put(v[1])
+        put(None)
+    put(None)
+
+    return b''.join(out), num_cats, num_defs
+
+
+def lz_compress(data):
+    out = bytearray()
+    size = len(data)
+    head = {}
+    prev = [-1] * size
+    literal_start = 0
+    pos = 0
+
+    def put_length(length):
+        while length >= 255:
+            out.append(255)
+            length -= 255
+        out.append(length)
+
+    def insert(p):
+        if p + LZ_MIN_MATCH <= size:
+            key = data[p:p + LZ_MIN_MATCH]
+            prev[p] = head.get(key, -1)
+            head[key] = p
+
+    def put_sequence(literals, offset, match_len):
+        lit_len = len(literals)
+        token = (min(lit_len, 15) << 4)
+        if offset:
+            token |= min(match_len - LZ_MIN_MATCH, 15)
+        out.append(token)
+        if lit_len >= 15:
+            put_length(lit_len - 15)
+        out.extend(literals)
+        if offset:
+            out.append(offset & 0xFF)
+            out.append(offset >> 8)
+            if match_len - LZ_MIN_MATCH >= 15:
+                put_length(match_len - LZ_MIN_MATCH - 15)
+
+    while pos + LZ_MIN_MATCH <= size:
+        best_len = 0
+        best_offset = 0
+        candidate = head.get(data[pos:pos + LZ_MIN_MATCH], -1)
+        chain = 0
+        while candidate >= 0 and chain < LZ_MAX_CHAIN:
+            offset = pos - candidate
+            if offset > LZ_MAX_OFFSET:
+                break
+            length = 0
+            while pos + length < size and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_len:
+                best_len = length
+                best_offset = offset
+            candidate = prev[candidate]
+            chain += 1
+
+        if best_len >= LZ_MIN_MATCH:
+            put_sequence(data[literal_start:pos], best_offset, best_len)
+            for p in range(pos, pos + best_len):
+                insert(p)
+            pos += best_len
+            literal_start = pos
+        else:
+            insert(pos)
+            pos += 1
+
+    put_sequence(data[literal_start:], 0, 0)
+    return bytes(out)
+
+
+def lz_decompress(data, size):
+    out = bytearray()
+    i = 0
+
+    def get_length(length):
+        nonlocal i
+        if length == 15:
+            while True:
+                b = data[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        return length
+
+    while i < len(data):
+        token = data[i]
+        i += 1
+        lit_len = get_length(token >> 4)
+        out.extend(data[i:i + lit_len])
+        i += lit_len
+        if i >= len(data):
+            break
+        offset = data[i] | (data[i + 1] << 8)
+        i += 2
+        match_len = get_length(token & 0xF) + LZ_MIN_MATCH
+        for _ in range(match_len):
+            out.append(out[-offset])
+    if len(out) != size:
+        sys.exit('Decompression size mismatch')
+    return bytes(out)
+
+
+def main():
+    with open(INTL_FILE, 'r', encoding='utf-8-sig') as f:
+        src = f.read()
+
+    macros = {}
+    for m in re.finditer(r'^#define ([A-Z0-9_]+) (NULL|(?:%s\s*)+)$' % STRING_RE, src, re.M):
+        value = m.group(2)
+        macros[m.group(1)] = None if value == 'NULL' else \
+            ''.join(c_unescape(s) for s in re.findall(STRING_RE, value))
+
+    out = []
+    out.append('/* This file is generated by libretro_core_options_intl_pack.py')
+    out.append(' * from libretro_core_options_intl.h - do not edit by hand */')
+    out.append('')
+    out.append('#ifndef LIBRETRO_CORE_OPTIONS_INTL_PACKED_H__')
+    out.append('#define LIBRETRO_CORE_OPTIONS_INTL_PACKED_H__')
+    out.append('')
+    out.append('#include <stddef.h>')
+    out.append('')
+    out.append('#include <libretro.h>')
+    out.append('')
+    out.append('struct retro_core_options_intl_packed')
+    out.append('{')
+    out.append('   const unsigned char *data;')
+    out.append('   size_t data_size;')
+    out.append('   size_t size;         /* Unpacked size */')
+    out.append('   size_t num_cats;')
+    out.append('   size_t num_defs;')
+    out.append('};')
+
+    total_raw = 0
+    total_packed = 0
+    entries = []
+    for suffix, enum in LANGUAGES:
+        cats = parse_initializer(array_body(src, 'option_cats_' + suffix), macros)
+        defs = parse_initializer(array_body(src, 'option_defs_' + suffix), macros)
+        raw, num_cats, num_defs = serialise(cats, defs)
+        packed = lz_compress(raw)
+        if lz_decompress(packed, len(raw)) != raw:
+            sys.exit('Compression round trip failed (%s)' % suffix)
+        total_raw += len(raw)
+        total_packed += len(packed)
+
+        name = 'options_%s_packed' % suffix
+        out.append('')
+        out.append('/* %s */' % enum)
+        out.append('static const unsigned char %s_data[] = {' % name)
+        for i in range(0, len(packed), 16):
+            out.append('   ' + ' '.join('0x%02x,' % b for b in packed[i:i + 16]))
+        out.append('};')
+        entries.append((enum, name, len(packed), len(raw), num_cats, num_defs))
+
+    out.append('')
+    out.append('static const struct retro_core_options_intl_packed')
+    out.append('      options_intl_packed[RETRO_LANGUAGE_LAST] = {')
+    out.append('   { NULL, 0, 0, 0, 0 }, /* RETRO_LANGUAGE_ENGLISH */')
+    index = {e[0]: e for e in entries}
+    with open(os.path.join(SCRIPT_DIR, '..', 'libretro-common', 'include', 'libretro.h'),
+              'r', encoding='utf-8') as f:
+        enums = re.findall(r'^\s*(RETRO_LANGUAGE_[A-Z_]+)\s*=\s*\d+', f.read(), re.M)
+    for enum in enums[1:]:
+        if enum in index:
+            _, name, data_size, size, num_cats, num_defs = index[enum]
+            out.append('   { %s_data, %d, %d, %d, %d }, /* %s */' %
+                       (name, data_size, size, num_cats, num_defs, enum))
+        else:
+            out.append('   { NULL, 0, 0, 0, 0 }, /* %s */' % enum)
+    out.append('};')
+    out.append('')
+    out.append('#endif')
+    out.append('')
+
+    with open(OUTPUT_FILE, 'w', encoding='utf-8', newline='\n') as f:
+        f.write('\n'.join(out))
+
+    print('Packed %d languages: %d -> %d bytes' % (len(entries), total_raw, total_packed))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,199 @@
+#include "link_cable.h"
+#include <string.h>
+
+namespace {
+
+struct PortState {
+	unsigned char out;
+	unsigned char post;
+	unsigned char in;
+	unsigned char peerOut;
+	unsigned char flags;
+};
+
+struct CableState {
+	unsigned char quantum[4];
+	PortState ports[2];
+};
+
+enum {
+	FLAG_CHECKED        = 0x01,
+	FLAG_ACTIVE         = 0x02,
+	FLAG_POST_FAST_CGB  = 0x04,
+	FLAG_POSTED         = 0x08,
+	FLAG_IN_FAST_CGB    = 0x10,
+	FLAG_HAS_IN         = 0x20,
+	FLAG_PEER_LISTENING = 0x40
+};
+
+void put32(unsigned char *dst, unsigned long v) {
+	dst[0] = v       & 0xFF;
+	dst[1] = v >>  8 & 0xFF;
+	dst[2] = v >> 16 & 0xFF;
+	dst[3] = v >> 24 & 0xFF;
+}
+
+unsigned long get32(const unsigned char *src) {
+	return (unsigned long)src[0]
+	     | (unsigned long)src[1] <<  8
+	     | (unsigned long)src[2] << 16
+	     | (unsigned long)src[3] << 24;
+}
+
+}
+
+LinkCable::Port::Port()
+{
+	reset();
+}
+
+void LinkCable::Port::reset()
+{
+	out_ = 0xFF;
+	checked_ = false;
+	active_ = false;
+	post_ = 0xFF;
+	postFastCgb_ = false;
+	posted_ = false;
+	in_ = 0xFF;
+	inFastCgb_ = false;
+	hasIn_ = false;
+	peerOut_ = 0xFF;
+	peerListening_ = false;
+}
+
+bool LinkCable::Port::check(unsigned char out, unsigned char& in, bool& fastCgb)
+{
+	active_ = true;
+
+	if (hasIn_) {
+		in = in_;
+		fastCgb = inFastCgb_;
+		hasIn_ = false;
+		return true;
+	}
+
+	out_ = out;
+	checked_ = true;
+	return false;
+}
+
+unsigned char LinkCable::Port::send(unsigned char data, bool fastCgb)
+{
+	active_ = true;
+	// Not listening while clocking a transfer
+	checked_ = false;
+
+	if (!peerListening_)
+		return 0xFF;
+
+	// One byte per quantum
+	peerListening_ = false;
+	post_ = data;
+	postFastCgb_ = fastCgb;
+	posted_ = true;
+	return peerOut_;
+}
+
+LinkCable::LinkCable()
+: quantum_(IDLE_QUANTUM_SAMPLES)
+{
+}
+
+void LinkCable::reset()
+{
+	ports_[0].reset();
+	ports_[1].reset();
+	quantum_ = IDLE_QUANTUM_SAMPLES;
+}
+
+unsigned LinkCable::sync()
+{
+	bool active = false;
+
+	// Empty mailboxes
+	for (unsigned i = 0; i < 2; ++i) {
+		Port &p = ports_[i];
+		Port &peer = ports_[i ^ 1];
+
+		if (p.posted_) {
+			peer.in_ = p.post_;
+			peer.inFastCgb_ = p.postFastCgb_;
+			peer.hasIn_ = true;
+		}
+	}
+
+	// Publish listening state for the next quantum
+	for (unsigned i = 0; i < 2; ++i) {
+		Port &p = ports_[i];
+		Port const &peer = ports_[i ^ 1];
+
+		p.peerListening_ = peer.checked_ && !peer.hasIn_;
+		p.peerOut_ = peer.out_;
+		active = active || p.active_ || p.hasIn_;
+	}
+
+	for (unsigned i = 0; i < 2; ++i) {
+		ports_[i].checked_ = false;
+		ports_[i].active_ = false;
+		ports_[i].posted_ = false;
+	}
+
+	quantum_ = active ? ACTIVE_QUANTUM_SAMPLES : IDLE_QUANTUM_SAMPLES;
+	return quantum_;
+}
+
+std::size_t LinkCable::stateSize() const
+{
+	return sizeof(CableState);
+}
+
+void LinkCable::saveState(void *data) const
+{
+	CableState state;
+
+	put32(state.quantum, quantum_);
+	for (unsigned i = 0; i < 2; ++i) {
+		Port const &p = ports_[i];
+		state.ports[i].out = p.out_;
+		state.ports[i].post = p.post_;
+		state.ports[i].in = p.in_;
+		state.ports[i].peerOut = p.peerOut_;
+		state.ports[i].flags = (p.checked_ ? FLAG_CHECKED : 0)
+		                     | (p.active_ ? FLAG_ACTIVE : 0)
+		                     | (p.postFastCgb_ ? FLAG_POST_FAST_CGB : 0)
+		                     | (p.posted_ ? FLAG_POSTED : 0)
+		                     | (p.inFastCgb_ ? FLAG_IN_FAST_CGB : 0)
+		                     | (p.hasIn_ ? FLAG_HAS_IN : 0)
+		                     | (p.peerListening_ ? FLAG_PEER_LISTENING : 0);
+	}
+
+	memcpy(data, &state, sizeof(state));
+}
+
+void LinkCable::loadState(const void *data)
+{
+	CableState state;
+
+	memcpy(&state, data, sizeof(state));
+
+	quantum_ = get32(state.quantum);
+	if (quantum_ != ACTIVE_QUANTUM_SAMPLES)
+		quantum_ = IDLE_QUANTUM_SAMPLES;
+
+	for (unsigned i = 0; i < 2; ++i) {
+		Port &p = ports_[i];
+		unsigned flags = state.ports[i].flags;
+		p.out_ = state.ports[i].out;
+		p.post_ = state.ports[i].post;
+		p.in_ = state.ports[i].in;
+		p.peerOut_ = state.ports[i].peerOut;
+		p.checked_ = flags & FLAG_CHECKED;
+		p.active_ = flags & FLAG_ACTIVE;
+		p.postFastCgb_ = flags & FLAG_POST_FAST_CGB;
+		p.posted_ = flags & FLAG_POSTED;
+		p.inFastCgb_ = flags & FLAG_IN_FAST_CGB;
+		p.hasIn_ = flags & FLAG_HAS_IN;
+		p.peerListening_ = flags & FLAG_PEER_LISTENING;
+	}
+}
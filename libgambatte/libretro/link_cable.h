@@ -0,0 +1,90 @@
+#ifndef _LINK_CABLE_H
+#define _LINK_CABLE_H
+
+#include <gambatte.h>
+#include <cstddef>
+
+// In-process Game Link cable, connecting the serial ports
+// of two gambatte::GB instances running in the same core.
+//
+// Both instances are run for the same length of emulated
+// time (a 'quantum', as returned by sync()), either one
+// after the other or concurrently on separate threads.
+// sync() must be called between quanta, while neither
+// instance is running. During a quantum each port only
+// touches its own state (outgoing bytes are posted to a
+// mailbox, and the peer is seen as it was at the last
+// sync()), so the two instances never interact mid-quantum.
+//
+// A port is 'listening' when its GB was waiting for an
+// external clock (SC = 0x80) during the last quantum. A
+// byte sent by the master to a listening peer returns the
+// peer's SB as of the last sync(), and is delivered at the
+// next sync() - the peer starts its transfer at its next
+// serial check. A master sending to a peer that is not
+// listening reads 0xFF, as with no cable connected.
+//
+// Quanta are one scanline long while either side is
+// using the serial port, and longer while both are idle.
+// Transfers therefore depend only on emulated time, never
+// on host timing or thread scheduling, so linked sessions
+// are fully deterministic (and can be saved and restored
+// via saveState()/loadState()).
+class LinkCable
+{
+	public:
+		enum {
+			// One scanline
+			ACTIVE_QUANTUM_SAMPLES = 228,
+			// 9 scanlines (roughly one byte at normal
+			// speed), must not exceed SOUND_SAMPLES_PER_RUN
+			IDLE_QUANTUM_SAMPLES = 228 * 9
+		};
+
+		LinkCable();
+
+		gambatte::SerialIO *port(unsigned index) { return &ports_[index]; }
+
+		void reset();
+		// Delivers bytes posted during the last quantum,
+		// and returns the length (in samples) of the next
+		unsigned sync();
+		unsigned quantum() const { return quantum_; }
+
+		std::size_t stateSize() const;
+		void saveState(void *data) const;
+		void loadState(const void *data);
+
+	private:
+		class Port : public gambatte::SerialIO
+		{
+			public:
+				Port();
+
+				void reset();
+
+				virtual bool check(unsigned char out, unsigned char& in, bool& fastCgb);
+				virtual unsigned char send(unsigned char data, bool fastCgb);
+
+				// Written by this port during a quantum
+				unsigned char out_;
+				bool checked_;
+				bool active_;
+				// Mailbox (to peer)
+				unsigned char post_;
+				bool postFastCgb_;
+				bool posted_;
+
+				// Written by sync() only
+				unsigned char in_;
+				bool inFastCgb_;
+				bool hasIn_;
+				unsigned char peerOut_;
+				bool peerListening_;
+		};
+
+		Port ports_[2];
+		unsigned quantum_;
+};
+
+#endif
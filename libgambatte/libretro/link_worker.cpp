@@ -0,0 +1,133 @@
+#include "link_worker.h"
+#include <unistd.h>
+
+namespace {
+
+// Polls before falling back to a condition variable
+// (a link quantum takes some tens of microseconds)
+enum { SPIN_ITERATIONS = 1 << 14 };
+
+}
+
+LinkWorker::Signal::Signal()
+: count_(0)
+, sleeping_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+	pthread_cond_init(&cond_, NULL);
+}
+
+LinkWorker::Signal::~Signal()
+{
+	pthread_cond_destroy(&cond_);
+	pthread_mutex_destroy(&mutex_);
+}
+
+void LinkWorker::Signal::raise()
+{
+	__atomic_add_fetch(&count_, 1, __ATOMIC_SEQ_CST);
+
+	// Paired with the store to sleeping_ in waitFor():
+	// either the waiter sees the new count, or we see
+	// that it is (about to be) asleep
+	if (__atomic_load_n(&sleeping_, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&mutex_);
+		pthread_cond_signal(&cond_);
+		pthread_mutex_unlock(&mutex_);
+	}
+}
+
+void LinkWorker::Signal::waitFor(unsigned long count)
+{
+	for (unsigned i = 0; i < SPIN_ITERATIONS; ++i) {
+		if (__atomic_load_n(&count_, __ATOMIC_ACQUIRE) >= count)
+			return;
+	}
+
+	pthread_mutex_lock(&mutex_);
+	__atomic_store_n(&sleeping_, 1, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n(&count_, __ATOMIC_SEQ_CST) < count)
+		pthread_cond_wait(&cond_, &mutex_);
+
+	__atomic_store_n(&sleeping_, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&mutex_);
+}
+
+LinkWorker::LinkWorker()
+: job_(0)
+, arg_(0)
+, posted_(0)
+, quit_(false)
+, running_(false)
+{
+}
+
+LinkWorker::~LinkWorker()
+{
+	stop();
+}
+
+bool LinkWorker::start(Job job, void *arg)
+{
+	stop();
+
+	job_ = job;
+	arg_ = arg;
+	posted_ = 0;
+	quit_ = false;
+	start_.reset();
+	done_.reset();
+
+	running_ = pthread_create(&thread_, NULL, threadMain, this) == 0;
+	return running_;
+}
+
+void LinkWorker::stop()
+{
+	if (!running_)
+		return;
+
+	quit_ = true;
+	start_.raise();
+	pthread_join(thread_, NULL);
+	running_ = false;
+}
+
+void LinkWorker::post()
+{
+	start_.raise();
+	++posted_;
+}
+
+void LinkWorker::wait()
+{
+	done_.waitFor(posted_);
+}
+
+unsigned LinkWorker::numCpus()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n > 0)
+		return n;
+#endif
+	return 1;
+}
+
+void *LinkWorker::threadMain(void *arg)
+{
+	LinkWorker &w = *static_cast<LinkWorker *>(arg);
+	unsigned long runs = 0;
+
+	for (;;) {
+		w.start_.waitFor(++runs);
+		if (w.quit_)
+			break;
+
+		w.job_(w.arg_);
+		w.done_.raise();
+	}
+
+	return NULL;
+}
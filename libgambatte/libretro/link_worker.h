@@ -0,0 +1,64 @@
+#ifndef _LINK_WORKER_H
+#define _LINK_WORKER_H
+
+#include <pthread.h>
+
+// Runs a job on a dedicated thread, once per post(),
+// in parallel with the calling thread. Used to run
+// player 2 of a local link session on a second core.
+//
+// post() and wait() act as a barrier between the two
+// threads: everything written before post() is visible
+// to the job, and everything written by the job is
+// visible after wait(). Both sides spin briefly before
+// sleeping, since link quanta are very short.
+class LinkWorker
+{
+	public:
+		typedef void (*Job)(void *arg);
+
+		LinkWorker();
+		~LinkWorker();
+
+		bool start(Job job, void *arg);
+		void stop();
+		bool running() const { return running_; }
+
+		// Starts one run of the job
+		void post();
+		// Waits for the last run started by post()
+		void wait();
+
+		static unsigned numCpus();
+
+	private:
+		class Signal
+		{
+			public:
+				Signal();
+				~Signal();
+
+				void reset() { count_ = 0; }
+				void raise();
+				void waitFor(unsigned long count);
+
+			private:
+				unsigned long count_;
+				int sleeping_;
+				pthread_mutex_t mutex_;
+				pthread_cond_t cond_;
+		};
+
+		static void *threadMain(void *arg);
+
+		Job job_;
+		void *arg_;
+		pthread_t thread_;
+		Signal start_;
+		Signal done_;
+		unsigned long posted_;
+		bool quit_;
+		bool running_;
+};
+
+#endif
@@ -11,11 +11,84 @@
 #include <ws2tcpip.h>
 #else
 #include <sys/socket.h>
-#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #endif
 
+#ifdef _WIN32
+#define NET_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define NET_IN_PROGRESS() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#define NET_WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#define NET_IN_PROGRESS() (errno == EINPROGRESS)
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+enum {
+	PROTOCOL_VERSION = 1,
+	DEFAULT_DELAY = 3,
+	// Frames between connection attempts
+	CONNECT_INTERVAL = 300,
+	// Frames to wait for the peer before giving up
+	STALL_TIMEOUT = 600,
+	MAX_STAMP = 0xFFFF,
+	MAX_EVENTS_PER_FRAME = 0xFFFF
+};
+
+// Message types
+enum {
+	MSG_HELLO = 'H',
+	MSG_FRAME = 'F'
+};
+
+// Event types
+enum {
+	EVENT_LISTEN = 'L',
+	EVENT_UNLISTEN = 'U',
+	EVENT_DATA = 'D',
+	EVENT_DATA_FAST_CGB = 'C'
+};
+
+// 'H' "GBLK" version delay
+const std::size_t HELLO_SIZE = 7;
+// 'F' seq[4] count[2], followed by count * (stamp[2] type value)
+const std::size_t FRAME_HEADER_SIZE = 7;
+const std::size_t EVENT_SIZE = 4;
+
+void put16(std::string& dst, unsigned long v) {
+	dst += (char)(v & 0xFF);
+	dst += (char)(v >> 8 & 0xFF);
+}
+
+void put32(std::string& dst, unsigned long v) {
+	put16(dst, v & 0xFFFF);
+	put16(dst, v >> 16 & 0xFFFF);
+}
+
+unsigned long get16(const char *src) {
+	return (unsigned long)(unsigned char)src[0]
+	     | (unsigned long)(unsigned char)src[1] << 8;
+}
+
+unsigned long get32(const char *src) {
+	return get16(src) | get16(src + 2) << 16;
+}
+
+void setNoDelay(int fd) {
+	int flag = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&flag, sizeof(flag));
+}
+
+}
+
 NetSerial::NetSerial()
 : is_stopped_(true)
 , is_server_(false)
@@ -23,8 +96,19 @@ NetSerial::NetSerial()
 , hostname_()
 , server_fd_(-1)
 , sockfd_(-1)
+, connecting_(false)
 , lastConnectAttempt_(0)
+, linked_(false)
+, helloSent_(false)
+, delay_(DEFAULT_DELAY)
+, localDelay_(DEFAULT_DELAY)
+, frameCount_(0)
+, latency_(0)
+, jitter_(0)
+, jitterSeed_(1)
+, lastRelease_(0)
 {
+	resetLink();
 }
 
 NetSerial::~NetSerial()
@@ -34,6 +118,13 @@ NetSerial::~NetSerial()
 
 bool NetSerial::start(bool is_server, int port, const std::string& hostname)
 {
+	// Core options may be re-applied at any time,
+	// don't drop an established connection
+	if (!is_stopped_ && is_server == is_server_ &&
+	    port == port_ && hostname == hostname_) {
+		return true;
+	}
+
 	stop();
 
 	gambatte_log(RETRO_LOG_INFO, "Starting GameLink network %s on %s:%d\n",
@@ -50,10 +141,7 @@ void NetSerial::stop()
 	if (!is_stopped_) {
 		gambatte_log(RETRO_LOG_INFO, "Stopping GameLink network\n");
 		is_stopped_ = true;
-		if (sockfd_ >= 0) {
-			close(sockfd_);
-			sockfd_ = -1;
-		}
+		disconnect();
 		if (server_fd_ >= 0) {
 			close(server_fd_);
 			server_fd_ = -1;
@@ -61,19 +149,84 @@ void NetSerial::stop()
 	}
 }
 
+void NetSerial::setDelay(unsigned frames)
+{
+	if (frames < 1)
+		frames = 1;
+	if (frames > MAX_DELAY)
+		frames = MAX_DELAY;
+	localDelay_ = frames;
+}
+
+void NetSerial::setSimulatedLatency(unsigned frames, unsigned jitter)
+{
+	latency_ = frames;
+	jitter_ = jitter < frames ? jitter : frames;
+}
+
+void NetSerial::disconnect()
+{
+	if (sockfd_ >= 0) {
+		close(sockfd_);
+		sockfd_ = -1;
+	}
+	connecting_ = false;
+	linked_ = false;
+	helloSent_ = false;
+	inBuf_.clear();
+	outQueue_.clear();
+	outBuf_.clear();
+	lastRelease_ = 0;
+	resetLink();
+}
+
+void NetSerial::resetLink()
+{
+	frame_ = 0;
+	position_ = 0;
+	stalled_ = 0;
+	listening_ = false;
+	checked_ = false;
+	announcedOut_ = 0xFF;
+	outEvents_.clear();
+	remoteFrames_.clear();
+	remoteSeq_ = 0;
+	current_.clear();
+	currentPos_ = 0;
+	remoteListening_ = false;
+	remoteOut_ = 0xFF;
+	inData_.clear();
+	inFastCgb_.clear();
+}
+
+bool NetSerial::setNonBlocking(int fd)
+{
+#ifdef _WIN32
+	u_long mode = 1;
+	if (ioctlsocket(fd, FIONBIO, &mode) != 0)
+#else
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+#endif
+	{
+		gambatte_log(RETRO_LOG_ERROR, "Error setting socket non-blocking: %s\n", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
 bool NetSerial::checkAndRestoreConnection(bool throttle)
 {
 	if (is_stopped_) {
 		return false;
 	}
 	if (sockfd_ < 0 && throttle) {
-		clock_t now = clock();
 		// Only attempt to establish the connection every 5 seconds
-		if (((now - lastConnectAttempt_) / CLOCKS_PER_SEC) < 5) {
+		if (frameCount_ - lastConnectAttempt_ < CONNECT_INTERVAL) {
 			return false;
 		}
 	}
-	lastConnectAttempt_ = clock();
+	lastConnectAttempt_ = frameCount_;
 	if (is_server_) {
 		if (!startServerSocket()) {
 			return false;
@@ -90,7 +243,6 @@ bool NetSerial::checkAndRestoreConnection(bool throttle)
 }
 bool NetSerial::startServerSocket()
 {
-	int fd;
 	struct sockaddr_in server_addr;
 
 	if (server_fd_ < 0) {
@@ -132,8 +284,6 @@ bool NetSerial::acceptClient()
 		return false;
 	}
 	if (sockfd_ < 0) {
-		int retval;
-
 		FD_ZERO(&rfds);
 		FD_SET(server_fd_, &rfds);
 		tv.tv_sec = 0;
@@ -149,13 +299,17 @@ bool NetSerial::acceptClient()
 			gambatte_log(RETRO_LOG_ERROR, "Error on accept: %s\n", strerror(errno));
 			return false;
 		}
+		if (!setNonBlocking(sockfd_)) {
+			disconnect();
+			return false;
+		}
+		setNoDelay(sockfd_);
 		gambatte_log(RETRO_LOG_INFO, "GameLink network server connected to client!\n");
 	}
 	return true;
 }
 bool NetSerial::startClientSocket()
 {
-	int fd;
 	struct sockaddr_in server_addr;
 
 	if (sockfd_ < 0) {
@@ -176,121 +330,354 @@ bool NetSerial::startClientSocket()
 			return false;
 		}
 
-		memmove((char*)&server_addr.sin_addr.s_addr, (char*)server_hostname->h_addr, server_hostname->h_length);
-		if (connect(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-			gambatte_log(RETRO_LOG_ERROR, "Error connecting to server: %s\n", strerror(errno));
+		if (!setNonBlocking(fd)) {
 			close(fd);
 			return false;
 		}
+		setNoDelay(fd);
+
+		memmove((char*)&server_addr.sin_addr.s_addr, (char*)server_hostname->h_addr, server_hostname->h_length);
+		if (connect(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+			if (!NET_IN_PROGRESS()) {
+				gambatte_log(RETRO_LOG_ERROR, "Error connecting to server: %s\n", strerror(errno));
+				close(fd);
+				return false;
+			}
+			// Completed in checkConnecting()
+			connecting_ = true;
+		}
 		sockfd_ = fd;
-		gambatte_log(RETRO_LOG_INFO, "GameLink network client connected to server!\n");
+		if (!connecting_)
+			gambatte_log(RETRO_LOG_INFO, "GameLink network client connected to server!\n");
 	}
 	return true;
 }
 
-unsigned char NetSerial::send(unsigned char data, bool fastCgb)
+bool NetSerial::checkConnecting()
 {
-	unsigned char buffer[2];
+	struct timeval tv;
+	fd_set wfds;
+	int err = 0;
+	socklen_t len = sizeof(err);
 
-	if (is_stopped_) {
-		return 0xFF;
+	FD_ZERO(&wfds);
+	FD_SET(sockfd_, &wfds);
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+
+	if (select(sockfd_ + 1, NULL, &wfds, NULL, &tv) <= 0) {
+		return false;
 	}
-	if (sockfd_ < 0) {
-		if (!checkAndRestoreConnection(true)) {
-			return 0xFF;
+
+	if (getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, (char *)&err, &len) < 0 || err != 0) {
+		gambatte_log(RETRO_LOG_ERROR, "Error connecting to server: %s\n", strerror(err ? err : errno));
+		disconnect();
+		return false;
+	}
+
+	connecting_ = false;
+	gambatte_log(RETRO_LOG_INFO, "GameLink network client connected to server!\n");
+	return true;
+}
+
+void NetSerial::queueMessage(const std::string& msg)
+{
+	Outgoing out;
+
+	out.release = 0;
+	if (latency_) {
+		long release = (long)(frameCount_ + latency_);
+		if (jitter_) {
+			jitterSeed_ = jitterSeed_ * 1103515245 + 12345;
+			release += (long)((jitterSeed_ >> 16) % (2 * jitter_ + 1)) - (long)jitter_;
 		}
+		// Messages are never reordered
+		if (release < (long)lastRelease_)
+			release = lastRelease_;
+		out.release = lastRelease_ = release;
 	}
+	out.data = msg;
+	outQueue_.push_back(out);
+}
 
-	buffer[0] = data;
-	buffer[1] = fastCgb;
-#ifdef _WIN32
-   if (::send(sockfd_, (char*) buffer, 2, 0) <= 0)
-#else
-	if (write(sockfd_, buffer, 2) <= 0)
-#endif
-   {
-		gambatte_log(RETRO_LOG_ERROR, "Error writing to socket: %s\n", strerror(errno));
-		close(sockfd_);
-		sockfd_ = -1;
-		return 0xFF;
+bool NetSerial::flush()
+{
+	while (!outQueue_.empty() && outQueue_.front().release <= frameCount_) {
+		outBuf_ += outQueue_.front().data;
+		outQueue_.pop_front();
 	}
 
-#ifdef _WIN32
-	if (recv(sockfd_, (char*) buffer, 2, 0) <= 0) 
-#else
-   if (read(sockfd_, buffer, 2) <= 0) 
-#endif
-   {
-		gambatte_log(RETRO_LOG_ERROR, "Error reading from socket: %s\n", strerror(errno));
-		close(sockfd_);
-		sockfd_ = -1;
-		return 0xFF;
+	while (!outBuf_.empty()) {
+		int n = ::send(sockfd_, outBuf_.data(), outBuf_.size(), MSG_NOSIGNAL);
+		if (n < 0) {
+			if (NET_WOULD_BLOCK())
+				break;
+			gambatte_log(RETRO_LOG_ERROR, "Error writing to socket: %s\n", strerror(errno));
+			disconnect();
+			return false;
+		}
+		outBuf_.erase(0, n);
+	}
+	return true;
+}
+
+bool NetSerial::receive()
+{
+	char buffer[1024];
+
+	for (;;) {
+		int n = recv(sockfd_, buffer, sizeof(buffer), 0);
+		if (n < 0) {
+			if (NET_WOULD_BLOCK())
+				break;
+			gambatte_log(RETRO_LOG_ERROR, "Error reading from socket: %s\n", strerror(errno));
+			disconnect();
+			return false;
+		}
+		if (n == 0) {
+			gambatte_log(RETRO_LOG_INFO, "GameLink network peer disconnected\n");
+			disconnect();
+			return false;
+		}
+		inBuf_.append(buffer, n);
 	}
 
-	return buffer[0];
+	return parseMessages();
 }
 
-bool NetSerial::check(unsigned char out, unsigned char& in, bool& fastCgb)
+bool NetSerial::parseMessages()
 {
-	unsigned char buffer[2];
-#ifdef _WIN32
-	u_long bytes_avail = 0;
-#else
-	int bytes_avail = 0;
-#endif
+	std::size_t pos = 0;
+
+	while (pos < inBuf_.size()) {
+		const char *msg = inBuf_.data() + pos;
+		std::size_t avail = inBuf_.size() - pos;
+
+		if (msg[0] == MSG_HELLO) {
+			if (avail < HELLO_SIZE)
+				break;
+			if (memcmp(msg + 1, "GBLK", 4) || msg[5] != PROTOCOL_VERSION || linked_) {
+				gambatte_log(RETRO_LOG_ERROR, "GameLink network protocol mismatch\n");
+				disconnect();
+				return false;
+			}
+
+			unsigned remoteDelay = (unsigned char)msg[6];
+			delay_ = remoteDelay > localDelay_ ? remoteDelay : localDelay_;
+			if (delay_ > MAX_DELAY)
+				delay_ = MAX_DELAY;
+
+			resetLink();
+			linked_ = true;
+			gambatte_log(RETRO_LOG_INFO, "GameLink network linked, input delay: %u frames\n", delay_);
+			pos += HELLO_SIZE;
+		} else if (msg[0] == MSG_FRAME && linked_) {
+			if (avail < FRAME_HEADER_SIZE)
+				break;
+
+			unsigned long seq = get32(msg + 1);
+			std::size_t count = get16(msg + 5);
+			std::size_t size = FRAME_HEADER_SIZE + count * EVENT_SIZE;
+			if (avail < size)
+				break;
+
+			if (seq != remoteSeq_) {
+				gambatte_log(RETRO_LOG_ERROR, "GameLink network sequence error (got %lu, expected %lu)\n",
+						seq, remoteSeq_);
+				disconnect();
+				return false;
+			}
+
+			remoteFrames_.push_back(Frame());
+			Frame& frame = remoteFrames_.back();
+			frame.seq = seq;
+			frame.events.resize(count);
+			for (std::size_t i = 0; i < count; ++i) {
+				const char *e = msg + FRAME_HEADER_SIZE + i * EVENT_SIZE;
+				frame.events[i].stamp = get16(e);
+				frame.events[i].type = e[2];
+				frame.events[i].value = e[3];
+			}
+
+			++remoteSeq_;
+			pos += size;
+		} else {
+			gambatte_log(RETRO_LOG_ERROR, "GameLink network protocol error\n");
+			disconnect();
+			return false;
+		}
+	}
+
+	inBuf_.erase(0, pos);
+	return true;
+}
+
+bool NetSerial::beginFrame()
+{
+	++frameCount_;
+
 	if (is_stopped_) {
-		return false;
+		return true;
 	}
 	if (sockfd_ < 0) {
 		if (!checkAndRestoreConnection(true)) {
+			return true;
+		}
+	}
+	if (connecting_ && !checkConnecting()) {
+		return true;
+	}
+
+	if (!helloSent_) {
+		std::string hello;
+		hello += (char)MSG_HELLO;
+		hello += "GBLK";
+		hello += (char)PROTOCOL_VERSION;
+		hello += (char)localDelay_;
+		queueMessage(hello);
+		helloSent_ = true;
+	}
+
+	if (!receive() || !flush() || !linked_) {
+		return true;
+	}
+
+	position_ = 0;
+	checked_ = false;
+	current_.clear();
+	currentPos_ = 0;
+
+	// The first delay_ frames have no peer events
+	if (frame_ >= delay_) {
+		if (remoteFrames_.empty()) {
+			if (++stalled_ > STALL_TIMEOUT) {
+				gambatte_log(RETRO_LOG_ERROR, "GameLink network peer timed out\n");
+				disconnect();
+				return true;
+			}
 			return false;
 		}
+
+		current_.swap(remoteFrames_.front().events);
+		remoteFrames_.pop_front();
 	}
-#ifdef _WIN32
-   if (ioctlsocket(sockfd_, FIONREAD, &bytes_avail) < 0)
-#else
-	if (ioctl(sockfd_, FIONREAD, &bytes_avail) < 0)
-#endif
-   {
-		gambatte_log(RETRO_LOG_ERROR, "IOCTL Failed: %s\n", strerror(errno));
-		return false;
+
+	stalled_ = 0;
+	return true;
+}
+
+void NetSerial::endFrame()
+{
+	if (!linked_) {
+		return;
 	}
 
-	// No data available yet
-	if (bytes_avail < 2) {
-		return false;
+	applyRemoteEvents((unsigned long)-1);
+
+	// No longer waiting for an external clock
+	if (listening_ && !checked_) {
+		postEvent(EVENT_UNLISTEN, 0);
+		listening_ = false;
 	}
 
-#ifdef _WIN32
-	if (recv(sockfd_, (char*) buffer, 2, 0) <= 0) 
-#else
-   if (read(sockfd_, buffer, 2) <= 0) 
-#endif
-   {
-		gambatte_log(RETRO_LOG_ERROR, "Error reading from socket: %s\n", strerror(errno));
-		close(sockfd_);
-		sockfd_ = -1;
-		return false;
+	std::string msg;
+	msg += (char)MSG_FRAME;
+	put32(msg, frame_);
+	put16(msg, outEvents_.size());
+	for (std::size_t i = 0; i < outEvents_.size(); ++i) {
+		put16(msg, outEvents_[i].stamp);
+		msg += (char)outEvents_[i].type;
+		msg += (char)outEvents_[i].value;
 	}
+	outEvents_.clear();
+	queueMessage(msg);
+	++frame_;
 
-//	slave_txn_cnt++;
+	flush();
+}
 
-	in = buffer[0];
-	fastCgb = buffer[1];
+void NetSerial::postEvent(unsigned char type, unsigned char value)
+{
+	Event e;
 
-	buffer[0] = out;
-	buffer[1] = 128;
-   #ifdef _WIN32
-      if (::send(sockfd_, (char*) buffer, 2, 0) <= 0)
-   #else
-   	if (write(sockfd_, buffer, 2) <= 0)
-   #endif
-   {
-		gambatte_log(RETRO_LOG_ERROR, "Error writing to socket: %s\n", strerror(errno));
-		close(sockfd_);
-		sockfd_ = -1;
+	if (outEvents_.size() >= MAX_EVENTS_PER_FRAME)
+		return;
+
+	e.stamp = position_ < MAX_STAMP ? position_ : static_cast<unsigned long>(MAX_STAMP);
+	e.type = type;
+	e.value = value;
+	outEvents_.push_back(e);
+}
+
+void NetSerial::applyRemoteEvents(unsigned long until)
+{
+	while (currentPos_ < current_.size() && current_[currentPos_].stamp <= until) {
+		const Event& e = current_[currentPos_++];
+
+		switch (e.type) {
+		case EVENT_LISTEN:
+			remoteListening_ = true;
+			remoteOut_ = e.value;
+			break;
+		case EVENT_UNLISTEN:
+			remoteListening_ = false;
+			break;
+		case EVENT_DATA:
+		case EVENT_DATA_FAST_CGB:
+			inData_.push_back(e.value);
+			inFastCgb_.push_back(e.type == EVENT_DATA_FAST_CGB);
+			break;
+		}
+	}
+}
+
+unsigned char NetSerial::send(unsigned char data, bool fastCgb)
+{
+	if (!linked_) {
+		return 0xFF;
+	}
+
+	applyRemoteEvents(position_);
+
+	if (listening_) {
+		postEvent(EVENT_UNLISTEN, 0);
+		listening_ = false;
+	}
+
+	if (!remoteListening_) {
+		return 0xFF;
+	}
+
+	// The peer must announce itself again before
+	// receiving another byte
+	remoteListening_ = false;
+	postEvent(fastCgb ? EVENT_DATA_FAST_CGB : EVENT_DATA, data);
+	return remoteOut_;
+}
+
+bool NetSerial::check(unsigned char out, unsigned char& in, bool& fastCgb)
+{
+	if (!linked_) {
 		return false;
 	}
 
-	return true;
+	applyRemoteEvents(position_);
+	checked_ = true;
+
+	if (!inData_.empty()) {
+		in = inData_.front();
+		fastCgb = inFastCgb_.front();
+		inData_.pop_front();
+		inFastCgb_.pop_front();
+		listening_ = false;
+		return true;
+	}
+
+	if (!listening_ || out != announcedOut_) {
+		postEvent(EVENT_LISTEN, out);
+		listening_ = true;
+		announcedOut_ = out;
+	}
+
+	return false;
 }
@@ -7,25 +7,100 @@
 #endif
 
 #include <gambatte.h>
-#include <time.h>
+#include <deque>
+#include <string>
+#include <vector>
 
+// Game Link over TCP, without blocking the emulator.
+//
+// Neither side ever waits for the other within a serial
+// transfer. Instead, each side reports its serial port
+// activity as events stamped with (frame, sample offset),
+// sent in one batched message per frame, and the other
+// side replays them with a fixed delay of delay() frames.
+// The two instances therefore run in lockstep, each seeing
+// the other's port as it was delay() frames ago:
+//
+// - A slave waiting for an external clock (SC = 0x80)
+//   announces that it is listening, along with its SB.
+// - A master starting a transfer (SC = 0x81) to a peer
+//   seen as listening reads the announced SB, and its byte
+//   is delivered to the peer delay() frames later. If the
+//   peer is not listening, the master reads 0xFF, as with
+//   no cable connected.
+//
+// As long as messages arrive within delay() frames, link
+// play never stalls. Otherwise beginFrame() returns false
+// and the frame is skipped (not blocked on) until the
+// message arrives.
+//
+// Messages carry sequence (frame) numbers, and a handshake
+// on connection agrees on the protocol version and delay
+// (the larger of the two sides' settings).
 class NetSerial : public gambatte::SerialIO
 {
 	public:
+		enum { MAX_DELAY = 8 };
+
 		NetSerial();
 		~NetSerial();
 
 		bool start(bool is_server, int port, const std::string& hostname);
 		void stop();
 
+		// Input delay, in frames (applied on next connection)
+		void setDelay(unsigned frames);
+		// For testing: delays outgoing messages by 'frames',
+		// plus or minus a random jitter of up to 'jitter'
+		void setSimulatedLatency(unsigned frames, unsigned jitter);
+
+		// Must be called once per frame, before running the
+		// emulator. Returns false if the frame must be skipped
+		// while waiting for the peer
+		bool beginFrame();
+		// Reports emulated time, after each GB::runFor()
+		void advance(unsigned samples) { position_ += samples; }
+		void endFrame();
+
+		bool linked() const { return linked_; }
+		unsigned delay() const { return delay_; }
+
 		virtual bool check(unsigned char out, unsigned char& in, bool& fastCgb);
 		virtual unsigned char send(unsigned char data, bool fastCgb);
 
 	private:
+		struct Event {
+			unsigned long stamp;
+			unsigned char type;
+			unsigned char value;
+		};
+
+		struct Frame {
+			unsigned long seq;
+			std::vector<Event> events;
+		};
+
+		struct Outgoing {
+			unsigned long release;
+			std::string data;
+		};
+
 		bool startServerSocket();
 		bool startClientSocket();
 		bool acceptClient();
+		bool checkConnecting();
 		bool checkAndRestoreConnection(bool throttle);
+		bool setNonBlocking(int fd);
+		void disconnect();
+
+		void resetLink();
+		void queueMessage(const std::string& msg);
+		bool flush();
+		bool receive();
+		bool parseMessages();
+
+		void applyRemoteEvents(unsigned long until);
+		void postEvent(unsigned char type, unsigned char value);
 
 		bool is_stopped_;
 		bool is_server_;
@@ -34,8 +109,45 @@ class NetSerial : public gambatte::SerialIO
 
 		int server_fd_;
 		int sockfd_;
+		bool connecting_;
+		unsigned long lastConnectAttempt_;
+
+		// Link session
+		bool linked_;
+		bool helloSent_;
+		unsigned delay_;
+		unsigned localDelay_;
+		unsigned long frameCount_;
+		unsigned long frame_;
+		unsigned long position_;
+		unsigned long stalled_;
+
+		// Local port, as announced to the peer
+		bool listening_;
+		bool checked_;
+		unsigned char announcedOut_;
+		std::vector<Event> outEvents_;
+
+		// Remote port, as seen locally
+		std::deque<Frame> remoteFrames_;
+		unsigned long remoteSeq_;
+		std::vector<Event> current_;
+		std::size_t currentPos_;
+		bool remoteListening_;
+		unsigned char remoteOut_;
+		std::deque<unsigned char> inData_;
+		std::deque<bool> inFastCgb_;
+
+		// Wire buffers
+		std::string inBuf_;
+		std::deque<Outgoing> outQueue_;
+		std::string outBuf_;
 
-		clock_t lastConnectAttempt_;
+		// Simulated latency
+		unsigned latency_;
+		unsigned jitter_;
+		unsigned long jitterSeed_;
+		unsigned long lastRelease_;
 };
 
 #endif
@@ -0,0 +1,274 @@
+#include "perf_profile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+PerfProfile::PerfProfile()
+{
+	reset(std::string(), 16743, 16743);
+}
+
+void PerfProfile::reset(const std::string &key, unsigned budgetUsec, unsigned overrunUsec)
+{
+	key_ = key;
+	budget_ = budgetUsec ? budgetUsec : 1;
+	overrun_ = overrunUsec;
+	frames_ = 0;
+	totalUsec_ = 0;
+	std::memset(histogram_, 0, sizeof histogram_);
+	scenes_.clear();
+	settings_.clear();
+	sessionFrames_ = 0;
+	sceneUsec_ = 0;
+}
+
+// Reads a number followed by a comma, or by the end of the string
+static bool parseNumber(const char *&s, unsigned long long &n)
+{
+	char *end;
+
+	if (*s < '0' || *s > '9')
+		return false;
+
+	n = std::strtoull(s, &end, 10);
+	if (*end != ',' && *end != '\0')
+		return false;
+
+	s = *end ? end + 1 : end;
+	return true;
+}
+
+bool PerfProfile::parse(const std::string &text)
+{
+	std::string key;
+	unsigned long long budget = 0;
+	unsigned long long frames = 0;
+	unsigned long long totalUsec = 0;
+	unsigned long long histogram[HISTOGRAM_BUCKETS] = { 0 };
+	std::vector<Scene> scenes;
+	std::vector<Settings> rows;
+	std::size_t pos = 0;
+
+	while (pos < text.size()) {
+		std::size_t eol = text.find('\n', pos);
+		if (eol == std::string::npos)
+			eol = text.size();
+
+		std::string line = text.substr(pos, eol - pos);
+		pos = eol + 1;
+
+		while (!line.empty() && (line[line.size() - 1] == '\r' || line[line.size() - 1] == ' '))
+			line.erase(line.size() - 1);
+
+		std::size_t const eq = line.find('=');
+		if (line.empty() || line[0] == ';' || line[0] == '[' || eq == std::string::npos)
+			continue;
+
+		std::string const name = line.substr(0, eq);
+		char const *value = line.c_str() + eq + 1;
+		unsigned long long a, b;
+
+		if (name == "key") {
+			key = value;
+		} else if (name == "budget_usec") {
+			parseNumber(value, budget);
+		} else if (name == "frames") {
+			parseNumber(value, frames);
+		} else if (name == "total_usec") {
+			parseNumber(value, totalUsec);
+		} else if (name == "histogram") {
+			unsigned long long counts[HISTOGRAM_BUCKETS];
+			unsigned i = 0;
+
+			while (i < HISTOGRAM_BUCKETS && parseNumber(value, counts[i]))
+				++i;
+
+			if (i == HISTOGRAM_BUCKETS && !*value)
+				std::memcpy(histogram, counts, sizeof histogram);
+		} else if (name == "scene") {
+			if (parseNumber(value, a) && parseNumber(value, b) && *value) {
+				Scene scene;
+				scene.usec = a;
+				scene.second = b;
+				scene.settings = value;
+				scenes.push_back(scene);
+			}
+		} else if (name == "settings") {
+			if (parseNumber(value, a) && parseNumber(value, b) && *value && b <= a) {
+				unsigned long long const max = MAX_FRAMES;
+				Settings s;
+				s.name = value;
+				s.frames = a < max ? a : max;
+				s.overruns = a < max ? b : b * max / a;
+				rows.push_back(s);
+			}
+		}
+	}
+
+	if (key != key_ || budget != budget_)
+		return false;
+
+	frames_ += frames;
+	totalUsec_ += totalUsec;
+
+	for (unsigned i = 0; i < HISTOGRAM_BUCKETS; ++i)
+		histogram_[i] += histogram[i];
+
+	for (std::size_t i = 0; i < scenes.size(); ++i)
+		addScene(scenes[i]);
+
+	for (std::size_t i = 0; i < rows.size(); ++i) {
+		Settings &s = settings_[settings(rows[i].name)];
+		s.frames += rows[i].frames;
+		s.overruns += rows[i].overruns;
+	}
+
+	return true;
+}
+
+std::string PerfProfile::text() const
+{
+	std::string out = "; Gambatte performance profile\n";
+	char buf[64];
+
+	out += "key=" + key_ + "\n";
+	snprintf(buf, sizeof buf, "budget_usec=%u\n", budget_);
+	out += buf;
+	snprintf(buf, sizeof buf, "frames=%llu\n", frames_);
+	out += buf;
+	snprintf(buf, sizeof buf, "total_usec=%llu\n", totalUsec_);
+	out += buf;
+	snprintf(buf, sizeof buf, "average_usec=%u\n", averageUsec());
+	out += buf;
+	snprintf(buf, sizeof buf, "p50_usec=%u\np95_usec=%u\np99_usec=%u\n",
+			percentileUsec(50), percentileUsec(95), percentileUsec(99));
+	out += buf;
+
+	out += "histogram=";
+	for (unsigned i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+		snprintf(buf, sizeof buf, i ? ",%llu" : "%llu", histogram_[i]);
+		out += buf;
+	}
+	out += "\n";
+
+	for (std::size_t i = 0; i < scenes_.size(); ++i) {
+		snprintf(buf, sizeof buf, "scene=%u,%lu,", scenes_[i].usec, scenes_[i].second);
+		out += buf + scenes_[i].settings + "\n";
+	}
+
+	for (std::size_t i = 0; i < settings_.size(); ++i) {
+		if (!settings_[i].frames)
+			continue;
+
+		snprintf(buf, sizeof buf, "settings=%lu,%lu,", settings_[i].frames, settings_[i].overruns);
+		out += buf + settings_[i].name + "\n";
+	}
+
+	return out;
+}
+
+unsigned PerfProfile::settings(const std::string &name)
+{
+	for (std::size_t i = 0; i < settings_.size(); ++i) {
+		if (settings_[i].name == name)
+			return i;
+	}
+
+	Settings s;
+	s.name = name;
+	s.frames = 0;
+	s.overruns = 0;
+	settings_.push_back(s);
+	return settings_.size() - 1;
+}
+
+void PerfProfile::frame(unsigned usec, unsigned settings)
+{
+	// A one-off stall (loading a state, say) should not
+	// count for more than a badly overrun frame, in the
+	// totals and scenes any more than in the histogram
+	if (usec > budget_ * 2)
+		usec = budget_ * 2;
+
+	unsigned bucket = static_cast<unsigned long long>(usec) * 20 / budget_;
+	if (bucket >= HISTOGRAM_BUCKETS)
+		bucket = HISTOGRAM_BUCKETS - 1;
+
+	++frames_;
+	totalUsec_ += usec;
+	++histogram_[bucket];
+
+	if (settings < settings_.size()) {
+		Settings &s = settings_[settings];
+
+		if (s.frames >= MAX_FRAMES) {
+			s.frames /= 2;
+			s.overruns /= 2;
+		}
+
+		++s.frames;
+		if (usec > overrun_)
+			++s.overruns;
+	}
+
+	sceneUsec_ += usec;
+	if (++sessionFrames_ % SCENE_FRAMES == 0) {
+		Scene scene;
+		scene.usec = sceneUsec_ / SCENE_FRAMES;
+		scene.second = sessionFrames_ / SCENE_FRAMES - 1;
+		if (settings < settings_.size())
+			scene.settings = settings_[settings].name;
+
+		addScene(scene);
+		sceneUsec_ = 0;
+	}
+}
+
+int PerfProfile::withinBudget(unsigned settings) const
+{
+	if (settings >= settings_.size())
+		return 0;
+
+	Settings const &s = settings_[settings];
+
+	if (s.overruns * OVERRUN_RATIO > s.frames)
+		return s.overruns >= MIN_OVERRUNS ? -1 : 0;
+
+	return s.frames >= MIN_FRAMES ? 1 : 0;
+}
+
+unsigned PerfProfile::averageUsec() const
+{
+	return frames_ ? totalUsec_ / frames_ : 0;
+}
+
+// Upper end of the bucket the percentile falls in
+unsigned PerfProfile::percentileUsec(unsigned percent) const
+{
+	unsigned long long const target = (frames_ * percent + 99) / 100;
+	unsigned long long count = 0;
+
+	if (!frames_)
+		return 0;
+
+	for (unsigned i = 0; i < HISTOGRAM_BUCKETS - 1; ++i) {
+		count += histogram_[i];
+		if (count >= target)
+			return static_cast<unsigned long long>(budget_) * (i + 1) / 20;
+	}
+
+	return budget_ * 2;
+}
+
+void PerfProfile::addScene(const Scene &scene)
+{
+	std::vector<Scene>::iterator it = scenes_.begin();
+
+	while (it != scenes_.end() && it->usec >= scene.usec)
+		++it;
+
+	scenes_.insert(it, scene);
+	if (scenes_.size() > NUM_SCENES)
+		scenes_.pop_back();
+}
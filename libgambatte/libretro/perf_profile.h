@@ -0,0 +1,93 @@
+#ifndef _PERF_PROFILE_H
+#define _PERF_PROFILE_H
+
+#include <string>
+#include <vector>
+
+// Frame time statistics for one game, added up across sessions.
+//
+// Kept as a few lines of text (see text()): the number of frames
+// and their total time, a histogram of frame times in steps of 5%
+// of the frame budget, the heaviest scenes (SCENE_FRAMES frames
+// each, by average frame time) and, for each set of settings the
+// game ran with, the frames it ran and how many of them overran.
+// Averages and percentiles are written out too, for reading, but
+// are worked out again from the histogram.
+//
+// Settings are named by the caller, and compared by name only.
+class PerfProfile
+{
+	public:
+		enum {
+			HISTOGRAM_BUCKETS = 41, // The last is everything over 200%
+			NUM_SCENES        = 4,
+			SCENE_FRAMES      = 60, // ~1 s
+			// Settings kept the game within budget if they
+			// overran in no more than one frame in OVERRUN_RATIO,
+			// over at least MIN_FRAMES frames. They overrun if
+			// they did so more often, in at least MIN_OVERRUNS
+			// frames
+			OVERRUN_RATIO     = 20,
+			MIN_FRAMES        = 600,    // ~10 s
+			MIN_OVERRUNS      = 30,     // ~0.5 s
+			// Counts for settings are halved past this, so that
+			// recent sessions weigh more
+			MAX_FRAMES        = 1 << 20 // ~5 h
+		};
+
+		PerfProfile();
+
+		// Starts over for the game 'key', with no statistics.
+		// Frames taking over 'overrunUsec' overrun
+		void reset(const std::string &key, unsigned budgetUsec, unsigned overrunUsec);
+
+		// Adds the statistics of earlier sessions, as written by
+		// text(). Returns false, adding nothing, if they are for
+		// another game or budget
+		bool parse(const std::string &text);
+		std::string text() const;
+
+		// Returns the index of the settings called 'name', for frame()
+		unsigned settings(const std::string &name);
+
+		// Records the time a frame took, with 'settings' in use.
+		// Times over twice the budget count as twice the budget
+		void frame(unsigned usec, unsigned settings);
+
+		// 1 if 'settings' are known to keep the game within budget,
+		// -1 if known to overrun, 0 if not known
+		int withinBudget(unsigned settings) const;
+
+		unsigned long long frames() const { return frames_; }
+		unsigned long sessionFrames() const { return sessionFrames_; }
+		unsigned averageUsec() const;
+		unsigned percentileUsec(unsigned percent) const;
+
+	private:
+		struct Scene {
+			unsigned usec;
+			unsigned long second; // From the start of its session
+			std::string settings;
+		};
+
+		struct Settings {
+			std::string name;
+			unsigned long frames;
+			unsigned long overruns;
+		};
+
+		std::string key_;
+		unsigned budget_;
+		unsigned overrun_;
+		unsigned long long frames_;
+		unsigned long long totalUsec_;
+		unsigned long long histogram_[HISTOGRAM_BUCKETS];
+		std::vector<Scene> scenes_;
+		std::vector<Settings> settings_;
+		unsigned long sessionFrames_;
+		unsigned long sceneUsec_;
+
+		void addScene(const Scene &scene);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "quality_governor.h"
+
+QualityGovernor::QualityGovernor()
+{
+	reset(1, 16743);
+}
+
+void QualityGovernor::reset(unsigned numLevels, unsigned budgetUsec, unsigned level)
+{
+	numLevels_ = numLevels ? numLevels : 1;
+	budget_ = budgetUsec;
+	level_ = level < numLevels_ ? level : numLevels_ - 1;
+	average_ = 0;
+	averageValid_ = false;
+	above_ = 0;
+	below_ = 0;
+	settle_ = 0;
+	framesAtLevel_ = 0;
+	upFrames_ = STEP_UP_FRAMES;
+	steppedUp_ = false;
+}
+
+bool QualityGovernor::setLevel(unsigned level)
+{
+	steppedUp_ = level < level_;
+	level_ = level;
+	above_ = 0;
+	below_ = 0;
+	settle_ = SETTLE_FRAMES;
+	framesAtLevel_ = 0;
+	return true;
+}
+
+bool QualityGovernor::frame(unsigned usec)
+{
+	if (numLevels_ < 2)
+		return false;
+
+	// A one-off stall (loading a state, say) should not
+	// count for more than a badly overrun frame
+	if (usec > budget_ * 2)
+		usec = budget_ * 2;
+
+	long const sample = static_cast<long>(usec) << AVERAGE_FRACTION_BITS;
+
+	if (averageValid_)
+		average_ += (sample - average_) >> AVERAGE_WEIGHT_SHIFT;
+	else
+		average_ = sample;
+
+	averageValid_ = true;
+
+	if (framesAtLevel_ < STEP_UP_FRAMES_MAX)
+		++framesAtLevel_;
+	else
+		upFrames_ = STEP_UP_FRAMES;
+
+	if (settle_) {
+		--settle_;
+		return false;
+	}
+
+	unsigned long const avg = averageUsec() * 100ul;
+
+	if (avg > static_cast<unsigned long>(budget_) * STEP_DOWN_PERCENT) {
+		below_ = 0;
+
+		if (level_ + 1 >= numLevels_ || ++above_ < STEP_DOWN_FRAMES)
+			return false;
+
+		// The last step up did not hold
+		if (steppedUp_ && framesAtLevel_ < upFrames_) {
+			upFrames_ *= 2;
+			if (upFrames_ > STEP_UP_FRAMES_MAX)
+				upFrames_ = STEP_UP_FRAMES_MAX;
+		}
+
+		return setLevel(level_ + 1);
+	}
+
+	above_ = 0;
+
+	if (avg >= static_cast<unsigned long>(budget_) * STEP_UP_PERCENT) {
+		below_ = 0;
+		return false;
+	}
+
+	if (level_ == 0 || ++below_ < upFrames_)
+		return false;
+
+	return setLevel(level_ - 1);
+}
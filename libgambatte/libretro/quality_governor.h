@@ -0,0 +1,66 @@
+#ifndef _QUALITY_GOVERNOR_H
+#define _QUALITY_GOVERNOR_H
+
+// Picks a quality level from the time the core takes per
+// frame, for devices that can only just run it.
+//
+// Levels go from 0 (as configured) to numLevels - 1 (the
+// cheapest); what each one changes is up to the caller.
+// Frame times are smoothed with an exponentially weighted
+// moving average. The level steps down once the average has
+// stayed above STEP_DOWN_PERCENT of the frame budget for
+// STEP_DOWN_FRAMES frames, and back up once it has stayed
+// below STEP_UP_PERCENT for the step up delay. A step up
+// that is undone within that delay doubles it (up to
+// STEP_UP_FRAMES_MAX), so that a level which cannot be held
+// is not retried every few seconds.
+class QualityGovernor
+{
+	public:
+		enum {
+			STEP_DOWN_PERCENT  = 85,
+			STEP_UP_PERCENT    = 55,
+			STEP_DOWN_FRAMES   = 30,   // ~0.5 s
+			STEP_UP_FRAMES     = 300,  // ~5 s
+			STEP_UP_FRAMES_MAX = 4800, // ~80 s
+			// Frames not acted on after a change, while
+			// the average catches up with the new level
+			SETTLE_FRAMES      = 30
+		};
+
+		QualityGovernor();
+
+		// Starts over at 'level', with no frame times
+		void reset(unsigned numLevels, unsigned budgetUsec, unsigned level = 0);
+
+		// Records the time the core took for a frame.
+		// Returns true if the level has changed
+		bool frame(unsigned usec);
+
+		unsigned level() const { return level_; }
+		unsigned numLevels() const { return numLevels_; }
+		unsigned averageUsec() const { return average_ >> AVERAGE_FRACTION_BITS; }
+
+	private:
+		enum {
+			AVERAGE_FRACTION_BITS = 4,
+			// Each frame weighs 1/8 in the average
+			AVERAGE_WEIGHT_SHIFT  = 3
+		};
+
+		unsigned numLevels_;
+		unsigned budget_;
+		unsigned level_;
+		long average_;
+		bool averageValid_;
+		unsigned above_;
+		unsigned below_;
+		unsigned settle_;
+		unsigned framesAtLevel_;
+		unsigned upFrames_;
+		bool steppedUp_;
+
+		bool setLevel(unsigned level);
+};
+
+#endif
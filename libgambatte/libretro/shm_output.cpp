@@ -0,0 +1,149 @@
+#include "shm_output.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// Frames a consumer can lag behind, plus the one being drawn
+#define SHM_OUTPUT_SLOTS 3
+// ~0.25 s at 65536 Hz, ~0.5 s at 32768 Hz
+#define SHM_OUTPUT_AUDIO_FRAMES (1 << 14)
+#define SHM_OUTPUT_ALIGN 4096
+
+static size_t alignUp(size_t size)
+{
+	return (size + SHM_OUTPUT_ALIGN - 1) & ~(size_t)(SHM_OUTPUT_ALIGN - 1);
+}
+
+ShmOutput::ShmOutput()
+: header_(0)
+, size_(0)
+, drawing_(0)
+{
+	name_[0] = '\0';
+}
+
+bool ShmOutput::open(const char *name, unsigned width, unsigned height,
+		unsigned pitch, unsigned pixelFormat, size_t frameSize)
+{
+	close();
+
+	size_t const slotSize = alignUp(Slot::PIXELS + frameSize);
+	size_t const slotOffset = alignUp(sizeof(Header));
+	size_t const audioOffset = slotOffset + SHM_OUTPUT_SLOTS * slotSize;
+	size_t const size = alignUp(audioOffset + SHM_OUTPUT_AUDIO_FRAMES * 2 * sizeof(int16_t));
+
+	int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	void *base = MAP_FAILED;
+	if (ftruncate(fd, size) == 0)
+		base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	::close(fd);
+
+	if (base == MAP_FAILED) {
+		shm_unlink(name);
+		return false;
+	}
+
+	// Fresh pages are zero filled, so all slots start out empty
+	header_ = static_cast<Header *>(base);
+	size_ = size;
+	drawing_ = 0;
+	strncpy(name_, name, sizeof name_ - 1);
+	name_[sizeof name_ - 1] = '\0';
+
+	header_->version = VERSION;
+	header_->numSlots = SHM_OUTPUT_SLOTS;
+	header_->slotSize = slotSize;
+	header_->slotOffset = slotOffset;
+	header_->width = width;
+	header_->height = height;
+	header_->pitch = pitch;
+	header_->pixelFormat = pixelFormat;
+	header_->audioOffset = audioOffset;
+	header_->audioCapacity = SHM_OUTPUT_AUDIO_FRAMES;
+	__atomic_store_n(&header_->magic, MAGIC, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+void ShmOutput::close()
+{
+	if (!header_)
+		return;
+
+	// Consumers keep their mappings, and see no new frames
+	munmap(header_, size_);
+	shm_unlink(name_);
+	header_ = 0;
+	size_ = 0;
+	name_[0] = '\0';
+}
+
+ShmOutput::Slot * ShmOutput::slot(uint64_t seq) const
+{
+	return reinterpret_cast<Slot *>(reinterpret_cast<char *>(header_)
+			+ header_->slotOffset + ((seq - 1) % SHM_OUTPUT_SLOTS) * header_->slotSize);
+}
+
+void * ShmOutput::beginFrame()
+{
+	drawing_ = header_->frameSeq + 1;
+
+	Slot *s = slot(drawing_);
+	__atomic_store_n(&s->seq, 0, __ATOMIC_RELAXED);
+	// Consumers must see the slot as taken before any pixel changes
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	return reinterpret_cast<char *>(s) + Slot::PIXELS;
+}
+
+void ShmOutput::endFrame()
+{
+	if (!drawing_)
+		return;
+
+	Slot *s = slot(drawing_);
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	s->timestampNs = now.tv_sec * UINT64_C(1000000000) + now.tv_nsec;
+	s->audioEnd = header_->audioWritten;
+
+	__atomic_store_n(&s->seq, drawing_, __ATOMIC_RELEASE);
+	__atomic_store_n(&header_->frameSeq, drawing_, __ATOMIC_RELEASE);
+	drawing_ = 0;
+}
+
+void ShmOutput::writeAudio(const int16_t *samples, size_t frames)
+{
+	int16_t *const ring = reinterpret_cast<int16_t *>(
+			reinterpret_cast<char *>(header_) + header_->audioOffset);
+	uint64_t written = header_->audioWritten;
+
+	// Only the last audioCapacity frames can be kept
+	if (frames > SHM_OUTPUT_AUDIO_FRAMES) {
+		samples += (frames - SHM_OUTPUT_AUDIO_FRAMES) * 2;
+		written += frames - SHM_OUTPUT_AUDIO_FRAMES;
+		frames = SHM_OUTPUT_AUDIO_FRAMES;
+	}
+
+	while (frames) {
+		size_t const pos = written % SHM_OUTPUT_AUDIO_FRAMES;
+		size_t n = SHM_OUTPUT_AUDIO_FRAMES - pos;
+		if (n > frames)
+			n = frames;
+
+		memcpy(ring + pos * 2, samples, n * 2 * sizeof(int16_t));
+		samples += n * 2;
+		written += n;
+		frames -= n;
+	}
+
+	__atomic_store_n(&header_->audioWritten, written, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,98 @@
+#ifndef _SHM_OUTPUT_H
+#define _SHM_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Video and audio output to other processes, through a POSIX
+// shared memory segment. Consumers map the segment read-only
+// and poll it: there are no locks, and no system calls per
+// frame on either side.
+//
+// The segment starts with a Header. Video frames go to a ring
+// of numSlots slots, slotSize bytes apart from slotOffset on,
+// each a Slot followed (at Slot::PIXELS) by the frame. The
+// core draws straight into the slot, so frames are not copied.
+// Audio goes to a ring of audioCapacity stereo frames of
+// interleaved int16_t, at audioOffset.
+//
+// To read the latest frame:
+//
+//    seq  = __atomic_load_n(&header->frameSeq, __ATOMIC_ACQUIRE);
+//    slot = base + slotOffset + ((seq - 1) % numSlots) * slotSize;
+//    if (seq && __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) == seq) {
+//       ... use the pixels ...
+//       __atomic_thread_fence(__ATOMIC_ACQUIRE);
+//       if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+//          ... the frame was overwritten while in use ...
+//    }
+//
+// A consumer has numSlots - 1 frames to finish with a frame.
+// Audio is read the same way: audioWritten counts the stereo
+// frames written so far, the frame numbered n being at
+// n % audioCapacity in the ring. A consumer more than
+// audioCapacity frames behind has lost audio.
+class ShmOutput
+{
+	public:
+		enum { MAGIC = 0x4F534247 }; // "GBSO"
+		enum { VERSION = 1 };
+
+		// Every member is written by the core only
+		struct Header {
+			uint32_t magic; // Set last, once the rest is valid
+			uint32_t version;
+			uint32_t numSlots;
+			uint32_t slotSize;
+			uint32_t slotOffset;
+			uint32_t width;
+			uint32_t height;
+			uint32_t pitch;       // Bytes per line
+			uint32_t pixelFormat; // enum retro_pixel_format
+			uint32_t audioOffset;
+			uint32_t audioCapacity;
+			uint32_t reserved;
+			double sampleRate;
+			uint64_t frameSeq;     // Last published frame, from 1 (0: none yet)
+			uint64_t audioWritten; // Stereo frames written
+		};
+
+		struct Slot {
+			enum { PIXELS = 64 };
+
+			uint64_t seq;         // Frame in the slot, 0 while it is drawn
+			uint64_t timestampNs; // CLOCK_MONOTONIC, when published
+			uint64_t audioEnd;    // audioWritten when published
+		};
+
+		ShmOutput();
+		~ShmOutput() { close(); }
+
+		// 'frameSize' is the size of the video buffer the core
+		// draws to, of which width x height pixels are output
+		bool open(const char *name, unsigned width, unsigned height,
+				unsigned pitch, unsigned pixelFormat, size_t frameSize);
+		void close();
+		bool isOpen() const { return header_ != 0; }
+		const char * name() const { return name_; }
+
+		void setSampleRate(double rate) { if (header_) header_->sampleRate = rate; }
+
+		// Returns the pixels of the slot the next frame is to
+		// be drawn to, taking it away from consumers
+		void * beginFrame();
+		// Publishes the frame started by beginFrame()
+		void endFrame();
+
+		void writeAudio(const int16_t *samples, size_t frames);
+
+	private:
+		Header *header_;
+		size_t size_;
+		uint64_t drawing_;
+		char name_[64];
+
+		Slot * slot(uint64_t seq) const;
+};
+
+#endif
@@ -94,6 +94,10 @@ void Bootloader::call_FF50() {
    }
 }
 
+bool Bootloader::booting() const {
+   return using_bootloader && !has_called_FF50;
+}
+
 //this is a developer function only,a real gameboy can never undo calling 0xFF50,this function is for savestate functionality
 void Bootloader::uncall_FF50() {
    std::memcpy((uint8_t*)addrspace_start, bootromswapspace, bootloadersize);
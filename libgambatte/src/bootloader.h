@@ -36,6 +36,9 @@ public:
    void choosebank(bool inbootloader);
 
    void call_FF50();
+
+   //true until the bootloader hands over to the cartridge
+   bool booting() const;
 };
    
 }
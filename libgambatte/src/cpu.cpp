@@ -39,6 +39,9 @@ CPU::CPU()
 , h(0x01)
 , l(0x4D)
 , skip_(false)
+#ifdef GAMBATTE_JIT
+, jit_(mem_)
+#endif
 {
 }
 
@@ -486,6 +489,44 @@ void CPU::loadState(SaveState const &state) {
 	PC_MOD(high << 8 | low); \
 } while (0)
 
+#ifdef GAMBATTE_JIT
+void CPU::runRecompiled(Recompiler::Block const *block,
+		unsigned char &a, unsigned short &pc, unsigned long &cycleCounter) {
+	Recompiler::Regs regs;
+	regs.cycleCounter = cycleCounter;
+	regs.pc = pc;
+	regs.sp = sp;
+	regs.hf1 = hf1;
+	regs.hf2 = hf2;
+	regs.zf = zf;
+	regs.cf = cf;
+	regs.a = a;
+	regs.b = b;
+	regs.c = c;
+	regs.d = d;
+	regs.e = e;
+	regs.h = h;
+	regs.l = l;
+
+	jit_.run(regs, block);
+
+	cycleCounter = regs.cycleCounter;
+	pc = regs.pc;
+	sp = regs.sp;
+	hf1 = regs.hf1;
+	hf2 = regs.hf2;
+	zf = regs.zf;
+	cf = regs.cf;
+	a = regs.a;
+	b = regs.b;
+	c = regs.c;
+	d = regs.d;
+	e = regs.e;
+	h = regs.h;
+	l = regs.l;
+}
+#endif
+
 void CPU::process(unsigned long const cycles) {
 	mem_.setEndtime(cycleCounter_, cycles);
 	mem_.updateInput();
@@ -508,6 +549,15 @@ void CPU::process(unsigned long const cycles) {
 		} else while (cycleCounter < mem_.nextEventTime()) {
 			unsigned char opcode;
 
+#ifdef GAMBATTE_JIT
+			if (jit_.enabled() && !skip_) {
+				if (Recompiler::Block const *block = jit_.block(pc, cycleCounter, mem_.nextEventTime())) {
+					runRecompiled(block, a, pc, cycleCounter);
+					continue;
+				}
+			}
+#endif
+
 			PC_READ(opcode);
 
 			if (skip_) {
@@ -21,6 +21,7 @@
 
 #include "gambatte.h"
 #include "gambatte-memory.h"
+#include "recompiler.h"
 #include "savestate.h"
 
 namespace gambatte {
@@ -44,6 +45,9 @@ public:
 #ifdef __LIBRETRO__
    void *savedata_ptr() { return mem_.savedata_ptr(); }
    unsigned savedata_size() { return mem_.savedata_size(); }
+   bool savedata_dirty() const { return mem_.savedata_dirty(); }
+   void set_savedata_dirty(bool dirty) { mem_.set_savedata_dirty(dirty); }
+   unsigned savedata_dirty_ranges(unsigned *offsets, unsigned *sizes, unsigned maxRanges) { return mem_.savedata_dirty_ranges(offsets, sizes, maxRanges); }
    void *rtcdata_ptr() { return mem_.rtcdata_ptr(); }
    unsigned rtcdata_size() { return mem_.rtcdata_size(); }
    void clearCheats() { mem_.clearCheats(); }
@@ -58,7 +62,7 @@ public:
    void *oamram_ptr() const { return mem_.oamram_ptr(); }
 #endif
 
-	void setVideoBuffer(video_pixel_t *videoBuf, std::ptrdiff_t pitch) {
+	void setVideoBuffer(void *videoBuf, std::ptrdiff_t pitch) {
 		mem_.setVideoBuffer(videoBuf, pitch);
 	}
 
@@ -96,6 +100,12 @@ public:
 
 	void setGameGenie(std::string const &codes) { mem_.setGameGenie(codes); }
 	void setGameShark(std::string const &codes) { mem_.setGameShark(codes); }
+	void setGameSharkFreeze(bool enable) { mem_.setGameSharkFreeze(enable); }
+#ifdef GAMBATTE_JIT
+	void setRecompilerEnabled(bool enable) { jit_.setEnabled(enable); }
+#else
+	void setRecompilerEnabled(bool) {}
+#endif
 
 	Memory mem_;
 private:
@@ -105,6 +115,12 @@ private:
 	unsigned hf1, hf2, zf, cf;
 	unsigned char a_, b, c, d, e, /*f,*/ h, l;
 	bool skip_;
+#ifdef GAMBATTE_JIT
+	Recompiler jit_;
+
+	void runRecompiled(Recompiler::Block const *block,
+			unsigned char &a, unsigned short &pc, unsigned long &cycleCounter);
+#endif
 
 	void process(unsigned long cycles);
 };
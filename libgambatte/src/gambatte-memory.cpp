@@ -44,6 +44,7 @@ Memory::Memory(Interrupter const &interrupter) :
 , oamDmaPos_(0xFE)
 , serialCnt_(0)
 , blanklcd_(false)
+, romGeneration_(0)
 {
 	intreq_.setEventTime<intevent_blit>(144 * 456ul);
 	intreq_.setEventTime<intevent_end>(0);
@@ -94,6 +95,8 @@ void Memory::loadState(SaveState const &state) {
 	tima_.loadState(state, TimaInterruptRequester(intreq_));
 	cart_.loadState(state);
 	intreq_.loadState(state);
+	// The boot ROM may get mapped in or out after this
+	++romGeneration_;
 
 	divLastUpdate_ = state.mem.divLastUpdate;
 	intreq_.setEventTime<intevent_serial>(state.mem.nextSerialtime > state.cpu.cycleCounter
@@ -119,6 +122,7 @@ void Memory::loadState(SaveState const &state) {
 	           : 8;
 
 	cart_.setVrambank(ioamhram_[0x14F] & isCgb());
+	cart_.setLcdOff(!(ioamhram_[0x140] & lcdc_en), ioamhram_);
 	cart_.setOamDmaSrc(oam_dma_src_off);
 	cart_.setWrambank(isCgb() && (ioamhram_[0x170] & 0x07) ? ioamhram_[0x170] & 0x07 : 1);
 
@@ -161,6 +165,12 @@ void Memory::startSerialTransfer(unsigned long cc, unsigned char data, bool fast
 		: (cc & ~0xFFul) + 0x200 * 8);
 }
 
+// Returns the next n bits of the received byte (MSB first),
+// i.e. those following the 8 - serialCnt_ already shifted in
+unsigned Memory::serialBitsIn(int n) const {
+	return ((serialize_value_ << (8 - serialCnt_)) & 0xFF) >> (8 - n);
+}
+
 void Memory::checkSerial(unsigned long const cc) {
 	// Periodically checks if serial data is received
 	if ((serial_io_ != 0) &&
@@ -181,7 +191,7 @@ void Memory::updateSerial(unsigned long const cc) {
 #ifdef HAVE_NETWORK
 			bool fire = ((ioamhram_[0x102] & 0x80) == 0x80);
 			ioamhram_[0x101] = ((ioamhram_[0x101] << serialCnt_) |
-					    (serialize_value_ >> (8 - serialCnt_))) & 0xFF;
+					    serialBitsIn(serialCnt_)) & 0xFF;
 #else
          ioamhram_[0x101] = (((ioamhram_[0x101] + 1) << serialCnt_) - 1) & 0xFF;
 #endif
@@ -199,7 +209,7 @@ void Memory::updateSerial(unsigned long const cc) {
 #ifdef HAVE_NETWORK
 			                                    serialize_is_fastcgb_);
 			ioamhram_[0x101] = ((ioamhram_[0x101] << (serialCnt_ - targetCnt)) |
-					    (serialize_value_ >> (8 - (serialCnt_ - targetCnt)))) & 0xFF;
+					    serialBitsIn(serialCnt_ - targetCnt)) & 0xFF;
 #else
                                              ioamhram_[0x102] & isCgb() * 2);
          ioamhram_[0x101] = (((ioamhram_[0x101] + 1) << (serialCnt_ - targetCnt)) - 1) & 0xFF;
@@ -624,46 +634,41 @@ static bool isInOamDmaConflictArea(OamDmaSrc const oamDmaSrc, unsigned const p,
 }
 
 unsigned Memory::nontrivial_read(unsigned const p, unsigned long const cc) {
-	if (p < 0xFF80) {
-		if (lastOamDmaUpdate_ != disabled_time) {
-			updateOamDma(cc);
-
-			if (isInOamDmaConflictArea(cart_.oamDmaSrc(), p, isCgb()) && oamDmaPos_ < 0xA0)
-				return ioamhram_[oamDmaPos_];
-		}
-
-		if (p < 0xC000) {
-			if (p < 0x8000)
-				return cart_.romdata(p >> 14)[p];
-
-			if (p < 0xA000) {
-				if (!lcd_.vramAccessible(cc))
-					return 0xFF;
-
-				return cart_.vrambankptr()[p];
-			}
-
-			if (cart_.rsrambankptr())
-				return cart_.rsrambankptr()[p];
+	if (lastOamDmaUpdate_ != disabled_time) {
+		updateOamDma(cc);
 
-			if (cart_.isHuC3())
-				return cart_.HuC3Read(p, cc);
+		if (isInOamDmaConflictArea(cart_.oamDmaSrc(), p, isCgb()) && oamDmaPos_ < 0xA0)
+			return ioamhram_[oamDmaPos_];
+	}
 
-			return cart_.rtcRead();
-		}
+	switch (cart_.pageHandler(p >> 8)) {
+	case page_rom:
+		return cart_.romdata(p >> 14)[p];
+	case page_vram:
+		if (!lcd_.vramAccessible(cc))
+			return 0xFF;
 
-		if (p < 0xFE00)
-			return cart_.wramdata(p >> 12 & 1)[p & 0xFFF];
+		return cart_.vrambankptr()[p];
+	case page_sram:
+		if (cart_.rsrambankptr())
+			return cart_.rsrambankptr()[p];
 
-		long const ffp = long(p) - 0xFF00;
-		if (ffp >= 0)
-			return nontrivial_ff_read(ffp, cc);
+		if (cart_.isHuC3())
+			return cart_.HuC3Read(p, cc);
 
+		return cart_.rtcRead();
+	case page_wram:
+		return cart_.wramdata(p >> 12 & 1)[p & 0xFFF];
+	case page_oam:
 		if (!lcd_.oamReadable(cc) || oamDmaPos_ < 0xA0)
 			return 0xFF;
+
+		return ioamhram_[p - 0xFE00];
+	case page_io:
+		break;
 	}
 
-	return ioamhram_[p - 0xFE00];
+	return nontrivial_ff_read(p - 0xFF00, cc);
 }
 
 void Memory::nontrivial_ff_write(unsigned const p, unsigned data, unsigned long const cc) {
@@ -947,6 +952,8 @@ void Memory::nontrivial_ff_write(unsigned const p, unsigned data, unsigned long
 					if (hdmaEnabled)
 						flagHdmaReq(intreq_);
 				}
+
+				cart_.setLcdOff(!(data & lcdc_en), ioamhram_);
 			}
          else
 				lcd_.lcdcChange(data, cc);
@@ -1028,6 +1035,7 @@ void Memory::nontrivial_ff_write(unsigned const p, unsigned data, unsigned long
    case 0x50://for bootloader, swap bootloader with rom
       bootloader.call_FF50();
       ioamhram_[0x150] = 0xFF;
+      ++romGeneration_;
       return;
 	case 0x51:
 		dmaSource_ = data << 8 | (dmaSource_ & 0xFF);
@@ -1139,34 +1147,43 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 		}
 	}
 
-	if (p < 0xFE00) {
-		if (p < 0xA000) {
-			if (p < 0x8000) {
-				cart_.mbcWrite(p, data);
-			} else if (lcd_.vramAccessible(cc)) {
-				lcd_.vramChange(cc);
-				cart_.vrambankptr()[p] = data;
-			}
-		} else if (p < 0xC000) {
-			if (cart_.wsrambankptr())
-				cart_.wsrambankptr()[p] = data;
-			else if (cart_.isHuC3())
-				cart_.HuC3Write(p, data);
-			else
-				cart_.rtcWrite(data);
-		} else
-			cart_.wramdata(p >> 12 & 1)[p & 0xFFF] = data;
-	} else if (p - 0xFF80u >= 0x7Fu) {
-		long const ffp = long(p) - 0xFF00;
-		if (ffp < 0) {
-			if (lcd_.oamWritable(cc) && oamDmaPos_ >= 0xA0 && (p < 0xFEA0 || isCgb())) {
-				lcd_.oamChange(cc);
-				ioamhram_[p - 0xFE00] = data;
-			}
-		} else
-			nontrivial_ff_write(ffp, data, cc);
-	} else
-		ioamhram_[p - 0xFE00] = data;
+	switch (cart_.pageHandler(p >> 8)) {
+	case page_rom:
+		cart_.mbcWrite(p, data);
+		return;
+	case page_vram:
+		if (lcd_.vramAccessible(cc)) {
+			lcd_.vramChange(cc);
+			cart_.vrambankptr()[p] = data;
+		}
+
+		return;
+	case page_sram:
+		if (cart_.wsrambankptr())
+			cart_.sramWrite(p, data);
+		else if (cart_.isHuC3())
+			cart_.HuC3Write(p, data);
+		else
+			cart_.rtcWrite(data);
+
+		break;
+	case page_wram:
+		cart_.wramdata(p >> 12 & 1)[p & 0xFFF] = data;
+		break;
+	case page_oam:
+		if (lcd_.oamWritable(cc) && oamDmaPos_ >= 0xA0 && (p < 0xFEA0 || isCgb())) {
+			lcd_.oamChange(cc);
+			ioamhram_[p - 0xFE00] = data;
+		}
+
+		return;
+	case page_io:
+		nontrivial_ff_write(p - 0xFF00, data, cc);
+		return;
+	}
+
+	if (interrupter_.gameSharkFrozen(p))
+		interrupter_.applyDirectCheats(*this);
 }
 
 std::size_t Memory::fillSoundBuffer(unsigned long cc) {
@@ -1174,6 +1191,16 @@ std::size_t Memory::fillSoundBuffer(unsigned long cc) {
 	return psg_.fillBuffer();
 }
 
+void Memory::setGameShark(std::string const &codes) {
+	interrupter_.setGameShark(codes, *this);
+	cart_.setWriteTraps(interrupter_.gameSharkWriteTraps());
+}
+
+void Memory::setGameSharkFreeze(bool const enable) {
+	interrupter_.setGameSharkFreeze(enable);
+	cart_.setWriteTraps(interrupter_.gameSharkWriteTraps());
+}
+
 int Memory::loadROM(const void *romdata, unsigned int romsize, unsigned int forceModel, const bool multicartCompat)
 {
    if (const int fail = cart_.loadROM(romdata, romsize, forceModel, multicartCompat))
@@ -1181,6 +1208,7 @@ int Memory::loadROM(const void *romdata, unsigned int romsize, unsigned int forc
    psg_.init(cart_.isCgb());
    lcd_.reset(ioamhram_, cart_.vramdata(), cart_.isCgb());
    interrupter_.clearCheats();
+   ++romGeneration_;
    return 0;
 }
 
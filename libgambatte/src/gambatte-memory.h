@@ -45,14 +45,18 @@ public:
 #ifdef __LIBRETRO__
    void *savedata_ptr() { return cart_.savedata_ptr(); }
    unsigned savedata_size() { return cart_.savedata_size(); }
+   bool savedata_dirty() const { return cart_.sramDirty(); }
+   void set_savedata_dirty(bool dirty) { cart_.setSramDirty(dirty); }
+   unsigned savedata_dirty_ranges(unsigned *offsets, unsigned *sizes, unsigned maxRanges) { return cart_.takeSramDirtyRanges(offsets, sizes, maxRanges); }
    void *rtcdata_ptr() { return cart_.rtcdata_ptr(); }
    unsigned rtcdata_size() { return cart_.rtcdata_size(); }
    void display_setColorCorrection(bool enable) { lcd_.setColorCorrection(enable); }
    void display_setColorCorrectionMode(unsigned colorCorrectionMode) { lcd_.setColorCorrectionMode(colorCorrectionMode); }
    void display_setColorCorrectionBrightness(float colorCorrectionBrightness) { lcd_.setColorCorrectionBrightness(colorCorrectionBrightness); }
    void display_setDarkFilterLevel(unsigned darkFilterLevel) { lcd_.setDarkFilterLevel(darkFilterLevel); }
+   void display_setPixelFormat(PixelFormat format) { lcd_.setPixelFormat(format); }
    video_pixel_t display_gbcToRgb32(const unsigned bgr15) { return lcd_.gbcToRgb32(bgr15); }
-   void clearCheats() { cart_.clearCheats(); interrupter_.clearCheats(); }
+   void clearCheats() { cart_.clearCheats(); interrupter_.clearCheats(); cart_.setWriteTraps(0); ++romGeneration_; }
    void *vram_ptr() const { return cart_.vramdata(); }
    void *rambank0_ptr() const { return cart_.wramdata(0); }
    void *rambank1_ptr() const { return cart_.wramdata(0) + 0x1000; }
@@ -91,13 +95,19 @@ public:
 		return p < 0x80 ? nontrivial_ff_read(p, cc) : ioamhram_[p + 0x100];
 	}
 
+	// HRAM shares its page with IO, but never needs the slow path
 	unsigned read(unsigned p, unsigned long cc) {
-		return cart_.rmem(p >> 12) ? cart_.rmem(p >> 12)[p] : nontrivial_read(p, cc);
+		if (unsigned char const *const page = cart_.rmem(p >> 8))
+			return page[p];
+
+		return p >= 0xFF80 ? ioamhram_[p - 0xFE00] : nontrivial_read(p, cc);
 	}
 
 	void write(unsigned p, unsigned data, unsigned long cc) {
-		if (cart_.wmem(p >> 12)) {
-			cart_.wmem(p >> 12)[p] = data;
+		if (unsigned char *const page = cart_.wmem(p >> 8)) {
+			page[p] = data;
+		} else if (p - 0xFF80u < 0x7Fu) {
+			ioamhram_[p - 0xFE00] = data;
 		} else
 			nontrivial_write(p, data, cc);
 	}
@@ -123,7 +133,7 @@ public:
 	void setSoundBuffer(uint_least32_t *buf, std::size_t size) { psg_.setBuffer(buf, size); }
 	std::size_t fillSoundBuffer(unsigned long cc);
 
-	void setVideoBuffer(video_pixel_t *videoBuf, std::ptrdiff_t pitch) {
+	void setVideoBuffer(void *videoBuf, std::ptrdiff_t pitch) {
 		lcd_.setVideoBuffer(videoBuf, pitch);
 	}
 
@@ -131,8 +141,22 @@ public:
 		lcd_.setDmgPaletteColor(palNum, colorNum, rgb32);
 	}
 
-	void setGameGenie(std::string const &codes) { cart_.setGameGenie(codes); }
-	void setGameShark(std::string const &codes) { interrupter_.setGameShark(codes); }
+	void setGameGenie(std::string const &codes) { cart_.setGameGenie(codes); ++romGeneration_; }
+	void setGameShark(std::string const &codes);
+	void setGameSharkFreeze(bool enable);
+
+	// Direct storage access for cheats
+	unsigned char * wramdata(unsigned area) const { return cart_.wramdata(area); }
+	unsigned wramBanks() const { return cart_.isCgb() ? 8 : 2; }
+	std::size_t sramSize() const { return cart_.sramSize(); }
+	void sramPoke(std::size_t offset, unsigned data) { cart_.sramPoke(offset, data); }
+
+	// For the recompiler, which inlines the fast paths of the accessors
+	// above, and needs to know when the contents of ROM change (on load,
+	// Game Genie codes and boot ROM mapping)
+	MemPtrs const & memPtrs() const { return cart_.memPtrs(); }
+	unsigned char * ioamhram() { return ioamhram_; }
+	unsigned romGeneration() const { return romGeneration_; }
 #ifdef HAVE_NETWORK
 	void checkSerial(unsigned long cc);
 #endif
@@ -161,6 +185,7 @@ private:
 	unsigned char oamDmaPos_;
 	unsigned char serialCnt_;
 	bool blanklcd_;
+	unsigned romGeneration_;
 
 	void decEventCycles(IntEventId eventId, unsigned long dec);
 	void oamDmaInitSetup();
@@ -173,6 +198,9 @@ private:
 	void nontrivial_ff_write(unsigned p, unsigned data, unsigned long cycleCounter);
 	void nontrivial_write(unsigned p, unsigned data, unsigned long cycleCounter);
 	void updateSerial(unsigned long cc);
+#ifdef HAVE_NETWORK
+	unsigned serialBitsIn(int n) const;
+#endif
 	void updateTimaIrq(unsigned long cc);
 	void updateIrqs(unsigned long cc);
 	bool isDoubleSpeed() const { return lcd_.isDoubleSpeed(); }
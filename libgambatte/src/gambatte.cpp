@@ -42,7 +42,7 @@ GB::~GB() {
 	delete p_;
 }
 
-long GB::runFor(gambatte::video_pixel_t *const videoBuf, const int pitch,
+long GB::runFor(void *const videoBuf, const int pitch,
 			gambatte::uint_least32_t *const soundBuf, std::size_t soundBufSize, unsigned &samples) {
 	
 	p_->cpu.setVideoBuffer(videoBuf, pitch);
@@ -99,6 +99,17 @@ void GB::setSerialIO(SerialIO *serial_io) {
 
 void *GB::savedata_ptr() { return p_->cpu.savedata_ptr(); }
 unsigned GB::savedata_size() { return p_->cpu.savedata_size(); }
+
+bool GB::savedata_dirty() {
+   return savedata_size() && p_->cpu.savedata_dirty();
+}
+
+unsigned GB::savedata_dirty_ranges(unsigned *offsets, unsigned *sizes, unsigned maxRanges) {
+   if (!savedata_size())
+      return 0;
+
+   return p_->cpu.savedata_dirty_ranges(offsets, sizes, maxRanges);
+}
 void *GB::rtcdata_ptr() { return p_->cpu.rtcdata_ptr(); }
 unsigned GB::rtcdata_size() { return p_->cpu.rtcdata_size(); }
 
@@ -122,6 +133,10 @@ bool GB::isLoaded() const {
 	return true;
 }
 
+bool GB::isBooting() const {
+	return p_->cpu.mem_.bootloader.booting();
+}
+
 void GB::setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned rgb32) {
 	p_->cpu.setDmgPaletteColor(palNum, colorNum, rgb32);
 }
@@ -133,6 +148,7 @@ void GB::loadState(const void *data) {
    if (StateSaver::loadState(state, data)) {
       p_->cpu.loadState(state);
       p_->cpu.mem_.bootloader.choosebank(state.mem.ioamhram.get()[0x150] != 0xFF);
+      p_->cpu.set_savedata_dirty(true);
    }
 }
 
@@ -150,6 +166,10 @@ size_t GB::stateSize() const {
    return StateSaver::stateSize(state);
 }
 
+const char * GB::stateDiff(const void *a, const void *b, size_t size) {
+   return StateSaver::stateDiff(a, b, size);
+}
+
 void GB::setColorCorrection(bool enable) {
    p_->cpu.mem_.display_setColorCorrection(enable);
 }
@@ -166,6 +186,10 @@ void GB::setDarkFilterLevel(unsigned darkFilterLevel) {
    p_->cpu.mem_.display_setDarkFilterLevel(darkFilterLevel);
 }
 
+void GB::setPixelFormat(PixelFormat format) {
+   p_->cpu.mem_.display_setPixelFormat(format);
+}
+
 video_pixel_t GB::gbcToRgb32(const unsigned bgr15) {
    return p_->cpu.mem_.display_gbcToRgb32(bgr15);
 }
@@ -179,10 +203,18 @@ void GB::setGameShark(const std::string &codes) {
  p_->cpu.setGameShark(codes);
 }
 
+void GB::setGameSharkFreeze(const bool enable) {
+	p_->cpu.setGameSharkFreeze(enable);
+}
+
 void GB::clearCheats() {
  p_->cpu.clearCheats();
 }
 
+void GB::setRecompilerEnabled(const bool enable) {
+	p_->cpu.setRecompilerEnabled(enable);
+}
+
 #ifdef __LIBRETRO__
 void *GB::vram_ptr() const {
  return p_->cpu.vram_ptr();
@@ -18,13 +18,17 @@
 
 #include "interrupter.h"
 #include "gambatte-memory.h"
+#include <cstring>
 
 namespace gambatte {
 
 Interrupter::Interrupter(unsigned short &sp, unsigned short &pc)
 : sp_(sp)
 , pc_(pc)
+, gsTraps_(0)
+, gsFreeze_(false)
 {
+	std::memset(gsFrozen_, 0, sizeof gsFrozen_);
 }
 
 unsigned long Interrupter::interrupt(unsigned const address, unsigned long cc, Memory &memory) {
@@ -44,36 +48,132 @@ unsigned long Interrupter::interrupt(unsigned const address, unsigned long cc, M
 }
 
 static int asHex(char c) {
-	return c >= 'A' ? c - 'A' + 0xA : c - '0';
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 0xA;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 0xA;
+
+	return -1;
 }
 
-void Interrupter::setGameShark(std::string const &codes) {
-	std::string code;
-
-	for (std::size_t pos = 0; pos < codes.length(); pos += code.length() + 1) {
-		code = codes.substr(pos, codes.find(';', pos) - pos);
-		if (code.length() >= 8) {
-			GsCode gs;
-			gs.type  =  asHex(code[0]) << 4 | asHex(code[1]);
-			gs.value = (asHex(code[2]) << 4 | asHex(code[3])) & 0xFF;
-			gs.address = (  asHex(code[4]) << 4
-			              | asHex(code[5])
-			              | asHex(code[6]) << 12
-			              | asHex(code[7]) <<  8) & 0xFFFF;
-			gsCodes_.push_back(gs);
+void Interrupter::setGameShark(std::string const &codes, Memory const &memory) {
+	std::size_t pos = 0;
+
+	while (pos < codes.length()) {
+		std::size_t end = codes.find(';', pos);
+		if (end == std::string::npos)
+			end = codes.length();
+
+		if (end - pos >= 8) {
+			int digit[8];
+			bool valid = true;
+			for (int i = 0; i < 8; ++i)
+				valid &= (digit[i] = asHex(codes[pos + i])) >= 0;
+
+			if (valid) {
+				GsCode gs;
+				gs.type    = digit[0] << 4 | digit[1];
+				gs.value   = digit[2] << 4 | digit[3];
+				gs.address = digit[4] << 4 | digit[5] | digit[6] << 12 | digit[7] << 8;
+				gsCodes_.push_back(gs);
+			}
 		}
+
+		pos = end + 1;
 	}
+
+	compileGameShark(memory);
 }
 
 void Interrupter::clearCheats() {
 	gsCodes_.clear();
+	gsWram_.clear();
+	gsWramBanked_.clear();
+	gsSram_.clear();
+	gsOther_.clear();
+	std::memset(gsFrozen_, 0, sizeof gsFrozen_);
+	gsTraps_ = 0;
 }
 
-void Interrupter::applyVblankCheats(unsigned long const cc, Memory &memory) {
+// Sorts codes by the storage they write to. Codes for WRAM, and
+// RAM-bank-specific codes (types 0x8x and 0x9x, x being the bank)
+// for cartridge RAM, become direct writes into bank storage.
+// Anything else still goes through Memory::write.
+void Interrupter::compileGameShark(Memory const &memory) {
+	unsigned const wramBanks = memory.wramBanks();
+	std::size_t const sramSize = memory.sramSize();
+
+	gsWram_.clear();
+	gsWramBanked_.clear();
+	gsSram_.clear();
+	gsOther_.clear();
+	std::memset(gsFrozen_, 0, sizeof gsFrozen_);
+	gsTraps_ = 0;
+
 	for (std::size_t i = 0, size = gsCodes_.size(); i < size; ++i) {
-		if (gsCodes_[i].type == 0x01)
-			memory.write(gsCodes_[i].address, gsCodes_[i].value, cc);
+		GsCode const &gs = gsCodes_[i];
+		bool const banked = (gs.type & 0xE0) == 0x80;
+		if (gs.type != 0x01 && !banked)
+			continue;
+
+		// Echo RAM mirrors 0xC000-0xDDFF
+		unsigned const p = gs.address >= 0xE000 && gs.address < 0xFE00
+		                 ? gs.address - 0x2000
+		                 : gs.address;
+		GsPatch patch;
+		patch.value = gs.value;
+
+		if (p >= 0xC000 && p < 0xD000) {
+			patch.offset = p - 0xC000;
+			gsWram_.push_back(patch);
+			gsTraps_ |= 1 << 0xC | 1 << 0xE;
+		} else if (p >= 0xD000 && p < 0xE000) {
+			patch.offset = p - 0xD000;
+			if (banked) {
+				unsigned const bank = gs.type & (wramBanks - 1);
+				patch.offset += (bank ? bank : 1) * 0x1000;
+				gsWram_.push_back(patch);
+			} else
+				gsWramBanked_.push_back(patch);
+
+			gsTraps_ |= 1 << 0xD | 1 << 0xF;
+		} else if (banked && p >= 0xA000 && p < 0xC000) {
+			if (!sramSize)
+				continue;
+
+			// Cartridge RAM sizes are powers of two
+			patch.offset = ((gs.type & 0x0F) * 0x2000ul + p - 0xA000) & (sramSize - 1);
+			gsSram_.push_back(patch);
+		} else {
+			gsOther_.push_back(gs);
+			continue;
+		}
+
+		gsFrozen_[(p - 0xA000) >> 3] |= 1 << ((p - 0xA000) & 7);
 	}
 }
 
+void Interrupter::applyDirectCheats(Memory &memory) const {
+	unsigned char *const wram = memory.wramdata(0);
+	unsigned char *const wramBank = memory.wramdata(1);
+
+	for (std::size_t i = 0, size = gsWram_.size(); i < size; ++i)
+		wram[gsWram_[i].offset] = gsWram_[i].value;
+
+	for (std::size_t i = 0, size = gsWramBanked_.size(); i < size; ++i)
+		wramBank[gsWramBanked_[i].offset] = gsWramBanked_[i].value;
+
+	for (std::size_t i = 0, size = gsSram_.size(); i < size; ++i)
+		memory.sramPoke(gsSram_[i].offset, gsSram_[i].value);
+}
+
+void Interrupter::applyVblankCheats(unsigned long const cc, Memory &memory) {
+	applyDirectCheats(memory);
+
+	for (std::size_t i = 0, size = gsOther_.size(); i < size; ++i)
+		memory.write(gsOther_[i].address, gsOther_[i].value, cc);
+}
+
 }
@@ -36,14 +36,42 @@ class Interrupter {
 public:
 	Interrupter(unsigned short &sp, unsigned short &pc);
 	unsigned long interrupt(unsigned address, unsigned long cycleCounter, Memory &memory);
-	void setGameShark(std::string const &codes);
+	void setGameShark(std::string const &codes, Memory const &memory);
+	void setGameSharkFreeze(bool enable) { gsFreeze_ = enable; }
 	void clearCheats();
 
+	// Areas (bit n for 0xn000-0xnFFF) whose writes must take the
+	// slow path, so that frozen codes can be re-applied
+	unsigned gameSharkWriteTraps() const { return gsFreeze_ ? gsTraps_ : 0; }
+
+	// p is a cartridge RAM or WRAM address (0xA000-0xFDFF)
+	bool gameSharkFrozen(unsigned p) const {
+		unsigned const i = (p < 0xE000 ? p : p - 0x2000) - 0xA000;
+		return gsFreeze_ && i < 0x4000 && (gsFrozen_[i >> 3] >> (i & 7) & 1);
+	}
+
+	void applyDirectCheats(Memory &memory) const;
+
 private:
+	// A code compiled to a write into WRAM or cartridge RAM storage
+	struct GsPatch {
+		unsigned offset;
+		unsigned char value;
+	};
+
 	unsigned short &sp_;
 	unsigned short &pc_;
 	std::vector<GsCode> gsCodes_;
+	std::vector<GsPatch> gsWram_;
+	std::vector<GsPatch> gsWramBanked_;
+	std::vector<GsPatch> gsSram_;
+	std::vector<GsCode> gsOther_;
+	// WRAM and cartridge RAM addresses (0xA000-0xDFFF) with codes
+	unsigned char gsFrozen_[0x4000 / 8];
+	unsigned gsTraps_;
+	bool gsFreeze_;
 
+	void compileGameShark(Memory const &memory);
 	void applyVblankCheats(unsigned long cc, Memory &mem);
 };
 
@@ -491,6 +491,29 @@ namespace gambatte
       }
    }
 
+   static void nullMbcWrite(Mbc *, unsigned, unsigned)
+   {
+   }
+
+   template<class T>
+   static void mbcWriteHandler(Mbc *const mbc, const unsigned P, const unsigned data)
+   {
+      static_cast<T *>(mbc)->T::romWrite(P, data);
+   }
+
+   template<class T>
+   void Cartridge::setMbc(T *const newMbc)
+   {
+      mbc.reset(newMbc);
+      mbcWrite_ = mbcWriteHandler<T>;
+   }
+
+   Cartridge::Cartridge()
+   : mbcWrite_(nullMbcWrite)
+   {
+      setSramDirty(false);
+   }
+
    void Cartridge::setStatePtrs(SaveState &state)
    {
       state.mem.vram.set(memptrs_.vramdata(), memptrs_.vramdataend() - memptrs_.vramdata());
@@ -531,6 +554,44 @@ namespace gambatte
       return n;
    }
 
+   void Cartridge::setSramDirty(const bool dirty)
+   {
+      std::memset(sramDirty_, dirty, sizeof sramDirty_);
+      sramDirtyAny_ = dirty;
+   }
+
+   unsigned Cartridge::takeSramDirtyRanges(unsigned *const offsets, unsigned *const sizes, const unsigned maxRanges)
+   {
+      if (!sramDirtyAny_)
+         return 0;
+
+      const unsigned size   = sramSize();
+      const unsigned blocks = (size + sram_block_size - 1) / sram_block_size;
+      unsigned n = 0;
+      unsigned i = 0;
+
+      while (i < blocks && n < maxRanges)
+      {
+         if (!sramDirty_[i])
+         {
+            ++i;
+            continue;
+         }
+
+         const unsigned first = i;
+         while (i < blocks && sramDirty_[i])
+            sramDirty_[i++] = 0;
+
+         offsets[n] = first * sram_block_size;
+         sizes[n]   = std::min(i * sram_block_size, size) - offsets[n];
+         ++n;
+      }
+
+      // Ranges that did not fit are left for the next call
+      sramDirtyAny_ = std::find(sramDirty_ + i, sramDirty_ + blocks, 1) != sramDirty_ + blocks;
+      return n;
+   }
+
    int Cartridge::loadROM(const void *data, unsigned int romsize, unsigned int forceModel, const bool multiCartCompat)
    {
       const uint8_t *romdata = (uint8_t*)data;
@@ -626,7 +687,9 @@ namespace gambatte
 
       ggUndoList_.clear();
       mbc.reset();
+      mbcWrite_ = nullMbcWrite;
       memptrs_.reset(rombanks, rambanks, cgb ? 8 : 2);
+      setSramDirty(false);
       rtc_.set(false, 0);
       huc3_.set(false);
 
@@ -636,21 +699,21 @@ namespace gambatte
 
       switch (type)
       {
-         case PLAIN: mbc.reset(new Mbc0(memptrs_)); break;
+         case PLAIN: setMbc(new Mbc0(memptrs_)); break;
          case MBC1:
                      if (!rambanks && rombanks == 64 && multiCartCompat) {
                         /*std::puts("Multi-ROM \"MBC1\" presumed");*/
-                        mbc.reset(new Mbc1Multi64(memptrs_));
+                        setMbc(new Mbc1Multi64(memptrs_));
                      } else
-                        mbc.reset(new Mbc1(memptrs_));
+                        setMbc(new Mbc1(memptrs_));
                      break;
-         case MBC2: mbc.reset(new Mbc2(memptrs_)); break;
-         case MBC3: mbc.reset(new Mbc3(memptrs_, hasRtc(memptrs_.romdata()[0x147]) ? &rtc_ : 0)); break;
-         case MBC5: mbc.reset(new Mbc5(memptrs_, rumble)); break;
-         case HUC1: mbc.reset(new HuC1(memptrs_)); break;
+         case MBC2: setMbc(new Mbc2(memptrs_)); break;
+         case MBC3: setMbc(new Mbc3(memptrs_, hasRtc(memptrs_.romdata()[0x147]) ? &rtc_ : 0)); break;
+         case MBC5: setMbc(new Mbc5(memptrs_, rumble)); break;
+         case HUC1: setMbc(new HuC1(memptrs_)); break;
          case HUC3:
             huc3_.set(true);
-            mbc.reset(new HuC3(memptrs_, &huc3_));
+            setMbc(new HuC3(memptrs_, &huc3_));
             break;
       }
 
@@ -23,6 +23,7 @@
 #include "rtc.h"
 #include "huc3.h"
 #include "savestate.h"
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -42,20 +43,30 @@ namespace gambatte
    class Cartridge
    {
       public:
+         // Granularity of battery RAM dirty tracking (GB::SAVEDATA_BLOCK_SIZE)
+         enum { sram_block_size = 0x200 };
+
+         Cartridge();
+
          void setStatePtrs(SaveState &);
          void saveState(SaveState &) const;
          void loadState(const SaveState &);
 
          bool loaded() const { return mbc.get(); }
 
-         const unsigned char * rmem(unsigned area) const
+         const unsigned char * rmem(unsigned page) const
          {
-            return memptrs_.rmem(area);
+            return memptrs_.rmem(page);
          }
 
-         unsigned char * wmem(unsigned area) const
+         unsigned char * wmem(unsigned page) const
          {
-            return memptrs_.wmem(area);
+            return memptrs_.wmem(page);
+         }
+
+         PageHandler pageHandler(unsigned page) const
+         {
+            return memptrs_.pageHandler(page);
          }
 
          unsigned char * vramdata() const
@@ -112,7 +123,17 @@ namespace gambatte
             memptrs_.setOamDmaSrc(oamDmaSrc);
          }
 
-         void mbcWrite(unsigned addr, unsigned data) { mbc->romWrite(addr, data); }
+         void setLcdOff(bool off, unsigned char *oamram)
+         {
+            memptrs_.setLcdOff(off, oamram);
+         }
+
+         const MemPtrs & memPtrs() const
+         {
+            return memptrs_;
+         }
+
+         void mbcWrite(unsigned addr, unsigned data) { mbcWrite_(mbc.get(), addr, data); }
 
          bool isCgb() const
          {
@@ -139,6 +160,36 @@ namespace gambatte
          unsigned char HuC3Read(unsigned p, unsigned long const cc) { return huc3_.read(p, cc); }
          void HuC3Write(unsigned p, unsigned data) { huc3_.write(p, data); }
 
+         void sramWrite(unsigned p, unsigned data)
+         {
+            unsigned char *const dst = memptrs_.wsrambankptr() + p;
+            if (*dst != data)
+            {
+               *dst = data;
+               // Writes to disabled RAM land outside of the banks
+               std::size_t const offset = dst - memptrs_.rambankdata();
+               if (offset < sramSize())
+                  setSramBlockDirty(offset);
+            }
+         }
+
+         // Writes to cartridge RAM storage directly, bypassing the memory map
+         void sramPoke(std::size_t offset, unsigned data)
+         {
+            if (memptrs_.rambankdata()[offset] != data)
+            {
+               memptrs_.rambankdata()[offset] = data;
+               setSramBlockDirty(offset);
+            }
+         }
+
+         std::size_t sramSize() const { return memptrs_.rambankdataend() - memptrs_.rambankdata(); }
+         void setWriteTraps(unsigned areas) { memptrs_.setWriteTraps(areas); }
+
+         bool sramDirty() const { return sramDirtyAny_; }
+         void setSramDirty(bool dirty);
+         unsigned takeSramDirtyRanges(unsigned *offsets, unsigned *sizes, unsigned maxRanges);
+
          void *savedata_ptr();
          unsigned savedata_size();
 
@@ -161,9 +212,25 @@ namespace gambatte
 
          std::auto_ptr<Mbc> mbc;
 
+         // Register write handler of the mapper type picked by loadROM,
+         // calling its romWrite without going through the vtable
+         typedef void (*MbcWriteHandler)(Mbc *mbc, unsigned addr, unsigned data);
+         MbcWriteHandler mbcWrite_;
+
          std::vector<AddrData> ggUndoList_;
 
+         // One flag per block of up to 16 banks
+         unsigned char sramDirty_[16 * 0x2000 / sram_block_size];
+         bool sramDirtyAny_;
+
          void applyGameGenie(const std::string &code);
+         template<class T> void setMbc(T *newMbc);
+
+         void setSramBlockDirty(std::size_t offset)
+         {
+            sramDirty_[offset / sram_block_size] = 1;
+            sramDirtyAny_ = true;
+         }
    };
 
 }
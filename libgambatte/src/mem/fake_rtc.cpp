@@ -415,12 +415,17 @@ struct tm FakeRtc::minutes_to_tm(uint32_t total_minutes) const
     
     // Convert to tm structure
     time_t time_val = static_cast<time_t>(total_seconds);
+#ifdef HAVE_LINK_THREADS
+    // May be called by two linked GB instances at once
+    gmtime_r(&time_val, &result);
+#else
     struct tm* tm_ptr = gmtime(&time_val);
     
     if (tm_ptr)
     {
         result = *tm_ptr;
     }
+#endif
     
     return result;
 }
@@ -34,8 +34,17 @@ namespace gambatte
       ,memchunk_(0)
       , rambankdata_(0)
       , wramdataend_(0)
+      , oamram_(0)
       , oamDmaSrc_(oam_dma_src_off)
+      , writeTraps_(0)
+      , lcdOff_(false)
    {
+      std::memset(handlers_ + 0x00, page_rom,  0x80);
+      std::memset(handlers_ + 0x80, page_vram, 0x20);
+      std::memset(handlers_ + 0xA0, page_sram, 0x20);
+      std::memset(handlers_ + 0xC0, page_wram, 0x3E);
+      handlers_[0xFE] = page_oam;
+      handlers_[0xFF] = page_io;
    }
 
    MemPtrs::~MemPtrs()
@@ -61,9 +70,14 @@ namespace gambatte
       std::memset(rdisabledRamw(), 0xFF, 0x2000);
 
       oamDmaSrc_    = oam_dma_src_off;
-      rmem_[0x3]    = rmem_[0x2] = rmem_[0x1] = rmem_[0x0] = romdata_[0];
-      rmem_[0xC]    = wmem_[0xC] = wramdata_[0] - 0xC000;
-      rmem_[0xE]    = wmem_[0xE] = wramdata_[0] - 0xE000;
+      writeTraps_   = 0;
+      // Nothing is mapped yet, so that the setters below can't
+      // take the new banks for the ones already mapped
+      romdata_[1]   = wramdata_[1] = 0;
+      rsrambankptr_ = wsrambankptr_ = 0;
+      setPages(0x00, 0x40, romdata_[0], 0);
+      setPages(0xC0, 0x10, wramdata_[0] - 0xC000, wramdata_[0] - 0xC000);
+      setPages(0xE0, 0x10, wramdata_[0] - 0xE000, wramdata_[0] - 0xE000);
 
       setRombank(1);
       setRambank(0, 0);
@@ -71,17 +85,38 @@ namespace gambatte
       setWrambank(1);
    }
 
+   void MemPtrs::setPages(const unsigned first, const unsigned count,
+         const unsigned char *const r, unsigned char *const w)
+   {
+      std::fill(rmem_ + first, rmem_ + first + count, r);
+      std::fill(wmem_ + first, wmem_ + first + count, w);
+   }
+
    void MemPtrs::setRombank0(const unsigned bank)
    {
-      romdata_[0] = romdata() + bank * 0x4000ul;
-      rmem_[0x3] = rmem_[0x2] = rmem_[0x1] = rmem_[0x0] = romdata_[0];
+      unsigned char *const romdata0 = romdata() + bank * 0x4000ul;
+
+      if (romdata0 == romdata_[0])
+         return;
+
+      romdata_[0] = romdata0;
+      setPages(0x00, 0x40, romdata_[0], 0);
       disconnectOamDmaAreas();
    }
 
    void MemPtrs::setRombank(const unsigned bank)
    {
-      romdata_[1] = romdata() + bank * 0x4000ul - 0x4000;
-      rmem_[0x7] = rmem_[0x6] = rmem_[0x5] = rmem_[0x4] = romdata_[1];
+      unsigned char *const romdata1 = romdata() + bank * 0x4000ul - 0x4000;
+
+      // Some games (mostly their music drivers) write the bank
+      // register hundreds of times a frame, usually with the bank
+      // that is already mapped. The map only depends on the banks,
+      // OAM DMA and the write traps, so it is left alone then.
+      if (romdata1 == romdata_[1])
+         return;
+
+      romdata_[1] = romdata1;
+      setPages(0x40, 0x40, romdata_[1], 0);
       disconnectOamDmaAreas();
    }
 
@@ -92,36 +127,91 @@ namespace gambatte
          : (rambankdata() != rambankdataend()
                ? rambankdata_ + rambank * 0x2000ul - 0xA000 : wdisabledRam() - 0xA000);
 
-      rsrambankptr_ = (flags & READ_EN) && srambankptr != wdisabledRam() - 0xA000 ? srambankptr : rdisabledRamw() - 0xA000;
-      wsrambankptr_ = (flags & WRITE_EN) ? srambankptr : wdisabledRam() - 0xA000;
-      rmem_[0xB] = rmem_[0xA] = rsrambankptr_;
-      wmem_[0xB] = wmem_[0xA] = wsrambankptr_;
+      unsigned char *const rsrambankptr = (flags & READ_EN) && srambankptr != wdisabledRam() - 0xA000
+         ? srambankptr : rdisabledRamw() - 0xA000;
+      unsigned char *const wsrambankptr = (flags & WRITE_EN) ? srambankptr : wdisabledRam() - 0xA000;
+
+      if (rsrambankptr == rsrambankptr_ && wsrambankptr == wsrambankptr_)
+         return;
+
+      rsrambankptr_ = rsrambankptr;
+      wsrambankptr_ = wsrambankptr;
+      // SRAM writes always take the slow path (see Cartridge::sramWrite)
+      setPages(0xA0, 0x20, rsrambankptr_, 0);
       disconnectOamDmaAreas();
    }
 
+   void MemPtrs::setVrambank(const unsigned bank)
+   {
+      vrambankptr_ = vramdata() + bank * 0x2000ul - 0x8000;
+      mapVideoRam();
+   }
+
    void MemPtrs::setWrambank(const unsigned bank)
    {
-      wramdata_[1] = wramdata_[0] + ((bank & 0x07) ? (bank & 0x07) : 1) * 0x1000;
-      rmem_[0xD] = wmem_[0xD] = wramdata_[1] - 0xD000;
+      unsigned char *const wramdata1 = wramdata_[0] + ((bank & 0x07) ? (bank & 0x07) : 1) * 0x1000;
+
+      if (wramdata1 == wramdata_[1])
+         return;
+
+      wramdata_[1] = wramdata1;
+      setPages(0xD0, 0x10, wramdata_[1] - 0xD000, wramdata_[1] - 0xD000);
+      setPages(0xF0, 0x0E, wramdata_[1] - 0xF000, wramdata_[1] - 0xF000);
       disconnectOamDmaAreas();
    }
 
    void MemPtrs::setOamDmaSrc(const OamDmaSrc oamDmaSrc)
    {
-      rmem_[0x3] = rmem_[0x2] = rmem_[0x1] = rmem_[0x0] = romdata_[0];
-      rmem_[0x7] = rmem_[0x6] = rmem_[0x5] = rmem_[0x4] = romdata_[1];
-      rmem_[0xB] = rmem_[0xA] = rsrambankptr_;
-      wmem_[0xB] = wmem_[0xA] = wsrambankptr_;
-      rmem_[0xC] = wmem_[0xC] = wramdata_[0] - 0xC000;
-      rmem_[0xD] = wmem_[0xD] = wramdata_[1] - 0xD000;
-      rmem_[0xE] = wmem_[0xE] = wramdata_[0] - 0xE000;
+      setPages(0x00, 0x40, romdata_[0], 0);
+      setPages(0x40, 0x40, romdata_[1], 0);
+      setPages(0xA0, 0x20, rsrambankptr_, 0);
+      setPages(0xC0, 0x10, wramdata_[0] - 0xC000, wramdata_[0] - 0xC000);
+      setPages(0xD0, 0x10, wramdata_[1] - 0xD000, wramdata_[1] - 0xD000);
+      setPages(0xE0, 0x10, wramdata_[0] - 0xE000, wramdata_[0] - 0xE000);
+      setPages(0xF0, 0x0E, wramdata_[1] - 0xF000, wramdata_[1] - 0xF000);
 
       oamDmaSrc_ = oamDmaSrc;
+      mapVideoRam();
       disconnectOamDmaAreas();
    }
 
+   void MemPtrs::setLcdOff(const bool off, unsigned char *const oamram)
+   {
+      lcdOff_ = off;
+      oamram_ = oamram;
+      mapVideoRam();
+   }
+
+   void MemPtrs::mapVideoRam()
+   {
+      // VRAM is a conflict area for OAM DMA from VRAM, and OAM is
+      // taken by any OAM DMA. Writes to 0xFEA0-0xFEFF only stick on CGB.
+      unsigned char *const vram = lcdOff_ && oamDmaSrc_ != oam_dma_src_vram ? vrambankptr_ : 0;
+      unsigned char *const oam = lcdOff_ && oamDmaSrc_ == oam_dma_src_off && oamram_ ? oamram_ - 0xFE00 : 0;
+
+      setPages(0x80, 0x20, vram, vram);
+      rmem_[0xFE] = oam;
+      wmem_[0xFE] = isCgb(*this) ? oam : 0;
+   }
+
+   void MemPtrs::setWriteTraps(const unsigned areas)
+   {
+      writeTraps_ = areas;
+      setOamDmaSrc(oamDmaSrc_);
+   }
+
    void MemPtrs::disconnectOamDmaAreas()
    {
+      if (oamDmaSrc_ == oam_dma_src_off && !writeTraps_)
+         return;
+
+      for (unsigned area = 0xC; area < 0x10; ++area)
+      {
+         if (writeTraps_ >> area & 1)
+            std::fill(wmem_ + area * 0x10, wmem_ + std::min(area * 0x10 + 0x10, 0xFEu),
+                  static_cast<unsigned char *>(0));
+      }
+
       if (isCgb(*this))
       {
          switch (oamDmaSrc_)
@@ -129,15 +219,13 @@ namespace gambatte
             case oam_dma_src_rom:  // fall through
             case oam_dma_src_sram:
             case oam_dma_src_invalid:
-               std::fill(rmem_, rmem_ + 8, static_cast<unsigned char *>(0));
-               rmem_[0xB] = rmem_[0xA] = 0;
-               wmem_[0xB] = wmem_[0xA] = 0;
+               setPages(0x00, 0x80, 0, 0);
+               setPages(0xA0, 0x20, 0, 0);
                break;
             case oam_dma_src_vram:
                break;
             case oam_dma_src_wram:
-               rmem_[0xE] = rmem_[0xD] = rmem_[0xC] = 0;
-               wmem_[0xE] = wmem_[0xD] = wmem_[0xC] = 0;
+               setPages(0xC0, 0x3E, 0, 0);
                break;
             case oam_dma_src_off:
                break;
@@ -151,11 +239,9 @@ namespace gambatte
             case oam_dma_src_sram:
             case oam_dma_src_wram:
             case oam_dma_src_invalid:
-               std::fill(rmem_, rmem_ + 8, static_cast<unsigned char *>(0));
-               rmem_[0xB] = rmem_[0xA] = 0;
-               wmem_[0xB] = wmem_[0xA] = 0;
-               rmem_[0xE] = rmem_[0xD] = rmem_[0xC] = 0;
-               wmem_[0xE] = wmem_[0xD] = wmem_[0xC] = 0;
+               setPages(0x00, 0x80, 0, 0);
+               setPages(0xA0, 0x20, 0, 0);
+               setPages(0xC0, 0x3E, 0, 0);
                break;
             case oam_dma_src_vram:
                break;
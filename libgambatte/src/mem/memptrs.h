@@ -29,6 +29,14 @@ namespace gambatte
                  oam_dma_src_invalid,
                  oam_dma_src_off, };
 
+   // What serves accesses to a page that isn't mapped for direct access
+   enum PageHandler { page_rom,
+                      page_vram,
+                      page_sram,
+                      page_wram,
+                      page_oam,
+                      page_io, };
+
    class MemPtrs
    {
       public:
@@ -43,14 +51,23 @@ namespace gambatte
          ~MemPtrs();
          void reset(unsigned rombanks, unsigned rambanks, unsigned wrambanks);
 
-         const unsigned char * rmem(unsigned area) const
+         // The map is kept in 256-byte pages, so that the ends of the
+         // address space (echo RAM, OAM) needn't share the slow path
+         // with IO. Pages are indexed by address >> 8, and point to
+         // where address 0 would be.
+         const unsigned char * rmem(unsigned page) const
          {
-            return rmem_[area];
+            return rmem_[page];
          }
 
-         unsigned char * wmem(unsigned area) const
+         unsigned char * wmem(unsigned page) const
          {
-            return wmem_[area];
+            return wmem_[page];
+         }
+
+         PageHandler pageHandler(unsigned page) const
+         {
+            return static_cast<PageHandler>(handlers_[page]);
          }
 
          unsigned char * vramdata() const
@@ -123,27 +140,51 @@ namespace gambatte
             return oamDmaSrc_;
          }
 
+         // The whole map, for code inlining the fast paths of
+         // Memory::read/write
+         const unsigned char * const * rmemTable() const
+         {
+            return rmem_;
+         }
+
+         unsigned char * const * wmemTable() const
+         {
+            return wmem_;
+         }
+
          void setRombank0(unsigned bank);
          void setRombank(unsigned bank);
          void setRambank(unsigned ramFlags, unsigned rambank);
-         void setVrambank(unsigned bank) { vrambankptr_ = vramdata() + bank * 0x2000ul - 0x8000; }
+         void setVrambank(unsigned bank);
          void setWrambank(unsigned bank);
          void setOamDmaSrc(OamDmaSrc oamDmaSrc);
+         // Sends writes to WRAM areas (bit n for 0xn000-0xnFFF,
+         // 0xF000-0xFDFF for n = 0xF) through the slow path
+         void setWriteTraps(unsigned areas);
+         // Maps VRAM, and OAM at 'oamram', while the LCD is off. The PPU
+         // neither locks them nor needs to catch up on writes then.
+         void setLcdOff(bool off, unsigned char *oamram);
 
       private:
          unsigned char *romdata_[2];
          unsigned char *wramdata_[2];
-         const unsigned char *rmem_[0x10];
-         unsigned char *wmem_[0x10];
+         const unsigned char *rmem_[0x100];
+         unsigned char *wmem_[0x100];
+         unsigned char handlers_[0x100];
          unsigned char *vrambankptr_;
          unsigned char *rsrambankptr_;
          unsigned char *wsrambankptr_;
          unsigned char *memchunk_;
          unsigned char *rambankdata_;
          unsigned char *wramdataend_;
+         unsigned char *oamram_;
          OamDmaSrc oamDmaSrc_;
+         unsigned writeTraps_;
+         bool lcdOff_;
          MemPtrs(const MemPtrs &);
          MemPtrs & operator=(const MemPtrs &);
+         void setPages(unsigned first, unsigned count, const unsigned char *r, unsigned char *w);
+         void mapVideoRam();
          void disconnectOamDmaAreas();
          unsigned char * rdisabledRamw() const { return wramdataend_ ; }
          unsigned char * wdisabledRam() const { return wramdataend_ + 0x2000; }
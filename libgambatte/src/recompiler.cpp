@@ -0,0 +1,1410 @@
+#include "recompiler.h"
+
+#ifdef GAMBATTE_JIT
+
+#include "gambatte-memory.h"
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include <sys/mman.h>
+
+namespace gambatte {
+
+namespace {
+
+enum { code_size = 16 * 1024 * 1024 };
+enum { max_block_insns = 64 };
+// Upper bound on the code size of a block
+enum { max_block_size = 0x8000 };
+
+unsigned const untranslatable = ~0u;
+
+typedef Recompiler::Regs Regs;
+
+enum {
+	reg_cc  = offsetof(Regs, cycleCounter),
+	reg_net = offsetof(Regs, nextEventTime),
+	reg_link = offsetof(Regs, link),
+	reg_hf1 = offsetof(Regs, hf1),
+	reg_hf2 = offsetof(Regs, hf2),
+	reg_zf  = offsetof(Regs, zf),
+	reg_cf  = offsetof(Regs, cf),
+	reg_pc  = offsetof(Regs, pc),
+	reg_sp  = offsetof(Regs, sp),
+	reg_a   = offsetof(Regs, a),
+	reg_b   = offsetof(Regs, b),
+	reg_c   = offsetof(Regs, c),
+	reg_d   = offsetof(Regs, d),
+	reg_e   = offsetof(Regs, e),
+	reg_h   = offsetof(Regs, h),
+	reg_l   = offsetof(Regs, l),
+	// Register pairs
+	reg_bc  = reg_c,
+	reg_de  = reg_e,
+	reg_hl  = reg_l
+};
+
+// Registers as encoded in opcodes: b, c, d, e, h, l, (hl), a
+unsigned const reg8[8] = { reg_b, reg_c, reg_d, reg_e, reg_h, reg_l, 0, reg_a };
+// bc, de, hl, sp
+unsigned const reg16[4] = { reg_bc, reg_de, reg_hl, reg_sp };
+
+enum { hf2_hcf = 0x200, hf2_subf = 0x400, hf2_incf = 0x800 };
+
+// Slow paths, called by translated code with regs->cycleCounter up to
+// date. Memory accesses may change the time of the next event.
+
+unsigned readSlow(Regs *regs, unsigned p) {
+	unsigned const data = regs->mem->read(p, regs->cycleCounter);
+	regs->nextEventTime = regs->mem->nextEventTime();
+	return data;
+}
+
+// Writes return the ROM generation, to tell if ROM contents changed
+
+unsigned writeSlow(Regs *regs, unsigned p, unsigned data) {
+	regs->mem->write(p, data, regs->cycleCounter);
+	regs->nextEventTime = regs->mem->nextEventTime();
+	return regs->mem->romGeneration();
+}
+
+unsigned ffReadSlow(Regs *regs, unsigned p) {
+	unsigned const data = regs->mem->ff_read(p, regs->cycleCounter);
+	regs->nextEventTime = regs->mem->nextEventTime();
+	return data;
+}
+
+unsigned ffWriteSlow(Regs *regs, unsigned p, unsigned data) {
+	regs->mem->ff_write(p, data, regs->cycleCounter);
+	regs->nextEventTime = regs->mem->nextEventTime();
+	return regs->mem->romGeneration();
+}
+
+void di(Regs *regs) {
+	regs->mem->di();
+	regs->nextEventTime = regs->mem->nextEventTime();
+}
+
+void ei(Regs *regs) {
+	regs->mem->ei(regs->cycleCounter);
+	regs->nextEventTime = regs->mem->nextEventTime();
+}
+
+// As in cpu.cpp
+unsigned updateHf2FromHf1(unsigned const hf1, unsigned hf2) {
+	unsigned lhs  = hf1 & 0xF;
+	unsigned rhs = (hf2 & 0xF) + (hf2 >> 8 & 1);
+	if (hf2 & hf2_incf) {
+		lhs = rhs;
+		rhs = 1;
+	}
+
+	unsigned res = (hf2 & hf2_subf)
+	             ?  lhs - rhs
+	             : (lhs + rhs) << 5;
+
+	hf2 |= res & hf2_hcf;
+	return hf2;
+}
+
+// push af
+unsigned flagsToF(Regs *regs) {
+	unsigned const hf2 = regs->hf2 = updateHf2FromHf1(regs->hf1, regs->hf2);
+	return ((hf2 & (hf2_subf | hf2_hcf)) | (regs->cf & 0x100)) >> 4
+	     | ((regs->zf & 0xFF) ? 0 : 0x80);
+}
+
+void daa(Regs *regs) {
+	unsigned hf2 = updateHf2FromHf1(regs->hf1, regs->hf2);
+	unsigned a = regs->a;
+	unsigned correction = (regs->cf & 0x100) ? 0x60 : 0x00;
+
+	if (hf2 & hf2_hcf)
+		correction |= 0x06;
+
+	if (!(hf2 &= hf2_subf)) {
+		if ((a & 0x0F) > 0x09)
+			correction |= 0x06;
+		if (a > 0x99)
+			correction |= 0x60;
+
+		a += correction;
+	} else
+		a -= correction;
+
+	regs->hf2 = hf2;
+	regs->cf = correction << 2 & 0x100;
+	regs->zf = a;
+	regs->a = a & 0xFF;
+}
+
+enum { eax, ecx, edx, ebx, esp, ebp, esi, edi };
+enum { cond_b = 2, cond_ae = 3, cond_e = 4, cond_ne = 5 };
+enum { alu_add, alu_or, alu_adc, alu_sbb, alu_and, alu_sub, alu_xor, alu_cmp };
+
+// Just enough of an x86-64 assembler. Translated code keeps the Regs
+// pointer in rbx, the cycle counter at the start of the block in r12,
+// the read and write maps in r13 and r14, and a flag set by slow path
+// writes that remapped or changed the code being run in r15.
+class Emitter {
+public:
+	explicit Emitter(unsigned char *p) : p_(p) {}
+	unsigned char * pos() const { return p_; }
+
+	void byte(unsigned v) { *p_++ = v & 0xFF; }
+	void imm16(unsigned v) { byte(v); byte(v >> 8); }
+	void imm32(unsigned long v) { imm16(v & 0xFFFF); imm16(v >> 16 & 0xFFFF); }
+	void imm64(uint64_t v) { imm32(v & 0xFFFFFFFF); imm32(v >> 32); }
+
+	// [rbx + off]
+	void load8(int r, unsigned off) { byte(0x0F); byte(0xB6); regs(r, off); }
+	void load16(int r, unsigned off) { byte(0x0F); byte(0xB7); regs(r, off); }
+	void load32(int r, unsigned off) { byte(0x8B); regs(r, off); }
+	// al, cl or dl
+	void store8(int r, unsigned off) { byte(0x88); regs(r, off); }
+	void store16(int r, unsigned off) { byte(0x66); byte(0x89); regs(r, off); }
+	void store32(int r, unsigned off) { byte(0x89); regs(r, off); }
+	void store8i(unsigned off, unsigned v) { byte(0xC6); regs(0, off); byte(v); }
+	void store16i(unsigned off, unsigned v) { byte(0x66); byte(0xC7); regs(0, off); imm16(v); }
+	void store32i(unsigned off, unsigned long v) { byte(0xC7); regs(0, off); imm32(v); }
+	void inc16(unsigned off) { byte(0x66); byte(0xFF); regs(0, off); }
+	void dec16(unsigned off) { byte(0x66); byte(0xFF); regs(1, off); }
+	void test8i(unsigned off, unsigned v) { byte(0xF6); regs(0, off); byte(v); }
+
+	void movi(int r, unsigned long v) { byte(0xB8 + r); imm32(v); }
+	void mov(int dst, int src) { byte(0x89); byte(0xC0 | src << 3 | dst); }
+	void alu(int op, int dst, int src) { byte(op << 3 | 1); byte(0xC0 | src << 3 | dst); }
+
+	void alui(int op, int dst, unsigned long v) {
+		v &= 0xFFFFFFFF;
+		if (v < 0x80 || v >= 0xFFFFFF80) {
+			byte(0x83);
+			byte(0xC0 | op << 3 | dst);
+			byte(v);
+		} else {
+			byte(0x81);
+			byte(0xC0 | op << 3 | dst);
+			imm32(v);
+		}
+	}
+
+	void shl(int r, unsigned n) { byte(0xC1); byte(0xE0 | r); byte(n); }
+	void shr(int r, unsigned n) { byte(0xC1); byte(0xE8 | r); byte(n); }
+
+	// Short forward jumps, to be bound to their target
+	unsigned char * jcc8(int cond) { byte(0x70 | cond); byte(0); return p_; }
+	unsigned char * jmp8() { byte(0xEB); byte(0); return p_; }
+	void bind(unsigned char *jump) { jump[-1] = p_ - jump; }
+
+	void jmp(unsigned char const *target) {
+		byte(0xE9);
+		rel32(target);
+	}
+
+	void jcc(int cond, unsigned char const *target) {
+		byte(0x0F);
+		byte(0x80 | cond);
+		rel32(target);
+	}
+
+	// A jump to the next instruction, to be patched by link()
+	unsigned char * jmpLinkable() { byte(0xE9); imm32(0); return p_; }
+
+	static void link(unsigned char *jump, unsigned char const *target) {
+		Emitter e(jump - 4);
+		e.imm32(static_cast<unsigned long>(target - jump));
+	}
+
+	// regs->link = p
+	void setLink(unsigned char const *p) {
+		byte(0x48); byte(0x8D); byte(0x05); rel32(p);  // lea rax, [rip + p]
+		byte(0x48); byte(0x89); regs(eax, reg_link);
+	}
+
+	template<class F>
+	void call(F fn) {
+		// mov rax, fn; call rax
+		byte(0x48); byte(0xB8); imm64(reinterpret_cast<uintptr_t>(fn));
+		byte(0xFF); byte(0xD0);
+	}
+
+	void movRdiRbx() { byte(0x48); byte(0x89); byte(0xDF); }
+
+	// r = the cycle counter 'cycles' into the block (rax or rcx)
+	void leaCycles(int r, unsigned long cycles) {
+		byte(0x49); byte(0x8D); byte(0x84 | r << 3); byte(0x24); imm32(cycles);
+	}
+
+	// regs->cycleCounter = the cycle counter 'cycles' into the block
+	void syncCycles(int r, unsigned long cycles) {
+		leaCycles(r, cycles);
+		byte(0x48); byte(0x89); regs(r, reg_cc);
+	}
+
+	void addCycles(unsigned long cycles) {
+		if (cycles) {
+			byte(0x49); byte(0x81); byte(0xC4); imm32(cycles);
+		}
+	}
+
+	void prologue(void const *rmem, void const *wmem) {
+		byte(0x53);                             // push rbx
+		byte(0x41); byte(0x54);                 // push r12
+		byte(0x41); byte(0x55);                 // push r13
+		byte(0x41); byte(0x56);                 // push r14
+		byte(0x41); byte(0x57);                 // push r15
+		byte(0x48); byte(0x89); byte(0xFB);     // mov rbx, rdi
+		byte(0x4C); byte(0x8B); regs(4, reg_cc);  // mov r12, [rbx + cc]
+		byte(0x49); byte(0xBD); imm64(reinterpret_cast<uintptr_t>(rmem));
+		byte(0x49); byte(0xBE); imm64(reinterpret_cast<uintptr_t>(wmem));
+		byte(0x45); byte(0x31); byte(0xFF);     // xor r15d, r15d
+	}
+
+	void epilogue() {
+		byte(0x4C); byte(0x89); regs(4, reg_cc);  // mov [rbx + cc], r12
+		byte(0x41); byte(0x5F);
+		byte(0x41); byte(0x5E);
+		byte(0x41); byte(0x5D);
+		byte(0x41); byte(0x5C);
+		byte(0x5B);
+		byte(0xC3);
+	}
+
+	// rcx = map[eax >> 8], testing it for null
+	void lookupRead() {
+		shr(eax, 8);
+		byte(0x49); byte(0x8B); byte(0x4C); byte(0xC5); byte(0x00);  // mov rcx, [r13 + rax*8]
+		byte(0x48); byte(0x85); byte(0xC9);                          // test rcx, rcx
+	}
+
+	// rcx = map[ecx >> 8], testing it for null
+	void lookupWrite() {
+		shr(ecx, 8);
+		byte(0x49); byte(0x8B); byte(0x4C); byte(0xCE); byte(0x00);  // mov rcx, [r14 + rcx*8]
+		byte(0x48); byte(0x85); byte(0xC9);
+	}
+
+	void loadRcxRdx() { byte(0x0F); byte(0xB6); byte(0x04); byte(0x11); }  // movzx eax, byte [rcx + rdx]
+	void storeRcxRdx() { byte(0x88); byte(0x04); byte(0x11); }             // mov [rcx + rdx], al
+	void movRcx(void const *p) { byte(0x48); byte(0xB9); imm64(reinterpret_cast<uintptr_t>(p)); }
+	void movRax(void const *p) { byte(0x48); byte(0xB8); imm64(reinterpret_cast<uintptr_t>(p)); }
+	// cmp rax, [r13 + page*8]
+	void cmpRaxReadMap(unsigned page) { byte(0x49); byte(0x3B); byte(0x85); imm32(page * 8); }
+	void loadAbs(void const *p) { byte(0xA0); imm64(reinterpret_cast<uintptr_t>(p)); }   // mov al, [p]
+	void storeAbs(void const *p) { byte(0xA2); imm64(reinterpret_cast<uintptr_t>(p)); }  // mov [p], al
+	void movzxAl() { byte(0x0F); byte(0xB6); byte(0xC0); }
+	void setWriteFlag() { byte(0x41); byte(0xBF); imm32(1); }   // mov r15d, 1
+	void testWriteFlag() { byte(0x45); byte(0x85); byte(0xFF); }
+
+	// cmp rax, [rbx + nextEventTime]
+	void cmpNextEventTime() { byte(0x48); byte(0x3B); regs(eax, reg_net); }
+
+private:
+	unsigned char *p_;
+
+	void regs(int r, unsigned off) { byte(0x43 | r << 3); byte(off); }
+	void rel32(unsigned char const *target) { imm32(static_cast<unsigned long>(target - (p_ + 4))); }
+};
+
+struct Insn {
+	unsigned pc;
+	unsigned char const *bytes;
+	unsigned length;
+	// From the start of the block
+	unsigned long cycles;
+};
+
+// Returns the length of the instruction at 'p', or 0 if it has to be
+// interpreted. Sets 'cycles' to how long it takes, unless it is a branch
+// (which always ends a block).
+unsigned decode(unsigned char const *const p, unsigned &cycles, bool &branch) {
+	unsigned const op = p[0];
+
+	branch = false;
+
+	switch (op) {
+	case 0x10: case 0x76: case 0xD3: case 0xD9: case 0xDB: case 0xDD:
+	case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED:
+	case 0xF4: case 0xFC: case 0xFD:
+		return 0;
+
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+		branch = true;
+		return 2;
+	case 0xC2: case 0xC3: case 0xC4: case 0xCA: case 0xCC: case 0xCD:
+	case 0xD2: case 0xD4: case 0xDA: case 0xDC:
+		branch = true;
+		return 3;
+	case 0xC0: case 0xC7: case 0xC8: case 0xC9: case 0xCF:
+	case 0xD0: case 0xD7: case 0xD8: case 0xDF:
+	case 0xE7: case 0xE9: case 0xEF: case 0xF7: case 0xFF:
+		branch = true;
+		return 1;
+
+	case 0x00: cycles = 4; return 1;
+	case 0x08: cycles = 20; return 3;
+	case 0x34: case 0x35: cycles = 12; return 1;
+	case 0x36: cycles = 12; return 2;
+
+	case 0xCB:
+		cycles = (p[1] & 7) != 6 ? 8 : (p[1] & 0xC0) == 0x40 ? 12 : 16;
+		return 2;
+
+	case 0xC1: case 0xD1: case 0xE1: case 0xF1: cycles = 12; return 1;
+	case 0xC5: case 0xD5: case 0xE5: case 0xF5: cycles = 16; return 1;
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE:
+	case 0xE6: case 0xEE: case 0xF6: case 0xFE: cycles = 8; return 2;
+	case 0xE0: case 0xF0: cycles = 12; return 2;
+	case 0xE2: case 0xF2: cycles = 8; return 1;
+	case 0xE8: cycles = 16; return 2;
+	case 0xF8: cycles = 12; return 2;
+	case 0xEA: case 0xFA: cycles = 16; return 3;
+	case 0xF9: cycles = 8; return 1;
+	}
+
+	if (op >= 0x40) {
+		// ld r,r' and alu a,r
+		cycles = (op & 7) == 6 || (op < 0x80 && (op & 0x38) == 0x30) ? 8 : 4;
+		return 1;
+	}
+
+	switch (op & 7) {
+	case 1:
+		if (op & 8) {
+			cycles = 8;  // add hl,rr
+			return 1;
+		}
+
+		cycles = 12;  // ld rr,nn
+		return 3;
+	case 2: case 3: cycles = 8; return 1;
+	case 4: case 5: cycles = 4; return 1;
+	case 6: cycles = 8; return 2;
+	default: cycles = 4; return 1;
+	}
+}
+
+class Translator {
+public:
+	Translator(unsigned char *code, unsigned char const *epilogue, Memory &mem)
+	: e_(code)
+	, epilogue_(epilogue)
+	, mem_(mem)
+	, entry_(0)
+	, area_(0)
+	, region_(0)
+	, lastInsnCycles_(0)
+	, calls_(false)
+	, slowWrite_(false)
+	{
+	}
+
+	unsigned char * pos() const { return e_.pos(); }
+	unsigned char * entry() const { return entry_; }
+	void translate(Insn const *insns, unsigned n, bool branch, unsigned long endCycles);
+
+private:
+	Emitter e_;
+	unsigned char const *const epilogue_;
+	Memory &mem_;
+	unsigned char *entry_;
+	// Read map entry of the code, and its 16 KiB region
+	unsigned char const *area_;
+	unsigned region_;
+	unsigned long lastInsnCycles_;
+	// Whether the current instruction calls into Memory (which may move
+	// the next event), and whether that includes slow path writes (which
+	// may also remap memory)
+	bool calls_;
+	bool slowWrite_;
+
+	void insn(Insn const &in);
+	void cb(Insn const &in);
+	void branch(Insn const &in);
+
+	void exit(unsigned pc, unsigned long cycles) {
+		e_.store16i(reg_pc, pc);
+		exitTo(cycles);
+	}
+
+	// regs->pc set already
+	void exitTo(unsigned long cycles) {
+		e_.addCycles(cycles);
+		e_.jmp(epilogue_);
+	}
+
+	void exitLinkable(unsigned pc, unsigned long cycles);
+
+	void read(unsigned long cycles);
+	void write(unsigned long cycles);
+	void checkRemap();
+	void ffRead(unsigned long cycles);
+	void ffWrite(unsigned long cycles);
+	void ffReadConst(unsigned p, unsigned long cycles);
+	void ffWriteConst(unsigned p, unsigned long cycles);
+	void pushPrep();
+	void pushImm(unsigned pc, unsigned long cycles);
+	void pop(unsigned off, unsigned long cycles);
+	void shift(unsigned op);
+	void alu(unsigned op);
+	unsigned char * testCond(unsigned cond);
+};
+
+// An exit that gets linked to the block at pc. Only done within the
+// region, as the bank mapped to other regions may change in between.
+void Translator::exitLinkable(unsigned const pc, unsigned long const cycles) {
+	if (pc >> 14 != region_) {
+		exit(pc, cycles);
+		return;
+	}
+
+	if (slowWrite_) {
+		e_.testWriteFlag();
+		unsigned char *const noSlowWrite = e_.jcc8(cond_e);
+		exit(pc, cycles);
+		e_.bind(noSlowWrite);
+	}
+
+	e_.store16i(reg_pc, pc);
+	e_.addCycles(cycles);
+	unsigned char *const jump = e_.jmpLinkable();
+	e_.setLink(jump);
+	e_.jmp(epilogue_);
+}
+
+// Sets the r15 flag if the ROM generation returned in eax is not the
+// one the code was translated in, or another bank got mapped in its place
+void Translator::checkRemap() {
+	e_.alui(alu_cmp, eax, mem_.romGeneration());
+	unsigned char *const changed = e_.jcc8(cond_ne);
+	e_.movRax(area_);
+	e_.cmpRaxReadMap(region_ << 6);
+	unsigned char *const same = e_.jcc8(cond_e);
+	e_.bind(changed);
+	e_.setWriteFlag();
+	e_.bind(same);
+}
+
+// eax = [edx]
+void Translator::read(unsigned long const cycles) {
+	e_.mov(eax, edx);
+	e_.lookupRead();
+	unsigned char *const slow = e_.jcc8(cond_e);
+	e_.loadRcxRdx();
+	unsigned char *const done = e_.jmp8();
+	e_.bind(slow);
+	e_.syncCycles(eax, cycles);
+	e_.movRdiRbx();
+	e_.mov(esi, edx);
+	e_.call(readSlow);
+	e_.bind(done);
+	calls_ = true;
+}
+
+// [edx] = al
+void Translator::write(unsigned long const cycles) {
+	e_.mov(ecx, edx);
+	e_.lookupWrite();
+	unsigned char *const slow = e_.jcc8(cond_e);
+	e_.storeRcxRdx();
+	unsigned char *const done = e_.jmp8();
+	e_.bind(slow);
+	e_.syncCycles(ecx, cycles);
+	e_.movRdiRbx();
+	e_.mov(esi, edx);
+	e_.mov(edx, eax);
+	e_.call(writeSlow);
+	checkRemap();
+	e_.bind(done);
+	calls_ = slowWrite_ = true;
+}
+
+// eax = [0xFF00 + edx]
+void Translator::ffRead(unsigned long const cycles) {
+	e_.alui(alu_cmp, edx, 0x80);
+	unsigned char *const slow = e_.jcc8(cond_b);
+	e_.movRcx(mem_.ioamhram() + 0x100);
+	e_.loadRcxRdx();
+	unsigned char *const done = e_.jmp8();
+	e_.bind(slow);
+	e_.syncCycles(eax, cycles);
+	e_.movRdiRbx();
+	e_.mov(esi, edx);
+	e_.call(ffReadSlow);
+	e_.bind(done);
+	calls_ = true;
+}
+
+// [0xFF00 + edx] = al
+void Translator::ffWrite(unsigned long const cycles) {
+	e_.mov(ecx, edx);
+	e_.alui(alu_sub, ecx, 0x80);
+	e_.alui(alu_cmp, ecx, 0x7F);
+	unsigned char *const slow = e_.jcc8(cond_ae);
+	e_.movRcx(mem_.ioamhram() + 0x100);
+	e_.storeRcxRdx();
+	unsigned char *const done = e_.jmp8();
+	e_.bind(slow);
+	e_.syncCycles(ecx, cycles);
+	e_.movRdiRbx();
+	e_.mov(esi, edx);
+	e_.mov(edx, eax);
+	e_.call(ffWriteSlow);
+	checkRemap();
+	e_.bind(done);
+	calls_ = slowWrite_ = true;
+}
+
+void Translator::ffReadConst(unsigned const p, unsigned long const cycles) {
+	if (p >= 0x80) {
+		e_.loadAbs(mem_.ioamhram() + 0x100 + p);
+		e_.movzxAl();
+		return;
+	}
+
+	e_.syncCycles(eax, cycles);
+	e_.movRdiRbx();
+	e_.movi(esi, p);
+	e_.call(ffReadSlow);
+	calls_ = true;
+}
+
+void Translator::ffWriteConst(unsigned const p, unsigned long const cycles) {
+	if (p - 0x80u < 0x7Fu) {
+		e_.storeAbs(mem_.ioamhram() + 0x100 + p);
+		return;
+	}
+
+	e_.syncCycles(ecx, cycles);
+	e_.movRdiRbx();
+	e_.movi(esi, p);
+	e_.mov(edx, eax);
+	e_.call(ffWriteSlow);
+	checkRemap();
+	calls_ = slowWrite_ = true;
+}
+
+// a op= ecx, with the flags the way cpu.cpp computes them
+void Translator::alu(unsigned const op) {
+	switch (op) {
+	case 0: // add
+		e_.load8(eax, reg_a);
+		e_.store32(eax, reg_hf1);
+		e_.store32(ecx, reg_hf2);
+		e_.alu(alu_add, eax, ecx);
+		e_.store32(eax, reg_zf);
+		e_.store32(eax, reg_cf);
+		e_.store8(eax, reg_a);
+		break;
+	case 1: // adc
+		e_.load8(eax, reg_a);
+		e_.store32(eax, reg_hf1);
+		e_.load32(edx, reg_cf);
+		e_.alui(alu_and, edx, 0x100);
+		e_.alu(alu_or, edx, ecx);
+		e_.store32(edx, reg_hf2);
+		e_.shr(edx, 8);
+		e_.alu(alu_add, eax, ecx);
+		e_.alu(alu_add, eax, edx);
+		e_.store32(eax, reg_zf);
+		e_.store32(eax, reg_cf);
+		e_.store8(eax, reg_a);
+		break;
+	case 2: // sub
+	case 7: // cp
+		e_.load8(eax, reg_a);
+		e_.store32(eax, reg_hf1);
+		e_.mov(edx, ecx);
+		e_.alui(alu_or, edx, hf2_subf);
+		e_.store32(edx, reg_hf2);
+		e_.alu(alu_sub, eax, ecx);
+		e_.store32(eax, reg_zf);
+		e_.store32(eax, reg_cf);
+		if (op == 2)
+			e_.store8(eax, reg_a);
+		break;
+	case 3: // sbc
+		e_.load8(eax, reg_a);
+		e_.store32(eax, reg_hf1);
+		e_.load32(edx, reg_cf);
+		e_.alui(alu_and, edx, 0x100);
+		e_.alu(alu_or, edx, ecx);
+		e_.alui(alu_or, edx, hf2_subf);
+		e_.store32(edx, reg_hf2);
+		e_.shr(edx, 8);
+		e_.alui(alu_and, edx, 1);
+		e_.alu(alu_sub, eax, edx);
+		e_.alu(alu_sub, eax, ecx);
+		e_.store32(eax, reg_zf);
+		e_.store32(eax, reg_cf);
+		e_.store8(eax, reg_a);
+		break;
+	case 4: // and
+		e_.load8(eax, reg_a);
+		e_.alu(alu_and, eax, ecx);
+		e_.store8(eax, reg_a);
+		e_.store32(eax, reg_zf);
+		e_.store32i(reg_hf2, hf2_hcf);
+		e_.store32i(reg_cf, 0);
+		break;
+	case 5: // xor
+	case 6: // or
+		e_.load8(eax, reg_a);
+		e_.alu(op == 5 ? alu_xor : alu_or, eax, ecx);
+		e_.store8(eax, reg_a);
+		e_.store32(eax, reg_zf);
+		e_.store32i(reg_hf2, 0);
+		e_.store32i(reg_cf, 0);
+		break;
+	}
+}
+
+// Jumps if the condition (nz, z, nc, c) is false
+unsigned char * Translator::testCond(unsigned const cond) {
+	switch (cond) {
+	case 0: e_.test8i(reg_zf, 0xFF); return e_.jcc8(cond_e);
+	case 1: e_.test8i(reg_zf, 0xFF); return e_.jcc8(cond_ne);
+	case 2: e_.test8i(reg_cf + 1, 1); return e_.jcc8(cond_ne);
+	default: e_.test8i(reg_cf + 1, 1); return e_.jcc8(cond_e);
+	}
+}
+
+
+void Translator::pushPrep() {
+	e_.dec16(reg_sp);
+	e_.load16(edx, reg_sp);
+}
+
+// Pushes a return address, high byte at 'cycles', low byte 4 cycles later
+void Translator::pushImm(unsigned const pc, unsigned long const cycles) {
+	pushPrep();
+	e_.movi(eax, pc >> 8);
+	write(cycles);
+	pushPrep();
+	e_.movi(eax, pc & 0xFF);
+	write(cycles + 4);
+}
+
+// Pops into the register pair at 'off', low byte at 'cycles'
+void Translator::pop(unsigned const off, unsigned long const cycles) {
+	e_.load16(edx, reg_sp);
+	read(cycles);
+	e_.store8(eax, off);
+	e_.inc16(reg_sp);
+	e_.load16(edx, reg_sp);
+	read(cycles + 4);
+	e_.store8(eax, off + 1);
+	e_.inc16(reg_sp);
+}
+
+// Rotates and shifts (cb 00-3f) of eax, leaving the result in al
+void Translator::shift(unsigned const op) {
+	switch (op) {
+	case 0: // rlc
+		e_.shl(eax, 1);
+		e_.store32(eax, reg_cf);
+		e_.mov(ecx, eax);
+		e_.shr(ecx, 8);
+		e_.alu(alu_or, eax, ecx);
+		e_.store32(eax, reg_zf);
+		break;
+	case 1: // rrc
+		e_.store32(eax, reg_zf);
+		e_.mov(ecx, eax);
+		e_.shl(ecx, 8);
+		e_.store32(ecx, reg_cf);
+		e_.alu(alu_or, eax, ecx);
+		e_.shr(eax, 1);
+		break;
+	case 2: // rl
+		e_.load32(ecx, reg_cf);
+		e_.shr(ecx, 8);
+		e_.alui(alu_and, ecx, 1);
+		e_.shl(eax, 1);
+		e_.store32(eax, reg_cf);
+		e_.alu(alu_or, eax, ecx);
+		e_.store32(eax, reg_zf);
+		break;
+	case 3: // rr
+		e_.load32(ecx, reg_cf);
+		e_.alui(alu_and, ecx, 0x100);
+		e_.mov(esi, eax);
+		e_.shl(esi, 8);
+		e_.store32(esi, reg_cf);
+		e_.alu(alu_or, eax, ecx);
+		e_.shr(eax, 1);
+		e_.store32(eax, reg_zf);
+		break;
+	case 4: // sla
+		e_.shl(eax, 1);
+		e_.store32(eax, reg_cf);
+		e_.store32(eax, reg_zf);
+		break;
+	case 5: // sra
+		e_.mov(ecx, eax);
+		e_.shl(ecx, 8);
+		e_.store32(ecx, reg_cf);
+		e_.mov(ecx, eax);
+		e_.shr(ecx, 1);
+		e_.store32(ecx, reg_zf);
+		e_.alui(alu_and, eax, 0x80);
+		e_.alu(alu_or, eax, ecx);
+		break;
+	case 6: // swap
+		e_.store32(eax, reg_zf);
+		e_.mov(ecx, eax);
+		e_.shl(ecx, 4);
+		e_.shr(eax, 4);
+		e_.alu(alu_or, eax, ecx);
+		e_.store32i(reg_cf, 0);
+		break;
+	default: // srl
+		e_.mov(ecx, eax);
+		e_.shl(ecx, 8);
+		e_.store32(ecx, reg_cf);
+		e_.shr(eax, 1);
+		e_.store32(eax, reg_zf);
+		break;
+	}
+
+	e_.store32i(reg_hf2, 0);
+}
+
+void Translator::cb(Insn const &in) {
+	unsigned const op = in.bytes[1];
+	unsigned const r = op & 7;
+	unsigned const n = op >> 3 & 7;
+
+	if (r == 6) {
+		e_.load16(edx, reg_hl);
+		read(in.cycles + 8);
+	} else
+		e_.load8(eax, reg8[r]);
+
+	switch (op >> 6) {
+	case 0:
+		shift(n);
+		break;
+	case 1: // bit
+		e_.alui(alu_and, eax, 1 << n);
+		e_.store32(eax, reg_zf);
+		e_.store32i(reg_hf2, hf2_hcf);
+		return;
+	case 2: // res
+		e_.alui(alu_and, eax, ~(1u << n) & 0xFF);
+		break;
+	default: // set
+		e_.alui(alu_or, eax, 1 << n);
+		break;
+	}
+
+	if (r == 6) {
+		e_.load16(edx, reg_hl);
+		write(in.cycles + 12);
+	} else
+		e_.store8(eax, reg8[r]);
+}
+
+void Translator::insn(Insn const &in) {
+	unsigned const op = in.bytes[0];
+	unsigned const imm8 = in.bytes[1];
+	unsigned const imm16 = in.bytes[2] << 8 | in.bytes[1];
+	unsigned long const cycles = in.cycles;
+
+	if (op >= 0x40 && op < 0x80) {
+		unsigned const dst = op >> 3 & 7;
+		unsigned const src = op & 7;
+
+		if (src == 6) {
+			e_.load16(edx, reg_hl);
+			read(cycles + 4);
+			e_.store8(eax, reg8[dst]);
+		} else if (dst == 6) {
+			e_.load16(edx, reg_hl);
+			e_.load8(eax, reg8[src]);
+			write(cycles + 4);
+		} else if (dst != src) {
+			e_.load8(eax, reg8[src]);
+			e_.store8(eax, reg8[dst]);
+		}
+
+		return;
+	}
+
+	if (op >= 0x80 && op < 0xC0) {
+		if (op == 0x97) {
+			e_.store32i(reg_hf2, hf2_subf);
+			e_.store32i(reg_cf, 0);
+			e_.store32i(reg_zf, 0);
+			e_.store8i(reg_a, 0);
+		} else if (op == 0xBF) {
+			e_.store32i(reg_cf, 0);
+			e_.store32i(reg_zf, 0);
+			e_.store32i(reg_hf2, hf2_subf);
+		} else {
+			if ((op & 7) == 6) {
+				e_.load16(edx, reg_hl);
+				read(cycles + 4);
+				e_.mov(ecx, eax);
+			} else
+				e_.load8(ecx, reg8[op & 7]);
+
+			alu(op >> 3 & 7);
+		}
+
+		return;
+	}
+
+	switch (op) {
+	case 0x00:
+		break;
+	case 0x01: case 0x11: case 0x21: case 0x31:
+		e_.store16i(reg16[op >> 4], imm16);
+		break;
+	case 0x02: case 0x12:
+		e_.load16(edx, reg16[op >> 4]);
+		e_.load8(eax, reg_a);
+		write(cycles + 4);
+		break;
+	case 0x22: case 0x32:
+		e_.load16(edx, reg_hl);
+		e_.load8(eax, reg_a);
+		write(cycles + 4);
+
+		if (op == 0x22)
+			e_.inc16(reg_hl);
+		else
+			e_.dec16(reg_hl);
+
+		break;
+	case 0x0A: case 0x1A:
+		e_.load16(edx, reg16[op >> 4]);
+		read(cycles + 4);
+		e_.store8(eax, reg_a);
+		break;
+	case 0x2A: case 0x3A:
+		e_.load16(edx, reg_hl);
+		read(cycles + 4);
+		e_.store8(eax, reg_a);
+
+		if (op == 0x2A)
+			e_.inc16(reg_hl);
+		else
+			e_.dec16(reg_hl);
+
+		break;
+	case 0x03: case 0x13: case 0x23: case 0x33:
+		e_.inc16(reg16[op >> 4]);
+		break;
+	case 0x0B: case 0x1B: case 0x2B: case 0x3B:
+		e_.dec16(reg16[op >> 4]);
+		break;
+	case 0x04: case 0x0C: case 0x14: case 0x1C: case 0x24: case 0x2C: case 0x3C:
+	case 0x05: case 0x0D: case 0x15: case 0x1D: case 0x25: case 0x2D: case 0x3D:
+		e_.load8(eax, reg8[op >> 3]);
+		e_.mov(ecx, eax);
+		e_.alui(alu_or, ecx, op & 1 ? hf2_incf | hf2_subf : hf2_incf);
+		e_.store32(ecx, reg_hf2);
+		e_.alui(op & 1 ? alu_sub : alu_add, eax, 1);
+		e_.store32(eax, reg_zf);
+		e_.store8(eax, reg8[op >> 3]);
+		break;
+	case 0x34: case 0x35:
+		e_.load16(edx, reg_hl);
+		read(cycles + 4);
+		e_.mov(ecx, eax);
+		e_.alui(alu_or, ecx, op & 1 ? hf2_incf | hf2_subf : hf2_incf);
+		e_.store32(ecx, reg_hf2);
+		e_.alui(op & 1 ? alu_sub : alu_add, eax, 1);
+		e_.store32(eax, reg_zf);
+		e_.load16(edx, reg_hl);
+		write(cycles + 8);
+		break;
+	case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E:
+		e_.store8i(reg8[op >> 3], imm8);
+		break;
+	case 0x36:
+		e_.load16(edx, reg_hl);
+		e_.movi(eax, imm8);
+		write(cycles + 8);
+		break;
+	case 0x07: // rlca
+		e_.load8(eax, reg_a);
+		e_.shl(eax, 1);
+		e_.store32(eax, reg_cf);
+		e_.mov(ecx, eax);
+		e_.shr(ecx, 8);
+		e_.alu(alu_or, eax, ecx);
+		e_.store8(eax, reg_a);
+		e_.store32i(reg_hf2, 0);
+		e_.store32i(reg_zf, 1);
+		break;
+	case 0x0F: // rrca
+		e_.load8(eax, reg_a);
+		e_.mov(ecx, eax);
+		e_.shl(ecx, 8);
+		e_.alu(alu_or, ecx, eax);
+		e_.store32(ecx, reg_cf);
+		e_.shr(ecx, 1);
+		e_.store8(ecx, reg_a);
+		e_.store32i(reg_hf2, 0);
+		e_.store32i(reg_zf, 1);
+		break;
+	case 0x17: // rla
+		e_.load32(ecx, reg_cf);
+		e_.shr(ecx, 8);
+		e_.alui(alu_and, ecx, 1);
+		e_.load8(eax, reg_a);
+		e_.shl(eax, 1);
+		e_.store32(eax, reg_cf);
+		e_.alu(alu_or, eax, ecx);
+		e_.store8(eax, reg_a);
+		e_.store32i(reg_hf2, 0);
+		e_.store32i(reg_zf, 1);
+		break;
+	case 0x1F: // rra
+		e_.load32(ecx, reg_cf);
+		e_.alui(alu_and, ecx, 0x100);
+		e_.load8(eax, reg_a);
+		e_.mov(edx, eax);
+		e_.shl(edx, 8);
+		e_.store32(edx, reg_cf);
+		e_.alu(alu_or, eax, ecx);
+		e_.shr(eax, 1);
+		e_.store8(eax, reg_a);
+		e_.store32i(reg_hf2, 0);
+		e_.store32i(reg_zf, 1);
+		break;
+	case 0x08:
+		e_.movi(edx, imm16);
+		e_.load8(eax, reg_sp);
+		write(cycles + 12);
+		e_.movi(edx, (imm16 + 1) & 0xFFFF);
+		e_.load8(eax, reg_sp + 1);
+		write(cycles + 16);
+		break;
+	case 0x09: case 0x19: case 0x29:
+		// add hl,rr
+		e_.load8(eax, reg_l);
+		e_.load8(ecx, reg16[op >> 4]);
+		e_.load8(edx, reg16[op >> 4] + 1);
+		e_.alu(alu_add, eax, ecx);
+		e_.store8(eax, reg_l);
+		e_.load8(ecx, reg_h);
+		e_.store32(ecx, reg_hf1);
+		e_.mov(esi, eax);
+		e_.alui(alu_and, esi, 0x100);
+		e_.alu(alu_or, esi, edx);
+		e_.store32(esi, reg_hf2);
+		e_.shr(eax, 8);
+		e_.alu(alu_add, eax, edx);
+		e_.alu(alu_add, eax, ecx);
+		e_.store32(eax, reg_cf);
+		e_.store8(eax, reg_h);
+		break;
+	case 0x39:
+		// add hl,sp
+		e_.load8(eax, reg_l);
+		e_.load16(edx, reg_sp);
+		e_.alu(alu_add, eax, edx);
+		e_.store8(eax, reg_l);
+		e_.load8(ecx, reg_h);
+		e_.store32(ecx, reg_hf1);
+		e_.mov(esi, eax);
+		e_.alu(alu_xor, esi, edx);
+		e_.alui(alu_and, esi, 0x100);
+		e_.shr(edx, 8);
+		e_.alu(alu_or, esi, edx);
+		e_.store32(esi, reg_hf2);
+		e_.shr(eax, 8);
+		e_.alu(alu_add, eax, ecx);
+		e_.store32(eax, reg_cf);
+		e_.store8(eax, reg_h);
+		break;
+	case 0x27:
+		e_.movRdiRbx();
+		e_.call(daa);
+		break;
+	case 0x2F: // cpl
+		e_.store32i(reg_hf2, hf2_subf | hf2_hcf);
+		e_.load8(eax, reg_a);
+		e_.alui(alu_xor, eax, 0xFF);
+		e_.store8(eax, reg_a);
+		break;
+	case 0x37: // scf
+		e_.store32i(reg_cf, 0x100);
+		e_.store32i(reg_hf2, 0);
+		break;
+	case 0x3F: // ccf
+		e_.load32(eax, reg_cf);
+		e_.alui(alu_xor, eax, 0x100);
+		e_.store32(eax, reg_cf);
+		e_.store32i(reg_hf2, 0);
+		break;
+	case 0xC1: case 0xD1: case 0xE1:
+		pop(reg16[op >> 4 & 3], cycles + 4);
+		break;
+	case 0xF1:
+		e_.load16(edx, reg_sp);
+		read(cycles + 4);
+		e_.mov(ecx, eax);
+		e_.alui(alu_and, ecx, 0x80);
+		e_.alui(alu_xor, ecx, 0x80);
+		e_.store32(ecx, reg_zf);
+		e_.shl(eax, 4);
+		e_.mov(ecx, eax);
+		e_.alui(alu_and, ecx, hf2_subf | hf2_hcf);
+		e_.store32(ecx, reg_hf2);
+		e_.alui(alu_and, eax, 0x100);
+		e_.store32(eax, reg_cf);
+		e_.inc16(reg_sp);
+		e_.load16(edx, reg_sp);
+		read(cycles + 8);
+		e_.store8(eax, reg_a);
+		e_.inc16(reg_sp);
+		break;
+	case 0xC5: case 0xD5: case 0xE5:
+		pushPrep();
+		e_.load8(eax, reg16[op >> 4 & 3] + 1);
+		write(cycles + 4);
+		pushPrep();
+		e_.load8(eax, reg16[op >> 4 & 3]);
+		write(cycles + 8);
+		break;
+	case 0xF5:
+		pushPrep();
+		e_.load8(eax, reg_a);
+		write(cycles + 4);
+		e_.movRdiRbx();
+		e_.call(flagsToF);
+		pushPrep();
+		write(cycles + 8);
+		break;
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE:
+	case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+		e_.movi(ecx, imm8);
+		alu(op >> 3 & 7);
+		break;
+	case 0xCB:
+		cb(in);
+		break;
+	case 0xE0:
+		e_.load8(eax, reg_a);
+		ffWriteConst(imm8, cycles + 8);
+		break;
+	case 0xF0:
+		ffReadConst(imm8, cycles + 8);
+		e_.store8(eax, reg_a);
+		break;
+	case 0xE2:
+		e_.load8(edx, reg_c);
+		e_.load8(eax, reg_a);
+		ffWrite(cycles + 4);
+		break;
+	case 0xF2:
+		e_.load8(edx, reg_c);
+		ffRead(cycles + 4);
+		e_.store8(eax, reg_a);
+		break;
+	case 0xE8: case 0xF8:
+		// add sp,n; ld hl,sp+n
+		e_.load16(eax, reg_sp);
+		e_.mov(ecx, eax);
+		e_.alui(alu_add, ecx, (imm8 ^ 0x80) - 0x80);
+		e_.mov(edx, eax);
+		e_.alui(alu_xor, edx, (imm8 ^ 0x80) - 0x80);
+		e_.alu(alu_xor, edx, ecx);
+		e_.store32(edx, reg_cf);
+		e_.shl(edx, 5);
+		e_.alui(alu_and, edx, hf2_hcf);
+		e_.store32(edx, reg_hf2);
+		e_.store32i(reg_zf, 1);
+		e_.store16(ecx, op == 0xE8 ? reg_sp : reg_hl);
+		break;
+	case 0xEA:
+		e_.movi(edx, imm16);
+		e_.load8(eax, reg_a);
+		write(cycles + 12);
+		break;
+	case 0xFA:
+		e_.movi(edx, imm16);
+		read(cycles + 12);
+		e_.store8(eax, reg_a);
+		break;
+	case 0xF9:
+		e_.load16(eax, reg_hl);
+		e_.store16(eax, reg_sp);
+		break;
+	case 0xF3:
+		e_.movRdiRbx();
+		e_.call(di);
+		calls_ = true;
+		break;
+	case 0xFB:
+		e_.syncCycles(eax, cycles + 4);
+		e_.movRdiRbx();
+		e_.call(ei);
+		calls_ = true;
+		break;
+	}
+}
+
+void Translator::branch(Insn const &in) {
+	unsigned const op = in.bytes[0];
+	unsigned const next = (in.pc + in.length) & 0xFFFF;
+	unsigned const imm16 = in.bytes[2] << 8 | in.bytes[1];
+	unsigned const jr = (next + (in.bytes[1] ^ 0x80) - 0x80) & 0xFFFF;
+	unsigned const cond = op >> 3 & 3;
+	unsigned long const cycles = in.cycles;
+
+	switch (op) {
+	case 0x18:
+		exitLinkable(jr, cycles + 12);
+		break;
+	case 0x20: case 0x28: case 0x30: case 0x38:
+		{
+			unsigned char *const notTaken = testCond(cond);
+			exitLinkable(jr, cycles + 12);
+			e_.bind(notTaken);
+			exitLinkable(next, cycles + 8);
+		}
+		break;
+	case 0xC3:
+		exitLinkable(imm16, cycles + 16);
+		break;
+	case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+		{
+			unsigned char *const notTaken = testCond(cond);
+			exitLinkable(imm16, cycles + 16);
+			e_.bind(notTaken);
+			exitLinkable(next, cycles + 12);
+		}
+		break;
+	case 0xCD:
+		pushImm(next, cycles + 16);
+		exitLinkable(imm16, cycles + 24);
+		break;
+	case 0xC4: case 0xCC: case 0xD4: case 0xDC:
+		{
+			unsigned char *const taken = testCond(cond ^ 1);
+			exitLinkable(next, cycles + 12);
+			e_.bind(taken);
+			pushImm(next, cycles + 16);
+			exitLinkable(imm16, cycles + 24);
+		}
+		break;
+	case 0xC9:
+		pop(reg_pc, cycles + 4);
+		exitTo(cycles + 16);
+		break;
+	case 0xC0: case 0xC8: case 0xD0: case 0xD8:
+		{
+			unsigned char *const taken = testCond(cond ^ 1);
+			exitLinkable(next, cycles + 8);
+			e_.bind(taken);
+			pop(reg_pc, cycles + 8);
+			exitTo(cycles + 20);
+		}
+		break;
+	case 0xE9:
+		e_.load16(eax, reg_hl);
+		e_.store16(eax, reg_pc);
+		exitTo(cycles + 4);
+		break;
+	default: // rst
+		pushImm(next, cycles + 4);
+		exitLinkable(op & 0x38, cycles + 16);
+		break;
+	}
+}
+
+void Translator::translate(Insn const *const insns, unsigned const n, bool const endsInBranch,
+                           unsigned long const endCycles) {
+	lastInsnCycles_ = insns[n - 1].cycles;
+	region_ = insns[0].pc >> 14;
+	area_ = mem_.memPtrs().rmemTable()[region_ << 6];
+	e_.prologue(mem_.memPtrs().rmemTable(), mem_.memPtrs().wmemTable());
+	entry_ = e_.pos();
+	e_.leaCycles(eax, lastInsnCycles_);
+	e_.cmpNextEventTime();
+	e_.jcc(cond_ae, epilogue_);
+
+	for (unsigned i = 0; i < n; ++i) {
+		Insn const &in = insns[i];
+		unsigned const next = (in.pc + in.length) & 0xFFFF;
+
+		calls_ = slowWrite_ = false;
+
+		if (i == n - 1) {
+			if (endsInBranch) {
+				branch(in);
+			} else {
+				insn(in);
+				exitLinkable(next, endCycles);
+			}
+
+			break;
+		}
+
+		insn(in);
+
+		// Slow path writes may have switched banks (or disconnected ROM
+		// for OAM DMA), and calls may have moved the next event in front
+		// of the rest of the block
+		if (slowWrite_) {
+			e_.testWriteFlag();
+			unsigned char *const skip = e_.jcc8(cond_e);
+			exit(next, insns[i + 1].cycles);
+			e_.bind(skip);
+		}
+
+		if (calls_) {
+			e_.leaCycles(eax, lastInsnCycles_);
+			e_.cmpNextEventTime();
+			unsigned char *const skip = e_.jcc8(cond_b);
+			exit(next, insns[i + 1].cycles);
+			e_.bind(skip);
+		}
+	}
+}
+
+}
+
+Recompiler::Recompiler(Memory &mem)
+: mem_(mem)
+, code_(0)
+, codePos_(0)
+, epilogue_(0)
+, generation_(~0u)
+, enabled_(false)
+{
+	void *const code = mmap(0, code_size, PROT_READ | PROT_WRITE | PROT_EXEC,
+	                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED)
+		return;
+
+	code_ = epilogue_ = static_cast<unsigned char *>(code);
+	Emitter e(epilogue_);
+	e.epilogue();
+	codePos_ = e.pos();
+	enabled_ = true;
+}
+
+Recompiler::~Recompiler() {
+	for (std::size_t i = 0; i < pages_.size(); ++i)
+		delete[] pages_[i];
+
+	if (code_)
+		munmap(code_, code_size);
+}
+
+void Recompiler::setEnabled(bool enabled) {
+	enabled_ = enabled && code_;
+}
+
+void Recompiler::flush() {
+	MemPtrs const &memptrs = mem_.memPtrs();
+
+	for (std::size_t i = 0; i < pages_.size(); ++i)
+		delete[] pages_[i];
+
+	pages_.assign((memptrs.romdataend() - memptrs.romdata()) / 0x4000 * 2, 0);
+	blocks_.clear();
+	codePos_ = epilogue_;
+	Emitter e(codePos_);
+	e.epilogue();
+	codePos_ = e.pos();
+	generation_ = mem_.romGeneration();
+}
+
+Recompiler::Block const * Recompiler::romBlock(unsigned const pc,
+		unsigned long const cycleCounter, unsigned long const nextEventTime) {
+	if (generation_ != mem_.romGeneration() || code_ + code_size - codePos_ < max_block_size)
+		flush();
+
+	Block const *const b = find(pc);
+	return b && cycleCounter + b->lastInsnCycles < nextEventTime ? b : 0;
+}
+
+// Returns the block at pc, translating it if there is room left
+Recompiler::Block const * Recompiler::find(unsigned const pc) {
+	if (pc >= 0x8000 || generation_ != mem_.romGeneration())
+		return 0;
+
+	MemPtrs const &memptrs = mem_.memPtrs();
+	unsigned char const *const area = memptrs.rmemTable()[pc >> 8];
+	if (!area || area + pc < memptrs.romdata() || area + pc >= memptrs.romdataend())
+		return 0;
+
+	std::size_t const offset = area + pc - memptrs.romdata();
+	unsigned *&page = pages_[(offset >> 14) << 1 | pc >> 14];
+	if (!page)
+		page = new unsigned[0x4000]();
+
+	unsigned &index = page[pc & 0x3FFF];
+	if (!index) {
+		if (code_ + code_size - codePos_ < max_block_size)
+			return 0;
+
+		index = translate(pc);
+	}
+
+	return index != untranslatable ? &blocks_[index - 1] : 0;
+}
+
+unsigned Recompiler::translate(unsigned const pc) {
+	unsigned char const *const area = mem_.memPtrs().rmemTable()[pc >> 8];
+	unsigned const regionEnd = (pc | 0x3FFF) + 1;
+	Insn insns[max_block_insns];
+	unsigned n = 0;
+	unsigned long cycles = 0;
+	bool branch = false;
+
+	// Instructions (and the operands decode looks at) may not run past
+	// the 16 KiB region, as the next one may be mapped to another bank
+	for (unsigned p = pc; n < max_block_insns && !branch && regionEnd - p >= 3;) {
+		unsigned insnCycles = 0;
+		unsigned const length = decode(area + p, insnCycles, branch);
+		if (!length)
+			break;
+
+		insns[n].pc = p;
+		insns[n].bytes = area + p;
+		insns[n].length = length;
+		insns[n].cycles = cycles;
+		++n;
+		p += length;
+		cycles += insnCycles;
+	}
+
+	if (!n)
+		return untranslatable;
+
+	Translator t(codePos_, epilogue_, mem_);
+	Block block;
+	block.code = reinterpret_cast<void (*)(Regs *)>(codePos_);
+	block.lastInsnCycles = insns[n - 1].cycles;
+	t.translate(insns, n, branch, cycles);
+	block.entry = t.entry();
+	codePos_ = t.pos();
+	blocks_.push_back(block);
+	return blocks_.size();
+}
+
+void Recompiler::run(Regs &regs, Block const *block) {
+	regs.mem = &mem_;
+
+	do {
+		regs.nextEventTime = mem_.nextEventTime();
+		regs.link = 0;
+		block->code(&regs);
+
+		block = find(regs.pc);
+		if (block && regs.link)
+			Emitter::link(regs.link, block->entry);
+	} while (block && regs.cycleCounter + block->lastInsnCycles < mem_.nextEventTime());
+}
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef RECOMPILER_H
+#define RECOMPILER_H
+
+// The recompiler emits x86-64 code for the System V ABI
+#if defined(HAVE_JIT) && defined(__x86_64__) && !defined(_WIN32)
+#define GAMBATTE_JIT
+#endif
+
+#ifdef GAMBATTE_JIT
+
+#include <cstddef>
+#include <vector>
+
+namespace gambatte {
+
+class Memory;
+
+// Translates basic blocks of ROM code into x86-64 code, for CPU::process
+// to run instead of interpreting them.
+//
+// The translated code does exactly what the interpreter does, cycle for
+// cycle: it calls into Memory at the same cycle counts for every access
+// that doesn't take the fast path of Memory::read/write, and a block is
+// only entered when the interpreter would run all of it before the next
+// event. Instructions that need more than that (halt, stop, reti)
+// end blocks, and are left to the interpreter.
+//
+// Blocks are looked up by where their code is in ROM (bank and offset)
+// rather than by address, so bank switching needs no invalidation. They
+// are thrown away when the contents of ROM change. Exits to a fixed
+// address in the same 16 KiB region get linked directly to the block
+// there, which then only checks that it may run before the next event.
+class Recompiler {
+public:
+	// CPU state, as seen by translated code. Register pairs are laid out
+	// as little endian words.
+	struct Regs {
+		unsigned long cycleCounter;
+		unsigned long nextEventTime;
+		Memory *mem;
+		// Exit to link to the block at pc, once it is translated
+		unsigned char *link;
+		unsigned hf1, hf2, zf, cf;
+		unsigned short pc, sp;
+		unsigned char c, b, e, d, l, h, a;
+	};
+
+	struct Block {
+		void (*code)(Regs *regs);
+		// Where blocks linked to this one jump to, past the prologue
+		unsigned char *entry;
+		// Cycles from the start of the block to its last instruction
+		unsigned long lastInsnCycles;
+	};
+
+	explicit Recompiler(Memory &mem);
+	~Recompiler();
+
+	bool enabled() const { return enabled_; }
+	void setEnabled(bool enabled);
+
+	// Returns the block at pc, translating it if needed, or null if there
+	// is none or an event would be due before its last instruction
+	Block const * block(unsigned pc, unsigned long cycleCounter, unsigned long nextEventTime) {
+		// Only code in ROM gets translated
+		return pc < 0x8000 ? romBlock(pc, cycleCounter, nextEventTime) : 0;
+	}
+	// Runs 'block', then the blocks following it for as long as possible
+	void run(Regs &regs, Block const *block);
+
+private:
+	Memory &mem_;
+	unsigned char *code_;
+	unsigned char *codePos_;
+	unsigned char *epilogue_;
+	// Block indices plus one, by ROM bank and address half (blocks
+	// embed addresses, and a bank can be mapped to either half)
+	std::vector<unsigned *> pages_;
+	std::vector<Block> blocks_;
+	unsigned generation_;
+	bool enabled_;
+
+	void flush();
+	Block const * romBlock(unsigned pc, unsigned long cycleCounter, unsigned long nextEventTime);
+	Block const * find(unsigned pc);
+	unsigned translate(unsigned pc);
+
+	Recompiler(Recompiler const &);
+	Recompiler & operator=(Recompiler const &);
+};
+
+}
+
+#endif
+
+#endif
@@ -21,6 +21,14 @@
 #include <cstring>
 #include <algorithm>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PSG_SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PSG_SCAN_NEON
+#endif
+
 /*
 	Frame Sequencer
 
@@ -125,12 +133,85 @@ namespace gambatte
       lastUpdate_ = newCc - (oldCc - lastUpdate_);
    }
 
+#if defined(PSG_SCAN_SSE2)
+   /* Running sum of the n (a multiple of 8) samples at b, as in
+    * fillBuffer(). Each vector of 4 is summed by adding itself
+    * shifted by one, then two lanes; only adding the sum of the
+    * samples before the block is serial. The packed halves need
+    * no special care: plain 32-bit adds carry and borrow across
+    * them exactly as the scalar sum does */
+   static uint_least32_t scanBuffer(uint_least32_t *b, std::size_t n, uint_least32_t sum)
+   {
+      const __m128i bias = _mm_set1_epi32(0x8000);
+      __m128i carry      = _mm_set1_epi32((int)sum);
+
+      for (; n; n -= 8, b += 8)
+      {
+         __m128i lo = _mm_loadu_si128((const __m128i*)b);
+         __m128i hi = _mm_loadu_si128((const __m128i*)(b + 4));
+
+         lo    = _mm_add_epi32(lo, _mm_slli_si128(lo, 4));
+         hi    = _mm_add_epi32(hi, _mm_slli_si128(hi, 4));
+         lo    = _mm_add_epi32(lo, _mm_slli_si128(lo, 8));
+         hi    = _mm_add_epi32(hi, _mm_slli_si128(hi, 8));
+         hi    = _mm_add_epi32(hi, _mm_shuffle_epi32(lo, 0xFF));
+         lo    = _mm_add_epi32(lo, carry);
+         hi    = _mm_add_epi32(hi, carry);
+         carry = _mm_shuffle_epi32(hi, 0xFF);
+
+         _mm_storeu_si128((__m128i*)b, _mm_xor_si128(lo, bias));
+         _mm_storeu_si128((__m128i*)(b + 4), _mm_xor_si128(hi, bias));
+      }
+
+      return (uint_least32_t)_mm_cvtsi128_si32(carry);
+   }
+#elif defined(PSG_SCAN_NEON)
+   /* See the SSE2 version */
+   static uint_least32_t scanBuffer(uint_least32_t *buf, std::size_t n, uint_least32_t sum)
+   {
+      const uint32x4_t bias = vdupq_n_u32(0x8000);
+      const uint32x4_t zero = vdupq_n_u32(0);
+      uint32x4_t carry      = vdupq_n_u32(sum);
+      uint32_t *b           = reinterpret_cast<uint32_t*>(buf);
+
+      for (; n; n -= 8, b += 8)
+      {
+         uint32x4_t lo = vld1q_u32(b);
+         uint32x4_t hi = vld1q_u32(b + 4);
+
+         lo    = vaddq_u32(lo, vextq_u32(zero, lo, 3));
+         hi    = vaddq_u32(hi, vextq_u32(zero, hi, 3));
+         lo    = vaddq_u32(lo, vextq_u32(zero, lo, 2));
+         hi    = vaddq_u32(hi, vextq_u32(zero, hi, 2));
+         hi    = vaddq_u32(hi, vdupq_lane_u32(vget_high_u32(lo), 1));
+         lo    = vaddq_u32(lo, carry);
+         hi    = vaddq_u32(hi, carry);
+         carry = vdupq_lane_u32(vget_high_u32(hi), 1);
+
+         vst1q_u32(b, veorq_u32(lo, bias));
+         vst1q_u32(b + 4, veorq_u32(hi, bias));
+      }
+
+      return vgetq_lane_u32(carry, 0);
+   }
+#endif
+
    size_t PSG::fillBuffer()
    {
       uint_least32_t sum = rsum_;
       uint_least32_t *b = buffer_;
       unsigned n = bufferPos_;
 
+#if defined(PSG_SCAN_SSE2) || defined(PSG_SCAN_NEON)
+      if (sizeof(uint_least32_t) == 4)
+      {
+         const unsigned n8 = n & ~7u;
+
+         sum = scanBuffer(b, n8, sum);
+         b  += n8;
+         n  -= n8;
+      }
+#else
       if (unsigned n2 = n >> 3)
       {
          n -= n2 << 3;
@@ -157,6 +238,7 @@ namespace gambatte
             b += 8;
          } while (--n2);
       }
+#endif
 
       while (n--)
       {
@@ -32,66 +32,177 @@ static unsigned long toPeriod(unsigned const nr3) {
 	return r << s;
 }
 
+namespace {
+
+// The output bit sequences of the 15-bit and 7-bit LFSRs (periods 32767 and 127) as
+// packed bit tables, with the position of every register value in them. Each bit
+// shifted into the register reaches bit 0 after 14 (6) more shifts, so bits 0-14
+// (0-6) of the register at position pos are bits pos to pos + 14 (pos + 6) of the
+// sequence.
+class LfsrTables {
+public:
+	enum { period15 = 0x7FFF, period7 = 0x7F };
+
+	LfsrTables();
+	unsigned pos15(unsigned reg) const { return pos15_[reg & 0x7FFF]; }
+	unsigned pos7(unsigned reg) const { return pos7_[reg & 0x7F]; }
+	unsigned reg15(unsigned pos) const { return bits(bits15_, pos) & 0x7FFF; }
+
+	// After 8 or more shifts in 7-bit mode, bits 8-14 repeat bits 0-6, and bit 7
+	// holds the last bit shifted out
+	unsigned reg7(unsigned pos) const {
+		unsigned const b = bits(bits7_, pos) & 0xFF;
+		return (b >> 1) * 0x101 | (b & 1) << 7;
+	}
+
+	unsigned lowestBit(unsigned x) const {
+		return x & 0xFF ? lowestBit_[x & 0xFF] : 8 + lowestBit_[x >> 8 & 0xFF];
+	}
+
+private:
+	// Sized for reading 3 bytes at any position
+	unsigned char bits15_[(period15 + 24) / 8];
+	// Starts one bit before position 0, for the bit shifted out
+	unsigned char bits7_[(period7 + 24) / 8];
+	unsigned short pos15_[0x8000];
+	unsigned char pos7_[0x80];
+	unsigned char lowestBit_[0x100];
+
+	static unsigned bits(unsigned char const *table, unsigned pos) {
+		unsigned char const *const p = table + (pos >> 3);
+		return (p[0] | p[1] << 8 | p[2] << 16) >> (pos & 7);
+	}
+};
+
+LfsrTables::LfsrTables() {
+	std::fill(bits15_, bits15_ + sizeof bits15_, 0);
+	std::fill(bits7_, bits7_ + sizeof bits7_, 0);
+	pos15_[0] = 0;
+	pos7_[0] = 0;
+
+	unsigned reg = 0x7FFF;
+	for (unsigned i = 0; i < period15 + 15; ++i) {
+		if (i < period15)
+			pos15_[reg] = i;
+
+		bits15_[i >> 3] |= (reg & 1) << (i & 7);
+		reg = reg >> 1 | ((reg ^ reg >> 1) & 1) << 14;
+	}
+
+	reg = 0x7F;
+	for (unsigned i = 0; i < period7 + 8; ++i) {
+		if (i < period7)
+			pos7_[reg] = i;
+
+		bits7_[(i + 1) >> 3] |= (reg & 1) << ((i + 1) & 7);
+		reg = reg >> 1 | ((reg ^ reg >> 1) & 1) << 6;
+	}
+
+	bits7_[0] |= bits7_[period7 >> 3] >> (period7 & 7) & 1;
+
+	lowestBit_[0] = 8;
+	for (unsigned i = 1; i < 0x100; ++i) {
+		unsigned n = 0;
+		while (!(i >> n & 1))
+			++n;
+
+		lowestBit_[i] = n;
+	}
+}
+
+// Only looked up once channel 4 is triggered, which no static constructor does
+LfsrTables const lfsrTables;
+
+}
+
 namespace gambatte {
 
 Channel4::Lfsr::Lfsr()
 : backupCounter_(counter_disabled)
 , reg_(0x7FFF)
 , nr3_(0)
+, inc_(1)
 , master_(false)
+, enableEvents_(false)
 {
 }
 
+void Channel4::Lfsr::shift(unsigned long periods) {
+	if (nr3_ & 8) {
+		if (periods > 7) {
+			reg_ = reg_ & 0x7F
+			     ? lfsrTables.reg7((lfsrTables.pos7(reg_) + periods) % LfsrTables::period7)
+			     : 0;
+		} else {
+			while (periods > 6) {
+				unsigned const xored = (reg_ << 1 ^ reg_) & 0x7E;
+				reg_ = (reg_ >> 6 & ~0x7E) | xored | xored << 8;
+				periods -= 6;
+			}
+
+			unsigned const xored = ((reg_ ^ reg_ >> 1) << (7 - periods)) & 0x7F;
+			reg_ = (reg_ >> periods & ~(0x80 - (0x80 >> periods))) | xored | xored << 8;
+		}
+	} else if (periods > 14) {
+		reg_ = reg_
+		     ? lfsrTables.reg15((lfsrTables.pos15(reg_) + periods) % LfsrTables::period15)
+		     : 0;
+	} else
+		reg_ = reg_ >> periods | (((reg_ ^ reg_ >> 1) << (15 - periods)) & 0x7FFF);
+}
+
 void Channel4::Lfsr::updateBackupCounter(unsigned long const cc) {
 	if (backupCounter_ <= cc) {
 		unsigned long const period = toPeriod(nr3_);
 		unsigned long periods = (cc - backupCounter_) / period + 1;
 		backupCounter_ += periods * period;
 
-		if (master_ && nr3_ < 0xE0) {
-			if (nr3_ & 8) {
-				while (periods > 6) {
-					unsigned const xored = (reg_ << 1 ^ reg_) & 0x7E;
-					reg_ = (reg_ >> 6 & ~0x7E) | xored | xored << 8;
-					periods -= 6;
-				}
-
-				unsigned const xored = ((reg_ ^ reg_ >> 1) << (7 - periods)) & 0x7F;
-				reg_ = (reg_ >> periods & ~(0x80 - (0x80 >> periods))) | xored | xored << 8;
-			} else {
-				while (periods > 15) {
-					reg_ = reg_ ^ reg_ >> 1;
-					periods -= 15;
-				}
-
-				reg_ = reg_ >> periods | (((reg_ ^ reg_ >> 1) << (15 - periods)) & 0x7FFF);
-			}
-		}
+		if (master_ && nr3_ < 0xE0)
+			shift(periods);
 	}
 }
 
+inline void Channel4::Lfsr::setRun(unsigned long const period) {
+	// The next shifts output the bits of the register in order, so the output
+	// changes with the first one that differs from bit 0. Runs are cut at 6 (14)
+	// shifts, which event() does in one step.
+	unsigned const width = nr3_ & 8 ? 6 : 14;
+	inc_ = lfsrTables.lowestBit((reg_ ^ (0 - (reg_ & 1))) | 1u << width);
+	counter_ = backupCounter_ + (inc_ - 1) * period;
+}
+
+void Channel4::Lfsr::setCounter() {
+	if (enableEvents_ && master_ && nr3_ < 0xE0)
+		setRun(toPeriod(nr3_));
+	else
+		counter_ = counter_disabled;
+}
+
 void Channel4::Lfsr::reviveCounter(unsigned long cc) {
 	updateBackupCounter(cc);
-	counter_ = backupCounter_;
+	enableEvents_ = true;
+	setCounter();
 }
 
 inline void Channel4::Lfsr::event() {
-	if (nr3_ < 0xE0) {
-		unsigned const shifted = reg_ >> 1;
-		unsigned const xored = (reg_ ^ shifted) & 1;
-		reg_ = shifted | xored << 14;
-
-		if (nr3_ & 8)
-			reg_ = (reg_ & ~0x40) | xored << 6;
-	}
-
-	counter_ += toPeriod(nr3_);
-	backupCounter_ = counter_;
+	// Shifts through the run of unchanged output bits in one go
+	unsigned long const period = toPeriod(nr3_);
+	unsigned const n = inc_;
+
+	if (nr3_ & 8) {
+		unsigned const xored = ((reg_ ^ reg_ >> 1) << (7 - n)) & 0x7F;
+		reg_ = (reg_ >> n & ~(0x80 - (0x80 >> n))) | xored | xored << 8;
+	} else
+		reg_ = reg_ >> n | (((reg_ ^ reg_ >> 1) << (15 - n)) & 0x7FFF);
+
+	backupCounter_ = counter_ + period;
+	setRun(period);
 }
 
 void Channel4::Lfsr::nr3Change(unsigned newNr3, unsigned long cc) {
 	updateBackupCounter(cc);
 	nr3_ = newNr3;
+	setCounter();
 }
 
 void Channel4::Lfsr::nr4Init(unsigned long cc) {
@@ -99,7 +210,8 @@ void Channel4::Lfsr::nr4Init(unsigned long cc) {
 	updateBackupCounter(cc);
 	master_ = true;
 	backupCounter_ += 4;
-	counter_ = backupCounter_;
+	enableEvents_ = true;
+	setCounter();
 }
 
 void Channel4::Lfsr::reset(unsigned long cc) {
@@ -111,20 +223,23 @@ void Channel4::Lfsr::reset(unsigned long cc) {
 void Channel4::Lfsr::resetCounters(unsigned long oldCc) {
 	updateBackupCounter(oldCc);
 	backupCounter_ -= counter_max;
-	SoundUnit::resetCounters(oldCc);
+	setCounter();
 }
 
 void Channel4::Lfsr::saveState(SaveState &state, unsigned long cc) {
 	updateBackupCounter(cc);
+	setCounter();
 	state.spu.ch4.lfsr.counter = backupCounter_;
 	state.spu.ch4.lfsr.reg = reg_;
 }
 
 void Channel4::Lfsr::loadState(SaveState const &state) {
-	counter_ = backupCounter_ = std::max(state.spu.ch4.lfsr.counter, state.spu.cycleCounter);
+	backupCounter_ = std::max(state.spu.ch4.lfsr.counter, state.spu.cycleCounter);
 	reg_ = state.spu.ch4.lfsr.reg;
 	master_ = state.spu.ch4.master;
 	nr3_ = state.mem.ioamhram.get()[0x122];
+	enableEvents_ = true;
+	setCounter();
 }
 
 Channel4::Channel4()
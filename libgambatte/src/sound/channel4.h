@@ -55,16 +55,21 @@ private:
 		void reset(unsigned long cc);
 		void saveState(SaveState &state, unsigned long cc);
 		void loadState(SaveState const &state);
-		void disableMaster() { killCounter(); master_ = false; reg_ = 0x7FFF; }
-		void killCounter() { counter_ = counter_disabled; }
+		void disableMaster() { master_ = false; reg_ = 0x7FFF; killCounter(); }
+		void killCounter() { enableEvents_ = false; setCounter(); }
 		void reviveCounter(unsigned long cc);
 
 	private:
 		unsigned long backupCounter_;
 		unsigned short reg_;
 		unsigned char nr3_;
+		unsigned char inc_;
 		bool master_;
+		bool enableEvents_;
 
+		void setCounter();
+		void setRun(unsigned long period);
+		void shift(unsigned long periods);
 		void updateBackupCounter(unsigned long cc);
 	};
 
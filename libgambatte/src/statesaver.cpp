@@ -521,6 +521,48 @@ bool StateSaver::loadState(SaveState &state, const void *data) {
    return true;
 }
 
+const char * StateSaver::stateDiff(const void *a, const void *b, size_t size) {
+   const unsigned char *pa = static_cast<const unsigned char*>(a);
+   const unsigned char *pb = static_cast<const unsigned char*>(b);
+
+   if (size < 5)
+      return std::memcmp(pa, pb, size) ? "header" : 0;
+
+   // version, snapshot
+   size_t pos = 5 + (pa[2] << 16 | pa[3] << 8 | pa[4]);
+
+   if (pos > size || std::memcmp(pa, pb, pos))
+      return "header";
+
+   while (pos < size) {
+      const char *label = reinterpret_cast<const char*>(pa + pos);
+      size_t end = pos;
+
+      while (end < size && pa[end])
+         ++end;
+
+      // label, NUL, size (24 bits), data
+      end += 4;
+      if (end <= size)
+         end += pa[end - 3] << 16 | pa[end - 2] << 8 | pa[end - 1];
+      if (end > size)
+         end = size;
+
+      if (std::memcmp(pa + pos, pb + pos, end - pos)) {
+         for (SaverList::const_iterator it = list.begin(); it != list.end(); ++it) {
+            if (!std::strncmp(it->label, label, end - pos))
+               return it->label;
+         }
+
+         return "unknown";
+      }
+
+      pos = end;
+   }
+
+   return 0;
+}
+
 size_t StateSaver::stateSize(const SaveState &state) {
    omemstream file(0);
 
@@ -39,6 +39,7 @@ public:
    static void saveState(const SaveState &state, void *data);
    static bool loadState(SaveState &state, const void *data);
    static size_t stateSize(const SaveState &state);
+   static const char * stateDiff(const void *a, const void *b, size_t size);
 };
 
 }
@@ -29,6 +29,7 @@ void LCD::reset(const unsigned char *const oamram, unsigned char const *vram, co
 {
    ppu_.reset(oamram, vram, cgb);
    lycIrq_.setCgb(cgb);
+   invalidateRegCache();
    refreshPalettes();
 }
 
@@ -102,6 +103,7 @@ void LCD::loadState(const SaveState &state, const unsigned char *const oamram)
 
    ppu_.loadState(state, oamram);
    lycIrq_.loadState(state);
+   invalidateRegCache();
    m0Irq_.loadState(state);
 
    if (ppu_.lcdc() & 0x80)
@@ -619,9 +621,17 @@ void LCD::lycRegChange(const unsigned data, const unsigned long cc)
    }
 }
 
-unsigned LCD::getStat(const unsigned lycReg, const unsigned long cc)
+// Moves 'end' back to 'time' if that is the earlier one still to come
+static inline void clipWindow(unsigned long &end, const unsigned long time, const unsigned long cc)
+{
+   if (time > cc && time < end)
+      end = time;
+}
+
+unsigned LCD::readStat(const unsigned lycReg, const unsigned long cc)
 {
    unsigned stat = 0;
+   unsigned long end = static_cast<unsigned long>(-1);
 
    if (ppu_.lcdc() & 0x80)
    {
@@ -630,6 +640,7 @@ unsigned LCD::getStat(const unsigned lycReg, const unsigned long cc)
 
       int const timeToNextLy  = ppu_.lyCounter().time() - cc;
       unsigned is_doublespeed = (unsigned)isDoubleSpeed();
+      unsigned long const lyTime = ppu_.lyCounter().time();
 
       if (ppu_.lyCounter().ly() > 143)
       {
@@ -644,20 +655,75 @@ unsigned LCD::getStat(const unsigned lycReg, const unsigned long cc)
          {
             if (!ppu_.inactivePeriodAfterDisplayEnable(cc))
                stat = 2;
+            else
+               end = cc + 1;
+         }
+         else
+         {
+            unsigned long const m0Time = m0TimeOfCurrentLine(cc);
+
+            if (cc + is_doublespeed - ppu_.cgb() + 2 < m0Time)
+               stat = 3;
+
+            clipWindow(end, m0Time + ppu_.cgb() - is_doublespeed - 2, cc);
+            clipWindow(end, nextM0Time_.predictedNextM0Time(), cc);
          }
-         else if (cc + is_doublespeed - ppu_.cgb() + 2 < m0TimeOfCurrentLine(cc))
-            stat = 3;
+
+         // Mode 2 ends 80 cycles into the line
+         clipWindow(end, lyTime - (377 << is_doublespeed) + 1, cc);
       }
 
       LyCnt const lycCmp = getLycCmpLy(ppu_.lyCounter(), cc);
 
       if (lycReg == lycCmp.ly && lycCmp.timeToNextLy > 4 - is_doublespeed * 4)
          stat |= 4;
+
+      // Where the mode 1 and LYC match bits, and LY 153 as seen by
+      // the LYC match, change
+      clipWindow(end, lyTime - 4 + is_doublespeed * 4, cc);
+      clipWindow(end, lyTime - (448 << is_doublespeed), cc);
+      clipWindow(end, lyTime - (448 << is_doublespeed) - 4 + is_doublespeed * 4, cc);
+      clipWindow(end, eventTimes_.nextEventTime(), cc);
    }
 
+   statCache_.end = end;
+   statCache_.value = stat;
+   statCache_.lycReg = lycReg;
    return stat;
 }
 
+unsigned LCD::readLyReg(const unsigned long cc)
+{
+   unsigned lyReg = 0;
+   unsigned long end = static_cast<unsigned long>(-1);
+
+   if (ppu_.lcdc() & 0x80) {
+      if (cc >= ppu_.lyCounter().time())
+         update(cc);
+
+      unsigned long const lyTime = ppu_.lyCounter().time();
+      lyReg = ppu_.lyCounter().ly();
+      end = lyTime;
+
+      if (lyReg == 153) {
+         if (isDoubleSpeed()) {
+            if (lyTime - cc <= 456 * 2 - 8)
+               lyReg = 0;
+            else
+               end = lyTime - (456 * 2 - 8);
+         } else
+            lyReg = 0;
+      } else if (lyTime - cc <= 4)
+         ++lyReg;
+      else
+         end = lyTime - 4;
+   }
+
+   lyCache_.end = end;
+   lyCache_.value = lyReg;
+   return lyReg;
+}
+
 inline void LCD::doMode2IrqEvent()
 {
    const unsigned ly = eventTimes_(LY_COUNT) - eventTimes_(MODE2_IRQ) < 8
@@ -749,6 +815,8 @@ inline void LCD::event()
 
 void LCD::update(const unsigned long cycleCounter)
 {
+   invalidateRegCache();
+
    if (!(ppu_.lcdc() & 0x80))
       return;
 
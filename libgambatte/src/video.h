@@ -49,7 +49,7 @@ class LCD
       void saveState(SaveState &state) const;
       void loadState(const SaveState &state, const unsigned char *oamram);
       void setDmgPaletteColor(unsigned palNum, unsigned colorNum, video_pixel_t rgb32);
-      void setVideoBuffer(video_pixel_t *videoBuf, int pitch);
+      void setVideoBuffer(void *videoBuf, int pitch);
       void setDmgMode(bool mode) { ppu_.setDmgMode(mode); }
    
       void swapToDMG() {
@@ -114,28 +114,18 @@ class LCD
 
       void vramChange(const unsigned long cycleCounter) { update(cycleCounter); }
 
-      unsigned getStat(unsigned lycReg, unsigned long cycleCounter);
+      unsigned getStat(const unsigned lycReg, const unsigned long cycleCounter) {
+         if (cycleCounter < statCache_.end && lycReg == statCache_.lycReg)
+            return statCache_.value;
+
+         return readStat(lycReg, cycleCounter);
+      }
 
       unsigned getLyReg(const unsigned long cycleCounter) {
-         unsigned lyReg = 0;
-
-         if (ppu_.lcdc() & 0x80) {
-            if (cycleCounter >= ppu_.lyCounter().time())
-               update(cycleCounter);
-
-            lyReg = ppu_.lyCounter().ly();
-
-            if (lyReg == 153) {
-               if (isDoubleSpeed()) {
-                  if (ppu_.lyCounter().time() - cycleCounter <= 456 * 2 - 8)
-                     lyReg = 0;
-               } else
-                  lyReg = 0;
-            } else if (ppu_.lyCounter().time() - cycleCounter <= 4)
-               ++lyReg;
-         }
+         if (cycleCounter < lyCache_.end)
+            return lyCache_.value;
 
-         return lyReg;
+         return readLyReg(cycleCounter);
       }
 
       unsigned long nextMode1IrqTime() const { return eventTimes_(MODE1_IRQ); }
@@ -157,6 +147,7 @@ class LCD
       void setColorCorrectionMode(unsigned colorCorrectionMode);
       void setColorCorrectionBrightness(float colorCorrectionBrightness);
       void setDarkFilterLevel(unsigned darkFilterLevel);
+      void setPixelFormat(PixelFormat format);
       video_pixel_t gbcToRgb32(const unsigned bgr15);
    private:
       enum Event { MEM_EVENT, LY_COUNT }; enum { NUM_EVENTS = LY_COUNT + 1 };
@@ -211,8 +202,26 @@ class LCD
       unsigned char m2IrqStatReg_;
       unsigned char m1IrqStatReg_;
 
+      // Last value read from LY or STAT (mode and LYC match bits), and
+      // the cycle it holds until. Games poll these in tight loops, so the
+      // value is only worked out again once that cycle or a change to the
+      // LCD state (which always goes through update()) is reached.
+      struct RegCache {
+         unsigned long end;
+         unsigned value;
+         unsigned lycReg;
+      };
+
+      RegCache statCache_;
+      RegCache lyCache_;
+
+      void invalidateRegCache() { statCache_.end = lyCache_.end = 0; }
+      unsigned readStat(unsigned lycReg, unsigned long cycleCounter);
+      unsigned readLyReg(unsigned long cycleCounter);
+
       static void setDmgPalette(video_pixel_t *palette, const video_pixel_t *dmgColors, unsigned data);
       void setDmgPaletteColor(unsigned index, video_pixel_t rgb32);
+      void setDefaultDmgColors();
 
       void setDBuffer();
       void refreshPalettes();
@@ -231,6 +240,7 @@ class LCD
       unsigned colorCorrectionMode;
       float colorCorrectionBrightness;
       unsigned darkFilterLevel;
+      PixelFormat pixelFormat;
       void doCgbColorChange(unsigned char *const pdata,
             video_pixel_t *const palette, unsigned index, const unsigned data);
 
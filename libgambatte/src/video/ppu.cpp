@@ -58,11 +58,14 @@ static unsigned short const expand_lut[0x200] = {
 #undef EXPAND
 #undef PREP
 
+// Every state is instantiated for the DMG and for the CGB, so that the
+// per-pixel paths don't test the model. PPU::reset picks the set to run.
 #define DECLARE_FUNC(n, id) \
 	enum { ID##n = id }; \
-	static void f##n (PPUPriv &); \
-	static unsigned predictCyclesUntilXpos_f##n (PPUPriv const &, int targetxpos, unsigned cycles); \
-	static PPUState const f##n##_ = { f##n, predictCyclesUntilXpos_f##n, ID##n }
+	template<bool Cgb> static void f##n (PPUPriv &); \
+	template<bool Cgb> static unsigned predictCyclesUntilXpos_f##n (PPUPriv const &, int targetxpos, unsigned cycles); \
+	template<bool Cgb> struct f##n##_ { static PPUState const state; }; \
+	template<bool Cgb> PPUState const f##n##_<Cgb>::state = { f##n<Cgb>, predictCyclesUntilXpos_f##n<Cgb>, ID##n }
 
 namespace M2_Ly0    { DECLARE_FUNC(0, 0); }
 namespace M2_LyNon0 { DECLARE_FUNC(0, 0); DECLARE_FUNC(1, 0); }
@@ -111,6 +114,10 @@ static inline int weMasterCheckPriorToLyIncLineCycle(bool cgb) { return 450 - cg
 static inline int weMasterCheckAfterLyIncLineCycle(bool cgb) { return 454 - cgb; }
 static inline int m3StartLineCycle(bool /*cgb*/) { return 83; }
 
+// The DMG has no double speed mode, so its instantiations never check for it
+template<bool Cgb>
+static inline unsigned doubleSpeed(PPUPriv const &p) { return Cgb && p.lyCounter.isDoubleSpeed(); }
+
 static inline void nextCall(int const cycles, PPUState const &state, PPUPriv &p) {
 	int const c = p.cycles - cycles;
 	if (c >= 0) {
@@ -123,24 +130,27 @@ static inline void nextCall(int const cycles, PPUState const &state, PPUPriv &p)
 }
 
 namespace M2_Ly0 {
+	template<bool Cgb>
 	static void f0(PPUPriv &p) {
 		p.weMaster = lcdcWinEn(p) && 0 == p.wy;
 		p.winYPos = 0xFF;
-		nextCall(m3StartLineCycle(p.cgb), M3Start::f0_, p);
+		nextCall(m3StartLineCycle(Cgb), M3Start::f0_<Cgb>::state, p);
 	}
 }
 
 namespace M2_LyNon0 {
+	template<bool Cgb>
 	static void f0(PPUPriv &p) {
 		p.weMaster |= lcdcWinEn(p) && p.lyCounter.ly() == p.wy;
-		nextCall(   weMasterCheckAfterLyIncLineCycle(p.cgb)
-		          - weMasterCheckPriorToLyIncLineCycle(p.cgb), f1_, p);
+		nextCall(   weMasterCheckAfterLyIncLineCycle(Cgb)
+		          - weMasterCheckPriorToLyIncLineCycle(Cgb), f1_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f1(PPUPriv &p) {
 		p.weMaster |= lcdcWinEn(p) && p.lyCounter.ly() + 1 == p.wy;
-		nextCall(456 - weMasterCheckAfterLyIncLineCycle(p.cgb) + m3StartLineCycle(p.cgb),
-		         M3Start::f0_, p);
+		nextCall(456 - weMasterCheckAfterLyIncLineCycle(Cgb) + m3StartLineCycle(Cgb),
+		         M3Start::f0_<Cgb>::state, p);
 	}
 }
 
@@ -167,6 +177,7 @@ static int loadTileDataByte1(PPUPriv const &p) {
 }
 
 namespace M3Start {
+	template<bool Cgb>
 	static void f0(PPUPriv &p) {
 		p.xpos = 0;
 
@@ -177,10 +188,11 @@ namespace M3Start {
 		} else
 			p.winDrawState = 0;
 
-		p.nextCallPtr = &f1_;
-		f1(p);
+		p.nextCallPtr = &f1_<Cgb>::state;
+		f1<Cgb>(p);
 	}
 
+	template<bool Cgb>
 	static void f1(PPUPriv &p) {
 		while (p.xpos < max_m3start_cycles) {
 			if ((p.xpos & 7) == (p.scx & 7))
@@ -244,23 +256,24 @@ namespace M3Start {
 		p.endx = 8 - (p.scx & 7);
 
 		static PPUState const *const flut[8] = {
-			&M3Loop::Tile::f0_,
-			&M3Loop::Tile::f1_,
-			&M3Loop::Tile::f2_,
-			&M3Loop::Tile::f3_,
-			&M3Loop::Tile::f4_,
-			&M3Loop::Tile::f5_,
-			&M3Loop::Tile::f5_,
-			&M3Loop::Tile::f5_
+			&M3Loop::Tile::f0_<Cgb>::state,
+			&M3Loop::Tile::f1_<Cgb>::state,
+			&M3Loop::Tile::f2_<Cgb>::state,
+			&M3Loop::Tile::f3_<Cgb>::state,
+			&M3Loop::Tile::f4_<Cgb>::state,
+			&M3Loop::Tile::f5_<Cgb>::state,
+			&M3Loop::Tile::f5_<Cgb>::state,
+			&M3Loop::Tile::f5_<Cgb>::state
 		};
 
-		nextCall(1-p.cgb, *flut[p.scx & 7], p);
+		nextCall(1-Cgb, *flut[p.scx & 7], p);
 	}
 }
 
 namespace M3Loop {
 
-static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *const dbufline,
+template<class Pixel>
+static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, Pixel *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	unsigned const tileIndexSign = ~p.lcdc << 3 & 0x80;
 	unsigned char const *const tileDataLine = p.vram + tileIndexSign * 32 + tileline * 2;
@@ -321,8 +334,8 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 			p.cycles -= n;
 
 			unsigned ntileword = p.ntileword;
-			video_pixel_t *      dst    = dbufline + xpos - 8;
-			video_pixel_t *const dstend = dst + n;
+			Pixel *      dst    = dbufline + xpos - 8;
+			Pixel *const dstend = dst + n;
 			xpos += n;
 
 			if (!lcdcBgEn(p)) {
@@ -360,7 +373,7 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 		}
 
 		{
-			video_pixel_t *const dst = dbufline + (xpos - 8);
+			Pixel *const dst = dbufline + (xpos - 8);
 			unsigned const tileword = -(p.lcdc & 1U) & p.ntileword;
 
 			dst[0] = p.bgPalette[ tileword & 0x0003       ];
@@ -393,7 +406,7 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 					unsigned const attrib = p.spriteList[i].attrib;
 					unsigned spword       = p.spwordList[i];
 					video_pixel_t const *const spPalette = p.spPalette + (attrib >> 2 & 4);
-					video_pixel_t *d = dst + pos;
+					Pixel *d = dst + pos;
 
 					if (!(attrib & attr_bgpriority)) {
 						switch (n) {
@@ -452,7 +465,8 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, video_pixel_t *co
 	p.xpos = xpos;
 }
 
-static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *const dbufline,
+template<class Pixel>
+static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, Pixel *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	int xpos = p.xpos;
 	unsigned char const *const vram = p.vram;
@@ -504,8 +518,8 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 
 			unsigned ntileword = p.ntileword;
 			unsigned nattrib   = p.nattrib;
-			video_pixel_t *      dst    = dbufline + xpos - 8;
-			video_pixel_t *const dstend = dst + n;
+			Pixel *      dst    = dbufline + xpos - 8;
+			Pixel *const dstend = dst + n;
 			xpos += n;
 
 			do {
@@ -545,7 +559,7 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 		}
 
 		{
-			video_pixel_t *const dst = dbufline + (xpos - 8);
+			Pixel *const dst = dbufline + (xpos - 8);
 			unsigned const tileword = p.ntileword;
 			unsigned const attrib   = p.nattrib;
 			video_pixel_t const *const bgPalette = p.bgPalette + (attrib & 7) * 4;
@@ -592,7 +606,7 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 
 					if (!((attrib | sattrib) & bgprioritymask)) {
 						unsigned char  *const idt = idtab + pos;
-						video_pixel_t *const   d =   dst + pos;
+						Pixel *const   d =   dst + pos;
 
 						switch (n) {
 						case 8: if ((spword >> 14    ) && id < idt[7]) {
@@ -683,6 +697,7 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, video_pixel_t *co
 	p.xpos = xpos;
 }
 
+template<bool Cgb, class Pixel>
 static void doFullTilesUnrolled(PPUPriv &p) {
 	int xpos = p.xpos;
 	int const xend = static_cast<int>(p.wx) < xpos || p.wx >= 168
@@ -691,7 +706,7 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 	if (xpos >= xend)
 		return;
 
-	video_pixel_t *const dbufline = p.framebuf.fbline();
+	Pixel *const dbufline = p.framebuf.fbline<Pixel>();
 	unsigned char const *tileMapLine;
 	unsigned tileline;
 	unsigned tileMapXpos;
@@ -704,14 +719,14 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 	} else {
 		tileMapLine = p.vram + (p.lcdc << 7 & 0x400)
 		                     + ((p.scy + p.lyCounter.ly()) & 0xF8) * 4 + 0x1800;
-		tileMapXpos = (p.scx + xpos + 1 - p.cgb) >> 3;
+		tileMapXpos = (p.scx + xpos + 1 - Cgb) >> 3;
 		tileline    = (p.scy + p.lyCounter.ly()) & 7;
 	}
 
 	if (xpos < 8) {
-		video_pixel_t prebuf[16];
+		Pixel prebuf[16];
 
-		if (p.cgb) {
+		if (Cgb) {
 			doFullTilesUnrolledCgb(p, xend < 8 ? xend : 8, prebuf + (8 - xpos),
 			                       tileMapLine, tileline, tileMapXpos);
 		} else {
@@ -732,16 +747,24 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 		tileMapXpos += (newxpos - xpos) >> 3;
 	}
 
-	if (p.cgb) {
+	if (Cgb) {
 		doFullTilesUnrolledCgb(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
 	} else
 		doFullTilesUnrolledDmg(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
 }
 
+template<bool Cgb>
+static void doFullTiles(PPUPriv &p) {
+	if (p.framebuf.wide())
+		doFullTilesUnrolled<Cgb, PixelXrgb8888::pixel_t>(p);
+	else
+		doFullTilesUnrolled<Cgb, PixelRgb565::pixel_t>(p);
+}
+
+template<bool Cgb>
 static void plotPixel(PPUPriv &p) {
 	int const xpos = p.xpos;
 	unsigned const tileword = p.tileword;
-	video_pixel_t *const fbline = p.framebuf.fbline();
 
 	if (static_cast<int>(p.wx) == xpos
 			&& (p.weMaster || (p.wy2 == p.lyCounter.ly() && lcdcWinEn(p)))
@@ -749,11 +772,11 @@ static void plotPixel(PPUPriv &p) {
 		if (p.winDrawState == 0 && lcdcWinEn(p)) {
 			p.winDrawState = win_draw_start | win_draw_started;
 			++p.winYPos;
-		} else if (!p.cgb && (p.winDrawState == 0 || xpos == 166))
+		} else if (!Cgb && (p.winDrawState == 0 || xpos == 166))
 			p.winDrawState |= win_draw_start;
 	}
 
-	unsigned const twdata = tileword & ((p.lcdc & 1) | p.cgb) * 3;
+	unsigned const twdata = tileword & ((p.lcdc & 1) | Cgb) * 3;
 	video_pixel_t pixel = p.bgPalette[twdata + (p.attrib & 7) * 4];
 	int i = static_cast<int>(p.nextSprite) - 1;
 
@@ -761,7 +784,7 @@ static void plotPixel(PPUPriv &p) {
 		unsigned spdata = 0;
 		unsigned attrib = 0;
 
-		if (p.cgb) {
+		if (Cgb) {
 			unsigned minId = 0xFF;
 
 			do {
@@ -799,52 +822,56 @@ static void plotPixel(PPUPriv &p) {
 	}
 
 	if (xpos - 8 >= 0)
-		fbline[xpos - 8] = pixel;
+		p.framebuf.setPixel(xpos - 8, pixel);
 
 	p.xpos = xpos + 1;
 	p.tileword = tileword >> 2;
 }
 
+template<bool Cgb>
 static void plotPixelIfNoSprite(PPUPriv &p) {
 	if (p.spriteList[p.nextSprite].spx == p.xpos) {
-		if (!(lcdcObjEn(p) | p.cgb)) {
+		if (!(lcdcObjEn(p) | Cgb)) {
 			do {
 				++p.nextSprite;
 			} while (p.spriteList[p.nextSprite].spx == p.xpos);
 
-			plotPixel(p);
+			plotPixel<Cgb>(p);
 		}
 	} else
-		plotPixel(p);
+		plotPixel<Cgb>(p);
 }
 
+template<bool Cgb>
 static unsigned long nextM2Time(PPUPriv const &p)
 {
-   unsigned is_doublespeed = (unsigned)p.lyCounter.isDoubleSpeed();
+   unsigned is_doublespeed = doubleSpeed<Cgb>(p);
 	unsigned long nextm2    = (bool)is_doublespeed
 		? p.lyCounter.time() + (weMasterCheckPriorToLyIncLineCycle(true ) + m2_ds_offset) * 2 - 456 * 2
-		: p.lyCounter.time() +  weMasterCheckPriorToLyIncLineCycle(p.cgb)                     - 456    ;
+		: p.lyCounter.time() +  weMasterCheckPriorToLyIncLineCycle(Cgb)                     - 456    ;
 	if (p.lyCounter.ly() == 143)
-		nextm2 += (456 * 10 + 456 - weMasterCheckPriorToLyIncLineCycle(p.cgb)) << is_doublespeed;
+		nextm2 += (456 * 10 + 456 - weMasterCheckPriorToLyIncLineCycle(Cgb)) << is_doublespeed;
 
 	return nextm2;
 }
 
+template<bool Cgb>
 static void xpos168(PPUPriv &p) {
-   unsigned is_doublespeed    = (unsigned)p.lyCounter.isDoubleSpeed();
+   unsigned is_doublespeed    = doubleSpeed<Cgb>(p);
 	p.lastM0Time               = p.now - (p.cycles << is_doublespeed);
 
-	unsigned long const nextm2 = nextM2Time(p);
+	unsigned long const nextm2 = nextM2Time<Cgb>(p);
 
 	p.cycles = p.now >= nextm2
 		?  long((p.now - nextm2) >> is_doublespeed)
 		: -long((nextm2 - p.now) >> is_doublespeed);
 
-	nextCall(0, p.lyCounter.ly() == 143 ? M2_Ly0::f0_ : M2_LyNon0::f0_, p);
+	nextCall(0, p.lyCounter.ly() == 143 ? M2_Ly0::f0_<Cgb>::state : M2_LyNon0::f0_<Cgb>::state, p);
 }
 
+template<bool Cgb>
 static bool handleWinDrawStartReq(PPUPriv const &p, int const xpos, unsigned char &winDrawState) {
-	bool const startWinDraw = (xpos < 167 || p.cgb)
+	bool const startWinDraw = (xpos < 167 || Cgb)
 	                       && (winDrawState &= win_draw_started);
 	if (!lcdcWinEn(p))
 		winDrawState &= ~win_draw_started;
@@ -852,20 +879,22 @@ static bool handleWinDrawStartReq(PPUPriv const &p, int const xpos, unsigned cha
 	return startWinDraw;
 }
 
+template<bool Cgb>
 static bool handleWinDrawStartReq(PPUPriv &p) {
-	return handleWinDrawStartReq(p, p.xpos, p.winDrawState);
+	return handleWinDrawStartReq<Cgb>(p, p.xpos, p.winDrawState);
 }
 
 namespace StartWindowDraw {
+	template<bool Cgb>
 	static void inc(PPUState const &nextf, PPUPriv &p) {
-		if (!lcdcWinEn(p) && p.cgb) {
-			plotPixelIfNoSprite(p);
+		if (!lcdcWinEn(p) && Cgb) {
+			plotPixelIfNoSprite<Cgb>(p);
 
 			if (p.xpos == p.endx) {
 				if (p.xpos < 168) {
-					nextCall(1, Tile::f0_, p);
+					nextCall(1, Tile::f0_<Cgb>::state, p);
 				} else
-					xpos168(p);
+					xpos168<Cgb>(p);
 
 				return;
 			}
@@ -874,6 +903,7 @@ namespace StartWindowDraw {
 		nextCall(1, nextf, p);
 	}
 
+	template<bool Cgb>
 	static void f0(PPUPriv &p) {
 		if (p.xpos == p.endx) {
 			p.tileword = p.ntileword;
@@ -895,101 +925,113 @@ namespace StartWindowDraw {
 			                 + ((p.scy + p.lyCounter.ly()) & 0xF8) * 4 + 0x3800];
 		}
 
-		inc(f1_, p);
+		inc<Cgb>(f1_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f1(PPUPriv &p) {
-		inc(f2_, p);
+		inc<Cgb>(f2_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f2(PPUPriv &p) {
 		p.reg0 = loadTileDataByte0(p);
-		inc(f3_, p);
+		inc<Cgb>(f3_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f3(PPUPriv &p) {
-		inc(f4_, p);
+		inc<Cgb>(f4_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f4(PPUPriv &p) {
 		int const r1 = loadTileDataByte1(p);
 
 		p.ntileword = (expand_lut + (p.nattrib << 3 & 0x100))[p.reg0]
 		            + (expand_lut + (p.nattrib << 3 & 0x100))[r1    ] * 2;
 
-		inc(f5_, p);
+		inc<Cgb>(f5_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f5(PPUPriv &p) {
-		inc(Tile::f0_, p);
+		inc<Cgb>(Tile::f0_<Cgb>::state, p);
 	}
 }
 
 namespace LoadSprites {
+	template<bool Cgb>
 	static void inc(PPUState const &nextf, PPUPriv &p) {
-		plotPixelIfNoSprite(p);
+		plotPixelIfNoSprite<Cgb>(p);
 
 		if (p.xpos == p.endx) {
 			if (p.xpos < 168) {
-				nextCall(1, Tile::f0_, p);
+				nextCall(1, Tile::f0_<Cgb>::state, p);
 			} else
-				xpos168(p);
+				xpos168<Cgb>(p);
 		} else
 			nextCall(1, nextf, p);
 	}
 
+	template<bool Cgb>
 	static void f0(PPUPriv &p) {
 		p.reg1 = p.spriteMapper.oamram()[p.spriteList[p.currentSprite].oampos + 2];
-		nextCall(1, f1_, p);
+		nextCall(1, f1_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f1(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
 		p.spriteList[p.currentSprite].attrib =
 			p.spriteMapper.oamram()[p.spriteList[p.currentSprite].oampos + 3];
-		inc(f2_, p);
+		inc<Cgb>(f2_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f2(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
 		unsigned const spline =
 			(  (p.spriteList[p.currentSprite].attrib & attr_yflip)
 			 ? p.spriteList[p.currentSprite].line ^ 15
 			 : p.spriteList[p.currentSprite].line         ) * 2;
-		p.reg0 = p.vram[(p.spriteList[p.currentSprite].attrib << 10 & p.cgb * 0x2000)
+		p.reg0 = p.vram[(p.spriteList[p.currentSprite].attrib << 10 & Cgb * 0x2000)
 		              + (lcdcObj2x(p) ? (p.reg1 * 16 & ~16) | spline : p.reg1 * 16 | (spline & ~16))];
-		inc(f3_, p);
+		inc<Cgb>(f3_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f3(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
-		inc(f4_, p);
+		inc<Cgb>(f4_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f4(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
 		unsigned const spline =
 			(  (p.spriteList[p.currentSprite].attrib & attr_yflip)
 			 ? p.spriteList[p.currentSprite].line ^ 15
 			 : p.spriteList[p.currentSprite].line         ) * 2;
-		p.reg1 = p.vram[(p.spriteList[p.currentSprite].attrib << 10 & p.cgb * 0x2000)
+		p.reg1 = p.vram[(p.spriteList[p.currentSprite].attrib << 10 & Cgb * 0x2000)
 		              + (lcdcObj2x(p) ? (p.reg1 * 16 & ~16) | spline : p.reg1 * 16 | (spline & ~16)) + 1];
-		inc(f5_, p);
+		inc<Cgb>(f5_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f5(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
-		plotPixelIfNoSprite(p);
+		plotPixelIfNoSprite<Cgb>(p);
 
 		unsigned entry = p.currentSprite;
 
@@ -1006,35 +1048,37 @@ namespace LoadSprites {
 
 		if (p.xpos == p.endx) {
 			if (p.xpos < 168) {
-				nextCall(1, Tile::f0_, p);
+				nextCall(1, Tile::f0_<Cgb>::state, p);
 			} else
-				xpos168(p);
+				xpos168<Cgb>(p);
 		} else {
-			p.nextCallPtr = &Tile::f5_;
-			nextCall(1, Tile::f5_, p);
+			p.nextCallPtr = &Tile::f5_<Cgb>::state;
+			nextCall(1, Tile::f5_<Cgb>::state, p);
 		}
 	}
 }
 
 namespace Tile {
+	template<bool Cgb>
 	static void inc(PPUState const &nextf, PPUPriv &p) {
-		plotPixelIfNoSprite(p);
+		plotPixelIfNoSprite<Cgb>(p);
 
 		if (p.xpos == 168) {
-			xpos168(p);
+			xpos168<Cgb>(p);
 		} else
 			nextCall(1, nextf, p);
 	}
 
+	template<bool Cgb>
 	static void f0(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
-		doFullTilesUnrolled(p);
+		doFullTiles<Cgb>(p);
 
 		if (p.xpos == 168) {
 			++p.cycles;
-			return xpos168(p);
+			return xpos168<Cgb>(p);
 		}
 
 		p.tileword = p.ntileword;
@@ -1049,66 +1093,71 @@ namespace Tile {
 			                 + (p.winYPos & 0xF8) * 4
 			                 + ((p.xpos + p.wscx) >> 3 & 0x1F) + 0x3800];
 		} else {
-			p.reg1    = p.vram[((p.lcdc << 7 | (p.scx + p.xpos + 1 - p.cgb) >> 3) & 0x41F)
+			p.reg1    = p.vram[((p.lcdc << 7 | (p.scx + p.xpos + 1 - Cgb) >> 3) & 0x41F)
 			                 + ((p.scy + p.lyCounter.ly()) & 0xF8) * 4 + 0x1800];
-			p.nattrib = p.vram[((p.lcdc << 7 | (p.scx + p.xpos + 1 - p.cgb) >> 3) & 0x41F)
+			p.nattrib = p.vram[((p.lcdc << 7 | (p.scx + p.xpos + 1 - Cgb) >> 3) & 0x41F)
 			                 + ((p.scy + p.lyCounter.ly()) & 0xF8) * 4 + 0x3800];
 		}
 
-		inc(f1_, p);
+		inc<Cgb>(f1_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f1(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
-		inc(f2_, p);
+		inc<Cgb>(f2_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f2(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
 		p.reg0 = loadTileDataByte0(p);
-		inc(f3_, p);
+		inc<Cgb>(f3_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f3(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
-		inc(f4_, p);
+		inc<Cgb>(f4_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f4(PPUPriv &p) {
-		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-			return StartWindowDraw::f0(p);
+		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+			return StartWindowDraw::f0<Cgb>(p);
 
 		int const r1 = loadTileDataByte1(p);
 
 		p.ntileword = (expand_lut + (p.nattrib << 3 & 0x100))[p.reg0]
 		            + (expand_lut + (p.nattrib << 3 & 0x100))[r1    ] * 2;
 
-		plotPixelIfNoSprite(p);
+		plotPixelIfNoSprite<Cgb>(p);
 
 		if (p.xpos == 168) {
-			xpos168(p);
+			xpos168<Cgb>(p);
 		} else
-			nextCall(1, f5_, p);
+			nextCall(1, f5_<Cgb>::state, p);
 	}
 
+	template<bool Cgb>
 	static void f5(PPUPriv &p) {
 		int endx = p.endx;
-		p.nextCallPtr = &f5_;
+		p.nextCallPtr = &f5_<Cgb>::state;
 
 		do {
-			if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
-				return StartWindowDraw::f0(p);
+			if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq<Cgb>(p))
+				return StartWindowDraw::f0<Cgb>(p);
 
 			if (p.spriteList[p.nextSprite].spx == p.xpos) {
-				if (lcdcObjEn(p) | p.cgb) {
+				if (lcdcObjEn(p) | Cgb) {
 					p.currentSprite = p.nextSprite;
-					return LoadSprites::f0(p);
+					return LoadSprites::f0<Cgb>(p);
 				}
 
 				do {
@@ -1116,13 +1165,13 @@ namespace Tile {
 				} while (p.spriteList[p.nextSprite].spx == p.xpos);
 			}
 
-			plotPixel(p);
+			plotPixel<Cgb>(p);
 
 			if (p.xpos == endx) {
 				if (endx < 168) {
-					nextCall(1, f0_, p);
+					nextCall(1, f0_<Cgb>::state, p);
 				} else
-					xpos168(p);
+					xpos168<Cgb>(p);
 
 				return;
 			}
@@ -1133,33 +1182,37 @@ namespace Tile {
 } // namespace M3Loop
 
 namespace M2_Ly0 {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, unsigned winDrawState,
 	                                          int targetxpos, unsigned cycles);
 }
 
 namespace M2_LyNon0 {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, unsigned winDrawState,
 	                                          int targetxpos, unsigned cycles);
 }
 
 namespace M3Loop {
 
+template<bool Cgb>
 static unsigned predictCyclesUntilXposNextLine(
 		PPUPriv const &p, unsigned winDrawState, int const targetx) {
-	if (p.wx == 166 && !p.cgb && p.xpos < 167
+	if (p.wx == 166 && !Cgb && p.xpos < 167
 			&& (p.weMaster || (p.wy2 == p.lyCounter.ly() && lcdcWinEn(p)))) {
 		winDrawState = win_draw_start | (lcdcWinEn(p) ? win_draw_started : 0);
 	}
 
-   unsigned is_doublespeed = (unsigned)p.lyCounter.isDoubleSpeed();
-	unsigned const cycles   = (nextM2Time(p) - p.now) >> is_doublespeed;
+   unsigned is_doublespeed = doubleSpeed<Cgb>(p);
+	unsigned const cycles   = (nextM2Time<Cgb>(p) - p.now) >> is_doublespeed;
 
 	return p.lyCounter.ly() == 143
-	     ?    M2_Ly0::predictCyclesUntilXpos_f0(p, winDrawState, targetx, cycles)
-	     : M2_LyNon0::predictCyclesUntilXpos_f0(p, winDrawState, targetx, cycles);
+	     ?    M2_Ly0::predictCyclesUntilXpos_f0<Cgb>(p, winDrawState, targetx, cycles)
+	     : M2_LyNon0::predictCyclesUntilXpos_f0<Cgb>(p, winDrawState, targetx, cycles);
 }
 
 namespace StartWindowDraw {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_fn(PPUPriv const &p, int xpos,
 		int endx, unsigned ly, unsigned nextSprite, bool weMaster,
 		unsigned winDrawState, int fno, int targetx, unsigned cycles);
@@ -1190,18 +1243,19 @@ namespace Tile {
 		return nextSprite;
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_fn(PPUPriv const &p, int const xpos,
 			int const endx, unsigned const ly, unsigned const nextSprite,
 			bool const weMaster, unsigned char winDrawState, int const fno,
 			int const targetx, unsigned cycles) {
 		if ((winDrawState & win_draw_start)
-				&& handleWinDrawStartReq(p, xpos, winDrawState)) {
-			return StartWindowDraw::predictCyclesUntilXpos_fn(p, xpos, endx,
+				&& handleWinDrawStartReq<Cgb>(p, xpos, winDrawState)) {
+			return StartWindowDraw::predictCyclesUntilXpos_fn<Cgb>(p, xpos, endx,
 				ly, nextSprite, weMaster, winDrawState, 0, targetx, cycles);
 		}
 
 		if (xpos > targetx)
-			return predictCyclesUntilXposNextLine(p, winDrawState, targetx);
+			return predictCyclesUntilXposNextLine<Cgb>(p, winDrawState, targetx);
 
 		enum { NO_TILE_NUMBER = 1 }; // low bit set, so it will never be equal to an actual tile number.
 
@@ -1211,12 +1265,12 @@ namespace Tile {
 		if (p.wx - unsigned(xpos) < targetx - unsigned(xpos)
 				&& lcdcWinEn(p) && (weMaster || p.wy2 == ly)
 				&& !(winDrawState & win_draw_started)
-				&& (p.cgb || p.wx != 166)) {
+				&& (Cgb || p.wx != 166)) {
 			nwx = p.wx;
 			cycles += 6;
 		}
 
-		if (lcdcObjEn(p) | p.cgb) {
+		if (lcdcObjEn(p) | Cgb) {
 			unsigned char const *sprite = p.spriteMapper.sprites(ly);
 			unsigned char const *const spriteEnd = sprite + p.spriteMapper.numSprites(ly);
 			sprite += nextSprite;
@@ -1248,45 +1302,53 @@ namespace Tile {
 		return cycles;
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_fn(PPUPriv const &p,
 			int endx, int fno, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.xpos, endx, p.lyCounter.ly(),
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.xpos, endx, p.lyCounter.ly(),
 			p.nextSprite, p.weMaster, p.winDrawState, fno, targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.xpos < 160 ? p.xpos + 8 : 168, 0, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.xpos < 160 ? p.xpos + 8 : 168, 0, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 1, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 1, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f2(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 2, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 2, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f3(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 3, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 3, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f4(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 4, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 4, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f5(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 5, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 5, targetx, cycles);
 	}
 }
 
 namespace StartWindowDraw {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_fn(PPUPriv const &p, int xpos,
 			int const endx, unsigned const ly, unsigned const nextSprite, bool const weMaster,
 			unsigned const winDrawState, int const fno, int const targetx, unsigned cycles) {
 		if (xpos > targetx)
-			return predictCyclesUntilXposNextLine(p, winDrawState, targetx);
+			return predictCyclesUntilXposNextLine<Cgb>(p, winDrawState, targetx);
 
 		unsigned cinc = 6 - fno;
 
-		if (!lcdcWinEn(p) && p.cgb) {
+		if (!lcdcWinEn(p) && Cgb) {
 			unsigned xinc = std::min<int>(cinc, std::min(endx, targetx + 1) - xpos);
 
-			if ((lcdcObjEn(p) | p.cgb) && p.spriteList[nextSprite].spx < xpos + xinc) {
+			if ((lcdcObjEn(p) | Cgb) && p.spriteList[nextSprite].spx < xpos + xinc) {
 				xpos = p.spriteList[nextSprite].spx;
 			} else {
 				cinc = xinc;
@@ -1297,145 +1359,169 @@ namespace StartWindowDraw {
 		cycles += cinc;
 
 		if (xpos <= targetx) {
-			return Tile::predictCyclesUntilXpos_fn(p, xpos, xpos < 160 ? xpos + 8 : 168,
+			return Tile::predictCyclesUntilXpos_fn<Cgb>(p, xpos, xpos < 160 ? xpos + 8 : 168,
 				ly, nextSprite, weMaster, winDrawState, 0, targetx, cycles);
 		}
 
 		return cycles - 1;
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_fn(PPUPriv const &p,
 			int endx, int fno, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.xpos, endx, p.lyCounter.ly(),
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.xpos, endx, p.lyCounter.ly(),
 			p.nextSprite, p.weMaster, p.winDrawState, fno, targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, int targetx, unsigned cycles) {
 		int endx = p.xpos == p.endx
 		         ? (p.xpos < 160 ? p.xpos + 8 : 168)
 		         : p.endx;
-		return predictCyclesUntilXpos_fn(p, endx, 0, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, endx, 0, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 1, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 1, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f2(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 2, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 2, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f3(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 3, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 3, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f4(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 4, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 4, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f5(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, p.endx, 5, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, p.endx, 5, targetx, cycles);
 	}
 }
 
 namespace LoadSprites {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_fn(PPUPriv const &p,
 			int const fno, int const targetx, unsigned cycles)
    {
 		unsigned nextSprite = p.nextSprite;
-		if (lcdcObjEn(p) | p.cgb)
+		if (lcdcObjEn(p) | Cgb)
       {
 			cycles += 6 - fno;
 			nextSprite += 1;
 		}
 
-		return Tile::predictCyclesUntilXpos_fn(p, p.xpos, p.endx, p.lyCounter.ly(),
+		return Tile::predictCyclesUntilXpos_fn<Cgb>(p, p.xpos, p.endx, p.lyCounter.ly(),
 			nextSprite, p.weMaster, p.winDrawState, 5, targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, 0, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, 0, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, 1, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, 1, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f2(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, 2, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, 2, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f3(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, 3, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, 3, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f4(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, 4, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, 4, targetx, cycles);
 	}
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f5(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_fn(p, 5, targetx, cycles);
+		return predictCyclesUntilXpos_fn<Cgb>(p, 5, targetx, cycles);
 	}
 }
 
 } // namespace M3Loop
 
 namespace M3Start {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, unsigned xpos, unsigned ly,
 			bool weMaster, unsigned winDrawState, int targetx, unsigned cycles) {
-		cycles += std::min(unsigned(p.scx - xpos) & 7, max_m3start_cycles - xpos) + 1 - p.cgb;
-		return M3Loop::Tile::predictCyclesUntilXpos_fn(p, 0, 8 - (p.scx & 7), ly, 0,
+		cycles += std::min(unsigned(p.scx - xpos) & 7, max_m3start_cycles - xpos) + 1 - Cgb;
+		return M3Loop::Tile::predictCyclesUntilXpos_fn<Cgb>(p, 0, 8 - (p.scx & 7), ly, 0,
 			weMaster, winDrawState, std::min(p.scx & 7, 5), targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, unsigned ly,
 			bool weMaster, unsigned winDrawState, int targetx, unsigned cycles) {
 		winDrawState = (winDrawState & win_draw_start) && lcdcWinEn(p) ? win_draw_started : 0;
-		return predictCyclesUntilXpos_f1(p, 0, ly, weMaster, winDrawState, targetx, cycles);
+		return predictCyclesUntilXpos_f1<Cgb>(p, 0, ly, weMaster, winDrawState, targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, int targetx, unsigned cycles) {
 		unsigned ly = p.lyCounter.ly() + (p.lyCounter.time() - p.now < 16);
-		return predictCyclesUntilXpos_f0(p, ly, p.weMaster, p.winDrawState, targetx, cycles);
+		return predictCyclesUntilXpos_f0<Cgb>(p, ly, p.weMaster, p.winDrawState, targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_f1(p, p.xpos, p.lyCounter.ly(), p.weMaster,
+		return predictCyclesUntilXpos_f1<Cgb>(p, p.xpos, p.lyCounter.ly(), p.weMaster,
 		                                 p.winDrawState, targetx, cycles);
 	}
 }
 
 namespace M2_Ly0 {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p,
 			unsigned winDrawState, int targetx, unsigned cycles) {
 		bool weMaster = lcdcWinEn(p) && 0 == p.wy;
 		unsigned ly = 0;
 
-		return M3Start::predictCyclesUntilXpos_f0(p, ly, weMaster,
-			winDrawState, targetx, cycles + m3StartLineCycle(p.cgb));
+		return M3Start::predictCyclesUntilXpos_f0<Cgb>(p, ly, weMaster,
+			winDrawState, targetx, cycles + m3StartLineCycle(Cgb));
 
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_f0(p, p.winDrawState, targetx, cycles);
+		return predictCyclesUntilXpos_f0<Cgb>(p, p.winDrawState, targetx, cycles);
 	}
 }
 
 namespace M2_LyNon0 {
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, bool weMaster,
 			unsigned winDrawState, int targetx, unsigned cycles) {
 		unsigned ly = p.lyCounter.ly() + 1;
 		weMaster |= lcdcWinEn(p) && ly == p.wy;
 
-		return M3Start::predictCyclesUntilXpos_f0(p, ly, weMaster, winDrawState, targetx,
-			cycles + 456 - weMasterCheckAfterLyIncLineCycle(p.cgb) + m3StartLineCycle(p.cgb));
+		return M3Start::predictCyclesUntilXpos_f0<Cgb>(p, ly, weMaster, winDrawState, targetx,
+			cycles + 456 - weMasterCheckAfterLyIncLineCycle(Cgb) + m3StartLineCycle(Cgb));
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f1(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_f1(p, p.weMaster, p.winDrawState, targetx, cycles);
+		return predictCyclesUntilXpos_f1<Cgb>(p, p.weMaster, p.winDrawState, targetx, cycles);
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p,
 			unsigned winDrawState, int targetx, unsigned cycles) {
 		bool weMaster = p.weMaster || (lcdcWinEn(p) && p.lyCounter.ly() == p.wy);
 
-		return predictCyclesUntilXpos_f1(p, weMaster, winDrawState, targetx,
-			cycles + weMasterCheckAfterLyIncLineCycle(p.cgb)
-			       - weMasterCheckPriorToLyIncLineCycle(p.cgb));
+		return predictCyclesUntilXpos_f1<Cgb>(p, weMaster, winDrawState, targetx,
+			cycles + weMasterCheckAfterLyIncLineCycle(Cgb)
+			       - weMasterCheckPriorToLyIncLineCycle(Cgb));
 	}
 
+	template<bool Cgb>
 	static unsigned predictCyclesUntilXpos_f0(PPUPriv const &p, int targetx, unsigned cycles) {
-		return predictCyclesUntilXpos_f0(p, p.winDrawState, targetx, cycles);
+		return predictCyclesUntilXpos_f0<Cgb>(p, p.winDrawState, targetx, cycles);
 	}
 }
 
@@ -1447,7 +1533,7 @@ PPUPriv::PPUPriv(NextM0Time &nextM0Time, unsigned char const *const oamram, unsi
 : nextSprite(0)
 , currentSprite(0xFF)
 , vram(vram)
-, nextCallPtr(&M2_Ly0::f0_)
+, nextCallPtr(&M2_Ly0::f0_<false>::state)
 , now(0)
 , lastM0Time(0)
 , cycles(-4396)
@@ -1539,28 +1625,29 @@ struct CycleState {
 	operator long() const { return cycle; }
 };
 
+template<bool Cgb>
 static PPUState const * decodeM3LoopState(unsigned state) {
 	switch (state) {
-	case M3Loop::Tile::ID0: return &M3Loop::Tile::f0_;
-	case M3Loop::Tile::ID1: return &M3Loop::Tile::f1_;
-	case M3Loop::Tile::ID2: return &M3Loop::Tile::f2_;
-	case M3Loop::Tile::ID3: return &M3Loop::Tile::f3_;
-	case M3Loop::Tile::ID4: return &M3Loop::Tile::f4_;
-	case M3Loop::Tile::ID5: return &M3Loop::Tile::f5_;
-
-	case M3Loop::LoadSprites::ID0: return &M3Loop::LoadSprites::f0_;
-	case M3Loop::LoadSprites::ID1: return &M3Loop::LoadSprites::f1_;
-	case M3Loop::LoadSprites::ID2: return &M3Loop::LoadSprites::f2_;
-	case M3Loop::LoadSprites::ID3: return &M3Loop::LoadSprites::f3_;
-	case M3Loop::LoadSprites::ID4: return &M3Loop::LoadSprites::f4_;
-	case M3Loop::LoadSprites::ID5: return &M3Loop::LoadSprites::f5_;
-
-	case M3Loop::StartWindowDraw::ID0: return &M3Loop::StartWindowDraw::f0_;
-	case M3Loop::StartWindowDraw::ID1: return &M3Loop::StartWindowDraw::f1_;
-	case M3Loop::StartWindowDraw::ID2: return &M3Loop::StartWindowDraw::f2_;
-	case M3Loop::StartWindowDraw::ID3: return &M3Loop::StartWindowDraw::f3_;
-	case M3Loop::StartWindowDraw::ID4: return &M3Loop::StartWindowDraw::f4_;
-	case M3Loop::StartWindowDraw::ID5: return &M3Loop::StartWindowDraw::f5_;
+	case M3Loop::Tile::ID0: return &M3Loop::Tile::f0_<Cgb>::state;
+	case M3Loop::Tile::ID1: return &M3Loop::Tile::f1_<Cgb>::state;
+	case M3Loop::Tile::ID2: return &M3Loop::Tile::f2_<Cgb>::state;
+	case M3Loop::Tile::ID3: return &M3Loop::Tile::f3_<Cgb>::state;
+	case M3Loop::Tile::ID4: return &M3Loop::Tile::f4_<Cgb>::state;
+	case M3Loop::Tile::ID5: return &M3Loop::Tile::f5_<Cgb>::state;
+
+	case M3Loop::LoadSprites::ID0: return &M3Loop::LoadSprites::f0_<Cgb>::state;
+	case M3Loop::LoadSprites::ID1: return &M3Loop::LoadSprites::f1_<Cgb>::state;
+	case M3Loop::LoadSprites::ID2: return &M3Loop::LoadSprites::f2_<Cgb>::state;
+	case M3Loop::LoadSprites::ID3: return &M3Loop::LoadSprites::f3_<Cgb>::state;
+	case M3Loop::LoadSprites::ID4: return &M3Loop::LoadSprites::f4_<Cgb>::state;
+	case M3Loop::LoadSprites::ID5: return &M3Loop::LoadSprites::f5_<Cgb>::state;
+
+	case M3Loop::StartWindowDraw::ID0: return &M3Loop::StartWindowDraw::f0_<Cgb>::state;
+	case M3Loop::StartWindowDraw::ID1: return &M3Loop::StartWindowDraw::f1_<Cgb>::state;
+	case M3Loop::StartWindowDraw::ID2: return &M3Loop::StartWindowDraw::f2_<Cgb>::state;
+	case M3Loop::StartWindowDraw::ID3: return &M3Loop::StartWindowDraw::f3_<Cgb>::state;
+	case M3Loop::StartWindowDraw::ID4: return &M3Loop::StartWindowDraw::f4_<Cgb>::state;
+	case M3Loop::StartWindowDraw::ID5: return &M3Loop::StartWindowDraw::f5_<Cgb>::state;
 	}
 
 	return 0;
@@ -1574,6 +1661,40 @@ static long cyclesUntilM0Upperbound(PPUPriv const &p) {
 	return cycles;
 }
 
+template<bool Cgb>
+static void loadStateCall(PPUPriv &p, unsigned const state,
+		long const videoCycles, long const vcycs, long const lineCycles) {
+	PPUState const *const m3loopState = decodeM3LoopState<Cgb>(state);
+
+	if (m3loopState && videoCycles < 144 * 456L && p.xpos < 168
+			&& lineCycles + cyclesUntilM0Upperbound(p) < weMasterCheckPriorToLyIncLineCycle(Cgb)) {
+		p.nextCallPtr = m3loopState;
+		p.cycles = -1;
+	} else if (vcycs < 143 * 456L + static_cast<long>(m3StartLineCycle(Cgb)) + max_m3start_cycles) {
+		CycleState const lineCycleStates[] = {
+			{   &M3Start::f0_<Cgb>::state, m3StartLineCycle(Cgb) },
+			{   &M3Start::f1_<Cgb>::state, m3StartLineCycle(Cgb) + max_m3start_cycles },
+			{ &M2_LyNon0::f0_<Cgb>::state, weMasterCheckPriorToLyIncLineCycle(Cgb) },
+			{ &M2_LyNon0::f1_<Cgb>::state, weMasterCheckAfterLyIncLineCycle(Cgb) },
+			{   &M3Start::f0_<Cgb>::state, m3StartLineCycle(Cgb) + 456 }
+		};
+
+		std::size_t const pos =
+			upperBound<sizeof lineCycleStates / sizeof *lineCycleStates - 1>(lineCycleStates, lineCycles);
+
+		p.cycles = lineCycles - lineCycleStates[pos].cycle;
+		p.nextCallPtr = lineCycleStates[pos].state;
+
+		if (&M3Start::f1_<Cgb>::state == lineCycleStates[pos].state) {
+			p.xpos   = lineCycles - m3StartLineCycle(Cgb) + 1;
+			p.cycles = -1;
+		}
+	} else {
+		p.cycles = vcycs - 70224;
+		p.nextCallPtr = &M2_Ly0::f0_<Cgb>::state;
+	}
+}
+
 static void loadSpriteList(PPUPriv &p, SaveState const &ss) {
 	if (ss.ppu.videoCycles < 144 * 456UL && ss.ppu.xpos < 168) {
 		unsigned const ly = ss.ppu.videoCycles / 456;
@@ -1605,8 +1726,6 @@ static void loadSpriteList(PPUPriv &p, SaveState const &ss) {
 }
 
 void PPU::loadState(SaveState const &ss, unsigned char const *const oamram) {
-	PPUState const *
-      const m3loopState   = decodeM3LoopState(ss.ppu.state);
 	long const videoCycles = std::min(ss.ppu.videoCycles, 70223UL);
 	bool const ds          = p_.cgb & ss.mem.ioamhram.get()[0x14D] >> 7;
 	long const vcycs       = videoCycles - ds * m2_ds_offset < 0
@@ -1641,41 +1760,52 @@ void PPU::loadState(SaveState const &ss, unsigned char const *const oamram) {
 	p_.lastM0Time = p_.now - ss.ppu.lastM0Time;
 	loadSpriteList(p_, ss);
 
-	if (m3loopState && videoCycles < 144 * 456L && p_.xpos < 168
-			&& lineCycles + cyclesUntilM0Upperbound(p_) < weMasterCheckPriorToLyIncLineCycle(p_.cgb)) {
-		p_.nextCallPtr = m3loopState;
-		p_.cycles = -1;
-	} else if (vcycs < 143 * 456L + static_cast<long>(m3StartLineCycle(p_.cgb)) + max_m3start_cycles) {
-		CycleState const lineCycleStates[] = {
-			{   &M3Start::f0_, m3StartLineCycle(p_.cgb) },
-			{   &M3Start::f1_, m3StartLineCycle(p_.cgb) + max_m3start_cycles },
-			{ &M2_LyNon0::f0_, weMasterCheckPriorToLyIncLineCycle(p_.cgb) },
-			{ &M2_LyNon0::f1_, weMasterCheckAfterLyIncLineCycle(p_.cgb) },
-			{   &M3Start::f0_, m3StartLineCycle(p_.cgb) + 456 }
-		};
-
-		std::size_t const pos =
-			upperBound<sizeof lineCycleStates / sizeof *lineCycleStates - 1>(lineCycleStates, lineCycles);
-
-		p_.cycles = lineCycles - lineCycleStates[pos].cycle;
-		p_.nextCallPtr = lineCycleStates[pos].state;
-
-		if (&M3Start::f1_ == lineCycleStates[pos].state) {
-			p_.xpos   = lineCycles - m3StartLineCycle(p_.cgb) + 1;
-			p_.cycles = -1;
-		}
-	} else {
-		p_.cycles = vcycs - 70224;
-		p_.nextCallPtr = &M2_Ly0::f0_;
-	}
+	if (p_.cgb)
+		loadStateCall<true>(p_, ss.ppu.state, videoCycles, vcycs, lineCycles);
+	else
+		loadStateCall<false>(p_, ss.ppu.state, videoCycles, vcycs, lineCycles);
 }
 
 void PPU::reset(unsigned char const *oamram, unsigned char const *vram, bool cgb) {
 	p_.vram = vram;
 	p_.cgb = cgb;
+	p_.nextCallPtr = cgb ? &M2_Ly0::f0_<true>::state : &M2_Ly0::f0_<false>::state;
 	p_.spriteMapper.reset(oamram, cgb);
 }
 
+#ifdef HAVE_BENCHMARK
+void PPU::drawBenchmarkLine(unsigned const lcdc) {
+	// sprite list of line 0 as set up by M3Start, with enough cycles
+	// left that the full tile loop draws the whole line in one go
+	unsigned const numSprites = p_.spriteMapper.numSprites(0);
+	unsigned char const *const sprites = p_.spriteMapper.sprites(0);
+
+	for (unsigned i = 0; i < numSprites; ++i) {
+		unsigned pos = sprites[i];
+
+		p_.spriteList[i].spx    = p_.spriteMapper.posbuf()[pos+1];
+		p_.spriteList[i].line   = 16u - p_.spriteMapper.posbuf()[pos];
+		p_.spriteList[i].oampos = pos * 2;
+		p_.spwordList[i] = 0;
+	}
+
+	p_.spriteList[numSprites].spx = 0xFF;
+	p_.nextSprite = 0;
+	p_.lcdc = lcdc;
+	p_.wx = 0xFF;
+	p_.winDrawState = 0;
+	p_.xpos = 0;
+	p_.ntileword = 0;
+	p_.cycles = 456;
+	p_.framebuf.setFbline(0);
+
+	if (p_.cgb)
+		M3Loop::doFullTiles<true>(p_);
+	else
+		M3Loop::doFullTiles<false>(p_);
+}
+#endif
+
 void PPU::resetCc(unsigned long const oldCc, unsigned long const newCc) {
 	unsigned long const dec = oldCc - newCc;
 	unsigned long const videoCycles = lcdcEn(p_) ? p_.lyCounter.frameCycles(p_.now) : 0;
@@ -1696,7 +1826,8 @@ void PPU::speedChange(unsigned long const cycleCounter)
 	p_.lyCounter.reset(videoCycles, p_.now);
 	p_.spriteMapper.postSpeedChange(cycleCounter);
 
-	if (&M2_Ly0::f0_ == p_.nextCallPtr || &M2_LyNon0::f0_ == p_.nextCallPtr) {
+	// Only the CGB has a double speed mode to change to
+	if (&M2_Ly0::f0_<true>::state == p_.nextCallPtr || &M2_LyNon0::f0_<true>::state == p_.nextCallPtr) {
 		if ((bool)is_doublespeed)
 			p_.cycles -= m2_ds_offset;
       else
@@ -1717,7 +1848,7 @@ void PPU::setLcdc(unsigned const lcdc, unsigned long const cc) {
 		p_.spriteMapper.enableDisplay(cc);
 		p_.weMaster = (lcdc & lcdc_we) && 0 == p_.wy;
 		p_.winDrawState = 0;
-		p_.nextCallPtr = &M3Start::f0_;
+		p_.nextCallPtr = p_.cgb ? &M3Start::f0_<true>::state : &M3Start::f0_<false>::state;
 		p_.cycles = -int(m3StartLineCycle(p_.cgb) + m2_ds_offset * p_.lyCounter.isDoubleSpeed());
 	} else if ((p_.lcdc ^ lcdc) & lcdc_we) {
 		if (!(lcdc & lcdc_we)) {
@@ -28,21 +28,39 @@
 
 namespace gambatte {
 
+// The frame buffer holds pixels in the format set with setFormat, as
+// Pixel*::pixel_t. Only the storage size matters here; colours come
+// packed from the palettes.
 class PPUFrameBuf {
 public:
-	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), pitch_(0) {}
-	video_pixel_t * fb() const { return buf_; }
-	video_pixel_t * fbline() const { return fbline_; }
+	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), pitch_(0), format_(PIXEL_RGB565) {}
+	void * fb() const { return buf_; }
+	template<class Pixel> Pixel * fbline() const { return static_cast<Pixel *>(fbline_); }
 	std::ptrdiff_t pitch() const { return pitch_; }
-	void setBuf(video_pixel_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
-	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline(); }
+	PixelFormat format() const { return format_; }
+	bool wide() const { return format_ == PIXEL_XRGB8888; }
+	void setBuf(void *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
+	void setFormat(PixelFormat format) { format_ = format; }
+	void setFbline(unsigned ly) {
+		fbline_ = buf_
+		        ? static_cast<char *>(buf_) + std::ptrdiff_t(ly) * pitch_ * pixelSize(format_)
+		        : nullfbline();
+	}
+
+	void setPixel(int x, video_pixel_t pixel) const {
+		if (wide())
+			fbline<PixelXrgb8888::pixel_t>()[x] = pixel;
+		else
+			fbline<PixelRgb565::pixel_t>()[x] = pixel;
+	}
 
 private:
-	video_pixel_t *buf_;
-	video_pixel_t *fbline_;
+	void *buf_;
+	void *fbline_;
 	std::ptrdiff_t pitch_;
+	PixelFormat format_;
 
-	static video_pixel_t * nullfbline() { static video_pixel_t nullfbline_[160]; return nullfbline_; }
+	static void * nullfbline() { static PixelXrgb8888::pixel_t nullfbline_[160]; return nullfbline_; }
 };
 
 struct PPUPriv;
@@ -128,7 +146,8 @@ public:
 	void reset(unsigned char const *oamram, unsigned char const *vram, bool cgb);
 	void resetCc(unsigned long oldCc, unsigned long newCc);
 	void saveState(SaveState &ss) const;
-	void setFrameBuf(video_pixel_t *buf, std::ptrdiff_t pitch) { p_.framebuf.setBuf(buf, pitch); }
+	void setFrameBuf(void *buf, std::ptrdiff_t pitch) { p_.framebuf.setBuf(buf, pitch); }
+	void setPixelFormat(PixelFormat format) { p_.framebuf.setFormat(format); }
 	void setLcdc(unsigned lcdc, unsigned long cc);
 	void setScx(unsigned scx) { p_.scx = scx; }
 	void setScy(unsigned scy) { p_.scy = scy; }
@@ -139,6 +158,11 @@ public:
 	void speedChange(unsigned long cycleCounter);
 	video_pixel_t * spPalette() { return p_.spPalette; }
 	void update(unsigned long cc);
+#ifdef HAVE_BENCHMARK
+	// Draws line 0 with the full tile loop, from the current VRAM, OAM,
+	// palettes and scroll, for the kernel benchmarks
+	void drawBenchmarkLine(unsigned lcdc);
+#endif
 
 private:
 	PPUPriv p_;
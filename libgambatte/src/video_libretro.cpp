@@ -77,34 +77,39 @@ namespace gambatte
       refreshPalettes();
    }
 
+   void LCD::setPixelFormat(PixelFormat pixelFormat_)
+   {
+      pixelFormat = pixelFormat_;
+      ppu_.setPixelFormat(pixelFormat);
+      setDefaultDmgColors();
+      refreshPalettes();
+   }
+
+   void LCD::setDefaultDmgColors()
+   {
+      // White, light grey, dark grey and black, in each pixel format
+      static const video_pixel_t dmgColors[3][4] = {
+         { 0xFFFF,   0xAD55,   0x52AA,   0x0000 }, // RGB565
+         { 0xEFFF,   0x56B5,   0x294A,   0x0000 }, // ABGR1555
+         { 0xFFFFFF, 0xAAAAAA, 0x555555, 0x0000 }  // XRGB8888
+      };
+
+      for (std::size_t i = 0; i < sizeof(dmgColorsRgb32_) / sizeof(dmgColorsRgb32_[0]); ++i)
+         setDmgPaletteColor(i, dmgColors[pixelFormat][i & 3]);
+   }
+
    LCD::LCD(const unsigned char *const oamram, const unsigned char *const vram, const VideoInterruptRequester memEventRequester) :
       ppu_(nextM0Time_, oamram, vram),
       eventTimes_(memEventRequester),
       statReg_(0),
       m2IrqStatReg_(0),
-      m1IrqStatReg_(0)
+      m1IrqStatReg_(0),
+      pixelFormat(PIXEL_RGB565)
    {
       std::memset( bgpData_, 0, sizeof  bgpData_);
       std::memset(objpData_, 0, sizeof objpData_);
 
-      for (std::size_t i = 0; i < sizeof(dmgColorsRgb32_) / sizeof(dmgColorsRgb32_[0]); ++i)
-      {
-#ifdef VIDEO_RGB565
-         uint16_t dmgColors[4]={0xFFFF, //11111 111111 11111
-            0xAD55, //10101 101010 10101
-            0x52AA, //01010 010101 01010
-            0x0000};//00000 000000 00000
-         setDmgPaletteColor(i, dmgColors[i&3]);
-#elif defined(VIDEO_ABGR1555)
-         uint16_t dmgColors[4]={0xEFFF, //11111 111111 11111
-            0x56B5, //10101 10101 10101
-            0x294A, //01010 01010 01010
-            0x0000};//00000 000000 00000
-         setDmgPaletteColor(i, dmgColors[i&3]);
-#else
-         setDmgPaletteColor(i, (3 - (i & 3)) * 85 * 0x010101);
-#endif
-      }
+      setDefaultDmgColors();
 
       reset(oamram, vram, false);
       setVideoBuffer(0, 160);
@@ -120,12 +125,13 @@ namespace gambatte
       palette[index] = gbcToRgb32(pdata[index << 1] | pdata[(index << 1) + 1] << 8);
    }
 
-   void LCD::setVideoBuffer(video_pixel_t *const videoBuf, const int pitch)
+   void LCD::setVideoBuffer(void *const videoBuf, const int pitch)
    {
       ppu_.setFrameBuf(videoBuf, pitch);
    }
 
-   static void clear(video_pixel_t *buf, const unsigned long color, const int dpitch)
+   template<class Pixel>
+   static void clear(Pixel *buf, const unsigned long color, const int dpitch)
    {
       unsigned lines = 144;
 
@@ -152,7 +158,11 @@ namespace gambatte
       if (blanklcd && ppu_.frameBuf().fb())
       {
          const video_pixel_t color = ppu_.cgb() ? gbcToRgb32(0xFFFF) : dmgColorsRgb32_[0];
-         clear(ppu_.frameBuf().fb(), color, ppu_.frameBuf().pitch());
+
+         if (ppu_.frameBuf().wide())
+            clear(static_cast<PixelXrgb8888::pixel_t *>(ppu_.frameBuf().fb()), color, ppu_.frameBuf().pitch());
+         else
+            clear(static_cast<PixelRgb565::pixel_t *>(ppu_.frameBuf().fb()), color, ppu_.frameBuf().pitch());
       }
    }
 
@@ -285,13 +295,15 @@ namespace gambatte
          bFinal = static_cast<unsigned>((bDark * rgbMax) + 0.5) & 0x1F;
       }
       
-#ifdef VIDEO_RGB565
-      return rFinal << 11 | gFinal << 6 | bFinal;
-#elif defined(VIDEO_ABGR1555)
-      return bFinal << 10 | gFinal << 5 | rFinal;
-#else
-      return rFinal << 16 | gFinal << 8 | bFinal;
-#endif
+      switch (pixelFormat)
+      {
+         case PIXEL_ABGR1555:
+            return PixelAbgr1555::fromRgb555(rFinal, gFinal, bFinal);
+         case PIXEL_XRGB8888:
+            return PixelXrgb8888::fromRgb555(rFinal, gFinal, bFinal);
+         default:
+            return PixelRgb565::fromRgb555(rFinal, gFinal, bFinal);
+      }
    }
 
 }